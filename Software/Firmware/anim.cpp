@@ -0,0 +1,104 @@
+#include "anim.h"
+#include "profiler.h"
+
+// ==================== CLOCK ====================
+uint64_t anim_now_us() {
+    return ticker_read_us(get_us_ticker_data());
+}
+
+// ==================== TRACKS ====================
+void anim_start(AnimTrack* t, uint32_t period_ms, uint8_t ease, uint8_t repeat, uint64_t now_us) {
+    t->start_us = now_us;
+    t->period_us = period_ms ? period_ms * 1000 : 1;
+    t->ease = ease;
+    t->repeat = repeat;
+}
+
+uint16_t anim_ease(uint8_t ease, uint16_t x) {
+    uint32_t v = x > ANIM_ONE ? ANIM_ONE : x;
+    uint32_t u = ANIM_ONE - v;
+    switch(ease) {
+    case ANIM_EASE_IN:
+        return (uint16_t)(v * v / ANIM_ONE * v / ANIM_ONE);
+    case ANIM_EASE_OUT:
+        return (uint16_t)(ANIM_ONE - u * u / ANIM_ONE * u / ANIM_ONE);
+    case ANIM_EASE_IN_OUT:
+        return (uint16_t)(v * v / ANIM_ONE * (3 * ANIM_ONE - 2 * v) / ANIM_ONE);
+    default:
+        return (uint16_t)v;
+    }
+}
+
+uint16_t anim_value(const AnimTrack* t, uint64_t now_us, uint32_t delay_us) {
+    uint64_t elapsed = now_us > t->start_us ? now_us - t->start_us : 0;
+    elapsed += delay_us;
+
+    uint32_t x;
+    if(t->repeat == ANIM_ONCE) {
+        x = elapsed >= t->period_us ? ANIM_ONE : (uint32_t)(elapsed * ANIM_ONE / t->period_us);
+    } else {
+        uint32_t into = (uint32_t)(elapsed % t->period_us);
+        x = (uint32_t)((uint64_t)into * ANIM_ONE / t->period_us);
+        if(t->repeat == ANIM_PINGPONG) {
+            x *= 2;
+            if(x > ANIM_ONE) {
+                x = 2 * ANIM_ONE - x;
+            }
+        }
+    }
+    return anim_ease(t->ease, (uint16_t)x);
+}
+
+int32_t anim_lerp(int32_t a, int32_t b, uint16_t v) {
+    return a + (int32_t)(((int64_t)(b - a) * v) / ANIM_ONE);
+}
+
+uint32_t anim_color_lerp(uint32_t a, uint32_t b, uint16_t v) {
+    uint32_t out = 0;
+    for(int shift = 0; shift < 32; shift += 8) {
+        int32_t c = anim_lerp((a >> shift) & 0xFF, (b >> shift) & 0xFF, v);
+        out |= (uint32_t)c << shift;
+    }
+    return out;
+}
+
+// ==================== FRAME PACING ====================
+static AnimStats anim_frame_stats;
+static uint64_t  anim_last_frame_us = 0;
+static bool      anim_resumed = true;
+
+void anim_frame_done(uint64_t now_us, uint32_t cycles) {
+    AnimStats& s = anim_frame_stats;
+    if(!anim_resumed) {
+        uint64_t interval = now_us - anim_last_frame_us;
+        uint32_t us = interval > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (uint32_t)interval;
+        if(us > s.max_interval_us) {
+            s.max_interval_us = us;
+        }
+        if(us > ANIM_LATE_US) {
+            s.late++;
+        }
+    }
+    anim_last_frame_us = now_us;
+    anim_resumed = false;
+    s.frames++;
+    s.cycles += cycles;
+    if(cycles > s.max_cycles) {
+        s.max_cycles = cycles;
+    }
+    if(cycles > ANIM_BUDGET_US * PROF_CYCLES_PER_US) {
+        s.over_budget++;
+    }
+}
+
+void anim_frames_resume() {
+    anim_resumed = true;
+}
+
+AnimStats anim_stats() {
+    return anim_frame_stats;
+}
+
+void anim_stats_reset() {
+    memset(&anim_frame_stats, 0, sizeof(anim_frame_stats));
+}
@@ -0,0 +1,75 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+#include "mbed.h"
+
+// ==================== ANIMATION TIMELINE ====================
+// Screen animation is a function of time, not of a frame counter: each
+// moving thing is a track (start time, period, repeat shape, easing) and
+// its value is worked out from the current time whenever a frame is drawn.
+// A late or dropped frame just shows the next position, nothing jumps when
+// a counter wraps, and the rate the screen is drawn at can change without
+// changing how fast anything moves.
+//
+// The clock is mbed's 64-bit microsecond ticker, which the HAL keeps
+// extended past the 32-bit us_ticker wrap (every ~71.6 minutes) from its
+// own interrupt, however long nothing here reads it. A track started before
+// a standby or another screen resumes in phase.
+// Values are fractions in ANIM_ONE (Q12), integer-only.
+#define ANIM_ONE                4096
+
+#define ANIM_FRAME_US           25000       // Directive screens: 40 frames/s
+#define ANIM_BUDGET_US          4000        // UI CPU per frame before it counts as over
+#define ANIM_LATE_US            (ANIM_FRAME_US * 3 / 2)    // A frame interval this long dropped one
+
+// Easing, applied to a track's 0..ANIM_ONE position
+#define ANIM_EASE_LINEAR        0
+#define ANIM_EASE_IN            1           // Cubic, starts slow
+#define ANIM_EASE_OUT           2           // Cubic, ends slow
+#define ANIM_EASE_IN_OUT        3           // Smoothstep, slow at both ends
+
+// Repeat shape over one period
+#define ANIM_LOOP               0           // 0 -> 1, then again from 0
+#define ANIM_PINGPONG           1           // 0 -> 1 -> 0
+#define ANIM_ONCE               2           // 0 -> 1, then holds 1
+
+struct AnimTrack {
+    uint64_t start_us;
+    uint32_t period_us;
+    uint8_t  ease;
+    uint8_t  repeat;
+};
+
+struct AnimStats {
+    uint32_t frames;            // Frames drawn
+    uint32_t late;              // Intervals over ANIM_LATE_US
+    uint32_t max_interval_us;
+    uint32_t over_budget;       // Frames over ANIM_BUDGET_US of CPU
+    uint64_t cycles;            // Total, at PROF_CPU_HZ
+    uint32_t max_cycles;
+};
+
+// Microseconds since boot; any context
+uint64_t anim_now_us();
+
+void anim_start(AnimTrack* t, uint32_t period_ms, uint8_t ease, uint8_t repeat, uint64_t now_us);
+
+// Eased position at now_us, 0..ANIM_ONE. delay_us runs the track that much
+// ahead, so icons sharing a track can move in sequence.
+uint16_t anim_value(const AnimTrack* t, uint64_t now_us, uint32_t delay_us = 0);
+
+uint16_t anim_ease(uint8_t ease, uint16_t x);
+
+// a + (b - a) * v, and the same per channel of an ARGB8888 colour
+int32_t  anim_lerp(int32_t a, int32_t b, uint16_t v);
+uint32_t anim_color_lerp(uint32_t a, uint32_t b, uint16_t v);
+
+// Frame pacing: called once per frame drawn with when it was drawn and the
+// CPU it took. After anim_frames_resume() (the screen's ticks starting
+// again) the gap before the next frame is not counted as an interval.
+void      anim_frame_done(uint64_t now_us, uint32_t cycles);
+void      anim_frames_resume();
+AnimStats anim_stats();
+void      anim_stats_reset();
+
+#endif
@@ -0,0 +1,347 @@
+#include "audio.h"
+#include "profiler.h"
+#include "stm32746g_discovery_audio.h"
+#include <string.h>
+
+#define AUDIO_CMD_BEEP          0
+#define AUDIO_CMD_PATTERN       1
+#define AUDIO_CMD_SILENCE       2
+
+AudioEngine audio;
+
+// ==================== WAVETABLES ====================
+// One cycle of sine, Q15
+static const int16_t audio_sine[AUDIO_SINE_SIZE] = {
+         0,    804,   1608,   2410,   3212,   4011,   4808,   5602,   6393,   7179,   7962,   8739,
+      9512,  10278,  11039,  11793,  12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+     18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,  23170,  23731,  24279,  24811,
+     25329,  25832,  26319,  26790,  27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+     30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,  32137,  32285,  32412,  32521,
+     32609,  32678,  32728,  32757,  32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+     32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,  30273,  29956,  29621,  29268,
+     28898,  28510,  28105,  27683,  27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+     23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,  18204,  17530,  16846,  16151,
+     15446,  14732,  14010,  13279,  12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+      6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,      0,   -804,  -1608,  -2410,
+     -3212,  -4011,  -4808,  -5602,  -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530, -18204, -18868, -19519, -20159,
+    -20787, -21403, -22005, -22594, -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+    -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956, -30273, -30571, -30852, -31113,
+    -31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285, -32137, -31971, -31785, -31580,
+    -31356, -31113, -30852, -30571, -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+    -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731, -23170, -22594, -22005, -21403,
+    -20787, -20159, -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,  -6393,  -5602,  -4808,  -4011,
+     -3212,  -2410,  -1608,   -804,
+};
+
+// Raised-cosine fade, Q15, 0 to full over AUDIO_RAMP_FRAMES
+static const int16_t audio_ramp[AUDIO_RAMP_FRAMES] = {
+        5,    44,   123,   241,   398,   593,   827,  1098,  1406,  1749,  2128,  2542,
+     2989,  3468,  3978,  4518,  5086,  5682,  6304,  6950,  7618,  8308,  9017,  9744,
+    10487, 11244, 12014, 12794, 13583, 14378, 15178, 15981, 16786, 17589, 18389, 19184,
+    19973, 20753, 21523, 22280, 23023, 23750, 24459, 25149, 25817, 26463, 27085, 27681,
+    28249, 28789, 29299, 29778, 30225, 30639, 31018, 31361, 31669, 31940, 32174, 32369,
+    32526, 32644, 32723, 32762,
+};
+
+// ==================== PATTERNS ====================
+static const AudioStep audio_change_steps[] = {
+    {1200, 1200, 30},
+};
+
+static const AudioStep audio_caution_steps[] = {
+    {1400, 900, 120}, {0, 0, 60}, {1400, 900, 120},
+};
+
+static const AudioStep audio_stop_steps[] = {
+    {2400, 2400, 50}, {0, 0, 30}, {2400, 2400, 50}, {0, 0, 30}, {2400, 2400, 50}, {0, 0, 30},
+    {700, 700, 300},
+};
+
+#define AUDIO_STEPS(a)  a, (uint8_t)(sizeof(a) / sizeof(a[0]))
+
+const AudioPattern audio_patterns[AUDIO_PATTERN_COUNT] = {
+    {"change", AUDIO_STEPS(audio_change_steps)},
+    {"caution", AUDIO_STEPS(audio_caution_steps)},
+    {"stop", AUDIO_STEPS(audio_stop_steps)},
+};
+
+// Phase step per frame for hz, Q32 turns
+static uint32_t audio_step(uint16_t hz) {
+    if(hz >= AUDIO_RATE_HZ / 2) {
+        hz = AUDIO_RATE_HZ / 2 - 1;
+    }
+    return (uint32_t)(((uint64_t)hz << 32) / AUDIO_RATE_HZ);
+}
+
+// ==================== ENGINE ====================
+AudioEngine::AudioEngine() : _sink(NULL), _paused(false), _head(0), _tail(0) {
+    memset(_voices, 0, sizeof(_voices));
+    memset(&_stats, 0, sizeof(_stats));
+    memset(_buffer, 0, sizeof(_buffer));
+    _silent[0] = _silent[1] = true;
+}
+
+bool AudioEngine::start(AudioSink* sink) {
+    memset(_voices, 0, sizeof(_voices));
+    memset(&_stats, 0, sizeof(_stats));
+    memset(_buffer, 0, sizeof(_buffer));
+    _silent[0] = _silent[1] = true;
+    _head = _tail = 0;
+    _sink = sink;
+    _paused = false;
+    if(!_sink->start(this)) {
+        _sink = NULL;
+        return false;
+    }
+    return true;
+}
+
+void AudioEngine::stop() {
+    if(_sink == NULL) {
+        return;
+    }
+    if(!_paused) {
+        _sink->stop();
+    }
+    _paused = false;
+    _sink = NULL;
+}
+
+// Nothing is sounding after a standby's idle period, so the voices and the
+// buffer start over on resume
+void AudioEngine::pause() {
+    if(_sink == NULL || _paused) {
+        return;
+    }
+    _sink->stop();
+    _paused = true;
+    memset(_voices, 0, sizeof(_voices));
+    memset(_buffer, 0, sizeof(_buffer));
+    _silent[0] = _silent[1] = true;
+}
+
+bool AudioEngine::resume() {
+    if(!_paused) {
+        return true;        // Not paused, or never started
+    }
+    _paused = false;
+    if(!_sink->start(this)) {
+        _sink = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool AudioEngine::beep(uint16_t freq_hz, uint16_t ms) {
+    Command c = {AUDIO_CMD_BEEP, 0, freq_hz, ms};
+    return post(c);
+}
+
+bool AudioEngine::play(uint8_t pattern) {
+    if(pattern >= AUDIO_PATTERN_COUNT) {
+        return false;
+    }
+    Command c = {AUDIO_CMD_PATTERN, pattern, 0, 0};
+    return post(c);
+}
+
+bool AudioEngine::silence() {
+    Command c = {AUDIO_CMD_SILENCE, 0, 0, 0};
+    return post(c);
+}
+
+// Several threads post; fill() is the only reader
+bool AudioEngine::post(const Command& c) {
+    if(_sink == NULL) {
+        return false;
+    }
+    core_util_critical_section_enter();
+    bool room = _head - _tail < AUDIO_QUEUE;
+    if(room) {
+        _queue[_head & (AUDIO_QUEUE - 1)] = c;
+        _head = _head + 1;
+        _stats.commands++;
+    } else {
+        _stats.dropped++;
+    }
+    core_util_critical_section_exit();
+    return room;
+}
+
+bool AudioEngine::active() const {
+    if(_head != _tail) {
+        return true;
+    }
+    for(uint8_t i = 0; i < AUDIO_VOICES; i++) {
+        if(_voices[i].steps != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// fill() context: a command starts on its voice at once
+void AudioEngine::take(const Command& c) {
+    if(c.type == AUDIO_CMD_BEEP) {
+        Voice& v = _voices[AUDIO_VOICE_BEEP];
+        v.single.start_hz = c.freq_hz;
+        v.single.end_hz = c.freq_hz;
+        v.single.ms = c.ms;
+        begin(v, &v.single, c.freq_hz > 0 && c.ms > 0 ? 1 : 0);
+    } else if(c.type == AUDIO_CMD_PATTERN) {
+        const AudioPattern& p = audio_patterns[c.pattern];
+        begin(_voices[AUDIO_VOICE_CUE], p.steps, p.count);
+    } else {
+        for(uint8_t i = 0; i < AUDIO_VOICES; i++) {
+            begin(_voices[i], NULL, 0);
+        }
+    }
+}
+
+void AudioEngine::begin(Voice& v, const AudioStep* steps, uint8_t count) {
+    v.steps = count > 0 ? steps : NULL;
+    v.left = count;
+    v.phase = 0;
+    if(v.steps != NULL) {
+        enter_step(v);
+    }
+}
+
+void AudioEngine::enter_step(Voice& v) {
+    const AudioStep& s = *v.steps;
+    v.frames = (uint32_t)s.ms * AUDIO_RATE_HZ / 1000;
+    if(v.frames == 0) {
+        v.frames = 1;
+    }
+    v.pos = 0;
+    v.rest = (s.start_hz == 0);
+    v.step = audio_step(s.start_hz);
+    int64_t end = audio_step(s.end_hz != 0 ? s.end_hz : s.start_hz);
+    v.sweep = (int32_t)((end - (int64_t)v.step) / (int64_t)v.frames);
+}
+
+// Next sample of one voice, Q15 at AUDIO_LEVEL_Q15
+int32_t AudioEngine::render(Voice& v) {
+    if(v.steps == NULL) {
+        return 0;
+    }
+    int32_t out = 0;
+    if(!v.rest) {
+        // Table read, interpolated on the next 8 bits of phase
+        uint32_t i = v.phase >> 24;
+        int32_t frac = (int32_t)((v.phase >> 16) & 0xFF);
+        int32_t a = audio_sine[i];
+        int32_t b = audio_sine[(i + 1) & (AUDIO_SINE_SIZE - 1)];
+        int32_t s = a + (((b - a) * frac) >> 8);
+
+        int32_t gain = AUDIO_LEVEL_Q15;
+        if(v.pos < AUDIO_RAMP_FRAMES) {
+            gain = (gain * audio_ramp[v.pos]) >> 15;
+        }
+        uint32_t tail = v.frames - 1 - v.pos;
+        if(tail < AUDIO_RAMP_FRAMES) {
+            gain = (gain * audio_ramp[tail]) >> 15;
+        }
+        out = (s * gain) >> 15;
+        v.phase += v.step;
+        v.step += (uint32_t)v.sweep;
+    }
+    if(++v.pos >= v.frames) {
+        v.steps++;
+        if(--v.left == 0) {
+            v.steps = NULL;
+        } else {
+            enter_step(v);
+        }
+    }
+    return out;
+}
+
+bool AudioEngine::fill(uint8_t half) {
+    uint32_t start = prof_cycles();
+    half &= 1;
+    while(_tail != _head) {
+        take(_queue[_tail & (AUDIO_QUEUE - 1)]);
+        _tail = _tail + 1;
+    }
+    _stats.blocks++;
+
+    bool idle = true;
+    for(uint8_t i = 0; i < AUDIO_VOICES; i++) {
+        if(_voices[i].steps != NULL) {
+            idle = false;
+        }
+    }
+    if(idle && _silent[half]) {
+        _stats.silent++;
+        return false;
+    }
+
+    int16_t* out = _buffer[half];
+    if(idle) {
+        memset(out, 0, sizeof(_buffer[0]));
+    } else {
+        for(uint32_t f = 0; f < AUDIO_BLOCK_FRAMES; f++) {
+            int32_t acc = 0;
+            for(uint8_t i = 0; i < AUDIO_VOICES; i++) {
+                acc += render(_voices[i]);
+            }
+            if(acc > 32767) acc = 32767;
+            if(acc < -32768) acc = -32768;
+            out[2 * f] = (int16_t)acc;
+            out[2 * f + 1] = (int16_t)acc;
+        }
+    }
+    _silent[half] = idle;
+
+    uint32_t cycles = prof_cycles() - start;
+    _stats.cycles = cycles;
+    if(cycles > _stats.max_cycles) {
+        _stats.max_cycles = cycles;
+    }
+    return true;
+}
+
+#if defined(TARGET_STM32F7)
+// ==================== SAI2 + DMA SINK ====================
+extern SAI_HandleTypeDef haudio_out_sai;    // The BSP's
+static AudioEngine* audio_active = NULL;
+
+static void audio_dma_irq_handler() {
+    HAL_DMA_IRQHandler(haudio_out_sai.hdmatx);
+}
+
+static void audio_refill(uint8_t half) {
+    if(audio_active != NULL && audio_active->fill(half)) {
+        SCB_CleanDCache_by_Addr((uint32_t*)audio_active->block(half), audio_active->block_bytes());
+    }
+}
+
+extern "C" void BSP_AUDIO_OUT_HalfTransfer_CallBack(void) {
+    audio_refill(0);
+}
+
+extern "C" void BSP_AUDIO_OUT_TransferComplete_CallBack(void) {
+    audio_refill(1);
+}
+
+bool SaiAudioSink::start(AudioEngine* engine) {
+    if(BSP_AUDIO_OUT_Init(OUTPUT_DEVICE_HEADPHONE, AUDIO_VOLUME, AUDIO_RATE_HZ) != AUDIO_OK) {
+        return false;
+    }
+    BSP_AUDIO_OUT_SetAudioFrameSlot(CODEC_AUDIOFRAME_SLOT_02);
+    NVIC_SetVector(AUDIO_OUT_SAIx_DMAx_IRQ, (uint32_t)&audio_dma_irq_handler);
+
+    audio_active = engine;
+    SCB_CleanDCache_by_Addr((uint32_t*)engine->buffer(), engine->buffer_bytes());
+    return BSP_AUDIO_OUT_Play((uint16_t*)engine->buffer(), engine->buffer_bytes()) == AUDIO_OK;
+}
+
+void SaiAudioSink::stop() {
+    BSP_AUDIO_OUT_Stop(CODEC_PDWN_SW);
+    audio_active = NULL;
+}
+#endif
@@ -0,0 +1,163 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include "mbed.h"
+#include <stdint.h>
+
+// ==================== AUDIO ENGINE ====================
+// Operator cues through the Discovery's codec (headphone jack). The codec
+// plays one double buffer in a loop through SAI2 + DMA. Each half-transfer
+// interrupt renders the half the DMA has just left, so the caller never
+// waits: beep() and play() only post a command to a small queue, and the
+// next block picks it up (at most one block, 16 ms, later).
+//
+// Two voices are mixed into each block. The beep voice takes play_beep()
+// and the cue voice takes the patterns; a new command replaces whatever
+// its voice was playing. A voice reads a fixed-point sine table with a
+// 32-bit phase accumulator. A chirp is a linear sweep of the phase step.
+// Every tone fades in and out through a raised-cosine ramp table, so
+// nothing clicks. With both voices idle a block is only rendered until
+// its half is silent, and after that an interrupt costs a few
+// instructions.
+//
+// The sink is the codec on the board. On the host it is a WAV file
+// (sim_wav.h), so the mixer can be heard and checked on Linux.
+#define AUDIO_RATE_HZ           16000
+#define AUDIO_BLOCK_FRAMES      256         // Per DMA half: 16 ms
+#define AUDIO_CHANNELS          2           // Codec slots; every cue is mono
+#define AUDIO_QUEUE             8           // Must be a power of two
+#define AUDIO_SINE_SIZE         256
+#define AUDIO_RAMP_FRAMES       64          // 4 ms fade in and out
+#define AUDIO_LEVEL_Q15         14000       // Per voice; two at full level still fit
+#define AUDIO_VOLUME            70          // Codec output volume, 0..100
+
+#define AUDIO_VOICE_BEEP        0
+#define AUDIO_VOICE_CUE         1
+#define AUDIO_VOICES            2
+
+// Cue patterns
+#define AUDIO_PATTERN_CHANGE    0           // Directive changed
+#define AUDIO_PATTERN_CAUTION   1           // SLOW: two falling chirps
+#define AUDIO_PATTERN_STOP      2           // STOP: rapid high pips, then a low tone
+#define AUDIO_PATTERN_COUNT     3
+#define AUDIO_PATTERN_NONE      255
+
+// One step of a pattern: a tone swept from start_hz to end_hz, or a rest
+// when start_hz is 0
+struct AudioStep {
+    uint16_t start_hz;
+    uint16_t end_hz;
+    uint16_t ms;
+};
+
+struct AudioPattern {
+    const char*      name;
+    const AudioStep* steps;
+    uint8_t          count;
+};
+
+extern const AudioPattern audio_patterns[AUDIO_PATTERN_COUNT];
+
+struct AudioStats {
+    uint32_t blocks;                        // Halves handed to the sink
+    uint32_t silent;                        // ...already silent, not touched
+    uint32_t commands;
+    uint32_t dropped;                       // Queue full
+    uint32_t cycles;                        // Last rendered block, CPU cycles
+    uint32_t max_cycles;
+};
+
+class AudioEngine;
+
+// ==================== SINK INTERFACE ====================
+// Plays the engine's double buffer in a loop, calling fill(0) when the
+// first half has been played and fill(1) for the second
+class AudioSink {
+public:
+    virtual ~AudioSink() {}
+    virtual bool start(AudioEngine* engine) = 0;
+    virtual void stop() = 0;
+};
+
+// ==================== ENGINE ====================
+class AudioEngine {
+public:
+    AudioEngine();
+
+    bool start(AudioSink* sink);
+    void stop();
+
+    // Standby: the sink stops (codec powered down) and restarts on resume.
+    // Commands posted in between wait in the queue. resume() is false only
+    // if the sink fails to restart; the engine is then stopped.
+    void pause();
+    bool resume();
+
+    // Any thread, never blocks. False if stopped or the queue is full.
+    bool beep(uint16_t freq_hz, uint16_t ms);
+    bool play(uint8_t pattern);
+    bool silence();
+
+    // Sink side, interrupt context: renders half 0 or 1. Returns false if
+    // the half was left as it was (still silent).
+    bool fill(uint8_t half);
+
+    int16_t*       buffer() { return &_buffer[0][0]; }
+    const int16_t* block(uint8_t half) const { return _buffer[half & 1]; }
+    uint32_t       buffer_bytes() const { return sizeof(_buffer); }
+    uint32_t       block_bytes() const { return sizeof(_buffer[0]); }
+
+    bool       active() const;              // Anything sounding or queued
+    AudioStats stats() const { return _stats; }
+
+private:
+    struct Command {
+        uint8_t  type;
+        uint8_t  pattern;
+        uint16_t freq_hz;
+        uint16_t ms;
+    };
+
+    struct Voice {
+        const AudioStep* steps;             // Remaining steps, NULL = idle
+        uint8_t          left;
+        AudioStep        single;            // beep() as a one-step pattern
+        uint32_t         phase;             // Q32 turns
+        uint32_t         step;              // Phase step per frame
+        int32_t          sweep;             // Added to step every frame
+        uint32_t         pos;               // Frames into the step
+        uint32_t         frames;            // Step length
+        bool             rest;
+    };
+
+    bool post(const Command& c);
+    void take(const Command& c);
+    void begin(Voice& v, const AudioStep* steps, uint8_t count);
+    void enter_step(Voice& v);
+    int32_t render(Voice& v);
+
+    AudioSink*        _sink;
+    bool              _paused;
+    Command           _queue[AUDIO_QUEUE];
+    volatile uint32_t _head;                // Producers, in a critical section
+    volatile uint32_t _tail;                // fill() only
+    Voice             _voices[AUDIO_VOICES];
+    bool              _silent[2];
+    AudioStats        _stats;
+    int16_t           _buffer[2][AUDIO_BLOCK_FRAMES * AUDIO_CHANNELS] __attribute__((aligned(32)));
+};
+
+extern AudioEngine audio;
+
+#if defined(TARGET_STM32F7)
+// ==================== SAI2 + DMA SINK ====================
+// WM8994 codec through the BSP: SAI2 block A, DMA2 Stream4, circular, with
+// the half and complete callbacks as the two fills
+class SaiAudioSink : public AudioSink {
+public:
+    virtual bool start(AudioEngine* engine);
+    virtual void stop();
+};
+#endif
+
+#endif
@@ -0,0 +1,273 @@
+#include "blackbox.h"
+#include "marshalling.h"
+#include "telemetry.h"
+#include "logger.h"
+#include "memstats.h"
+#include <string.h>
+
+// Block slot in SDRAM: header fields as the writer keeps them (magic and
+// CRC are filled in on export), records after
+struct BlackboxSlot {
+    uint32_t          magic;
+    volatile uint32_t sequence;
+    uint32_t          base_us;
+    volatile uint16_t used;
+    uint16_t          crc;
+};
+
+static bool              bb_recording = false;
+static volatile uint32_t bb_seq = 0;            // Block being written, 0 = none yet
+static BlackboxSlot*     bb_slot = NULL;
+static uint32_t          bb_used = 0;
+static BlackboxCursor    bb_cursor;
+static uint8_t           bb_scratch[BLACKBOX_RECORD_MAX];
+static BlackboxStats     bb_counters;
+
+// State restated at the top of every block
+static uint8_t               bb_ir = 0xFF;      // 0xFF until the first pass
+static UltrasonicMeasurement bb_echo;
+static bool                  bb_have_echo = false;
+static uint8_t               bb_auto = DIRECTIVE_NONE;
+
+// Export staging copy, and its sender
+static uint8_t           bb_stage[BLACKBOX_BLOCK_BYTES];
+static volatile bool     bb_streaming = false;
+
+static inline BlackboxSlot* slot_of(uint32_t seq) {
+    return (BlackboxSlot*)(uintptr_t)(BLACKBOX_ADDR + (seq % BLACKBOX_BLOCKS) * BLACKBOX_BLOCK_BYTES);
+}
+
+static inline uint8_t* records_of(BlackboxSlot* s) {
+    return (uint8_t*)s + BLACKBOX_HEADER_BYTES;
+}
+
+static uint8_t automation_state() {
+    return automation_active ? current_directive : DIRECTIVE_NONE;
+}
+
+// ==================== WRITER (SAMPLER CONTEXT) ====================
+static void put(const uint8_t* rec, size_t len) {
+    memcpy(records_of(bb_slot) + bb_used, rec, len);
+    bb_used += len;
+    bb_counters.bytes += len;
+    __sync_synchronize();           // Records before the length that covers them
+    bb_slot->used = (uint16_t)bb_used;
+}
+
+// Moves to the next slot, dropping the oldest block once the ring is full
+static void open_block(uint32_t base_us) {
+    uint32_t seq = bb_seq + 1;
+    BlackboxSlot* s = slot_of(seq);
+    s->sequence = 0;                // Readers skip it while it changes hands
+    __sync_synchronize();
+    s->magic = 0;
+    s->base_us = base_us;
+    s->used = 0;
+    s->crc = 0;
+    __sync_synchronize();
+    s->sequence = seq;
+    bb_seq = seq;
+    bb_slot = s;
+    bb_used = 0;
+    bb_counters.blocks++;
+    bb_counters.bytes += BLACKBOX_HEADER_BYTES;
+    blackbox_cursor_init(&bb_cursor, base_us);
+
+    // Enough state for a replay to start here
+    if(bb_ir != 0xFF) {
+        put(bb_scratch, blackbox_put_ir(bb_ir, bb_scratch));
+    }
+    if(bb_have_echo) {
+        put(bb_scratch, blackbox_put_echo(&bb_cursor, bb_echo.status, true, bb_echo.trigger_us,
+                                          bb_echo.complete_us, bb_echo.pulse_us, bb_scratch));
+    }
+    put(bb_scratch, blackbox_put_directive(BLACKBOX_AUTO, bb_auto, bb_scratch));
+}
+
+// Encodes against a copy of the cursor; a record that does not fit goes
+// to a fresh block, encoded again from that block's starting state
+template<typename Encode>
+static void append(Encode encode) {
+    BlackboxCursor c = bb_cursor;
+    size_t len = encode(&c);
+    if(bb_used + len > BLACKBOX_BLOCK_BYTES - BLACKBOX_HEADER_BYTES) {
+        open_block(bb_cursor.clock_us);
+        c = bb_cursor;
+        len = encode(&c);
+    }
+    put(bb_scratch, len);
+    bb_cursor = c;
+}
+
+void blackbox_ldr(const LdrFrame* frames, uint32_t n) {
+    if(!bb_recording) {
+        return;
+    }
+    bb_counters.ldr_frames += n;
+    while(n > 0) {
+        uint8_t run = n > BLACKBOX_LDR_RUN_MAX ? BLACKBOX_LDR_RUN_MAX : (uint8_t)n;
+        append([&](BlackboxCursor* c) { return blackbox_put_ldr(c, frames, run, bb_scratch); });
+        frames += run;
+        n -= run;
+    }
+}
+
+void blackbox_ir(uint8_t level) {
+    if(!bb_recording || level == bb_ir) {
+        return;
+    }
+    bb_ir = level;
+    append([&](BlackboxCursor* c) { return blackbox_put_ir(level, bb_scratch); });
+}
+
+void blackbox_echo(const UltrasonicMeasurement& m, bool held) {
+    if(!bb_recording) {
+        return;
+    }
+    bb_echo = m;
+    bb_have_echo = true;
+    append([&](BlackboxCursor* c) {
+        return blackbox_put_echo(c, m.status, held, m.trigger_us, m.complete_us, m.pulse_us, bb_scratch);
+    });
+}
+
+void blackbox_pass(uint8_t events, uint32_t now_us) {
+    if(!bb_recording) {
+        return;
+    }
+    // Automation started or stopped from the UI since the last pass
+    uint8_t state = automation_state();
+    if(state != bb_auto) {
+        bb_auto = state;
+        append([&](BlackboxCursor* c) { return blackbox_put_directive(BLACKBOX_AUTO, state, bb_scratch); });
+    }
+    bb_counters.passes++;
+    append([&](BlackboxCursor* c) { return blackbox_put_pass(c, events, now_us, bb_scratch); });
+}
+
+void blackbox_directive(uint8_t directive) {
+    if(!bb_recording) {
+        return;
+    }
+    bb_auto = directive;
+    append([&](BlackboxCursor* c) { return blackbox_put_directive(BLACKBOX_DIRECTIVE, directive, bb_scratch); });
+}
+
+void blackbox_start() {
+    bb_recording = false;
+    bb_seq = 0;
+    bb_ir = 0xFF;
+    bb_have_echo = false;
+    bb_auto = automation_state();
+    uint32_t exported = bb_counters.exported;
+    memset(&bb_counters, 0, sizeof(bb_counters));
+    bb_counters.exported = exported;
+    for(uint32_t i = 0; i < BLACKBOX_BLOCKS; i++) {
+        slot_of(i)->sequence = 0;
+    }
+    open_block(us_ticker_read());
+    bb_recording = true;
+}
+
+void blackbox_stop() {
+    bb_recording = false;
+}
+
+// ==================== READERS ====================
+uint32_t blackbox_export(blackbox_sink_t sink, void* ctx) {
+    uint32_t newest = bb_seq;
+    uint32_t oldest = newest > BLACKBOX_BLOCKS ? newest - BLACKBOX_BLOCKS + 1 : 1;
+    uint32_t sent = 0;
+    bb_counters.exported = 0;
+
+    for(uint32_t seq = oldest; seq <= newest; seq++) {
+        BlackboxSlot* s = slot_of(seq);
+        if(s->sequence != seq) {
+            continue;
+        }
+        uint16_t used = s->used;
+        uint32_t base_us = s->base_us;
+        __sync_synchronize();
+        memcpy(bb_stage + BLACKBOX_HEADER_BYTES, records_of(s), used);
+        __sync_synchronize();
+
+        // The writer reached this slot again while it was being copied
+        if(s->sequence != seq || bb_seq >= seq + BLACKBOX_BLOCKS) {
+            continue;
+        }
+        blackbox_put_header(bb_stage, seq, base_us, used);
+        uint32_t len = BLACKBOX_HEADER_BYTES + used;
+        sent += len;
+        bb_counters.exported = sent;
+        if(!sink(bb_stage, len, ctx)) {
+            break;
+        }
+    }
+    return sent;
+}
+
+static bool stream_sink(const uint8_t* block, uint32_t len, void* ctx) {
+    uint32_t seq = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+    TelemetryChunk c;
+    c.block = seq;
+    c.total = (uint16_t)len;
+    for(uint32_t offset = 0; offset < len; offset += c.len) {
+        c.offset = (uint16_t)offset;
+        c.len = (uint8_t)(len - offset > TELEMETRY_CHUNK_MAX ? TELEMETRY_CHUNK_MAX : len - offset);
+        memcpy(c.data, block + offset, c.len);
+        telemetry_send_chunk(c);
+    }
+    return true;
+}
+
+uint32_t blackbox_stream() {
+    bb_streaming = true;
+    LOG_INFO("black box: streaming %u blocks", bb_seq > BLACKBOX_BLOCKS ? BLACKBOX_BLOCKS : bb_seq);
+    uint32_t sent = blackbox_export(stream_sink, NULL);
+    LOG_INFO("black box: %u bytes sent", sent);
+    bb_streaming = false;
+    return sent;
+}
+
+#if defined(TARGET_STM32F7)
+// Started on the first send, after boot, so its stack is not allocated then
+static uint64_t   bb_stack[BLACKBOX_STREAM_STACK / 8];
+static Thread     bb_thread(osPriorityBelowNormal, BLACKBOX_STREAM_STACK, (unsigned char*)bb_stack);
+static EventFlags bb_flags;
+static bool       bb_thread_started = false;
+
+static void blackbox_stream_main() {
+    while(1) {
+        bb_flags.wait_any(1);
+        blackbox_stream();
+    }
+}
+#endif
+
+void blackbox_stream_async() {
+    if(bb_streaming) {
+        return;
+    }
+#if defined(TARGET_STM32F7)
+    if(!bb_thread_started) {
+        bb_thread_started = true;
+        bb_thread.start(blackbox_stream_main);
+        mem_watch_thread(bb_thread.get_id(), "blackbox");
+    }
+    bb_streaming = true;
+    bb_flags.set(1);
+#else
+    blackbox_stream();
+#endif
+}
+
+BlackboxStats blackbox_stats() {
+    BlackboxStats st = bb_counters;
+    st.streaming = bb_streaming;
+    uint32_t newest = bb_seq;
+    if(newest != 0) {
+        uint32_t oldest = newest > BLACKBOX_BLOCKS ? newest - BLACKBOX_BLOCKS + 1 : 1;
+        st.span_us = bb_cursor.clock_us - slot_of(oldest)->base_us;
+    }
+    return st;
+}
@@ -0,0 +1,69 @@
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include "mbed.h"
+#include "mirror.h"
+#include "ultrasonic.h"
+#include "blackbox_codec.h"
+
+// ==================== BLACK-BOX RECORDER ====================
+// Keeps what the sampler consumed: every LDR frame, IR level change and
+// echo, the pass that published each SensorFrame and the directives
+// decided from it, delta-encoded (blackbox_codec.h) into a ring of blocks
+// in the SDRAM the display modules and the screen mirror leave free. The approach simulator
+// writes about 20 kB/s, so the ring holds the last couple of minutes.
+//
+// The sampler is the only writer and only appends; a block is finished by
+// moving on to the next slot. blackbox_export() copies blocks out from any
+// thread without stopping it, and leaves out a block the writer has come
+// round to again in the meantime.
+//
+// blackbox_stream() sends the ring down the telemetry stream, and
+// telemetry_decode -b turns that back into a file, which
+// Host/build/blackbox_replay plays through the sampler, the directive
+// logic and the screens.
+#define BLACKBOX_SDRAM_END      (LCD_FB_START_ADDRESS + 8 * 1024 * 1024)
+#define BLACKBOX_ADDR           MIRROR_SDRAM_FREE
+#define BLACKBOX_BLOCKS         ((BLACKBOX_SDRAM_END - BLACKBOX_ADDR) / BLACKBOX_BLOCK_BYTES)
+#define BLACKBOX_STREAM_STACK   2048
+
+struct BlackboxStats {
+    uint32_t blocks;            // Started since blackbox_start()
+    uint32_t bytes;             // Encoded, headers included
+    uint32_t span_us;           // Oldest block in the ring to the last pass
+    uint32_t ldr_frames;
+    uint32_t passes;
+    uint32_t exported;          // Bytes sent by the current or last export
+    bool     streaming;
+};
+
+// Takes a block with its header filled in; false stops the export
+typedef bool (*blackbox_sink_t)(const uint8_t* block, uint32_t len, void* ctx);
+
+// Empties the ring and starts recording. sensor_sampler_start() calls it;
+// sensor_replay_begin() stops recording.
+void blackbox_start();
+void blackbox_stop();
+
+// Writer side, sampler context only
+void blackbox_ldr(const LdrFrame* frames, uint32_t n);
+void blackbox_ir(uint8_t level);                // Every pass; kept on change
+void blackbox_echo(const UltrasonicMeasurement& m, bool held);
+void blackbox_pass(uint8_t events, uint32_t now_us);
+void blackbox_directive(uint8_t directive);
+
+// Every block in the ring, oldest first and the unfinished one last.
+// Returns the bytes handed to sink.
+uint32_t blackbox_export(blackbox_sink_t sink, void* ctx);
+
+// blackbox_export() into the telemetry stream; takes as long as the UART
+// does, about 50 s for a full ring at TELEMETRY_BAUD
+uint32_t blackbox_stream();
+
+// blackbox_stream() on its own low-priority thread on the board (at once
+// on the host); ignored while one is running
+void blackbox_stream_async();
+
+BlackboxStats blackbox_stats();
+
+#endif
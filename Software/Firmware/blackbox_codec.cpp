@@ -0,0 +1,234 @@
+#include "blackbox_codec.h"
+#include "telemetry_codec.h"
+#include <string.h>
+
+static inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// ==================== VARINTS ====================
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline size_t put_varint(uint8_t* out, uint32_t v) {
+    size_t n = 0;
+    while(v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// False on a truncated or over-long varint
+static bool get_varint(BlackboxReader* r, uint32_t* v) {
+    uint32_t value = 0;
+    for(uint8_t shift = 0; shift < 35; shift += 7) {
+        if(r->p >= r->end) {
+            return false;
+        }
+        uint8_t b = *r->p++;
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) {
+            *v = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool get_signed(BlackboxReader* r, int32_t* v) {
+    uint32_t u;
+    if(!get_varint(r, &u)) {
+        return false;
+    }
+    *v = unzigzag(u);
+    return true;
+}
+
+static inline uint8_t tag(uint8_t type, uint8_t arg) {
+    return (uint8_t)(type | (arg << 4));
+}
+
+void blackbox_cursor_init(BlackboxCursor* c, uint32_t base_us) {
+    memset(c, 0, sizeof(*c));
+    c->clock_us = base_us;
+    c->ldr_us = base_us;
+}
+
+// ==================== ENCODER ====================
+size_t blackbox_put_ldr(BlackboxCursor* c, const LdrFrame* frames, uint8_t n, uint8_t* out) {
+    size_t len = 0;
+    out[len++] = tag(BLACKBOX_LDR, (uint8_t)(n - 1));
+    for(uint8_t i = 0; i < n; i++) {
+        const LdrFrame& f = frames[i];
+        len += put_varint(out + len, zigzag((int32_t)(f.timestamp_us - c->ldr_us - BLACKBOX_LDR_PERIOD_US)));
+        c->ldr_us = f.timestamp_us;
+        for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+            len += put_varint(out + len, zigzag((int32_t)f.raw[ch] - (int32_t)c->ldr[ch]));
+            c->ldr[ch] = f.raw[ch];
+        }
+    }
+    return len;
+}
+
+size_t blackbox_put_ir(uint8_t level, uint8_t* out) {
+    out[0] = tag(BLACKBOX_IR, level ? 1 : 0);
+    return 1;
+}
+
+size_t blackbox_put_echo(BlackboxCursor* c, uint8_t status, bool held, uint32_t trigger_us,
+                         uint32_t complete_us, uint32_t pulse_us, uint8_t* out) {
+    size_t len = 0;
+    out[len++] = tag(BLACKBOX_ECHO, (uint8_t)((status & 0x07) | (held ? BLACKBOX_ECHO_HELD : 0)));
+    len += put_varint(out + len, zigzag((int32_t)(complete_us - c->clock_us)));
+    len += put_varint(out + len, complete_us - trigger_us);
+    len += put_varint(out + len, zigzag((int32_t)(pulse_us - c->pulse_us)));
+    c->clock_us = complete_us;
+    c->pulse_us = pulse_us;
+    return len;
+}
+
+size_t blackbox_put_pass(BlackboxCursor* c, uint8_t events, uint32_t now_us, uint8_t* out) {
+    size_t len = 0;
+    out[len++] = tag(BLACKBOX_PASS, (uint8_t)(events & 0x0F));
+    len += put_varint(out + len, zigzag((int32_t)(now_us - c->clock_us)));
+    c->clock_us = now_us;
+    return len;
+}
+
+size_t blackbox_put_directive(uint8_t type, uint8_t directive, uint8_t* out) {
+    out[0] = tag(type, directive > 6 ? BLACKBOX_AUTO_OFF : directive);
+    return 1;
+}
+
+void blackbox_put_header(uint8_t* block, uint32_t sequence, uint32_t base_us, uint16_t used) {
+    put32(block, BLACKBOX_MAGIC);
+    put32(block + 4, sequence);
+    put32(block + 8, base_us);
+    put16(block + 12, used);
+
+    // The CRC runs over the header so far, then straight on over the records
+    uint16_t crc = crc16_ccitt(block, 14);
+    crc = crc16_ccitt_update(crc, block + BLACKBOX_HEADER_BYTES, used);
+    put16(block + 14, crc);
+}
+
+// ==================== DECODER ====================
+int blackbox_open(BlackboxReader* r, const uint8_t* data, size_t len, BlackboxHeader* h) {
+    if(len < BLACKBOX_HEADER_BYTES) {
+        return BLACKBOX_ERR_LENGTH;
+    }
+    if(get32(data) != BLACKBOX_MAGIC) {
+        return BLACKBOX_ERR_MAGIC;
+    }
+    h->sequence = get32(data + 4);
+    h->base_us = get32(data + 8);
+    h->used = get16(data + 12);
+    if(h->used > BLACKBOX_BLOCK_BYTES - BLACKBOX_HEADER_BYTES || BLACKBOX_HEADER_BYTES + (size_t)h->used > len) {
+        return BLACKBOX_ERR_LENGTH;
+    }
+    uint16_t crc = crc16_ccitt(data, 14);
+    crc = crc16_ccitt_update(crc, data + BLACKBOX_HEADER_BYTES, h->used);
+    if(crc != get16(data + 14)) {
+        return BLACKBOX_ERR_CRC;
+    }
+
+    r->p = data + BLACKBOX_HEADER_BYTES;
+    r->end = r->p + h->used;
+    r->ldr_left = 0;
+    blackbox_cursor_init(&r->cursor, h->base_us);
+    return BLACKBOX_OK;
+}
+
+static bool next_ldr_frame(BlackboxReader* r, BlackboxRecord* out) {
+    BlackboxCursor* c = &r->cursor;
+    int32_t v;
+    if(!get_signed(r, &v)) {
+        return false;
+    }
+    c->ldr_us += (uint32_t)v + BLACKBOX_LDR_PERIOD_US;
+    for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+        if(!get_signed(r, &v)) {
+            return false;
+        }
+        c->ldr[ch] = (uint16_t)(c->ldr[ch] + v);
+    }
+    out->type = BLACKBOX_LDR;
+    out->arg = 0;
+    out->t_us = c->ldr_us;
+    memcpy(out->ldr, c->ldr, sizeof(out->ldr));
+    r->ldr_left--;
+    return true;
+}
+
+int blackbox_next(BlackboxReader* r, BlackboxRecord* out) {
+    if(r->ldr_left > 0) {
+        return next_ldr_frame(r, out) ? 1 : BLACKBOX_ERR_RECORD;
+    }
+    if(r->p >= r->end) {
+        return 0;
+    }
+
+    BlackboxCursor* c = &r->cursor;
+    uint8_t t = *r->p++;
+    uint8_t arg = t >> 4;
+    int32_t v;
+    uint32_t u;
+    memset(out, 0, sizeof(*out));
+    out->type = t & 0x0F;
+    out->arg = arg;
+
+    switch(out->type) {
+    case BLACKBOX_LDR:
+        r->ldr_left = (uint8_t)(arg + 1);
+        return next_ldr_frame(r, out) ? 1 : BLACKBOX_ERR_RECORD;
+
+    case BLACKBOX_IR:
+    case BLACKBOX_DIRECTIVE:
+    case BLACKBOX_AUTO:
+        return 1;
+
+    case BLACKBOX_ECHO:
+        if(!get_signed(r, &v) || !get_varint(r, &u)) {
+            return BLACKBOX_ERR_RECORD;
+        }
+        c->clock_us += (uint32_t)v;
+        out->t_us = c->clock_us;
+        out->trigger_us = c->clock_us - u;
+        if(!get_signed(r, &v)) {
+            return BLACKBOX_ERR_RECORD;
+        }
+        c->pulse_us += (uint32_t)v;
+        out->pulse_us = c->pulse_us;
+        return 1;
+
+    case BLACKBOX_PASS:
+        if(!get_signed(r, &v)) {
+            return BLACKBOX_ERR_RECORD;
+        }
+        c->clock_us += (uint32_t)v;
+        out->t_us = c->clock_us;
+        return 1;
+    }
+    return BLACKBOX_ERR_RECORD;
+}
@@ -0,0 +1,121 @@
+#ifndef BLACKBOX_CODEC_H
+#define BLACKBOX_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ldr_scan.h"
+
+// ==================== BLACK-BOX RECORDING FORMAT ====================
+// Portable (no mbed): shared by the firmware recorder and the host replayer.
+//
+// A recording is a run of blocks of at most BLACKBOX_BLOCK_BYTES, each
+// decodable on its own, so a ring can drop its oldest block whole. A file
+// is the blocks back to back, oldest first, each as long as its header says.
+//
+//   0  u32  magic             BLACKBOX_MAGIC
+//   4  u32  sequence          1-based block counter; gaps = lost blocks
+//   8  u32  base_us           Time the first deltas in the block start from
+//  12  u16  used              Record bytes after the header
+//  14  u16  crc               CRC-16/CCITT-FALSE over bytes 0-13 and the records
+//  16  records
+//
+// A record is a tag byte, type in the low nibble and a small argument in
+// the high one, then varints: unsigned LEB128, signed values zigzag-mapped
+// first so a small delta of either sign is one byte. LDR times are deltas
+// from the previous frame less the scan period and LDR values deltas from
+// the previous frame; other times are deltas from the previous timed
+// record. Both start from base_us and zero at the top of each block.
+//
+//   LDR        arg frames - 1; per frame zz(dt - period), then zz(d raw) x 6
+//   IR         arg level; the pin level from the next pass on
+//   ECHO       arg status | BLACKBOX_ECHO_HELD; zz(dt), trigger-to-complete
+//              time, zz(d pulse). HELD: already fed to the range tracker.
+//   PASS       arg SENSOR_EVENT_*; zz(dt). The sampler published a frame.
+//   DIRECTIVE  arg directive, decided from the pass just before it
+//   AUTO       arg directive or BLACKBOX_AUTO_OFF; automation was started
+//              or stopped (or a new block began) before the next pass
+//
+// A new block starts with IR, ECHO (HELD) and AUTO records restating the
+// current state, so replay can begin at any block.
+#define BLACKBOX_MAGIC          0x31584242  // "BBX1"
+#define BLACKBOX_BLOCK_BYTES    4096
+#define BLACKBOX_HEADER_BYTES   16
+#define BLACKBOX_LDR_PERIOD_US  (1000000UL / LDR_SCAN_RATE_HZ)
+#define BLACKBOX_LDR_RUN_MAX    16          // Frames in one LDR record
+
+// Record types
+#define BLACKBOX_LDR            1
+#define BLACKBOX_IR             2
+#define BLACKBOX_ECHO           3
+#define BLACKBOX_PASS           4
+#define BLACKBOX_DIRECTIVE      5
+#define BLACKBOX_AUTO           6
+
+#define BLACKBOX_ECHO_HELD      0x08
+#define BLACKBOX_AUTO_OFF       0x0F
+
+// Longest record: a full LDR run, every varint at its widest
+#define BLACKBOX_RECORD_MAX     (1 + BLACKBOX_LDR_RUN_MAX * 5 * (1 + LDR_CHANNELS))
+
+// blackbox_open() / blackbox_next() results
+#define BLACKBOX_OK             0
+#define BLACKBOX_ERR_LENGTH     -1
+#define BLACKBOX_ERR_MAGIC      -2
+#define BLACKBOX_ERR_CRC        -3
+#define BLACKBOX_ERR_RECORD     -4
+
+struct BlackboxHeader {
+    uint32_t sequence;
+    uint32_t base_us;
+    uint16_t used;
+};
+
+// Delta state, one per direction; reset at the top of every block
+struct BlackboxCursor {
+    uint32_t clock_us;              // Last timed record other than LDR
+    uint32_t ldr_us;
+    uint16_t ldr[LDR_CHANNELS];
+    uint32_t pulse_us;
+};
+
+// One decoded record; an LDR run comes out one frame at a time
+struct BlackboxRecord {
+    uint8_t  type;
+    uint8_t  arg;                   // Level, status, events or directive
+    uint32_t t_us;                  // Conversion, completion or pass time
+    uint16_t ldr[LDR_CHANNELS];
+    uint32_t trigger_us;            // ECHO
+    uint32_t pulse_us;
+};
+
+struct BlackboxReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    BlackboxCursor cursor;
+    uint8_t        ldr_left;        // Frames still to come in the current run
+};
+
+void blackbox_cursor_init(BlackboxCursor* c, uint32_t base_us);
+
+// ==================== ENCODER ====================
+// Each writes one record to out (BLACKBOX_RECORD_MAX bytes will always do),
+// advances the cursor and returns the length
+size_t blackbox_put_ldr(BlackboxCursor* c, const LdrFrame* frames, uint8_t n, uint8_t* out);
+size_t blackbox_put_ir(uint8_t level, uint8_t* out);
+size_t blackbox_put_echo(BlackboxCursor* c, uint8_t status, bool held, uint32_t trigger_us,
+                         uint32_t complete_us, uint32_t pulse_us, uint8_t* out);
+size_t blackbox_put_pass(BlackboxCursor* c, uint8_t events, uint32_t now_us, uint8_t* out);
+size_t blackbox_put_directive(uint8_t type, uint8_t directive, uint8_t* out);
+
+// Fills in the header of a block whose records are already in place
+void blackbox_put_header(uint8_t* block, uint32_t sequence, uint32_t base_us, uint16_t used);
+
+// ==================== DECODER ====================
+// Checks the header and CRC of the block at the start of data (len bytes
+// available) and points the reader at its records
+int blackbox_open(BlackboxReader* r, const uint8_t* data, size_t len, BlackboxHeader* h);
+
+// Next record: 1, 0 at the end of the block, or BLACKBOX_ERR_RECORD
+int blackbox_next(BlackboxReader* r, BlackboxRecord* out);
+
+#endif
@@ -0,0 +1,93 @@
+#include "damage.h"
+
+static inline int16_t min16(int16_t a, int16_t b) { return a < b ? a : b; }
+static inline int16_t max16(int16_t a, int16_t b) { return a > b ? a : b; }
+
+static DamageRect rect_union(const DamageRect& a, const DamageRect& b) {
+    DamageRect r = { min16(a.x0, b.x0), min16(a.y0, b.y0), max16(a.x1, b.x1), max16(a.y1, b.y1) };
+    return r;
+}
+
+// Overlapping or sharing an edge
+static bool rect_touches(const DamageRect& a, const DamageRect& b) {
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+// ==================== DIRTY RECTANGLE TRACKING ====================
+DamageTracker::DamageTracker(int16_t screen_w, int16_t screen_h) : _count(0) {
+    _screen = damage_rect(0, 0, screen_w, screen_h);
+}
+
+void DamageTracker::invalidate(int16_t x, int16_t y, int16_t w, int16_t h) {
+    invalidate(damage_rect(x, y, w, h));
+}
+
+void DamageTracker::invalidate(const DamageRect& in) {
+    // Clip to the screen
+    DamageRect r = { max16(in.x0, _screen.x0), max16(in.y0, _screen.y0),
+                     min16(in.x1, _screen.x1), min16(in.y1, _screen.y1) };
+    if(r.empty()) {
+        return;
+    }
+
+    // Absorb every rect the new one touches; repeat since the union grows
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(uint8_t i = 0; i < _count; i++) {
+            if(rect_touches(_rects[i], r)) {
+                r = rect_union(_rects[i], r);
+                remove(i);
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if(_count < DAMAGE_MAX_RECTS) {
+        _rects[_count++] = r;
+        return;
+    }
+
+    // List full: merge r into the rect whose union adds the least area
+    uint8_t best = 0;
+    int32_t best_cost = 0x7FFFFFFF;
+    for(uint8_t i = 0; i < _count; i++) {
+        DamageRect u = rect_union(_rects[i], r);
+        int32_t cost = u.area() - _rects[i].area() - r.area();
+        if(cost < best_cost) {
+            best_cost = cost;
+            best = i;
+        }
+    }
+    r = rect_union(_rects[best], r);
+    remove(best);
+    invalidate(r);
+}
+
+void DamageTracker::invalidate_all() {
+    _rects[0] = _screen;
+    _count = 1;
+}
+
+bool DamageTracker::is_dirty(const DamageRect& r) const {
+    for(uint8_t i = 0; i < _count; i++) {
+        if(_rects[i].intersects(r)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int32_t DamageTracker::area() const {
+    int32_t total = 0;
+    for(uint8_t i = 0; i < _count; i++) {
+        total += _rects[i].area();      // Rects never overlap after merging
+    }
+    return total;
+}
+
+void DamageTracker::remove(uint8_t i) {
+    _rects[i] = _rects[_count - 1];
+    _count--;
+}
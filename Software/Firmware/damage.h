@@ -0,0 +1,52 @@
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#include <stdint.h>
+
+// ==================== DIRTY RECTANGLE TRACKING ====================
+#define DAMAGE_MAX_RECTS    12      // Beyond this, closest rects are merged
+
+struct DamageRect {
+    int16_t x0, y0;                 // Inclusive
+    int16_t x1, y1;                 // Exclusive
+
+    int32_t area() const { return (int32_t)(x1 - x0) * (y1 - y0); }
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+    bool intersects(const DamageRect& o) const {
+        return x0 < o.x1 && o.x0 < x1 && y0 < o.y1 && o.y0 < y1;
+    }
+};
+
+inline DamageRect damage_rect(int16_t x, int16_t y, int16_t w, int16_t h) {
+    DamageRect r = { x, y, (int16_t)(x + w), (int16_t)(y + h) };
+    return r;
+}
+
+// Collects the regions invalidated during a frame. Overlapping or touching
+// rects are merged as they arrive; the list never grows past
+// DAMAGE_MAX_RECTS (the pair whose union wastes least area is merged).
+class DamageTracker {
+public:
+    DamageTracker(int16_t screen_w, int16_t screen_h);
+
+    void invalidate(int16_t x, int16_t y, int16_t w, int16_t h);
+    void invalidate(const DamageRect& r);
+    void invalidate_all();
+
+    bool is_dirty(const DamageRect& r) const;
+    bool any() const { return _count > 0; }
+    uint8_t count() const { return _count; }
+    const DamageRect& rect(uint8_t i) const { return _rects[i]; }
+    int32_t area() const;
+
+    void clear() { _count = 0; }
+
+private:
+    void remove(uint8_t i);
+
+    DamageRect _screen;
+    DamageRect _rects[DAMAGE_MAX_RECTS];
+    uint8_t    _count;
+};
+
+#endif
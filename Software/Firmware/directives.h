@@ -0,0 +1,152 @@
+#ifndef DIRECTIVES_H
+#define DIRECTIVES_H
+
+#include <stdint.h>
+
+// ==================== DIRECTIVES ====================
+// Portable (no mbed). What current_directive, the telemetry record and
+// the black box carry; the screens look them up in directive_presentation
+// (hmi.h).
+#define DIRECTIVE_LEFT          0
+#define DIRECTIVE_RIGHT         1
+#define DIRECTIVE_STRAIGHT      2
+#define DIRECTIVE_STOP          3
+#define DIRECTIVE_SLOW          4
+#define DIRECTIVE_SLIGHT_LEFT   5
+#define DIRECTIVE_SLIGHT_RIGHT  6
+#define DIRECTIVE_COUNT         7
+#define DIRECTIVE_NONE          255     // Outside auto mode
+
+// Side and strength of the turn a directive asks for: negative = port,
+// 2 = full turn, 1 = slight. A turn on screen needs a little less
+// deviation to stay than it did to appear.
+static constexpr int8_t directive_lateral[] = {-2, 2, 0, 0, 0, -1, 1};
+static_assert(sizeof(directive_lateral) == DIRECTIVE_COUNT, "directive_lateral: one entry per directive");
+
+// ==================== DIRECTION RULES ====================
+// determine_direction_from_sensors() thresholds a frame into these
+// conditions; the rules below map every combination of them to a
+// directive. The first rule (highest priority) whose masked conditions
+// equal its match wins.
+#define DIRECTION_COND_IR_BLOCKED   0x01    // IR beam broken (active low)
+#define DIRECTION_COND_STOP_ZONE    0x02    // Tracker projects past the stop line
+#define DIRECTION_COND_SLOW_ZONE    0x04    // Tracker in the SLOW band
+#define DIRECTION_COND_TURN         0x08    // Spot far enough off centre for a turn
+#define DIRECTION_COND_TRIM         0x10    // ... for a slight turn
+#define DIRECTION_COND_RIGHT        0x20    // Deviation toward A0/A1
+#define DIRECTION_COND_FAST         0x40    // Closing above SLOW_TRIM_CLOSING_CM_S
+#define DIRECTION_CONDITIONS        7
+#define DIRECTION_COMBINATIONS      (1u << DIRECTION_CONDITIONS)
+
+struct DirectionRule {
+    uint8_t mask;           // Conditions the rule looks at
+    uint8_t match;          // Their values for the rule to apply
+    uint8_t priority;       // Higher first; the table is sorted by it
+    uint8_t directive;
+};
+
+#define DIRECTION_RULE(mask, match, priority, directive) \
+    { (uint8_t)(mask), (uint8_t)(match), (uint8_t)(priority), (uint8_t)(directive) }
+
+// Priority: IR (STOP) > predicted STOP > turn > SLOW > slight turn > straight.
+// Close to the stop line, or closing on it fast, SLOW outranks the trim
+// while the aircraft is above taxi-in speed; once it has slowed, the
+// slight turns take over again.
+static constexpr DirectionRule direction_rules[] = {
+    DIRECTION_RULE(DIRECTION_COND_IR_BLOCKED, DIRECTION_COND_IR_BLOCKED, 100, DIRECTIVE_STOP),
+    DIRECTION_RULE(DIRECTION_COND_STOP_ZONE, DIRECTION_COND_STOP_ZONE, 90, DIRECTIVE_STOP),
+    DIRECTION_RULE(DIRECTION_COND_TURN | DIRECTION_COND_RIGHT, DIRECTION_COND_TURN, 80, DIRECTIVE_LEFT),
+    DIRECTION_RULE(DIRECTION_COND_TURN | DIRECTION_COND_RIGHT, DIRECTION_COND_TURN | DIRECTION_COND_RIGHT, 80,
+                   DIRECTIVE_RIGHT),
+    DIRECTION_RULE(DIRECTION_COND_SLOW_ZONE | DIRECTION_COND_TRIM, DIRECTION_COND_SLOW_ZONE, 70, DIRECTIVE_SLOW),
+    DIRECTION_RULE(DIRECTION_COND_SLOW_ZONE | DIRECTION_COND_FAST, DIRECTION_COND_SLOW_ZONE | DIRECTION_COND_FAST, 70,
+                   DIRECTIVE_SLOW),
+    DIRECTION_RULE(DIRECTION_COND_TRIM | DIRECTION_COND_RIGHT, DIRECTION_COND_TRIM, 60, DIRECTIVE_SLIGHT_LEFT),
+    DIRECTION_RULE(DIRECTION_COND_TRIM | DIRECTION_COND_RIGHT, DIRECTION_COND_TRIM | DIRECTION_COND_RIGHT, 60,
+                   DIRECTIVE_SLIGHT_RIGHT),
+    DIRECTION_RULE(0, 0, 0, DIRECTIVE_STRAIGHT),     // Centred, or no spot on the row
+};
+
+#define DIRECTION_RULE_COUNT    (sizeof(direction_rules) / sizeof(direction_rules[0]))
+
+// ==================== COMPILE-TIME CHECKS ====================
+// C++11 constexpr: one return statement each, loops as recursion.
+constexpr bool direction_rule_applies(uint32_t r, uint32_t conds) {
+    return (conds & direction_rules[r].mask) == direction_rules[r].match;
+}
+
+constexpr uint8_t direction_resolve(uint32_t conds, uint32_t r = 0) {
+    return r == DIRECTION_RULE_COUNT ? DIRECTIVE_NONE
+         : direction_rule_applies(r, conds) ? direction_rules[r].directive
+         : direction_resolve(conds, r + 1);
+}
+
+// Match only within the mask, a real directive, and sorted by priority
+constexpr bool direction_rules_well_formed(uint32_t r = 0) {
+    return r == DIRECTION_RULE_COUNT ||
+           ((direction_rules[r].match & ~direction_rules[r].mask) == 0 &&
+            direction_rules[r].directive < DIRECTIVE_COUNT &&
+            (r == 0 || direction_rules[r - 1].priority >= direction_rules[r].priority) &&
+            direction_rules_well_formed(r + 1));
+}
+
+// Some frame satisfies both rules
+constexpr bool direction_rules_overlap(uint32_t a, uint32_t b) {
+    return ((direction_rules[a].match ^ direction_rules[b].match) &
+            direction_rules[a].mask & direction_rules[b].mask) == 0;
+}
+
+// Every frame rule b matches, rule a matches too
+constexpr bool direction_rule_covers(uint32_t a, uint32_t b) {
+    return (direction_rules[a].mask & ~direction_rules[b].mask) == 0 &&
+           ((direction_rules[a].match ^ direction_rules[b].match) & direction_rules[a].mask) == 0;
+}
+
+// Pair a < b is a conflict when the table order alone decides between two
+// directives of equal priority, dead when an earlier rule hides b
+constexpr bool direction_pair_ok(uint32_t a, uint32_t b) {
+    return !(direction_rules[a].priority == direction_rules[b].priority &&
+             direction_rules[a].directive != direction_rules[b].directive &&
+             direction_rules_overlap(a, b)) &&
+           !direction_rule_covers(a, b);
+}
+
+constexpr bool direction_rules_consistent(uint32_t a = 0, uint32_t b = 1) {
+    return a + 1 >= DIRECTION_RULE_COUNT ? true
+         : b == DIRECTION_RULE_COUNT ? direction_rules_consistent(a + 1, a + 2)
+         : direction_pair_ok(a, b) && direction_rules_consistent(a, b + 1);
+}
+
+constexpr bool direction_rules_total(uint32_t conds = 0) {
+    return conds == DIRECTION_COMBINATIONS ||
+           (direction_resolve(conds) != DIRECTIVE_NONE && direction_rules_total(conds + 1));
+}
+
+static_assert(direction_rules_well_formed(), "direction_rules: match outside mask, bad directive or unsorted");
+static_assert(direction_rules_consistent(), "direction_rules: equal-priority rules disagree, or a rule can never apply");
+static_assert(direction_rules_total(), "direction_rules: some conditions resolve to no directive");
+
+// ==================== LOOKUP TABLE ====================
+// direction_resolve() for every combination, evaluated by the compiler
+// into a const table: at run time a directive is one indexed load.
+template<uint8_t... C>
+struct DirectionTable {
+    static const uint8_t lookup[sizeof...(C)];
+};
+
+template<uint8_t... C>
+const uint8_t DirectionTable<C...>::lookup[sizeof...(C)] = {direction_resolve(C)...};
+
+template<uint32_t N, uint8_t... C>
+struct DirectionTableOf : DirectionTableOf<N - 1, (uint8_t)(N - 1), C...> {};
+
+template<uint8_t... C>
+struct DirectionTableOf<0, C...> {
+    typedef DirectionTable<C...> table;
+};
+
+static inline uint8_t direction_lookup(uint8_t conds) {
+    return DirectionTableOf<DIRECTION_COMBINATIONS>::table::lookup[conds & (DIRECTION_COMBINATIONS - 1)];
+}
+
+#endif
@@ -0,0 +1,241 @@
+#include "display.h"
+#include "profiler.h"
+#include <string.h>
+
+// ==================== TWO-LAYER DISPLAY ====================
+#define DISPLAY_FLAG_FLIPPED    0x1
+
+static EventFlags      display_events;
+static volatile bool   display_flip_pending = false;
+static volatile uint32_t display_flip_count = 0;
+static uint32_t        display_copied = 0;
+
+// Content layer swap chain
+static uint32_t        display_front = DISPLAY_CONTENT_FB0;    // Scanned out (or queued)
+static uint32_t        display_back = DISPLAY_CONTENT_FB1;     // Drawn into
+static uint32_t        display_layer = DISPLAY_LAYER_CONTENT;  // Selected for drawing
+static uint32_t        display_target_addr = DISPLAY_CONTENT_FB1;
+
+// Chrome layer: scanned-out buffer and which slots hold a finished screen
+static uint32_t        display_chrome = DISPLAY_CHROME_BOOT;
+static bool            display_chrome_changed = false;
+static bool            display_chrome_cached[DISPLAY_CHROME_SLOTS];
+
+// Damage of the frame last presented; the content back buffer lacks it
+static DamageRect      display_stale[DAMAGE_MAX_RECTS];
+static uint8_t         display_stale_count = 0;
+
+// Everything drawn on the content layer since the screen was entered
+static DamageTracker   display_content_used(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+static volatile display_listener_t display_listener = NULL;
+
+// Runs in the LTDC interrupt once the new addresses have been latched
+extern "C" void HAL_LTDC_ReloadEventCallback(LTDC_HandleTypeDef* hltdc) {
+    display_flip_pending = false;
+    display_flip_count++;
+    PROF_FLIPPED();
+    display_events.set(DISPLAY_FLAG_FLIPPED);
+}
+
+#if defined(TARGET_STM32F7)
+extern LTDC_HandleTypeDef hLtdcHandler;     // Owned by the BSP
+
+static DMA2D_HandleTypeDef display_dma2d;
+
+static void display_ltdc_irq_handler() {
+    HAL_LTDC_IRQHandler(&hLtdcHandler);
+}
+
+// DMA2D memory-to-memory; the CPU is free while it runs
+static void copy_rect(uint32_t dst, uint32_t src, const DamageRect& r) {
+    uint32_t w = r.x1 - r.x0;
+    uint32_t h = r.y1 - r.y0;
+    uint32_t offset = (r.y0 * DISPLAY_WIDTH + r.x0) * 4;
+
+    // Pixels drawn by the CPU may still sit in the D-cache
+    SCB_CleanDCache_by_Addr((uint32_t*)(src + offset), ((h - 1) * DISPLAY_WIDTH + w) * 4);
+
+    display_dma2d.Instance = DMA2D;
+    display_dma2d.Init.Mode = DMA2D_M2M;
+    display_dma2d.Init.ColorMode = DMA2D_OUTPUT_ARGB8888;
+    display_dma2d.Init.OutputOffset = DISPLAY_WIDTH - w;
+    display_dma2d.LayerCfg[1].InputOffset = DISPLAY_WIDTH - w;
+    display_dma2d.LayerCfg[1].InputColorMode = DMA2D_INPUT_ARGB8888;
+    display_dma2d.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+    display_dma2d.LayerCfg[1].InputAlpha = 0;
+    if(HAL_DMA2D_Init(&display_dma2d) == HAL_OK &&
+       HAL_DMA2D_ConfigLayer(&display_dma2d, 1) == HAL_OK &&
+       HAL_DMA2D_Start(&display_dma2d, src + offset, dst + offset, w, h) == HAL_OK) {
+        HAL_DMA2D_PollForTransfer(&display_dma2d, 10);
+    }
+}
+#else
+static void copy_rect(uint32_t dst, uint32_t src, const DamageRect& r) {
+    uint32_t* d = (uint32_t*)(uintptr_t)dst;
+    const uint32_t* s = (const uint32_t*)(uintptr_t)src;
+    size_t row_bytes = (r.x1 - r.x0) * 4;
+    for(int16_t y = r.y0; y < r.y1; y++) {
+        memcpy(&d[y * DISPLAY_WIDTH + r.x0], &s[y * DISPLAY_WIDTH + r.x0], row_bytes);
+    }
+}
+#endif
+
+static void select_target(uint32_t layer, uint32_t addr) {
+    display_layer = layer;
+    display_target_addr = addr;
+    BSP_LCD_SelectLayer(layer);
+    BSP_LCD_SetLayerAddress_NoReload(layer, addr);
+}
+
+void display_init(uint32_t background) {
+    BSP_LCD_Init();
+
+    // LayerDefaultInit reloads immediately; both layers are on from here
+    BSP_LCD_LayerDefaultInit(DISPLAY_LAYER_CHROME, DISPLAY_CHROME_BOOT);
+    BSP_LCD_SelectLayer(DISPLAY_LAYER_CHROME);
+    BSP_LCD_Clear(background);
+    BSP_LCD_LayerDefaultInit(DISPLAY_LAYER_CONTENT, DISPLAY_CONTENT_FB0);
+    BSP_LCD_SelectLayer(DISPLAY_LAYER_CONTENT);
+    BSP_LCD_Clear(LCD_COLOR_TRANSPARENT);
+
+#if defined(TARGET_STM32F7)
+    NVIC_SetVector(LTDC_IRQn, (uint32_t)&display_ltdc_irq_handler);
+    HAL_NVIC_SetPriority(LTDC_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(LTDC_IRQn);
+#endif
+
+    // Draw into content buffer 1 from now on
+    display_front = DISPLAY_CONTENT_FB0;
+    display_back = DISPLAY_CONTENT_FB1;
+    select_target(DISPLAY_LAYER_CONTENT, display_back);
+    BSP_LCD_Clear(LCD_COLOR_TRANSPARENT);
+
+    display_chrome = DISPLAY_CHROME_BOOT;
+    display_chrome_changed = false;
+    display_drop_chrome();
+    display_flip_pending = false;
+    display_stale_count = 0;
+    display_content_used.clear();
+}
+
+void display_begin_frame() {
+    if(display_flip_pending) {
+        uint32_t flags = display_events.wait_any(DISPLAY_FLAG_FLIPPED, DISPLAY_FLIP_TIMEOUT_MS);
+        if(flags & osFlagsError) {
+            display_flip_pending = false;   // Missed the interrupt; carry on
+        }
+    }
+    display_events.clear(DISPLAY_FLAG_FLIPPED);
+
+    // Reload latched the shadow address, so re-pointing the layer at the
+    // old front only changes where the BSP draws
+    select_target(DISPLAY_LAYER_CONTENT, display_back);
+
+    for(uint8_t i = 0; i < display_stale_count; i++) {
+        const DamageRect& r = display_stale[i];
+        copy_rect(display_back, display_front, r);
+        display_copied += r.area();
+    }
+    display_stale_count = 0;
+}
+
+bool display_begin_screen(DamageTracker& damage, uint8_t slot, uint32_t background) {
+    // Only what the last screen actually drew needs clearing
+    BSP_LCD_SetTextColor(LCD_COLOR_TRANSPARENT);
+    for(uint8_t i = 0; i < display_content_used.count(); i++) {
+        const DamageRect& r = display_content_used.rect(i);
+        BSP_LCD_FillRect(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0);
+        damage.invalidate(r);
+    }
+    display_content_used.clear();
+
+    uint32_t chrome = DISPLAY_CHROME_FB(slot);
+    if(chrome != display_chrome) {
+        display_chrome = chrome;
+        display_chrome_changed = true;
+    }
+    if(display_chrome_cached[slot]) {
+        return false;
+    }
+
+    // Not scanned out until present(), so drawing it directly is safe
+    select_target(DISPLAY_LAYER_CHROME, chrome);
+    BSP_LCD_Clear(background);
+    display_chrome_cached[slot] = true;
+    return true;
+}
+
+void display_end_chrome() {
+    select_target(DISPLAY_LAYER_CONTENT, display_back);
+}
+
+void display_drop_chrome() {
+    for(uint8_t i = 0; i < DISPLAY_CHROME_SLOTS; i++) {
+        display_chrome_cached[i] = false;
+    }
+}
+
+void display_present(DamageTracker& damage) {
+    bool content_changed = damage.any();
+    if(!content_changed && !display_chrome_changed) {
+        return;
+    }
+
+    display_stale_count = damage.count();
+    for(uint8_t i = 0; i < display_stale_count; i++) {
+        display_stale[i] = damage.rect(i);
+        display_content_used.invalidate(display_stale[i]);
+    }
+    damage.clear();
+    bool chrome_changed = display_chrome_changed;
+
+    // The finished back buffer becomes the front at the next vertical blank
+    if(content_changed) {
+        uint32_t drawn = display_back;
+        display_back = display_front;
+        display_front = drawn;
+    }
+    display_chrome_changed = false;
+
+    display_flip_pending = true;
+    BSP_LCD_SetLayerAddress_NoReload(DISPLAY_LAYER_CHROME, display_chrome);
+    BSP_LCD_SetLayerAddress_NoReload(DISPLAY_LAYER_CONTENT, display_front);
+    BSP_LCD_SelectLayer(DISPLAY_LAYER_CONTENT);
+    display_layer = DISPLAY_LAYER_CONTENT;
+    display_target_addr = display_front;
+    BSP_LCD_Reload(BSP_LCD_RELOAD_VERTICAL_BLANKING);
+
+    display_listener_t listener = display_listener;
+    if(listener != NULL) {
+        if(chrome_changed) {
+            DamageRect all = damage_rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+            listener(display_front, display_chrome, &all, 1);
+        } else {
+            listener(display_front, display_chrome, display_stale, display_stale_count);
+        }
+    }
+}
+
+uint32_t display_target() {
+    return display_target_addr;
+}
+
+uint32_t display_draw_to(uint32_t addr) {
+    uint32_t previous = display_target_addr;
+    display_target_addr = addr;
+    BSP_LCD_SetLayerAddress_NoReload(display_layer, addr);
+    return previous;
+}
+
+void display_attach(display_listener_t fn) {
+    display_listener = fn;
+}
+
+uint32_t display_flips() {
+    return display_flip_count;
+}
+
+uint32_t display_copied_pixels() {
+    return display_copied;
+}
@@ -0,0 +1,96 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "mbed.h"
+#include "stm32746g_discovery_lcd.h"
+#include "damage.h"
+
+// ==================== DOUBLE-BUFFERED TWO-LAYER DISPLAY ====================
+#define DISPLAY_WIDTH           480
+#define DISPLAY_HEIGHT          272
+#define DISPLAY_FB_BYTES        (DISPLAY_WIDTH * DISPLAY_HEIGHT * 4)    // ARGB8888
+#define DISPLAY_FLIP_TIMEOUT_MS 50      // Three refreshes; LTDC stalled beyond this
+
+#define DISPLAY_LAYER_CHROME    0       // Static furniture, cached per screen
+#define DISPLAY_LAYER_CONTENT   1       // Changing widgets, per-pixel alpha on top
+#define DISPLAY_CHROME_SLOTS    5       // Screens whose chrome stays cached
+
+// SDRAM map (8 MB from LCD_FB_START_ADDRESS); DISPLAY_SDRAM_FREE onwards
+// belongs to other modules
+#define DISPLAY_CONTENT_FB0     LCD_FB_START_ADDRESS
+#define DISPLAY_CONTENT_FB1     (DISPLAY_CONTENT_FB0 + DISPLAY_FB_BYTES)
+#define DISPLAY_CHROME_BOOT     (DISPLAY_CONTENT_FB1 + DISPLAY_FB_BYTES)
+#define DISPLAY_CHROME_FB(slot) (DISPLAY_CHROME_BOOT + ((slot) + 1) * DISPLAY_FB_BYTES)
+#define DISPLAY_SDRAM_FREE      DISPLAY_CHROME_FB(DISPLAY_CHROME_SLOTS)
+
+// Two LTDC layers; the LTDC composites the content layer over the chrome
+// layer using each pixel's alpha, so content drawn in LCD_COLOR_TRANSPARENT
+// shows the chrome through.
+//
+// The chrome layer has one buffer per screen. A screen draws its chrome
+// the first time it is shown; after that, entering it just points the
+// layer at the cached buffer. It is never drawn while being scanned out.
+//
+// The content layer is double-buffered: the BSP draws into the back
+// buffer, display_present() queues it and the LTDC swaps addresses at the
+// next vertical blank, so a half-drawn frame is never visible. One flip may
+// be in flight while the caller goes on working.
+//
+// A frame is:
+//     display_begin_frame();      // waits out a pending flip; no lock held
+//     lcd_lock();
+//     if(display_begin_screen(damage, slot, background)) {  // new screen only
+//         ...draw the chrome...
+//         display_end_chrome();
+//     }
+//     ...draw content, invalidating what changed in the damage tracker...
+//     display_present(damage);
+//     lcd_unlock();
+//
+// The content back buffer is one frame behind the front. begin_frame()
+// brings it up to date by copying the previous frame's damage across, so
+// screens only redraw what changed since the frame they last drew.
+
+// Chrome layer on a blank background, content layer transparent
+void display_init(uint32_t background);
+
+// Blocks until the last presented frame is on screen, then catches the
+// content back buffer up and selects it for drawing
+void display_begin_frame();
+
+// Switches to the screen whose chrome lives in slot. Clears (and
+// invalidates) whatever the previous screen drew on the content layer.
+// Returns true if the chrome is not cached yet: the chrome buffer has been
+// cleared to background and selected, and the caller draws it, then calls
+// display_end_chrome().
+bool display_begin_screen(DamageTracker& damage, uint8_t slot, uint32_t background);
+void display_end_chrome();
+
+// Forget cached chrome, e.g. after a change that alters a screen's layout
+void display_drop_chrome();
+
+// Queues the content back buffer (if damaged) and the new chrome (if the
+// screen changed) for the next vertical blank and clears damage.
+void display_present(DamageTracker& damage);
+
+// Framebuffer the BSP is drawing into right now
+uint32_t display_target();
+
+// Points the BSP at another ARGB8888 surface with the screen's stride, for
+// off-screen rendering between begin_frame() and present(); returns the
+// previous target to hand back afterwards. No flip is in flight then, and
+// present() rewrites both layer addresses before reloading, so the LTDC
+// never latches the off-screen address.
+uint32_t display_draw_to(uint32_t addr);
+
+// Told about every frame present() queues: the content and chrome buffers
+// going out and what changed, the whole screen when the chrome did. UI
+// context with the LCD lock held, so it must be quick. One listener (the
+// screen mirror); NULL detaches.
+typedef void (*display_listener_t)(uint32_t content, uint32_t chrome, const DamageRect* rects, uint8_t count);
+void display_attach(display_listener_t fn);
+
+uint32_t display_flips();
+uint32_t display_copied_pixels();
+
+#endif
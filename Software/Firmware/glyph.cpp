@@ -0,0 +1,164 @@
+#include "glyph.h"
+#include <string.h>
+
+// ==================== GLYPH ATLAS ====================
+struct GlyphAtlas {
+    sFONT*   font;              // Cache key: font, color, back
+    uint32_t color;
+    uint32_t back;
+    uint32_t cell[GLYPH_COUNT]; // Pixels in the pool, stride = font->Width; 0 until drawn
+};
+
+static GlyphAtlas glyph_slots[GLYPH_ATLAS_SLOTS];
+static uint8_t    glyph_count = 0;
+static uint32_t   glyph_pool_next = GLYPH_POOL_ADDR;
+static GlyphStats glyph_counters;
+
+static GlyphAtlas* find_atlas(sFONT* font, uint32_t color, uint32_t back) {
+    for(uint8_t i = 0; i < glyph_count; i++) {
+        GlyphAtlas* a = &glyph_slots[i];
+        if(a->font == font && a->color == color && a->back == back) {
+            return a;
+        }
+    }
+    if(glyph_count >= GLYPH_ATLAS_SLOTS) {
+        return NULL;
+    }
+    GlyphAtlas* a = &glyph_slots[glyph_count++];
+    a->font = font;
+    a->color = color;
+    a->back = back;
+    memset(a->cell, 0, sizeof(a->cell));
+    return a;
+}
+
+// The BSP's own character routine, with its state put back afterwards
+static void bsp_char(sFONT* font, uint32_t color, uint32_t back, uint16_t x, uint16_t y, char c) {
+    sFONT* old_font = BSP_LCD_GetFont();
+    uint32_t old_color = BSP_LCD_GetTextColor();
+    uint32_t old_back = BSP_LCD_GetBackColor();
+    BSP_LCD_SetFont(font);
+    BSP_LCD_SetTextColor(color);
+    BSP_LCD_SetBackColor(back);
+    BSP_LCD_DisplayChar(x, y, (uint8_t)c);
+    BSP_LCD_SetFont(old_font);
+    BSP_LCD_SetTextColor(old_color);
+    BSP_LCD_SetBackColor(old_back);
+}
+
+// Draws the character into the canvas and keeps the cell. 0 if it does not fit.
+static uint32_t rasterise(GlyphAtlas* a, uint8_t index) {
+    uint16_t w = a->font->Width;
+    uint16_t h = a->font->Height;
+    uint32_t bytes = (uint32_t)w * h * 4;
+    if(h > GLYPH_CANVAS_ROWS || glyph_pool_next + bytes > GLYPH_POOL_ADDR + GLYPH_POOL_BYTES) {
+        return 0;
+    }
+
+    uint32_t target = display_draw_to(GLYPH_CANVAS_ADDR);
+    bsp_char(a->font, a->color, a->back, 0, 0, (char)(GLYPH_FIRST + index));
+    display_draw_to(target);
+
+    const uint32_t* canvas = (const uint32_t*)(uintptr_t)GLYPH_CANVAS_ADDR;
+#if defined(TARGET_STM32F7)
+    SCB_InvalidateDCache_by_Addr((uint32_t*)canvas, h * DISPLAY_WIDTH * 4);
+#endif
+    uint32_t* pixels = (uint32_t*)(uintptr_t)glyph_pool_next;
+    for(uint16_t row = 0; row < h; row++) {
+        memcpy(&pixels[row * w], &canvas[row * DISPLAY_WIDTH], w * 4);
+    }
+#if defined(TARGET_STM32F7)
+    SCB_CleanDCache_by_Addr(pixels, bytes);
+#endif
+
+    a->cell[index] = glyph_pool_next;
+    glyph_pool_next += (bytes + 31) & ~31U;     // Keep cells cache-line aligned
+    glyph_counters.rasterised++;
+    glyph_counters.pool_used = glyph_pool_next - GLYPH_POOL_ADDR;
+    return a->cell[index];
+}
+
+#if defined(TARGET_STM32F7)
+static DMA2D_HandleTypeDef glyph_dma2d;
+
+static bool copy_dma2d(uint32_t dst, uint32_t src, uint16_t w, uint16_t h) {
+    // Write back and drop any cached copy of the destination first, so
+    // neither a later eviction nor a later read sees stale pixels
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t*)dst, ((h - 1) * DISPLAY_WIDTH + w) * 4);
+
+    glyph_dma2d.Instance = DMA2D;
+    glyph_dma2d.Init.Mode = DMA2D_M2M;
+    glyph_dma2d.Init.ColorMode = DMA2D_OUTPUT_ARGB8888;
+    glyph_dma2d.Init.OutputOffset = DISPLAY_WIDTH - w;
+    glyph_dma2d.LayerCfg[1].InputOffset = 0;
+    glyph_dma2d.LayerCfg[1].InputColorMode = DMA2D_INPUT_ARGB8888;
+    glyph_dma2d.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+    glyph_dma2d.LayerCfg[1].InputAlpha = 0xFF;
+    if(HAL_DMA2D_Init(&glyph_dma2d) != HAL_OK ||
+       HAL_DMA2D_ConfigLayer(&glyph_dma2d, 1) != HAL_OK ||
+       HAL_DMA2D_Start(&glyph_dma2d, src, dst, w, h) != HAL_OK) {
+        return false;
+    }
+    return HAL_DMA2D_PollForTransfer(&glyph_dma2d, 10) == HAL_OK;
+}
+#endif
+
+static void draw_cell(GlyphAtlas* a, sFONT* font, uint32_t color, uint32_t back, int16_t x, int16_t y, char c) {
+    uint16_t w = font->Width;
+    uint16_t h = font->Height;
+    if(x < 0 || y < 0 || x + w > DISPLAY_WIDTH || y + h > DISPLAY_HEIGHT) {
+        return;
+    }
+    if(c < GLYPH_FIRST || c >= GLYPH_FIRST + GLYPH_COUNT) {
+        c = GLYPH_FIRST;
+    }
+
+    uint8_t index = (uint8_t)(c - GLYPH_FIRST);
+    uint32_t src = 0;
+    if(a != NULL) {
+        src = a->cell[index] != 0 ? a->cell[index] : rasterise(a, index);
+    }
+    if(src == 0) {
+        bsp_char(font, color, back, x, y, c);
+        return;
+    }
+
+    uint32_t dst = display_target() + (y * DISPLAY_WIDTH + x) * 4;
+    glyph_counters.blits++;
+    glyph_counters.pixels += w * h;
+#if defined(TARGET_STM32F7)
+    if(copy_dma2d(dst, src, w, h)) {
+        glyph_counters.dma2d_blits++;
+        return;
+    }
+#endif
+    uint32_t* d = (uint32_t*)(uintptr_t)dst;
+    const uint32_t* s = (const uint32_t*)(uintptr_t)src;
+    for(uint16_t row = 0; row < h; row++) {
+        memcpy(d, s, w * 4);
+        d += DISPLAY_WIDTH;
+        s += w;
+    }
+}
+
+void glyph_draw_char(sFONT* font, uint32_t color, uint32_t back, int16_t x, int16_t y, char c) {
+    draw_cell(find_atlas(font, color, back), font, color, back, x, y, c);
+}
+
+void glyph_draw_string(sFONT* font, uint32_t color, uint32_t back, int16_t x, int16_t y, const char* text) {
+    GlyphAtlas* a = find_atlas(font, color, back);
+    for(; *text != '\0' && x + font->Width <= DISPLAY_WIDTH; text++) {
+        draw_cell(a, font, color, back, x, y, *text);
+        x += font->Width;
+    }
+}
+
+void glyph_cache_reset() {
+    glyph_count = 0;
+    glyph_pool_next = GLYPH_POOL_ADDR;
+    memset(&glyph_counters, 0, sizeof(glyph_counters));
+}
+
+GlyphStats glyph_stats() {
+    return glyph_counters;
+}
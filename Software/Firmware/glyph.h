@@ -0,0 +1,50 @@
+#ifndef GLYPH_H
+#define GLYPH_H
+
+#include "mbed.h"
+#include "display.h"
+#include "sprite.h"
+
+// ==================== GLYPH ATLAS ====================
+// Text on the content layer is drawn from pre-rasterised glyphs instead of
+// BSP_LCD_DisplayStringAt, which re-measures the string and expands every
+// character bit by bit from the font table on each call.
+//
+// Each font/colour/background combination gets an atlas: one cell per
+// printable character, rasterised by BSP_LCD_DisplayChar the first time
+// that character is drawn and kept in an SDRAM pool as ARGB8888. The cell
+// holds the full character box, background included, so drawing it is an
+// opaque rectangle copy (DMA2D on the board, the CPU otherwise) that gives
+// exactly the pixels the BSP would have.
+#define GLYPH_FIRST             ' '
+#define GLYPH_COUNT             95                  // ' '..'~'
+#define GLYPH_ATLAS_SLOTS       24
+#define GLYPH_CANVAS_ADDR       SPRITE_SDRAM_FREE   // Screen stride, GLYPH_CANVAS_ROWS rows
+#define GLYPH_CANVAS_ROWS       32                  // Tallest font cell
+#define GLYPH_POOL_ADDR         (GLYPH_CANVAS_ADDR + GLYPH_CANVAS_ROWS * DISPLAY_WIDTH * 4)
+#define GLYPH_POOL_BYTES        (1024 * 1024)
+#define GLYPH_SDRAM_FREE        (GLYPH_POOL_ADDR + GLYPH_POOL_BYTES)
+
+struct GlyphStats {
+    uint32_t rasterised;        // Cells drawn by the BSP (cache misses)
+    uint32_t blits;
+    uint32_t dma2d_blits;
+    uint32_t pixels;            // Copied pixels, both paths
+    uint32_t pool_used;         // Bytes
+};
+
+// One character cell at (x, y) on the layer being drawn, as
+// BSP_LCD_DisplayChar with that font and those colours would draw it. Whole
+// cells only: a cell that would cross the screen edge is skipped. Only
+// between display_begin_frame() and display_present(); leaves the BSP
+// font and colours as they were. Falls back to the BSP when the atlas
+// slots or the pool are full.
+void glyph_draw_char(sFONT* font, uint32_t color, uint32_t back, int16_t x, int16_t y, char c);
+
+// BSP_LCD_DisplayStringAt(x, y, text, LEFT_MODE) through the atlas
+void glyph_draw_string(sFONT* font, uint32_t color, uint32_t back, int16_t x, int16_t y, const char* text);
+
+void       glyph_cache_reset();
+GlyphStats glyph_stats();
+
+#endif
@@ -0,0 +1,1122 @@
+#include "hmi.h"
+#include "marshalling.h"
+#include "numfmt.h"
+#include "profiler.h"
+#include "blackbox.h"
+#include "memstats.h"
+#include <math.h>
+
+// ==================== ADVANCED DRAWING PRIMITIVES ====================
+
+void draw_circle_outline(uint16_t x, uint16_t y, uint16_t radius, uint32_t color, uint8_t thickness) {
+    for(int t = 0; t < thickness; t++) {
+        BSP_LCD_SetTextColor(color);
+        BSP_LCD_DrawCircle(x, y, radius - t);
+    }
+}
+
+void draw_hmi_panel(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char* title) {
+    // Panel background
+    BSP_LCD_SetTextColor(HMI_SURFACE);
+    BSP_LCD_FillRect(x, y, w, h);
+    
+    // Border with 3D effect
+    BSP_LCD_SetTextColor(HMI_PANEL_BORDER);
+    BSP_LCD_DrawRect(x, y, w, h);
+    BSP_LCD_DrawRect(x + 1, y + 1, w - 2, h - 2);
+    
+    // Corner accents
+    BSP_LCD_SetTextColor(HMI_ACCENT_BLUE);
+    BSP_LCD_DrawHLine(x + 2, y + 2, 10);
+    BSP_LCD_DrawVLine(x + 2, y + 2, 10);
+    BSP_LCD_DrawHLine(x + w - 12, y + 2, 10);
+    BSP_LCD_DrawVLine(x + w - 3, y + 2, 10);
+    
+    // Title bar
+    if(title != NULL) {
+        BSP_LCD_SetTextColor(HMI_PANEL_BORDER);
+        BSP_LCD_FillRect(x + 2, y + 2, w - 4, 20);
+        BSP_LCD_SetFont(&Font12);
+        BSP_LCD_SetBackColor(HMI_PANEL_BORDER);
+        BSP_LCD_SetTextColor(HMI_ACCENT_BLUE);
+        BSP_LCD_DisplayStringAt(x + 8, y + 7, (uint8_t*)title, LEFT_MODE);
+    }
+}
+
+void draw_aviation_button(uint16_t x, uint16_t y, uint16_t w, uint16_t h, 
+                          const char* text, uint32_t color, bool active) {
+    // Button body
+    if(active) {
+        BSP_LCD_SetTextColor(color);
+        BSP_LCD_FillRect(x + 2, y + 2, w - 4, h - 4);
+    } else {
+        BSP_LCD_SetTextColor(HMI_SURFACE);
+        BSP_LCD_FillRect(x + 2, y + 2, w - 4, h - 4);
+    }
+    
+    // Border
+    BSP_LCD_SetTextColor(color);
+    BSP_LCD_DrawRect(x, y, w, h);
+    BSP_LCD_DrawRect(x + 1, y + 1, w - 2, h - 2);
+    
+    // Corner indicators
+    BSP_LCD_FillRect(x, y, 4, 4);
+    BSP_LCD_FillRect(x + w - 4, y, 4, 4);
+    BSP_LCD_FillRect(x, y + h - 4, 4, 4);
+    BSP_LCD_FillRect(x + w - 4, y + h - 4, 4, 4);
+    
+    // Text
+    BSP_LCD_SetFont(&Font16);
+    if(active) {
+        BSP_LCD_SetBackColor(color);
+        BSP_LCD_SetTextColor(HMI_BACKGROUND);
+    } else {
+        BSP_LCD_SetBackColor(HMI_SURFACE);
+        BSP_LCD_SetTextColor(color);
+    }
+    uint16_t text_x = x + (w - strlen(text) * 11) / 2;
+    uint16_t text_y = y + (h - 16) / 2;
+    BSP_LCD_DisplayStringAt(text_x, text_y, (uint8_t*)text, LEFT_MODE);
+}
+
+// ==================== AIRCRAFT ICON (High Quality) ====================
+void draw_aircraft_icon_hq(uint16_t x, uint16_t y, uint32_t color, bool glow) {
+    // Glow effect
+    if(glow) {
+        BSP_LCD_SetTextColor(color & 0x40FFFFFF);
+        BSP_LCD_FillCircle(x, y, 45);
+    }
+    
+    BSP_LCD_SetTextColor(color);
+    
+    // Fuselage (main body)
+    BSP_LCD_FillRect(x - 6, y - 25, 12, 50);
+    BSP_LCD_FillCircle(x, y - 25, 8);
+    
+    // Wings
+    BSP_LCD_FillRect(x - 35, y - 5, 70, 8);
+    // Wing tips
+    for(int i = 0; i < 5; i++) {
+        BSP_LCD_DrawHLine(x - 35 + i, y - 5 - i, 3);
+        BSP_LCD_DrawHLine(x + 32 - i, y - 5 - i, 3);
+    }
+    
+    // Tail
+    BSP_LCD_FillRect(x - 15, y + 20, 30, 5);
+    BSP_LCD_FillRect(x - 5, y + 15, 10, 15);
+    
+    // Engines
+    BSP_LCD_FillCircle(x - 18, y, 5);
+    BSP_LCD_FillCircle(x + 18, y, 5);
+    
+    // Cockpit window
+    BSP_LCD_SetTextColor(HMI_ACCENT_BLUE);
+    BSP_LCD_FillRect(x - 3, y - 20, 6, 8);
+    
+    // Details
+    BSP_LCD_SetTextColor(0x80FFFFFF);
+    BSP_LCD_DrawVLine(x - 1, y - 20, 40);
+}
+
+// Sprite-cache signature (origin + colour) for the glowing variant
+void draw_aircraft_icon_glow(uint16_t x, uint16_t y, uint32_t color) {
+    draw_aircraft_icon_hq(x, y, color, true);
+}
+
+// ==================== DIRECTION ARROWS ====================
+// Drawn once per colour into the sprite cache; the directive screen marches
+// them by blitting the cached sprite at an offset, never by redrawing.
+void draw_arrow_left_hmi(uint16_t x, uint16_t y, uint32_t color) {
+    BSP_LCD_SetTextColor(color);
+    
+    // Arrow shaft
+    BSP_LCD_FillRect(x + 20, y + 15, 30, 10);
+    
+    // Arrow head - perfect triangle
+    for(int i = 0; i < 15; i++) {
+        BSP_LCD_DrawVLine(x + i, y + 20 - i, 2 * i);
+    }
+    
+    // Clean outline
+    BSP_LCD_SetTextColor(HMI_BACKGROUND);
+    BSP_LCD_DrawRect(x + 20, y + 15, 30, 10);
+}
+
+void draw_arrow_right_hmi(uint16_t x, uint16_t y, uint32_t color) {
+    BSP_LCD_SetTextColor(color);
+    
+    // Arrow shaft
+    BSP_LCD_FillRect(x + 10, y + 15, 30, 10);
+    
+    // Arrow head - perfect triangle pointing right
+    for(int i = 0; i < 15; i++) {
+        BSP_LCD_DrawVLine(x + 40 + i, y + 5 + i, 30 - 2 * i);
+    }
+    
+    // Clean outline
+    BSP_LCD_SetTextColor(HMI_BACKGROUND);
+    BSP_LCD_DrawRect(x + 10, y + 15, 30, 10);
+}
+
+void draw_arrow_up_hmi(uint16_t x, uint16_t y, uint32_t color) {
+    BSP_LCD_SetTextColor(color);
+    
+    // Arrow shaft
+    BSP_LCD_FillRect(x + 15, y + 20, 10, 30);
+    
+    // Arrow head - perfect triangle pointing up
+    for(int i = 0; i < 15; i++) {
+        BSP_LCD_DrawHLine(x + 20 - i, y + i, 2 * i);
+    }
+    
+    // Clean outline
+    BSP_LCD_SetTextColor(HMI_BACKGROUND);
+    BSP_LCD_DrawRect(x + 15, y + 20, 10, 30);
+}
+
+// ==================== STOP SIGN ====================
+// Pulsed by colour: each of the AUTO_PULSE_LEVELS shades is its own sprite.
+void draw_stop_sign_hmi(uint16_t x, uint16_t y, uint32_t color) {
+    BSP_LCD_SetTextColor(color);
+    
+    // Octagon
+    BSP_LCD_FillRect(x + 8, y, 24, 40);
+    BSP_LCD_FillRect(x, y + 8, 40, 24);
+    BSP_LCD_FillRect(x + 4, y + 4, 6, 6);
+    BSP_LCD_FillRect(x + 30, y + 4, 6, 6);
+    BSP_LCD_FillRect(x + 4, y + 30, 6, 6);
+    BSP_LCD_FillRect(x + 30, y + 30, 6, 6);
+    
+    // Border
+    BSP_LCD_SetTextColor(HMI_TEXT_WHITE);
+    BSP_LCD_DrawCircle(x + 20, y + 20, 20);
+    BSP_LCD_DrawCircle(x + 20, y + 20, 19);
+    
+    // STOP text
+    BSP_LCD_SetFont(&Font16);
+    BSP_LCD_SetBackColor(color);
+    BSP_LCD_SetTextColor(HMI_TEXT_WHITE);
+    BSP_LCD_DisplayStringAt(x + 5, y + 16, (uint8_t*)"STOP", LEFT_MODE);
+}
+
+// ==================== STATUS INDICATORS ====================
+void draw_status_led(uint16_t x, uint16_t y, uint32_t color, bool active) {
+    if(active) {
+        BSP_LCD_SetTextColor(color);
+        BSP_LCD_FillCircle(x, y, 6);
+        BSP_LCD_SetTextColor(color & 0x60FFFFFF);
+        BSP_LCD_FillCircle(x, y, 9);
+    } else {
+        BSP_LCD_SetTextColor(0xFF1A1A1A);
+        BSP_LCD_FillCircle(x, y, 6);
+    }
+    BSP_LCD_SetTextColor(HMI_GRID_LINE);
+    draw_circle_outline(x, y, 7, HMI_GRID_LINE, 1);
+}
+
+// ==================== DAMAGE-TRACKED WIDGETS ====================
+DamageTracker hmi_damage(SCREEN_W, SCREEN_H);
+
+// Where BSP_LCD_DisplayStringAt would put the text (x0..x1 by y0..y1)
+static DamageRect text_extent(const HmiText* t) {
+    uint32_t len = strlen(t->text);
+    uint32_t cols = SCREEN_W / t->font->Width;
+    if(len > cols) len = cols;
+    int16_t x = t->x;
+    if(t->center) {
+        x = (len <= cols) ? ((cols - len) * t->font->Width) / 2 : 1;
+        if(x < 1) x = 1;
+    }
+    return damage_rect(x, t->y, len * t->font->Width, t->font->Height);
+}
+
+void hmi_text_init(HmiText* t, uint16_t x, uint16_t y, sFONT* font, uint32_t back, bool center) {
+    t->x = x;
+    t->y = y;
+    t->center = center;
+    t->font = font;
+    t->back = back;
+    t->text[0] = '\0';
+    t->color = 0;
+    t->drawn[0] = '\0';
+    t->drawn_color = 0;
+    t->shown = damage_rect(x, y, 0, 0);
+}
+
+void hmi_text_set(HmiText* t, const char* text, uint32_t color) {
+    if(color == t->color && strncmp(text, t->text, HMI_TEXT_MAX) == 0) {
+        return;
+    }
+    strncpy(t->text, text, HMI_TEXT_MAX - 1);
+    t->text[HMI_TEXT_MAX - 1] = '\0';
+    t->color = color;
+    
+    DamageRect target = text_extent(t);
+    if(color != t->drawn_color || target.x0 != t->shown.x0 || target.x1 != t->shown.x1) {
+        hmi_damage.invalidate(t->shown);
+        hmi_damage.invalidate(target);
+        return;
+    }
+    
+    // Same colour and cells: only the characters that differ from the screen
+    int16_t w = t->font->Width;
+    for(int16_t i = 0; target.x0 + (i + 1) * w <= target.x1; i++) {
+        if(t->text[i] != t->drawn[i]) {
+            hmi_damage.invalidate(target.x0 + i * w, target.y0, w, target.y1 - target.y0);
+        }
+    }
+}
+
+void hmi_text_paint(HmiText* t) {
+    DamageRect target = text_extent(t);
+    if(!hmi_damage.is_dirty(target) && !hmi_damage.is_dirty(t->shown)) {
+        return;
+    }
+
+    // Erase whatever the old string covered that the new one will not
+    BSP_LCD_SetTextColor(t->back);
+    if(t->shown.x0 < target.x0) {
+        BSP_LCD_FillRect(t->shown.x0, t->shown.y0, target.x0 - t->shown.x0, t->shown.y1 - t->shown.y0);
+    }
+    if(t->shown.x1 > target.x1) {
+        int16_t x = target.x1 > t->shown.x0 ? target.x1 : t->shown.x0;
+        BSP_LCD_FillRect(x, t->shown.y0, t->shown.x1 - x, t->shown.y1 - t->shown.y0);
+    }
+
+    // Cells this frame's damage touches; the rest already show the right
+    // glyph. A cell is drawn whole, so all of it counts as damage: rows
+    // that overlap a neighbour's edge (the diagnostics table) must reach
+    // the back buffer and the mirror too.
+    int16_t w = t->font->Width;
+    int16_t h = target.y1 - target.y0;
+    for(int16_t i = 0; target.x0 + (i + 1) * w <= target.x1; i++) {
+        DamageRect cell = damage_rect(target.x0 + i * w, target.y0, w, h);
+        if(hmi_damage.is_dirty(cell)) {
+            glyph_draw_char(t->font, t->color, t->back, cell.x0, cell.y0, t->text[i]);
+            hmi_damage.invalidate(cell);
+        }
+    }
+    memcpy(t->drawn, t->text, HMI_TEXT_MAX);
+    t->drawn_color = t->color;
+    t->shown = target;
+}
+
+void hmi_bar_init(HmiBar* b, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t back) {
+    b->x = x;
+    b->y = y;
+    b->w = w;
+    b->h = h;
+    b->back = back;
+    b->length = 0;
+    b->color = back;
+}
+
+void hmi_bar_set(HmiBar* b, uint16_t length, uint32_t color) {
+    if(length > b->w) length = b->w;
+    if(color != b->color) {
+        hmi_damage.invalidate(b->x, b->y, b->w, b->h);
+    } else if(length != b->length) {
+        // Only the span between the old and new fill edge changes
+        uint16_t lo = length < b->length ? length : b->length;
+        uint16_t hi = length < b->length ? b->length : length;
+        hmi_damage.invalidate(b->x + lo, b->y, hi - lo, b->h);
+    }
+    b->length = length;
+    b->color = color;
+}
+
+void hmi_bar_paint(const HmiBar* b) {
+    DamageRect bar = damage_rect(b->x, b->y, b->w, b->h);
+    int16_t split = b->x + b->length;
+
+    for(uint8_t i = 0; i < hmi_damage.count(); i++) {
+        const DamageRect& d = hmi_damage.rect(i);
+        if(!d.intersects(bar)) {
+            continue;
+        }
+        int16_t x0 = d.x0 > bar.x0 ? d.x0 : bar.x0;
+        int16_t x1 = d.x1 < bar.x1 ? d.x1 : bar.x1;
+        int16_t y0 = d.y0 > bar.y0 ? d.y0 : bar.y0;
+        int16_t y1 = d.y1 < bar.y1 ? d.y1 : bar.y1;
+
+        if(x0 < split) {
+            int16_t e = x1 < split ? x1 : split;
+            BSP_LCD_SetTextColor(b->color);
+            BSP_LCD_FillRect(x0, y0, e - x0, y1 - y0);
+        }
+        if(x1 > split) {
+            int16_t s = x0 > split ? x0 : split;
+            BSP_LCD_SetTextColor(b->back);
+            BSP_LCD_FillRect(s, y0, x1 - s, y1 - y0);
+        }
+    }
+}
+
+void hmi_led_set(HmiLed* l, uint16_t x, uint16_t y, uint32_t color, bool active) {
+    if(l->valid && l->x == x && l->y == y && l->color == color && l->active == active) {
+        return;
+    }
+    l->x = x;
+    l->y = y;
+    l->color = color;
+    l->active = active;
+    l->valid = true;
+    hmi_damage.invalidate(x - 9, y - 9, 19, 19);
+}
+
+// Cleared first so an inactive LED does not keep the old glow ring
+void hmi_led_paint(const HmiLed* l) {
+    if(l->valid && hmi_damage.is_dirty(damage_rect(l->x - 9, l->y - 9, 19, 19))) {
+        BSP_LCD_SetTextColor(HMI_TRANSPARENT);
+        BSP_LCD_FillRect(l->x - 9, l->y - 9, 19, 19);
+        draw_status_led(l->x, l->y, l->color, l->active);
+    }
+}
+
+// ==================== LCD INIT ====================
+void lcd_init() {
+    display_init(HMI_BACKGROUND);
+    sprite_cache_reset();
+    glyph_cache_reset();
+}
+
+// ==================== HOME SCREEN WITH DISTANCE DISPLAY ====================
+// Distance panel content area; the only part of the home screen that changes
+#define HOME_READOUT_X  342
+#define HOME_READOUT_Y  105
+#define HOME_READOUT_W  126
+#define HOME_READOUT_H  72
+
+static char home_readout_key[20];   // Reading currently on screen
+
+static void home_readout_format(float dist, char* key) {
+    if(dist > 0 && dist <= 400) {
+        numfmt_fixed(key, numfmt_scale(dist, 1), 1, 0);
+    } else {
+        strcpy(key, "---");
+    }
+}
+
+// Caller holds lcd_mutex. Repaints the readout only if the text would differ.
+static void draw_home_distance_readout(float dist) {
+    char key[20];
+    home_readout_format(dist, key);
+    if(strcmp(key, home_readout_key) == 0) {
+        return;
+    }
+    strcpy(home_readout_key, key);
+    hmi_damage.invalidate(HOME_READOUT_X, HOME_READOUT_Y, HOME_READOUT_W, HOME_READOUT_H);
+    
+    BSP_LCD_SetTextColor(HMI_TRANSPARENT);
+    BSP_LCD_FillRect(HOME_READOUT_X, HOME_READOUT_Y, HOME_READOUT_W, HOME_READOUT_H);
+    
+    if(dist > 0 && dist <= 400) {
+        // Valid distance reading
+        uint32_t dist_color = HMI_DISPLAY_GREEN;
+        if(dist < 10) dist_color = HMI_WARNING_RED;
+        else if(dist < 30) dist_color = HMI_CAUTION_AMBER;
+        
+        glyph_draw_string(&Font20, dist_color, HMI_TRANSPARENT, 350, 110, key);
+        glyph_draw_string(&Font16, dist_color, HMI_TRANSPARENT, 350, 135, "cm");
+        
+        // Status indicator
+        const char* status = "SAFE";
+        if(dist < 10) {
+            status = "TOO CLOSE";
+        } else if(dist < 30) {
+            status = "CAUTION";
+        }
+        glyph_draw_string(&Font12, HMI_TEXT_GRAY, HMI_TRANSPARENT, 350, 160, status);
+    } else {
+        // Out of range
+        glyph_draw_string(&Font20, HMI_TEXT_GRAY, HMI_TRANSPARENT, 350, 110, "---");
+        glyph_draw_string(&Font12, HMI_TEXT_GRAY, HMI_TRANSPARENT, 350, 135, "OUT OF");
+        glyph_draw_string(&Font12, HMI_TEXT_GRAY, HMI_TRANSPARENT, 350, 150, "RANGE");
+    }
+}
+
+void show_home_screen() {
+    display_begin_frame();
+    PROF_START(prof_t);
+    lcd_lock();
+    if(display_begin_screen(hmi_damage, HMI_SCREEN_HOME, HMI_BACKGROUND)) {
+        // Grid background
+        BSP_LCD_SetTextColor(HMI_GRID_LINE);
+        for(int i = 0; i < SCREEN_H; i += 20) {
+            BSP_LCD_DrawHLine(0, i, SCREEN_W);
+        }
+        for(int i = 0; i < SCREEN_W; i += 20) {
+            BSP_LCD_DrawVLine(i, 0, SCREEN_H);
+        }
+        
+        // Top header panel
+        draw_hmi_panel(10, 5, 460, 45, "AIRCRAFT GROUND CONTROL");
+        
+        // System info
+        BSP_LCD_SetFont(&Font16);
+        BSP_LCD_SetBackColor(HMI_SURFACE);
+        BSP_LCD_SetTextColor(HMI_ACCENT_BLUE);
+        BSP_LCD_DisplayStringAt(20, 30, (uint8_t*)"MARSHALLING SYSTEM v3.1", LEFT_MODE);
+        
+        // Status LEDs
+        BSP_LCD_SetFont(&Font12);
+        BSP_LCD_SetTextColor(HMI_TEXT_GRAY);
+        BSP_LCD_DisplayStringAt(320, 30, (uint8_t*)"SYS", LEFT_MODE);
+        draw_status_led(350, 35, HMI_INDICATOR_ON, true);
+        BSP_LCD_DisplayStringAt(360, 30, (uint8_t*)"PWR", LEFT_MODE);
+        draw_status_led(390, 35, HMI_INDICATOR_ON, true);
+        BSP_LCD_DisplayStringAt(400, 30, (uint8_t*)"RDY", LEFT_MODE);
+        draw_status_led(430, 35, HMI_DISPLAY_GREEN, true);
+        
+        // Main display panel
+        draw_hmi_panel(30, 60, 300, 140, "OPERATION CONTROL");
+        
+        // Aircraft icon in center
+        sprite_draw_icon(draw_aircraft_icon_glow, HMI_ACCENT_BLUE, 180, 115);
+        
+        // System status text
+        BSP_LCD_SetFont(&Font16);
+        BSP_LCD_SetBackColor(HMI_SURFACE);
+        BSP_LCD_SetTextColor(HMI_DISPLAY_GREEN);
+        BSP_LCD_DisplayStringAt(40, 160, (uint8_t*)"SYSTEM OPERATIONAL", LEFT_MODE);
+        
+        BSP_LCD_SetFont(&Font12);
+        BSP_LCD_SetTextColor(HMI_TEXT_GRAY);
+        BSP_LCD_DisplayStringAt(40, 178, (uint8_t*)"SELECT MODE TO BEGIN", LEFT_MODE);
+        
+        // Diagnostics (profiler) entry
+        draw_aviation_button(255, 166, 64, 26, "DIAG", HMI_TEXT_GRAY, false);
+        
+        // Distance panel (NEW)
+        draw_hmi_panel(340, 60, 130, 140, "DISTANCE");
+        
+        // Control buttons (3 buttons now)
+        draw_aviation_button(35, 215, 130, 45, "AUTO MODE", HMI_DISPLAY_GREEN, false);
+        draw_aviation_button(175, 215, 130, 45, "DISTANCE", HMI_ACCENT_BLUE, false);
+        draw_aviation_button(315, 215, 130, 45, "EXIT", HMI_WARNING_RED, false);
+        
+        // Corner decorations
+        BSP_LCD_SetTextColor(HMI_ACCENT_BLUE);
+        for(int i = 0; i < 15; i++) {
+            BSP_LCD_DrawPixel(5 + i, 5, HMI_ACCENT_BLUE);
+            BSP_LCD_DrawPixel(5, 5 + i, HMI_ACCENT_BLUE);
+            BSP_LCD_DrawPixel(SCREEN_W - 6 - i, 5, HMI_ACCENT_BLUE);
+            BSP_LCD_DrawPixel(SCREEN_W - 6, 5 + i, HMI_ACCENT_BLUE);
+        }
+        display_end_chrome();
+    }
+    
+    // Live distance readout (refresh_home_screen repaints it on change)
+    home_readout_key[0] = '\0';
+    draw_home_distance_readout(sensor_distance_cm());
+    
+    display_present(hmi_damage);
+    lcd_unlock();
+    PROF_STOP(PROF_RENDER_HOME, prof_t);
+}
+
+// Called on every new ultrasonic reading while the home screen is shown
+void refresh_home_screen() {
+    float dist = sensor_distance_cm();
+    char key[20];
+    home_readout_format(dist, key);
+    if(strcmp(key, home_readout_key) == 0) {
+        return;
+    }
+    display_begin_frame();
+    PROF_START(prof_t);
+    lcd_lock();
+    draw_home_distance_readout(dist);
+    display_present(hmi_damage);
+    lcd_unlock();
+    PROF_STOP(PROF_RENDER_HOME, prof_t);
+}
+
+// ==================== SHUTDOWN SCREEN ====================
+void show_shutdown_screen() {
+    display_begin_frame();
+    lcd_lock();
+    if(display_begin_screen(hmi_damage, HMI_SCREEN_SHUTDOWN, HMI_BACKGROUND)) {
+        draw_hmi_panel(90, 80, 300, 110, "SYSTEM SHUTDOWN");
+        draw_aircraft_icon_hq(240, 135, HMI_WARNING_RED, true);
+        BSP_LCD_SetFont(&Font20);
+        BSP_LCD_SetBackColor(HMI_SURFACE);
+        BSP_LCD_SetTextColor(HMI_WARNING_RED);
+        BSP_LCD_DisplayStringAt(0, 165, (uint8_t*)"SYSTEM EXITED", CENTER_MODE);
+        BSP_LCD_SetFont(&Font12);
+        BSP_LCD_SetTextColor(HMI_TEXT_GRAY);
+        BSP_LCD_DisplayStringAt(0, 185, (uint8_t*)"SAFE TO POWER DOWN", CENTER_MODE);
+        display_end_chrome();
+    }
+    display_present(hmi_damage);
+    lcd_unlock();
+}
+
+// ==================== DIAGNOSTICS SCREEN ====================
+// Two pages in the same table: one row per profiler probe, in microseconds,
+// or the memory budget (memstats.h) in two columns. Each row is a fixed-
+// width HmiText, so a refresh repaints only the digits that changed. The
+// page's titles are content too, so turning the page keeps the chrome.
+#define DIAG_ROW_X      20
+#define DIAG_ROW_Y      86
+#define DIAG_ROW_STEP   11      // Font12 cells; the glyphs' top row is blank
+#define DIAG_MEM_CELL   26      // name(10) size(8) used(8)
+
+static HmiText diag_rows[PROF_PROBES];
+static HmiText diag_overhead;
+static HmiText diag_blackbox;
+static HmiText diag_subtitle;
+static HmiText diag_title;
+static HmiText diag_header;
+static uint8_t diag_page = HMI_DIAG_PROFILER;
+
+#if PROFILER_ENABLED
+// name(13) n(7) mean p50 p99 max (9 each, one decimal)
+static void diag_format_row(char* out, uint8_t probe) {
+    const ProfHistogram* h = prof_histogram(probe);
+    const char* name = prof_name(probe);
+    uint8_t n = 0;
+    while(name[n] != '\0' && n < 13) {
+        out[n] = name[n];
+        n++;
+    }
+    while(n < 13) {
+        out[n++] = ' ';
+    }
+    n += numfmt_fixed(out + n, (int32_t)h->count, 0, 7);
+    uint32_t mean = h->count ? (uint32_t)(h->sum / h->count) : 0;
+    n += numfmt_fixed(out + n, (int32_t)prof_cycles_to_us10(mean), 1, 9);
+    n += numfmt_fixed(out + n, (int32_t)prof_cycles_to_us10(prof_percentile(h, 50)), 1, 9);
+    n += numfmt_fixed(out + n, (int32_t)prof_cycles_to_us10(prof_percentile(h, 99)), 1, 9);
+    numfmt_fixed(out + n, (int32_t)prof_cycles_to_us10(h->max), 1, 9);
+}
+#endif
+
+static uint8_t diag_format_cell(char* out, const MemEntry& e) {
+    uint8_t n = 0;
+    while(e.name[n] != '\0' && n < 10) {
+        out[n] = e.name[n];
+        n++;
+    }
+    while(n < 10) {
+        out[n++] = ' ';
+    }
+    n += numfmt_fixed(out + n, (int32_t)e.size, 0, 8);
+    if(e.used != MEM_NA) {
+        n += numfmt_fixed(out + n, (int32_t)e.used, 0, 8);
+    } else {
+        strcpy(out + n, "       -");
+        n += 8;
+    }
+    return n;
+}
+
+// Entries down the left column, then the right
+static void diag_refresh_memory(char* line) {
+    MemEntry e[MEM_ENTRIES_MAX];
+    uint8_t count = mem_entries(e, MEM_ENTRIES_MAX);
+    for(uint8_t r = 0; r < PROF_PROBES; r++) {
+        uint8_t n = 0;
+        line[0] = '\0';
+        if(r < count) {
+            n = diag_format_cell(line, e[r]);
+        }
+        if(r + PROF_PROBES < count) {
+            while(n < DIAG_MEM_CELL + 2) {
+                line[n++] = ' ';
+            }
+            diag_format_cell(line + n, e[r + PROF_PROBES]);
+        }
+        hmi_text_set(&diag_rows[r], line, HMI_DISPLAY_GREEN);
+    }
+
+    MemHeap h = mem_heap();
+    uint8_t n;
+    if(h.available) {
+        strcpy(line, "HEAP ");
+        n = strlen(line);
+        n += numfmt_uint(line + n, h.current);
+        strcpy(line + n, " B IN USE, ");
+        n += strlen(line + n);
+        n += numfmt_uint(line + n, h.allocs);
+        strcpy(line + n, " ALLOCS, ");
+    } else {
+        strcpy(line, "NO HEAP STATS IN THIS BUILD, ");
+    }
+    n = strlen(line);
+    n += numfmt_uint(line + n, h.late);
+    strcpy(line + n, " AFTER BOOT");
+    hmi_text_set(&diag_overhead, line, h.late ? HMI_CAUTION_AMBER : HMI_TEXT_GRAY);
+}
+
+void show_diag_screen() {
+    for(uint8_t p = 0; p < PROF_PROBES; p++) {
+        hmi_text_init(&diag_rows[p], DIAG_ROW_X, DIAG_ROW_Y + p * DIAG_ROW_STEP, &Font12, HMI_TRANSPARENT, false);
+    }
+    hmi_text_init(&diag_overhead, DIAG_ROW_X, DIAG_ROW_Y + PROF_PROBES * DIAG_ROW_STEP + 2,
+                  &Font12, HMI_TRANSPARENT, false);
+    hmi_text_init(&diag_blackbox, 250, 20, &Font12, HMI_TRANSPARENT, false);
+    hmi_text_init(&diag_subtitle, 20, 20, &Font12, HMI_TRANSPARENT, false);
+    hmi_text_init(&diag_title, 18, 52, &Font12, HMI_TRANSPARENT, false);
+    hmi_text_init(&diag_header, DIAG_ROW_X, DIAG_ROW_Y - 14, &Font12, HMI_TRANSPARENT, false);
+    
+    display_begin_frame();
+    lcd_lock();
+    if(display_begin_screen(hmi_damage, HMI_SCREEN_DIAG, HMI_BACKGROUND)) {
+        draw_hmi_panel(10, 5, 460, 35, "DIAGNOSTICS");
+        draw_hmi_panel(10, 45, 460, 178, "");
+        
+        draw_aviation_button(20, 228, 80, 38, "BACK", HMI_ACCENT_BLUE, false);
+        draw_aviation_button(108, 228, 80, 38, "RESET", HMI_CAUTION_AMBER, false);
+        draw_aviation_button(196, 228, 80, 38, "DUMP", HMI_DISPLAY_GREEN, false);
+        draw_aviation_button(284, 228, 80, 38, "SEND", HMI_DISPLAY_GREEN, false);
+        draw_aviation_button(372, 228, 80, 38, "PAGE", HMI_ACCENT_BLUE, false);
+        display_end_chrome();
+    }
+    display_present(hmi_damage);
+    lcd_unlock();
+    
+    refresh_diag_screen();
+}
+
+static void diag_refresh_profiler(char* line) {
+#if PROFILER_ENABLED
+    for(uint8_t p = 0; p < PROF_PROBES; p++) {
+        diag_format_row(line, p);
+        hmi_text_set(&diag_rows[p], line, prof_histogram(p)->count ? HMI_DISPLAY_GREEN : HMI_TEXT_GRAY);
+    }
+    strcpy(line, "OVERHEAD: EMPTY SPAN ");
+    uint8_t n = strlen(line);
+    n += numfmt_uint(line + n, prof_span_overhead());
+    strcpy(line + n, " CYC, RECORD ");
+    n += strlen(line + n);
+    n += numfmt_uint(line + n, prof_record_overhead());
+    strcpy(line + n, " CYC");
+    hmi_text_set(&diag_overhead, line, HMI_TEXT_GRAY);
+#else
+    for(uint8_t p = 1; p < PROF_PROBES; p++) {
+        hmi_text_set(&diag_rows[p], "", HMI_TEXT_GRAY);
+    }
+    hmi_text_set(&diag_rows[0], "PROFILER DISABLED AT BUILD TIME", HMI_CAUTION_AMBER);
+    hmi_text_set(&diag_overhead, "", HMI_TEXT_GRAY);
+#endif
+}
+
+// Called on the diagnostics tick while the screen is shown
+void refresh_diag_screen() {
+    char line[HMI_TEXT_MAX];
+    if(diag_page == HMI_DIAG_MEMORY) {
+        hmi_text_set(&diag_subtitle, "MEMORY BUDGET", HMI_ACCENT_BLUE);
+        hmi_text_set(&diag_title, "STACKS, SECTIONS, BUFFERS (BYTES)", HMI_ACCENT_BLUE);
+        hmi_text_set(&diag_header, "NAME          SIZE    USED  NAME          SIZE    USED", HMI_TEXT_GRAY);
+        diag_refresh_memory(line);
+    } else {
+        hmi_text_set(&diag_subtitle, "DWT CYCLE PROFILER", HMI_ACCENT_BLUE);
+        hmi_text_set(&diag_title, "PROBE TIMES (US)", HMI_ACCENT_BLUE);
+        hmi_text_set(&diag_header, "PROBE              N     MEAN      P50      P99      MAX", HMI_TEXT_GRAY);
+        diag_refresh_profiler(line);
+    }
+    
+    // Black box: how much is recorded, or how far a send has got
+    BlackboxStats bs = blackbox_stats();
+    uint8_t k;
+    if(bs.streaming) {
+        strcpy(line, "SENDING ");
+        k = strlen(line);
+        k += numfmt_uint(line + k, bs.exported / 1024);
+        strcpy(line + k, " KB");
+    } else {
+        strcpy(line, "BLACK BOX ");
+        k = strlen(line);
+        k += numfmt_uint(line + k, bs.bytes / 1024);
+        strcpy(line + k, " KB, ");
+        k += strlen(line + k);
+        k += numfmt_uint(line + k, bs.span_us / 1000000);
+        strcpy(line + k, " S");
+    }
+    hmi_text_set(&diag_blackbox, line, bs.streaming ? HMI_CAUTION_AMBER : HMI_TEXT_GRAY);
+    
+    display_begin_frame();
+    PROF_START(prof_t);
+    lcd_lock();
+    for(uint8_t p = 0; p < PROF_PROBES; p++) {
+        hmi_text_paint(&diag_rows[p]);
+    }
+    hmi_text_paint(&diag_overhead);
+    hmi_text_paint(&diag_blackbox);
+    hmi_text_paint(&diag_subtitle);
+    hmi_text_paint(&diag_title);
+    hmi_text_paint(&diag_header);
+    display_present(hmi_damage);
+    lcd_unlock();
+    PROF_STOP(PROF_RENDER_DIAG, prof_t);
+}
+
+void next_diag_page() {
+    diag_page = (diag_page + 1) % HMI_DIAG_PAGES;
+}
+
+bool diag_memory_page() {
+    return diag_page == HMI_DIAG_MEMORY;
+}
+
+int check_diag_touch(uint16_t x, uint16_t y) {
+    if(y > 228 && y < 266) {
+        for(uint8_t b = 0; b < 5; b++) {
+            uint16_t left = 20 + b * 88;
+            if(x > left && x < left + 80) {
+                play_beep(1000, 50);
+                return b + 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// ==================== DISTANCE DETAIL SCREEN ====================
+// Static chrome goes to the chrome layer once on entry; after that only the
+// reading, the status line and the bar repaint, and only when they change.
+static HmiText distance_value;
+static HmiText distance_status;
+static HmiBar  distance_bar;
+static bool    distance_bar_visible;
+static bool    distance_first;
+
+void show_distance_screen() {
+    hmi_text_init(&distance_value, 0, 110, &Font24, HMI_TRANSPARENT, true);
+    hmi_text_init(&distance_status, 0, 145, &Font16, HMI_TRANSPARENT, true);
+    hmi_bar_init(&distance_bar, 52, 177, 376, 16, HMI_TRANSPARENT);
+    distance_bar_visible = false;
+    distance_first = true;
+    
+    refresh_distance_screen();
+}
+
+// Called on every new ultrasonic reading while the screen is shown
+void refresh_distance_screen() {
+    float dist = sensor_distance_cm();
+    bool valid = (dist > 0 && dist <= 400);
+    
+    // Widget state for this frame; each invalidates only its own rect
+    if(valid) {
+        // Fixed width, so the string stays put and only changed digits repaint
+        char dist_str[HMI_TEXT_MAX];
+        uint8_t n = numfmt_fixed(dist_str, numfmt_scale(dist, 2), 2, 6);
+        strcpy(dist_str + n, " cm");
+        
+        uint32_t dist_color = HMI_DISPLAY_GREEN;
+        if(dist < 10) dist_color = HMI_WARNING_RED;
+        else if(dist < 30) dist_color = HMI_CAUTION_AMBER;
+        hmi_text_set(&distance_value, dist_str, dist_color);
+        
+        if(dist < 10) {
+            hmi_text_set(&distance_status, "CRITICAL - TOO CLOSE", HMI_WARNING_RED);
+        } else if(dist < 30) {
+            hmi_text_set(&distance_status, "CAUTION - PROXIMITY ALERT", HMI_CAUTION_AMBER);
+        } else if(dist < 100) {
+            hmi_text_set(&distance_status, "SAFE DISTANCE", HMI_DISPLAY_GREEN);
+        } else {
+            hmi_text_set(&distance_status, "CLEAR - NO OBSTACLES", HMI_ACCENT_BLUE);
+        }
+        
+        int bar_length = (int)((dist / 400.0f) * 376);
+        if(bar_length > 376) bar_length = 376;
+        hmi_bar_set(&distance_bar, bar_length, dist_color);
+    } else {
+        hmi_text_set(&distance_value, "OUT OF RANGE", HMI_TEXT_GRAY);
+        hmi_text_set(&distance_status, "NO VALID READING", HMI_TEXT_GRAY);
+    }
+    
+    // Bar outline appears/disappears with a valid reading
+    bool bar_outline_dirty = (valid != distance_bar_visible);
+    if(bar_outline_dirty) {
+        hmi_damage.invalidate(50, 175, 381, 21);
+        distance_bar_visible = valid;
+    }
+    
+    display_begin_frame();
+    PROF_START(prof_t);
+    lcd_lock();
+    
+    if(distance_first) {
+        if(display_begin_screen(hmi_damage, HMI_SCREEN_DISTANCE, HMI_BACKGROUND)) {
+            // Grid background
+            BSP_LCD_SetTextColor(HMI_GRID_LINE);
+            for(int i = 0; i < SCREEN_H; i += 20) {
+                BSP_LCD_DrawHLine(0, i, SCREEN_W);
+            }
+            
+            // Header
+            draw_hmi_panel(10, 5, 460, 45, "DISTANCE MONITORING");
+            
+            BSP_LCD_SetFont(&Font16);
+            BSP_LCD_SetBackColor(HMI_SURFACE);
+            BSP_LCD_SetTextColor(HMI_ACCENT_BLUE);
+            BSP_LCD_DisplayStringAt(20, 30, (uint8_t*)"ULTRASONIC SENSOR", LEFT_MODE);
+            
+            // Status LEDs
+            draw_status_led(350, 23, HMI_INDICATOR_ON, true);
+            draw_status_led(370, 23, HMI_DISPLAY_GREEN, true);
+            draw_status_led(390, 23, HMI_ACCENT_BLUE, true);
+            
+            // Main panel
+            draw_hmi_panel(30, 60, 420, 150, "DISTANCE READING");
+            
+            // Footer
+            BSP_LCD_SetFont(&Font12);
+            BSP_LCD_SetBackColor(HMI_BACKGROUND);
+            BSP_LCD_SetTextColor(HMI_TEXT_GRAY);
+            BSP_LCD_DisplayStringAt(0, 225, (uint8_t*)"TAP SCREEN TO RETURN TO MAIN MENU", CENTER_MODE);
+            display_end_chrome();
+        }
+        hmi_damage.invalidate(50, 175, 381, 21);
+        bar_outline_dirty = true;
+        distance_first = false;
+    }
+    
+    // Repaint only what this frame's damage touches
+    hmi_text_paint(&distance_value);
+    hmi_text_paint(&distance_status);
+    
+    if(bar_outline_dirty) {
+        if(distance_bar_visible) {
+            BSP_LCD_SetTextColor(HMI_GRID_LINE);
+            BSP_LCD_DrawRect(50, 175, 380, 20);
+        } else {
+            BSP_LCD_SetTextColor(HMI_TRANSPARENT);
+            BSP_LCD_FillRect(50, 175, 381, 21);
+        }
+    }
+    if(distance_bar_visible) {
+        hmi_bar_paint(&distance_bar);
+    }
+    
+    display_present(hmi_damage);
+    lcd_unlock();
+    PROF_STOP(PROF_RENDER_DISTANCE, prof_t);
+}
+
+// ==================== TOUCH CHECK (UPDATED FOR 3 BUTTONS) ====================
+// Home screen button under a tap: 1 auto, 2 distance, 3 exit, 0 none
+int check_touch(uint16_t x, uint16_t y) {
+    // Auto Mode button
+    if (x > 35 && x < 165 && y > 215 && y < 260) {
+        play_beep(1000, 50);
+        return 1;
+    }
+    // Distance button
+    if (x > 175 && x < 305 && y > 215 && y < 260) {
+        play_beep(1000, 50);
+        return 2;
+    }
+    // Exit button
+    if (x > 315 && x < 445 && y > 215 && y < 260) {
+        play_beep(800, 50);
+        return 3;
+    }
+    // Diagnostics button
+    if (x > 255 && x < 319 && y > 166 && y < 192) {
+        play_beep(1000, 50);
+        return 4;
+    }
+    return 0;
+}
+
+// ==================== AUTOMATION SCREENS (SENSOR-DRIVEN) ====================
+// Band holding the three directive icons, inside the directive panel; from
+// just under the instruction, so an up arrow can march above its place
+#define AUTO_ICON_BAND_X    60
+#define AUTO_ICON_BAND_Y    135
+#define AUTO_ICON_BAND_W    360
+#define AUTO_ICON_BAND_H    66
+#define AUTO_ICON_W         56      // Every icon fits this box from its origin
+#define AUTO_ICON_H         51
+#define AUTO_PULSE_LEVELS   6       // Shades of a pulsing icon, a sprite each
+#define AUTO_PULSE_DIM      2250    // Darkest shade, of ANIM_ONE
+#define AUTO_STATUS_MS      10000   // Status bar sweep
+#define AUTO_PROGRESS_MS    5000
+#define AUTO_BLINK_MS       400     // LED 2; LED 3 takes 1.5x
+#define AUTO_STATUS_W       400
+#define AUTO_PROGRESS_W     276
+
+static HmiText   auto_title;
+static HmiText   auto_instruction;
+static HmiBar    auto_status_bar;
+static HmiBar    auto_progress;
+static HmiLed    auto_leds[3];
+static uint8_t   auto_icons_mode;
+static int16_t   auto_icon_steps[DIRECTIVE_ICONS_MAX];  // March offset or shade on screen
+
+// Timeline tracks: the bars and LEDs from entering the screen, the icons
+// from the directive appearing
+static AnimTrack auto_status_track;
+static AnimTrack auto_progress_track;
+static AnimTrack auto_blink[2];
+static AnimTrack auto_motion;
+
+const DirectivePresentation directive_presentation[DIRECTIVE_COUNT] = {
+    {"TURN LEFT", "AIRCRAFT TURN PORT SIDE", HMI_CAUTION_AMBER, draw_arrow_left_hmi, 3, {140, 240, 340}, 145, AUDIO_PATTERN_CHANGE, -1, 0, 900},
+    {"TURN RIGHT", "AIRCRAFT TURN STARBOARD", HMI_CAUTION_AMBER, draw_arrow_right_hmi, 3, {80, 180, 280}, 145, AUDIO_PATTERN_CHANGE, 1, 0, 900},
+    {"PROCEED STRAIGHT", "CONTINUE FORWARD TAXI", HMI_DISPLAY_GREEN, draw_arrow_up_hmi, 3, {130, 215, 300}, 145, AUDIO_PATTERN_CHANGE, 0, -1, 900},
+    {"STOP AIRCRAFT", "HALT - OBSTACLE DETECTED", HMI_WARNING_RED, draw_stop_sign_hmi, 3, {140, 220, 300}, 150, AUDIO_PATTERN_STOP, 0, 0, 800},
+    {"SLOW DOWN", "APPROACHING STOP LINE", HMI_CAUTION_AMBER, draw_arrow_up_hmi, 1, {215}, 145, AUDIO_PATTERN_CAUTION, 0, -1, 1800},
+    {"SLIGHT LEFT", "EASE TO PORT SIDE", HMI_DISPLAY_GREEN, draw_arrow_left_hmi, 1, {240}, 145, AUDIO_PATTERN_CHANGE, -1, 0, 1400},
+    {"SLIGHT RIGHT", "EASE TO STARBOARD", HMI_DISPLAY_GREEN, draw_arrow_right_hmi, 1, {180}, 145, AUDIO_PATTERN_CHANGE, 1, 0, 1400},
+};
+
+static bool directive_pulses(const DirectivePresentation& p) {
+    return p.march_x == 0 && p.march_y == 0;
+}
+
+// Where icon i is on the timeline: pixels along the march, or a shade. The
+// icon at the back of the row leads and the rest follow a sixth of a
+// period apart, so the surge runs along the row the way the arrows point.
+static int16_t auto_icon_step(const DirectivePresentation& p, uint8_t i, uint64_t now_us) {
+    if(directive_pulses(p)) {
+        uint16_t v = anim_value(&auto_motion, now_us);
+        return (int16_t)((v * (AUTO_PULSE_LEVELS - 1) + ANIM_ONE / 2) / ANIM_ONE);
+    }
+    uint8_t back = (p.march_x < 0 || p.march_y < 0) ? p.icons - 1 - i : i;
+    uint32_t lead = (p.icons - 1 - back) * (auto_motion.period_us / (2 * DIRECTIVE_ICONS_MAX));
+    return (int16_t)anim_lerp(0, DIRECTIVE_MARCH_PX, anim_value(&auto_motion, now_us, lead));
+}
+
+// Everything icon i covers over a whole march
+static DamageRect auto_icon_sweep(const DirectivePresentation& p, uint8_t i) {
+    int16_t x = p.icon_x[i] + (p.march_x < 0 ? -DIRECTIVE_MARCH_PX : 0);
+    int16_t y = p.icon_y + (p.march_y < 0 ? -DIRECTIVE_MARCH_PX : 0);
+    return damage_rect(x, y, AUTO_ICON_W + (p.march_x ? DIRECTIVE_MARCH_PX : 0),
+                       AUTO_ICON_H + (p.march_y ? DIRECTIVE_MARCH_PX : 0));
+}
+
+// One cached sprite blit, moved or shaded
+static void draw_directive_icon(const DirectivePresentation& p, uint8_t i, uint32_t color, int16_t step) {
+    if(directive_pulses(p)) {
+        uint32_t dim = anim_color_lerp(HMI_BACKGROUND, color, AUTO_PULSE_DIM);
+        uint16_t v = (uint16_t)(step * ANIM_ONE / (AUTO_PULSE_LEVELS - 1));
+        sprite_draw_icon(p.icon, anim_color_lerp(dim, color, v), p.icon_x[i], p.icon_y);
+    } else {
+        sprite_draw_icon(p.icon, color, p.icon_x[i] + p.march_x * step, p.icon_y + p.march_y * step);
+    }
+}
+
+// redraw_all draws the static chrome layer (on entering the screen). A direction
+// change only repaints the title, instruction, icon band and the widgets
+// whose colour changed; an animation frame only the icons, bar spans and
+// LEDs that moved.
+void draw_automation_screen(const char* title, const char* instruction, 
+                           uint32_t color, uint8_t mode, bool redraw_all) {
+    
+    display_begin_frame();
+    PROF_START(prof_t);
+    uint32_t anim_t = prof_cycles();
+    uint64_t now_us = anim_now_us();
+    lcd_lock();
+    
+    // A new directive, not the screen being entered: its latency is measured
+    // to the flip that shows it
+    bool directive_changed = !redraw_all && mode != auto_icons_mode;
+    
+    if(redraw_all) {
+        if(display_begin_screen(hmi_damage, HMI_SCREEN_AUTO, HMI_BACKGROUND)) {
+            // Grid background
+            BSP_LCD_SetTextColor(HMI_GRID_LINE);
+            for(int i = 0; i < SCREEN_H; i += 20) {
+                BSP_LCD_DrawHLine(0, i, SCREEN_W);
+            }
+            
+            // Header
+            draw_hmi_panel(10, 5, 460, 35, "ACTIVE MARSHALLING");
+            BSP_LCD_SetFont(&Font12);
+            BSP_LCD_SetBackColor(HMI_SURFACE);
+            BSP_LCD_SetTextColor(HMI_ACCENT_BLUE);
+            BSP_LCD_DisplayStringAt(20, 20, (uint8_t*)"MODE: SENSOR-DRIVEN", LEFT_MODE);
+            
+            // Main instruction panel
+            draw_hmi_panel(20, 50, 440, 160, "MARSHALLING DIRECTIVE");
+            
+            // Footer
+            BSP_LCD_SetFont(&Font12);
+            BSP_LCD_SetBackColor(HMI_BACKGROUND);
+            BSP_LCD_SetTextColor(HMI_TEXT_GRAY);
+            BSP_LCD_DisplayStringAt(0, 225, (uint8_t*)"TAP SCREEN TO ABORT SEQUENCE", CENTER_MODE);
+            
+            // Progress bar outline
+            BSP_LCD_SetTextColor(HMI_GRID_LINE);
+            BSP_LCD_DrawRect(100, 245, 280, 12);
+            display_end_chrome();
+        }
+        
+        hmi_text_init(&auto_title, 0, 90, &Font24, HMI_TRANSPARENT, true);
+        hmi_text_init(&auto_instruction, 0, 118, &Font16, HMI_TRANSPARENT, true);
+        hmi_bar_init(&auto_status_bar, 25, 73, 400, 3, HMI_TRANSPARENT);
+        hmi_bar_init(&auto_progress, 102, 247, 276, 8, HMI_TRANSPARENT);
+        for(int i = 0; i < 3; i++) {
+            auto_leds[i].valid = false;
+        }
+        auto_icons_mode = DIRECTIVE_NONE;
+        anim_start(&auto_status_track, AUTO_STATUS_MS, ANIM_EASE_LINEAR, ANIM_LOOP, now_us);
+        anim_start(&auto_progress_track, AUTO_PROGRESS_MS, ANIM_EASE_IN_OUT, ANIM_LOOP, now_us);
+        anim_start(&auto_blink[0], AUTO_BLINK_MS, ANIM_EASE_LINEAR, ANIM_LOOP, now_us);
+        anim_start(&auto_blink[1], AUTO_BLINK_MS * 3 / 2, ANIM_EASE_LINEAR, ANIM_LOOP, now_us);
+    }
+    
+    // Widget state for this frame; each invalidates only its own rect
+    const DirectivePresentation& p = directive_presentation[mode];
+    hmi_text_set(&auto_title, title, color);
+    hmi_text_set(&auto_instruction, instruction, HMI_TEXT_GRAY);
+    bool new_icons = mode != auto_icons_mode;
+    if(new_icons) {
+        hmi_damage.invalidate(AUTO_ICON_BAND_X, AUTO_ICON_BAND_Y, AUTO_ICON_BAND_W, AUTO_ICON_BAND_H);
+        auto_icons_mode = mode;
+        anim_start(&auto_motion, p.period_ms, ANIM_EASE_IN_OUT, ANIM_PINGPONG, now_us);
+    }
+    for(uint8_t i = 0; i < p.icons; i++) {
+        int16_t step = auto_icon_step(p, i, now_us);
+        if(!new_icons && step != auto_icon_steps[i]) {
+            hmi_damage.invalidate(auto_icon_sweep(p, i));
+        }
+        auto_icon_steps[i] = step;
+    }
+    
+    // Status indicators
+    hmi_led_set(&auto_leds[0], 350, 23, color, true);
+    hmi_led_set(&auto_leds[1], 370, 23, color, anim_value(&auto_blink[0], now_us) < ANIM_ONE / 2);
+    hmi_led_set(&auto_leds[2], 390, 23, color, anim_value(&auto_blink[1], now_us) < ANIM_ONE / 2);
+    
+    // Animated status bar and progress bar
+    hmi_bar_set(&auto_status_bar, anim_lerp(0, AUTO_STATUS_W, anim_value(&auto_status_track, now_us)), color);
+    hmi_bar_set(&auto_progress, anim_lerp(0, AUTO_PROGRESS_W, anim_value(&auto_progress_track, now_us)), color);
+    
+    // Repaint only what this frame's damage touches: the whole band for a
+    // new directive, else each icon whose sweep changed
+    hmi_text_paint(&auto_title);
+    hmi_text_paint(&auto_instruction);
+    if(new_icons) {
+        BSP_LCD_SetTextColor(HMI_TRANSPARENT);
+        BSP_LCD_FillRect(AUTO_ICON_BAND_X, AUTO_ICON_BAND_Y, AUTO_ICON_BAND_W, AUTO_ICON_BAND_H);
+    }
+    for(uint8_t i = 0; i < p.icons; i++) {
+        DamageRect sweep = auto_icon_sweep(p, i);
+        if(hmi_damage.is_dirty(sweep)) {
+            BSP_LCD_SetTextColor(HMI_TRANSPARENT);
+            BSP_LCD_FillRect(sweep.x0, sweep.y0, sweep.x1 - sweep.x0, sweep.y1 - sweep.y0);
+            draw_directive_icon(p, i, color, auto_icon_steps[i]);
+        }
+    }
+    for(int i = 0; i < 3; i++) {
+        hmi_led_paint(&auto_leds[i]);
+    }
+    hmi_bar_paint(&auto_status_bar);
+    hmi_bar_paint(&auto_progress);
+    
+    // No flip is in flight here (begin_frame waited it out), so the next
+    // one to land is this frame's
+    if(directive_changed) {
+        PROF_PIXELS_PENDING(PROF_DIRECTIVE, directive_sample_us);
+    }
+    display_present(hmi_damage);
+    lcd_unlock();
+    PROF_STOP(PROF_RENDER_AUTO, prof_t);
+    anim_frame_done(now_us, prof_cycles() - anim_t);
+}
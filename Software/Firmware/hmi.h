@@ -0,0 +1,155 @@
+#ifndef HMI_H
+#define HMI_H
+
+#include "mbed.h"
+#include "stm32746g_discovery_lcd.h"
+#include "damage.h"
+#include "display.h"
+#include "sprite.h"
+#include "anim.h"
+#include "glyph.h"
+#include "directives.h"
+#include "audio.h"
+
+// ==================== AVIATION HMI COLOR SCHEME ====================
+#define HMI_BACKGROUND      0xFF000814    // Dark Navy
+#define HMI_SURFACE         0xFF0A1929    // Surface Panel
+#define HMI_ACCENT_BLUE     0xFF00D9FF    // Cyan Accent
+#define HMI_DISPLAY_GREEN   0xFF00FF41    // Aviation Green
+#define HMI_CAUTION_AMBER   0xFFFFBF00    // Caution Amber
+#define HMI_WARNING_RED     0xFFFF003C    // Warning Red
+#define HMI_TEXT_WHITE      0xFFFFFFFF    // White
+#define HMI_TEXT_GRAY       0xFF8B9DC3    // Gray Text
+#define HMI_GRID_LINE       0xFF1E3A5F    // Grid Lines
+#define HMI_INDICATOR_ON    0xFF00FF88    // Active Green
+#define HMI_PANEL_BORDER    0xFF2D5F8D    // Panel Border
+#define HMI_TRANSPARENT     0x00000000    // Content layer: chrome shows through
+
+// Screen constants
+#define SCREEN_W 480
+#define SCREEN_H 272
+
+// Chrome cache slot per screen (see display.h)
+#define HMI_SCREEN_HOME         0
+#define HMI_SCREEN_DISTANCE     1
+#define HMI_SCREEN_AUTO         2
+#define HMI_SCREEN_SHUTDOWN     3
+#define HMI_SCREEN_DIAG         4
+
+// ==================== DRAWING PRIMITIVES ====================
+// Icons below are also the rasterisers for the sprite cache: screens draw
+// them through sprite_draw_icon(), which blits a cached copy.
+void draw_circle_outline(uint16_t x, uint16_t y, uint16_t radius, uint32_t color, uint8_t thickness);
+void draw_hmi_panel(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char* title);
+void draw_aviation_button(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                          const char* text, uint32_t color, bool active);
+void draw_aircraft_icon_hq(uint16_t x, uint16_t y, uint32_t color, bool glow);
+void draw_aircraft_icon_glow(uint16_t x, uint16_t y, uint32_t color);
+void draw_arrow_left_hmi(uint16_t x, uint16_t y, uint32_t color);
+void draw_arrow_right_hmi(uint16_t x, uint16_t y, uint32_t color);
+void draw_arrow_up_hmi(uint16_t x, uint16_t y, uint32_t color);
+void draw_stop_sign_hmi(uint16_t x, uint16_t y, uint32_t color);
+void draw_status_led(uint16_t x, uint16_t y, uint32_t color, bool active);
+
+// ==================== DAMAGE-TRACKED WIDGETS ====================
+// Widgets live on the content layer and normally erase to HMI_TRANSPARENT.
+// Widgets remember what is on screen. *_set() compares the new state and
+// invalidates only the widget's own rectangle in hmi_damage; *_paint()
+// redraws the widget only where this frame's damage touches it.
+//
+// Text is drawn from the glyph atlas. When a string keeps its colour and
+// extent, only the cells whose character changed are invalidated, so a
+// readout that is padded to a fixed width repaints just the digits that
+// moved.
+extern DamageTracker hmi_damage;
+
+#define HMI_TEXT_MAX 64
+
+struct HmiText {
+    uint16_t   x, y;            // Left edge (unused when centred) and top
+    bool       center;          // Same placement as BSP CENTER_MODE
+    sFONT*     font;
+    uint32_t   back;
+    char       text[HMI_TEXT_MAX];
+    uint32_t   color;
+    char       drawn[HMI_TEXT_MAX];     // Text and colour currently on screen
+    uint32_t   drawn_color;
+    DamageRect shown;           // Extent currently on screen
+};
+
+struct HmiBar {
+    uint16_t x, y, w, h;        // Fill area
+    uint32_t back;
+    uint16_t length;            // Filled pixels from the left
+    uint32_t color;
+};
+
+struct HmiLed {
+    uint16_t x, y;
+    uint32_t color;
+    bool     active;
+    bool     valid;             // False until first set()
+};
+
+void hmi_text_init(HmiText* t, uint16_t x, uint16_t y, sFONT* font, uint32_t back, bool center);
+void hmi_text_set(HmiText* t, const char* text, uint32_t color);
+void hmi_text_paint(HmiText* t);
+
+void hmi_bar_init(HmiBar* b, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t back);
+void hmi_bar_set(HmiBar* b, uint16_t length, uint32_t color);
+void hmi_bar_paint(const HmiBar* b);
+
+void hmi_led_set(HmiLed* l, uint16_t x, uint16_t y, uint32_t color, bool active);
+void hmi_led_paint(const HmiLed* l);
+
+// ==================== DIRECTIVE PRESENTATION ====================
+// How the auto-mode screen shows each DIRECTIVE_*: text, colour and a row
+// of cached icons in the directive panel. Arrows march: each surges
+// DIRECTIVE_MARCH_PX the way it points and back, one after another along
+// the row, once per period. Icons that point nowhere (STOP) pulse in
+// brightness instead.
+#define DIRECTIVE_ICONS_MAX 3
+#define DIRECTIVE_MARCH_PX  10
+
+struct DirectivePresentation {
+    const char*      title;
+    const char*      instruction;
+    uint32_t         color;
+    sprite_render_fn icon;
+    uint8_t          icons;
+    uint16_t         icon_x[DIRECTIVE_ICONS_MAX];
+    uint16_t         icon_y;
+    uint8_t          cue;               // AUDIO_PATTERN_* on entering it
+    int8_t           march_x, march_y;  // Unit direction; 0, 0 pulses
+    uint16_t         period_ms;         // One march or pulse
+};
+
+extern const DirectivePresentation directive_presentation[DIRECTIVE_COUNT];
+
+// ==================== SCREENS ====================
+void lcd_init();
+void show_home_screen();
+void refresh_home_screen();
+void show_distance_screen();
+void refresh_distance_screen();
+int check_touch(uint16_t x, uint16_t y);
+void show_shutdown_screen();
+// Animated off the timeline (anim.h), read once the last flip has landed
+void draw_automation_screen(const char* title, const char* instruction,
+                            uint32_t color, uint8_t mode, bool redraw_all);
+
+// Profiler histograms or the memory budget as a table, and the black-box
+// state; refresh repaints only the changed digits. check_diag_touch: 1 back,
+// 2 reset the histograms, 3 dump the page to serial, 4 send the black box
+// down the telemetry stream, 5 turn the page.
+#define HMI_DIAG_PROFILER       0
+#define HMI_DIAG_MEMORY         1
+#define HMI_DIAG_PAGES          2
+
+void show_diag_screen();
+void refresh_diag_screen();
+int check_diag_touch(uint16_t x, uint16_t y);
+void next_diag_page();
+bool diag_memory_page();
+
+#endif
@@ -0,0 +1,50 @@
+#include "lateral.h"
+
+// Identity until the row is calibrated on the stand
+LateralCalibration lateral_cal[LATERAL_CHANNELS] = {
+    {0, LATERAL_GAIN_ONE},      // A0
+    {0, LATERAL_GAIN_ONE},      // A1
+    {0, LATERAL_GAIN_ONE},      // A2
+    {0, LATERAL_GAIN_ONE},      // A3
+    {0, LATERAL_GAIN_ONE},      // A4
+};
+
+static const int32_t lateral_pos[LATERAL_CHANNELS] = { 2, 1, 0, -1, -2 };
+
+LateralEstimate lateral_estimate(const uint16_t* levels, const LateralCalibration* cal) {
+    int32_t c[LATERAL_CHANNELS];
+    int32_t lo = LDR_ADC_FULL_SCALE;
+    int32_t hi = 0;
+    for(uint8_t i = 0; i < LATERAL_CHANNELS; i++) {
+        int32_t v = ((int32_t)levels[i] - cal[i].offset) * cal[i].gain_q12 >> 12;
+        if(v < 0) v = 0;
+        if(v > LDR_ADC_FULL_SCALE) v = LDR_ADC_FULL_SCALE;
+        c[i] = v;
+        if(v < lo) lo = v;
+        if(v > hi) hi = v;
+    }
+
+    int32_t sum = 0;
+    int32_t moment = 0;
+    for(uint8_t i = 0; i < LATERAL_CHANNELS; i++) {
+        int32_t w = c[i] - lo;
+        sum += w;
+        moment += w * lateral_pos[i];
+    }
+
+    LateralEstimate e;
+    int32_t contrast = hi - lo;
+    e.confidence = (uint8_t)(contrast >= LATERAL_FULL_CONTRAST ? 255 : contrast * 255 / LATERAL_FULL_CONTRAST);
+    e.deviation_q8 = (int16_t)(sum > 0 ? (moment << LATERAL_Q) / sum : 0);
+    return e;
+}
+
+uint8_t lateral_strength(int16_t deviation_q8, uint8_t previous) {
+    int32_t mag = deviation_q8 < 0 ? -deviation_q8 : deviation_q8;
+    int32_t hard = LATERAL_HARD_Q8 - (previous >= 2 ? LATERAL_HYST_Q8 : 0);
+    int32_t slight = LATERAL_DEADBAND_Q8 - (previous >= 1 ? LATERAL_HYST_Q8 : 0);
+    if(mag >= hard) {
+        return 2;
+    }
+    return mag >= slight ? 1 : 0;
+}
@@ -0,0 +1,49 @@
+#ifndef LATERAL_H
+#define LATERAL_H
+
+#include <stdint.h>
+#include "ldr_scan.h"
+
+// ==================== LATERAL DEVIATION ESTIMATOR ====================
+// Portable (no mbed). Where the laser spot sits across the A0..A4 row,
+// from one set of filtered levels, in constant time:
+//
+//   c[i] = (level[i] - offset[i]) * gain[i]     per-channel calibration
+//   w[i] = c[i] - min(c)                       ambient removed
+//   deviation = sum(w[i] * pos[i]) / sum(w[i])
+//
+// pos runs A0 = +2 .. A4 = -2 sensor pitches. Positive deviation means the
+// spot is toward A0/A1, which the directive logic answers with a turn to
+// the right. Confidence is the spot's contrast over ambient, saturating at
+// LATERAL_FULL_CONTRAST.
+#define LATERAL_CHANNELS        5           // A0..A4; A5 is not on the row
+#define LATERAL_Q               8           // Deviation in 1/256 pitch
+#define LATERAL_GAIN_ONE        4096        // Calibration gain, Q12
+#define LATERAL_FULL_CONTRAST   1638        // Raw counts (0.4 of full scale) = 255
+
+// Guidance bands, in 1/256 pitch; leaving a band takes LATERAL_HYST less
+#define LATERAL_DEADBAND_Q8     90          // Inside: straight
+#define LATERAL_HARD_Q8         256         // Outside: hard turn, slight between
+#define LATERAL_HYST_Q8         64
+#define LATERAL_MIN_CONFIDENCE  40          // Below: no spot, straight
+
+struct LateralCalibration {
+    uint16_t offset;            // Dark reading, raw counts
+    uint16_t gain_q12;          // LATERAL_GAIN_ONE = unity
+};
+
+struct LateralEstimate {
+    int16_t deviation_q8;       // -512..512, 0 when there is no spot
+    uint8_t confidence;         // 0..255
+};
+
+// Board calibration, A0..A4
+extern LateralCalibration lateral_cal[LATERAL_CHANNELS];
+
+LateralEstimate lateral_estimate(const uint16_t* levels, const LateralCalibration* cal);
+
+// 0 straight / inside the deadband, 1 slight, 2 hard. previous is the
+// strength currently shown on the same side, for hysteresis.
+uint8_t lateral_strength(int16_t deviation_q8, uint8_t previous);
+
+#endif
@@ -0,0 +1,240 @@
+#include "ldr_filter.h"
+#include <string.h>
+
+#if defined(TARGET_STM32F7)
+#include "mbed.h"
+#endif
+
+// ==================== TWO-LANE PRIMITIVES ====================
+// Each uint32_t holds two 16-bit lanes: channel 2k in the low half and
+// channel 2k+1 in the high half (little-endian load of the frame row)
+#if defined(TARGET_STM32F7)
+// USUB16 sets GE per lane where a >= b; SEL then picks per lane
+static inline uint32_t lanes_min(uint32_t a, uint32_t b) {
+    __USUB16(a, b);
+    return __SEL(b, a);
+}
+
+static inline uint32_t lanes_max(uint32_t a, uint32_t b) {
+    __USUB16(a, b);
+    return __SEL(a, b);
+}
+
+// y += ((x - y) * alpha) >> 15 on signed lanes
+static inline uint32_t lanes_iir(uint32_t y, uint32_t x, uint32_t alpha) {
+    uint32_t d = __SSUB16(x, y);
+    int32_t lo = (int32_t)__SMULBB(d, alpha) >> 15;
+    int32_t hi = (int32_t)__SMULTB(d, alpha) >> 15;
+    return __SADD16(y, __PKHBT(lo, hi, 16));
+}
+
+// 0xFFFF in each lane where y > th (signed)
+static inline uint32_t lanes_above(uint32_t y, uint32_t th) {
+    __SSUB16(th, y);
+    return __SEL(0, 0xFFFFFFFFUL);
+}
+#else
+static inline uint32_t lane(uint32_t v, int k) {
+    return (v >> (16 * k)) & 0xFFFF;
+}
+
+static inline int32_t slane(uint32_t v, int k) {
+    return (int16_t)lane(v, k);
+}
+
+static inline uint32_t lanes(uint32_t lo, uint32_t hi) {
+    return (lo & 0xFFFF) | (hi << 16);
+}
+
+static inline uint32_t lanes_min(uint32_t a, uint32_t b) {
+    return lanes(lane(a, 0) < lane(b, 0) ? lane(a, 0) : lane(b, 0),
+                 lane(a, 1) < lane(b, 1) ? lane(a, 1) : lane(b, 1));
+}
+
+static inline uint32_t lanes_max(uint32_t a, uint32_t b) {
+    return lanes(lane(a, 0) < lane(b, 0) ? lane(b, 0) : lane(a, 0),
+                 lane(a, 1) < lane(b, 1) ? lane(b, 1) : lane(a, 1));
+}
+
+static inline uint32_t lanes_iir(uint32_t y, uint32_t x, uint32_t alpha) {
+    int32_t a = slane(alpha, 0);
+    int32_t lo = slane(y, 0) + (((slane(x, 0) - slane(y, 0)) * a) >> 15);
+    int32_t hi = slane(y, 1) + (((slane(x, 1) - slane(y, 1)) * a) >> 15);
+    return lanes((uint32_t)lo, (uint32_t)hi);
+}
+
+static inline uint32_t lanes_above(uint32_t y, uint32_t th) {
+    return lanes(slane(y, 0) > slane(th, 0) ? 0xFFFF : 0,
+                 slane(y, 1) > slane(th, 1) ? 0xFFFF : 0);
+}
+#endif
+
+static inline void lanes_sort(uint32_t& a, uint32_t& b) {
+    uint32_t lo = lanes_min(a, b);
+    b = lanes_max(a, b);
+    a = lo;
+}
+
+static inline uint32_t load_lanes(const void* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void sort16(uint16_t& a, uint16_t& b) {
+    if(b < a) {
+        uint16_t t = a;
+        a = b;
+        b = t;
+    }
+}
+
+// ==================== SETUP ====================
+LdrFilterConfig ldr_filter_config(float threshold, float hysteresis) {
+    LdrFilterConfig cfg;
+    float on = (threshold + hysteresis) * LDR_ADC_FULL_SCALE;
+    float off = (threshold - hysteresis) * LDR_ADC_FULL_SCALE;
+    cfg.median = LDR_FILTER_MEDIAN;
+    cfg.alpha_q15 = LDR_FILTER_ALPHA_Q15;
+    cfg.on_raw = (uint16_t)(on < 0.0f ? 0.0f : on > LDR_ADC_FULL_SCALE ? LDR_ADC_FULL_SCALE : on);
+    cfg.off_raw = (uint16_t)(off < 0.0f ? 0.0f : off > LDR_ADC_FULL_SCALE ? LDR_ADC_FULL_SCALE : off);
+    return cfg;
+}
+
+void ldr_filter_init(LdrFilter* f, const LdrFilterConfig& cfg) {
+    memset(f, 0, sizeof(*f));
+
+    uint8_t m = cfg.median;
+    if(m == 0) m = 1;
+    if(m > LDR_FILTER_MEDIAN_MAX) m = LDR_FILTER_MEDIAN_MAX;
+    if((m & 1) == 0) m--;
+    f->median = m;
+
+    f->alpha_q15 = (int16_t)((cfg.alpha_q15 == 0) ? 1 : (cfg.alpha_q15 > 32767) ? 32767 : cfg.alpha_q15);
+
+    uint16_t on = cfg.on_raw > LDR_ADC_FULL_SCALE ? LDR_ADC_FULL_SCALE : cfg.on_raw;
+    uint16_t off = cfg.off_raw > on ? on : cfg.off_raw;
+    for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+        f->on_q[ch] = (int16_t)(on << LDR_FILTER_FRAC_BITS);
+        f->off_q[ch] = (int16_t)(off << LDR_FILTER_FRAC_BITS);
+    }
+}
+
+// First frame: fill the window and start the IIR at the sample itself
+static void ldr_filter_prime(LdrFilter* f, const uint16_t* raw) {
+    f->on = 0;
+    for(uint8_t k = 0; k < LDR_FILTER_MEDIAN_MAX; k++) {
+        memcpy(f->history[k], raw, sizeof(f->history[k]));
+    }
+    for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+        f->state[ch] = (int16_t)(raw[ch] << LDR_FILTER_FRAC_BITS);
+        if(f->state[ch] > f->on_q[ch]) {
+            f->on |= 1 << ch;
+        }
+    }
+    f->next = 0;
+    f->primed = true;
+}
+
+// ==================== PACKED PATH ====================
+uint8_t ldr_filter_run(LdrFilter* f, const uint16_t* interleaved, uint32_t frames) {
+    uint32_t alpha = (uint16_t)f->alpha_q15;
+
+    for(uint32_t i = 0; i < frames; i++) {
+        const uint16_t* raw = interleaved + i * LDR_CHANNELS;
+        f->frames++;
+        if(!f->primed) {
+            ldr_filter_prime(f, raw);
+            continue;
+        }
+
+        memcpy(f->history[f->next], raw, sizeof(f->history[0]));
+        f->next = (f->next + 1 == f->median) ? 0 : f->next + 1;
+
+        uint8_t on = 0;
+        for(uint8_t k = 0; k < LDR_FILTER_LANES; k++) {
+            uint32_t m;
+            if(f->median == 5) {
+                uint32_t p0 = load_lanes(&f->history[0][2 * k]);
+                uint32_t p1 = load_lanes(&f->history[1][2 * k]);
+                uint32_t p2 = load_lanes(&f->history[2][2 * k]);
+                uint32_t p3 = load_lanes(&f->history[3][2 * k]);
+                uint32_t p4 = load_lanes(&f->history[4][2 * k]);
+                // Seven compare-exchange median network, only the halves still needed
+                lanes_sort(p0, p1);
+                lanes_sort(p3, p4);
+                p3 = lanes_max(p0, p3);
+                p1 = lanes_min(p1, p4);
+                lanes_sort(p1, p2);
+                p2 = lanes_min(p2, p3);
+                m = lanes_max(p1, p2);
+            } else if(f->median == 3) {
+                uint32_t p0 = load_lanes(&f->history[0][2 * k]);
+                uint32_t p1 = load_lanes(&f->history[1][2 * k]);
+                uint32_t p2 = load_lanes(&f->history[2][2 * k]);
+                m = lanes_max(lanes_min(p0, p1), lanes_min(lanes_max(p0, p1), p2));
+            } else {
+                m = load_lanes(&raw[2 * k]);
+            }
+
+            uint32_t y = lanes_iir(load_lanes(&f->state[2 * k]), m << LDR_FILTER_FRAC_BITS, alpha);
+            memcpy(&f->state[2 * k], &y, sizeof(y));
+
+            // Lanes already on compare against the off level, the rest against on
+            uint32_t was = ((f->on >> (2 * k)) & 1 ? 0x0000FFFFUL : 0) |
+                           ((f->on >> (2 * k + 1)) & 1 ? 0xFFFF0000UL : 0);
+            uint32_t th = (load_lanes(&f->off_q[2 * k]) & was) | (load_lanes(&f->on_q[2 * k]) & ~was);
+            uint32_t above = lanes_above(y, th);
+            on |= (uint8_t)(((above & 1) | ((above >> 15) & 2)) << (2 * k));
+        }
+        f->on = on;
+    }
+    return f->on;
+}
+
+// ==================== SCALAR REFERENCE ====================
+uint8_t ldr_filter_run_ref(LdrFilter* f, const uint16_t* interleaved, uint32_t frames) {
+    for(uint32_t i = 0; i < frames; i++) {
+        const uint16_t* raw = interleaved + i * LDR_CHANNELS;
+        f->frames++;
+        if(!f->primed) {
+            ldr_filter_prime(f, raw);
+            continue;
+        }
+
+        memcpy(f->history[f->next], raw, sizeof(f->history[0]));
+        f->next = (f->next + 1 == f->median) ? 0 : f->next + 1;
+
+        uint8_t on = 0;
+        for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+            uint16_t p[LDR_FILTER_MEDIAN_MAX];
+            for(uint8_t k = 0; k < f->median; k++) {
+                p[k] = f->history[k][ch];
+            }
+            // Insertion sort; the window is at most five
+            for(uint8_t a = 1; a < f->median; a++) {
+                for(uint8_t b = a; b > 0; b--) {
+                    sort16(p[b - 1], p[b]);
+                }
+            }
+            int32_t x = (f->median > 1 ? p[f->median / 2] : raw[ch]) << LDR_FILTER_FRAC_BITS;
+
+            int32_t y = f->state[ch];
+            y += ((x - y) * f->alpha_q15) >> 15;
+            f->state[ch] = (int16_t)y;
+
+            int32_t th = (f->on & (1 << ch)) ? f->off_q[ch] : f->on_q[ch];
+            if(y > th) {
+                on |= 1 << ch;
+            }
+        }
+        f->on = on;
+    }
+    return f->on;
+}
+
+void ldr_filter_levels(const LdrFilter* f, uint16_t* out) {
+    for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+        out[ch] = (uint16_t)(f->state[ch] >> LDR_FILTER_FRAC_BITS);
+    }
+}
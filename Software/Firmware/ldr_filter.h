@@ -0,0 +1,68 @@
+#ifndef LDR_FILTER_H
+#define LDR_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ldr_scan.h"
+
+// ==================== LDR FILTER PIPELINE ====================
+// Portable (no mbed). Runs on every scanned frame, all six channels at once:
+//
+//   raw -> moving median (1, 3 or 5 frames) -> IIR low-pass -> hysteresis
+//
+// The median removes single-frame spikes. The IIR smooths what is left,
+// with the new sample weighted by alpha (Q15). The channel's on/off state
+// then changes only when the level leaves the band between off_raw and
+// on_raw.
+//
+// Fixed point throughout: samples are 12-bit and the IIR state is the raw
+// value << LDR_FILTER_FRAC_BITS, so every intermediate fits a 16-bit lane.
+// ldr_filter_run() packs two channels per 32-bit word. On the Cortex-M7 it
+// uses the DSP SIMD instructions (USUB16/SEL min-max, SSUB16/SMULxB/SADD16
+// for the IIR); elsewhere plain C emulates them lane by lane.
+// ldr_filter_run_ref() is the one-channel-at-a-time scalar reference.
+// Both produce bit-identical results.
+#define LDR_FILTER_MEDIAN_MAX   5
+#define LDR_FILTER_FRAC_BITS    3           // 4095 << 3 still fits int16
+#define LDR_FILTER_LANES        (LDR_CHANNELS / 2)
+
+// Defaults: 2.5 ms median at 2 kHz, ~2 ms IIR time constant
+#define LDR_FILTER_MEDIAN       5
+#define LDR_FILTER_ALPHA_Q15    8192        // 1/4
+
+struct LdrFilterConfig {
+    uint8_t  median;        // Window in frames: 1 (off), 3 or 5
+    uint16_t alpha_q15;     // IIR weight of the new sample, 1..32767
+    uint16_t on_raw;        // Channel turns on above this level...
+    uint16_t off_raw;       // ...and off again at or below this one
+};
+
+struct LdrFilter {
+    // History is [frame][channel], so each frame's row loads as three words
+    uint16_t history[LDR_FILTER_MEDIAN_MAX][LDR_CHANNELS] __attribute__((aligned(4)));
+    int16_t  state[LDR_CHANNELS] __attribute__((aligned(4)));    // IIR, Q3
+    int16_t  on_q[LDR_CHANNELS] __attribute__((aligned(4)));     // Thresholds, Q3
+    int16_t  off_q[LDR_CHANNELS] __attribute__((aligned(4)));
+    uint8_t  median;
+    uint8_t  next;          // History row the next frame goes to
+    int16_t  alpha_q15;
+    uint8_t  on;            // Bit ch set while channel ch is on
+    bool     primed;        // First frame seeds the history and the IIR
+    uint32_t frames;
+};
+
+// Defaults with the hysteresis band centred on threshold (0.0-1.0 scale)
+LdrFilterConfig ldr_filter_config(float threshold, float hysteresis);
+
+// Clamps out-of-range settings (an even median rounds down)
+void ldr_filter_init(LdrFilter* f, const LdrFilterConfig& cfg);
+
+// Filter frames of interleaved samples (A0..A5, A0..A5, ...); returns the
+// on/off bits after the last one
+uint8_t ldr_filter_run(LdrFilter* f, const uint16_t* interleaved, uint32_t frames);
+uint8_t ldr_filter_run_ref(LdrFilter* f, const uint16_t* interleaved, uint32_t frames);
+
+// Filtered levels on the raw ADC scale
+void ldr_filter_levels(const LdrFilter* f, uint16_t* out);
+
+#endif
@@ -0,0 +1,325 @@
+#include "ldr_scan.h"
+#include <string.h>
+
+#if defined(TARGET_STM32F7)
+#include "mbed.h"
+#endif
+
+// ==================== ACQUISITION ENGINE ====================
+LdrScanEngine::LdrScanEngine(uint32_t rate_hz)
+    : _source(NULL), _on_block(NULL), _period_us(1000000UL / rate_hz), _head(0) {
+    memset(_ring, 0, sizeof(_ring));
+}
+
+bool LdrScanEngine::start(LdrSampleSource* source) {
+    _source = source;
+    return _source->start(this);
+}
+
+void LdrScanEngine::stop() {
+    if(_source != NULL) {
+        _source->stop();
+        _source = NULL;
+    }
+}
+
+void LdrScanEngine::set_rate(uint32_t rate_hz) {
+    if(rate_hz == 0) {
+        return;
+    }
+    _period_us = 1000000UL / rate_hz;
+    if(_source != NULL) {
+        _source->set_rate(rate_hz);
+    }
+}
+
+void LdrScanEngine::on_block(const uint16_t* interleaved, uint32_t frames, uint32_t end_us) {
+    uint32_t head = _head;
+
+    for(uint32_t i = 0; i < frames; i++) {
+        LdrFrame& f = _ring[head & (LDR_RING_FRAMES - 1)];
+        memcpy(f.raw, interleaved + i * LDR_CHANNELS, sizeof(f.raw));
+        f.timestamp_us = end_us - (frames - 1 - i) * _period_us;
+        f.sequence = head + 1;
+
+        // Publish one frame at a time so readers always see the newest
+        __sync_synchronize();
+        head++;
+        _head = head;
+    }
+
+    if(_on_block != NULL) {
+        _on_block();
+    }
+}
+
+bool LdrScanEngine::latest(LdrFrame* out) const {
+    while(1) {
+        uint32_t head = _head;
+        if(head == 0) {
+            return false;
+        }
+        __sync_synchronize();
+        *out = _ring[(head - 1) & (LDR_RING_FRAMES - 1)];
+        __sync_synchronize();
+
+        // Slot head-1 is only rewritten once the producer wraps the ring
+        if(_head - head < LDR_RING_FRAMES - 1) {
+            return true;
+        }
+    }
+}
+
+uint32_t LdrScanEngine::read_since(uint32_t* cursor, LdrFrame* out, uint32_t max,
+                                   uint32_t* dropped) const {
+    uint32_t head = _head;
+    uint32_t start = *cursor;
+
+    // Oldest frame still safely in the ring (leave one slot for the writer)
+    uint32_t oldest = (head > LDR_RING_FRAMES - 1) ? head - (LDR_RING_FRAMES - 1) : 0;
+    if(start < oldest) {
+        if(dropped != NULL) *dropped += oldest - start;
+        start = oldest;
+    }
+
+    uint32_t n = head - start;
+    if(n > max) n = max;
+
+    __sync_synchronize();
+    for(uint32_t i = 0; i < n; i++) {
+        out[i] = _ring[(start + i) & (LDR_RING_FRAMES - 1)];
+    }
+    __sync_synchronize();
+
+    // Discard anything the producer lapped while we were copying
+    uint32_t lapped_before = (_head > LDR_RING_FRAMES - 1) ? _head - (LDR_RING_FRAMES - 1) : 0;
+    uint32_t skip = 0;
+    if(lapped_before > start) {
+        skip = lapped_before - start;
+        if(skip > n) skip = n;
+        if(dropped != NULL) *dropped += skip;
+        memmove(out, out + skip, (n - skip) * sizeof(LdrFrame));
+    }
+
+    *cursor = start + n;
+    return n - skip;
+}
+
+// ==================== SYNTHETIC SOURCE ====================
+SyntheticLdrSource::SyntheticLdrSource(ldr_generator_t generator, void* ctx, uint32_t rate_hz)
+    : _generator(generator), _ctx(ctx), _period_us(1000000UL / rate_hz),
+      _next_us(0), _primed(false), _engine(NULL) {
+}
+
+bool SyntheticLdrSource::start(LdrScanEngine* engine) {
+    _engine = engine;
+    _primed = false;
+    return true;
+}
+
+void SyntheticLdrSource::stop() {
+    _engine = NULL;
+}
+
+void SyntheticLdrSource::set_rate(uint32_t rate_hz) {
+    _period_us = 1000000UL / rate_hz;
+}
+
+void SyntheticLdrSource::pump(uint32_t now_us) {
+    if(_engine == NULL) {
+        return;
+    }
+    if(!_primed) {
+        _next_us = now_us;
+        _primed = true;
+    }
+
+    uint16_t block[LDR_DMA_HALF_FRAMES * LDR_CHANNELS];
+    uint32_t frames = 0;
+    uint32_t last_us = _next_us;
+
+    while((int32_t)(now_us - _next_us) >= 0) {
+        for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+            uint16_t v = _generator(ch, _next_us, _ctx);
+            block[frames * LDR_CHANNELS + ch] = v > LDR_ADC_FULL_SCALE ? LDR_ADC_FULL_SCALE : v;
+        }
+        last_us = _next_us;
+        _next_us += _period_us;
+        frames++;
+
+        if(frames == LDR_DMA_HALF_FRAMES) {
+            _engine->on_block(block, frames, last_us);
+            frames = 0;
+        }
+    }
+    if(frames > 0) {
+        _engine->on_block(block, frames, last_us);
+    }
+}
+
+#if defined(TARGET_STM32F7)
+// ==================== ADC3 SCAN + DMA SOURCE ====================
+// DISCO-F746NG Arduino header: all six analog pins are on ADC3
+static const struct {
+    GPIO_TypeDef* port;
+    uint16_t      pin;
+    uint32_t      channel;
+} LDR_ADC_MAP[LDR_CHANNELS] = {
+    {GPIOA, GPIO_PIN_0,  ADC_CHANNEL_0},    // A0
+    {GPIOF, GPIO_PIN_10, ADC_CHANNEL_8},    // A1
+    {GPIOF, GPIO_PIN_9,  ADC_CHANNEL_7},    // A2
+    {GPIOF, GPIO_PIN_8,  ADC_CHANNEL_6},    // A3
+    {GPIOF, GPIO_PIN_7,  ADC_CHANNEL_5},    // A4
+    {GPIOF, GPIO_PIN_6,  ADC_CHANNEL_4},    // A5
+};
+
+#define LDR_DMA_BUFFER_SAMPLES (2 * LDR_DMA_HALF_FRAMES * LDR_CHANNELS)
+
+// 32-byte aligned so cache maintenance never touches neighbouring data
+static uint16_t ldr_dma_buffer[LDR_DMA_BUFFER_SAMPLES] __attribute__((aligned(32)));
+
+static ADC_HandleTypeDef  ldr_hadc;
+static DMA_HandleTypeDef  ldr_hdma;
+static TIM_HandleTypeDef  ldr_htim;
+static AdcDmaLdrSource*   ldr_active_source = NULL;
+
+static void ldr_dma_irq_handler() {
+    HAL_DMA_IRQHandler(&ldr_hdma);
+}
+
+extern "C" void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc) {
+    if(hadc == &ldr_hadc && ldr_active_source != NULL) {
+        ldr_active_source->dispatch(0);
+    }
+}
+
+extern "C" void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
+    if(hadc == &ldr_hadc && ldr_active_source != NULL) {
+        ldr_active_source->dispatch(1);
+    }
+}
+
+AdcDmaLdrSource::AdcDmaLdrSource(uint32_t rate_hz) : _rate_hz(rate_hz), _engine(NULL) {
+}
+
+bool AdcDmaLdrSource::start(LdrScanEngine* engine) {
+    _engine = engine;
+    ldr_active_source = this;
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOF_CLK_ENABLE();
+    __HAL_RCC_ADC3_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    __HAL_RCC_TIM6_CLK_ENABLE();
+
+    GPIO_InitTypeDef gpio;
+    memset(&gpio, 0, sizeof(gpio));
+    gpio.Mode = GPIO_MODE_ANALOG;
+    gpio.Pull = GPIO_NOPULL;
+    for(int i = 0; i < LDR_CHANNELS; i++) {
+        gpio.Pin = LDR_ADC_MAP[i].pin;
+        HAL_GPIO_Init(LDR_ADC_MAP[i].port, &gpio);
+    }
+
+    // DMA2 Stream0 Channel2 = ADC3, circular so the two halves alternate
+    ldr_hdma.Instance = DMA2_Stream0;
+    ldr_hdma.Init.Channel = DMA_CHANNEL_2;
+    ldr_hdma.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    ldr_hdma.Init.PeriphInc = DMA_PINC_DISABLE;
+    ldr_hdma.Init.MemInc = DMA_MINC_ENABLE;
+    ldr_hdma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    ldr_hdma.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    ldr_hdma.Init.Mode = DMA_CIRCULAR;
+    ldr_hdma.Init.Priority = DMA_PRIORITY_HIGH;
+    ldr_hdma.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if(HAL_DMA_Init(&ldr_hdma) != HAL_OK) {
+        return false;
+    }
+    __HAL_LINKDMA(&ldr_hadc, DMA_Handle, ldr_hdma);
+
+    // ADC3: scan all six ranks once per TIM6 trigger
+    ldr_hadc.Instance = ADC3;
+    ldr_hadc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    ldr_hadc.Init.Resolution = ADC_RESOLUTION_12B;
+    ldr_hadc.Init.ScanConvMode = ENABLE;
+    ldr_hadc.Init.ContinuousConvMode = DISABLE;
+    ldr_hadc.Init.DiscontinuousConvMode = DISABLE;
+    ldr_hadc.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    ldr_hadc.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T6_TRGO;
+    ldr_hadc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    ldr_hadc.Init.NbrOfConversion = LDR_CHANNELS;
+    ldr_hadc.Init.DMAContinuousRequests = ENABLE;
+    ldr_hadc.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+    if(HAL_ADC_Init(&ldr_hadc) != HAL_OK) {
+        return false;
+    }
+
+    ADC_ChannelConfTypeDef ch;
+    memset(&ch, 0, sizeof(ch));
+    ch.SamplingTime = ADC_SAMPLETIME_144CYCLES;   // LDR dividers are high impedance
+    for(int i = 0; i < LDR_CHANNELS; i++) {
+        ch.Channel = LDR_ADC_MAP[i].channel;
+        ch.Rank = i + 1;
+        if(HAL_ADC_ConfigChannel(&ldr_hadc, &ch) != HAL_OK) {
+            return false;
+        }
+    }
+
+    NVIC_SetVector(DMA2_Stream0_IRQn, (uint32_t)&ldr_dma_irq_handler);
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+    if(HAL_ADC_Start_DMA(&ldr_hadc, (uint32_t*)ldr_dma_buffer, LDR_DMA_BUFFER_SAMPLES) != HAL_OK) {
+        return false;
+    }
+
+    // TIM6 ticks at 1 MHz and emits TRGO on update at the scan rate.
+    // APB1 timers run at 2x PCLK1 whenever the APB1 prescaler is not 1.
+    uint32_t tim_clk = HAL_RCC_GetPCLK1Freq();
+    if((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+        tim_clk *= 2;
+    }
+    ldr_htim.Instance = TIM6;
+    ldr_htim.Init.Prescaler = tim_clk / 1000000UL - 1;
+    ldr_htim.Init.CounterMode = TIM_COUNTERMODE_UP;
+    ldr_htim.Init.Period = 1000000UL / _rate_hz - 1;
+    ldr_htim.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if(HAL_TIM_Base_Init(&ldr_htim) != HAL_OK) {
+        return false;
+    }
+    TIM_MasterConfigTypeDef master;
+    memset(&master, 0, sizeof(master));
+    master.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    master.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    HAL_TIMEx_MasterConfigSynchronization(&ldr_htim, &master);
+
+    return HAL_TIM_Base_Start(&ldr_htim) == HAL_OK;
+}
+
+void AdcDmaLdrSource::stop() {
+    HAL_TIM_Base_Stop(&ldr_htim);
+    HAL_ADC_Stop_DMA(&ldr_hadc);
+    HAL_NVIC_DisableIRQ(DMA2_Stream0_IRQn);
+    ldr_active_source = NULL;
+    _engine = NULL;
+}
+
+void AdcDmaLdrSource::set_rate(uint32_t rate_hz) {
+    _rate_hz = rate_hz;
+    if(_engine != NULL) {
+        __HAL_TIM_SET_AUTORELOAD(&ldr_htim, 1000000UL / _rate_hz - 1);
+    }
+}
+
+void AdcDmaLdrSource::dispatch(uint8_t half) {
+    if(_engine == NULL) {
+        return;
+    }
+    uint16_t* block = ldr_dma_buffer + half * LDR_DMA_HALF_FRAMES * LDR_CHANNELS;
+
+    // DMA wrote behind the D-cache's back
+    SCB_InvalidateDCache_by_Addr((uint32_t*)block, LDR_DMA_HALF_FRAMES * LDR_CHANNELS * sizeof(uint16_t));
+
+    _engine->on_block(block, LDR_DMA_HALF_FRAMES, us_ticker_read());
+}
+#endif
@@ -0,0 +1,126 @@
+#ifndef LDR_SCAN_H
+#define LDR_SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==================== LDR ACQUISITION CONFIG ====================
+#define LDR_CHANNELS            6           // A0..A5
+#define LDR_ADC_FULL_SCALE      4095        // 12-bit ADC
+#define LDR_SCAN_RATE_HZ        2000        // Six-channel frames per second
+#define LDR_DMA_HALF_FRAMES     8           // Frames per DMA half-buffer
+#define LDR_RING_FRAMES         64          // Must be a power of two
+
+struct LdrFrame {
+    uint16_t raw[LDR_CHANNELS];             // 0..LDR_ADC_FULL_SCALE
+    uint32_t timestamp_us;                  // Conversion time of this frame
+    uint32_t sequence;                      // 1-based frame counter
+};
+
+// Same 0.0-1.0 scale AnalogIn::read() returns
+inline float ldr_to_float(uint16_t raw) {
+    return raw * (1.0f / LDR_ADC_FULL_SCALE);
+}
+
+class LdrScanEngine;
+
+// Called from the producer's context after each block is published
+typedef void (*ldr_block_fn)(void);
+
+// ==================== SAMPLE SOURCE INTERFACE ====================
+// A source produces interleaved blocks (A0..A5, A0..A5, ...) and hands them
+// to LdrScanEngine::on_block(). On the board that is the ADC3 scan + DMA
+// half/complete interrupt; on a host it is SyntheticLdrSource.
+class LdrSampleSource {
+public:
+    virtual ~LdrSampleSource() {}
+    virtual bool start(LdrScanEngine* engine) = 0;
+    virtual void stop() = 0;
+    virtual void set_rate(uint32_t rate_hz) = 0;    // While running, from the next frame
+};
+
+// ==================== ACQUISITION ENGINE ====================
+// Single producer (the source's interrupt), any number of lock-free readers.
+class LdrScanEngine {
+public:
+    LdrScanEngine(uint32_t rate_hz = LDR_SCAN_RATE_HZ);
+
+    bool start(LdrSampleSource* source);
+    void stop();
+    void attach(ldr_block_fn fn) { _on_block = fn; }
+
+    // Slower scanning for standby, and back. Frames of the block in flight
+    // when it changes are timestamped at the new rate.
+    void set_rate(uint32_t rate_hz);
+    uint32_t period_us() const { return _period_us; }
+
+    // Producer side. end_us is the timestamp of the last frame in the block.
+    void on_block(const uint16_t* interleaved, uint32_t frames, uint32_t end_us);
+
+    // Latest complete frame. Returns false until the first frame arrives.
+    bool latest(LdrFrame* out) const;
+
+    // Copy frames newer than *cursor (oldest first), advance *cursor.
+    // Frames overwritten before they were read are counted in *dropped.
+    uint32_t read_since(uint32_t* cursor, LdrFrame* out, uint32_t max,
+                        uint32_t* dropped = NULL) const;
+
+    uint32_t frame_count() const { return _head; }
+
+private:
+    LdrSampleSource*  _source;
+    ldr_block_fn      _on_block;
+    volatile uint32_t _period_us;
+    volatile uint32_t _head;                // Frames written so far
+    LdrFrame          _ring[LDR_RING_FRAMES];
+};
+
+// ==================== SYNTHETIC SOURCE ====================
+// Generates frames from a callback at LDR_SCAN_RATE_HZ. pump() is called
+// with the current time (from a Ticker, a test or a simulator clock) and
+// emits every frame that has become due, in LDR_DMA_HALF_FRAMES blocks.
+typedef uint16_t (*ldr_generator_t)(uint8_t channel, uint32_t t_us, void* ctx);
+
+class SyntheticLdrSource : public LdrSampleSource {
+public:
+    SyntheticLdrSource(ldr_generator_t generator, void* ctx,
+                       uint32_t rate_hz = LDR_SCAN_RATE_HZ);
+
+    virtual bool start(LdrScanEngine* engine);
+    virtual void stop();
+    virtual void set_rate(uint32_t rate_hz);
+
+    void pump(uint32_t now_us);
+    uint32_t period_us() const { return _period_us; }
+
+private:
+    ldr_generator_t _generator;
+    void*           _ctx;
+    uint32_t        _period_us;
+    uint32_t        _next_us;
+    bool            _primed;
+    LdrScanEngine*  _engine;
+};
+
+#if defined(TARGET_STM32F7)
+// ==================== ADC3 SCAN + DMA SOURCE ====================
+// ADC3 scans A0..A5 on every TIM6 update; DMA2 Stream0 writes a circular,
+// double-buffered block and the half/complete interrupts publish each half.
+class AdcDmaLdrSource : public LdrSampleSource {
+public:
+    AdcDmaLdrSource(uint32_t rate_hz = LDR_SCAN_RATE_HZ);
+
+    virtual bool start(LdrScanEngine* engine);
+    virtual void stop();
+    virtual void set_rate(uint32_t rate_hz);    // TIM6 reload, at its next update
+
+    // Called from the DMA interrupt with the half that just completed
+    void dispatch(uint8_t half);
+
+private:
+    uint32_t       _rate_hz;
+    LdrScanEngine* _engine;
+};
+#endif
+
+#endif
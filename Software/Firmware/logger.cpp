@@ -0,0 +1,218 @@
+#include "logger.h"
+#include "marshalling.h"
+#include "telemetry.h"
+
+#define LOG_RING_MASK   (LOG_RING_ENTRIES - 1)
+
+// Bounded MPSC ring. Each slot's seq says whose turn it is: pos when free
+// for the producer that claims pos, pos + 1 once that entry is complete.
+struct LogEntry {
+    volatile uint32_t seq;
+    const char*       fmt;
+    uint32_t          timestamp_us;
+    uint8_t           level;
+    uint8_t           nargs;
+    LogArg            args[LOG_MAX_ARGS];
+};
+
+static LogEntry log_ring[LOG_RING_ENTRIES];
+static volatile uint32_t log_head = 0;      // Next position to claim
+static uint32_t log_tail = 0;               // Consumer only
+static bool log_ready = false;
+static volatile uint32_t log_written = 0;
+static volatile uint32_t log_dropped = 0;
+static uint32_t log_drained = 0;
+static uint32_t log_dropped_reported = 0;
+
+uint32_t log_ring_bytes() {
+    return sizeof(log_ring);
+}
+
+static void log_ring_init() {
+    for(uint32_t i = 0; i < LOG_RING_ENTRIES; i++) {
+        log_ring[i].seq = i;
+    }
+    log_ready = true;
+}
+
+// ==================== PRODUCERS ====================
+void log_push(uint8_t level, const char* fmt, const LogArg* args, uint8_t nargs) {
+    if(!log_ready) {
+        core_util_critical_section_enter();
+        if(!log_ready) log_ring_init();
+        core_util_critical_section_exit();
+    }
+
+    uint32_t pos = log_head;
+    LogEntry* e;
+    while(1) {
+        e = &log_ring[pos & LOG_RING_MASK];
+        int32_t dif = (int32_t)(e->seq - pos);
+        if(dif == 0) {
+            if(__sync_bool_compare_and_swap(&log_head, pos, pos + 1)) {
+                break;
+            }
+        } else if(dif < 0) {
+            // Slot still holds an undrained entry: ring full
+            __sync_fetch_and_add(&log_dropped, 1);
+            return;
+        }
+        pos = log_head;
+    }
+
+    e->fmt = fmt;
+    e->timestamp_us = us_ticker_read();
+    e->level = level;
+    e->nargs = (nargs > LOG_MAX_ARGS) ? LOG_MAX_ARGS : nargs;
+    for(uint8_t i = 0; i < e->nargs; i++) {
+        e->args[i] = args[i];
+    }
+    __sync_synchronize();
+    e->seq = pos + 1;
+    __sync_fetch_and_add(&log_written, 1);
+}
+
+// ==================== CONSUMER ====================
+// printf subset: flags, width and precision pass through to snprintf; the
+// conversion picks how the stored 32-bit argument is read
+static size_t log_format(char* out, size_t size, const char* fmt,
+                         const LogArg* args, uint8_t nargs) {
+    size_t n = 0;
+    uint8_t next = 0;
+
+    while(*fmt != '\0' && n + 1 < size) {
+        if(*fmt != '%') {
+            out[n++] = *fmt++;
+            continue;
+        }
+
+        char spec[16];
+        size_t k = 0;
+        spec[k++] = *fmt++;
+        while(*fmt != '\0' && strchr("-+ #0123456789.lhzjt", *fmt) != NULL) {
+            if(strchr("lhzjt", *fmt) == NULL && k < sizeof(spec) - 2) {
+                spec[k++] = *fmt;
+            }
+            fmt++;
+        }
+        char type = *fmt;
+        if(type == '\0') {
+            break;
+        }
+        fmt++;
+        spec[k++] = type;
+        spec[k] = '\0';
+
+        if(type == '%') {
+            out[n++] = '%';
+            continue;
+        }
+        LogArg v = (next < nargs) ? args[next] : LogArg();
+        next++;
+
+        int w;
+        switch(type) {
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            w = snprintf(out + n, size - n, spec, (double)v.f);
+            break;
+        case 's':
+            w = snprintf(out + n, size - n, spec, v.s != NULL ? v.s : "(null)");
+            break;
+        case 'd': case 'i': case 'c':
+            w = snprintf(out + n, size - n, spec, (int)v.i);
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            w = snprintf(out + n, size - n, spec, (unsigned)v.u);
+            break;
+        case 'p':
+            w = snprintf(out + n, size - n, spec, (const void*)v.s);
+            break;
+        default:
+            w = 0;
+            break;
+        }
+        if(w > 0) {
+            n += ((size_t)w < size - n) ? (size_t)w : size - n - 1;
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+static const char log_level_tag[] = { 'D', 'I', 'W', 'E' };
+
+static_assert(LOG_LINE_MAX <= TELEMETRY_LOG_MAX + 1, "a formatted log line must fit one log record");
+
+// Once the binary stream owns USART1 a printf would land inside its
+// frames, so each line goes down the stream as a log record instead
+static void log_send(uint32_t timestamp_us, uint8_t level, const char* text, size_t len) {
+    TelemetryLog l;
+    l.timestamp_us = timestamp_us;
+    l.level = level;
+    l.len = (uint8_t)len;
+    memcpy(l.text, text, len);
+    telemetry_send_log(l);
+}
+
+uint32_t log_drain() {
+    if(!log_ready) {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    char line[LOG_LINE_MAX];
+
+    while(1) {
+        LogEntry* e = &log_ring[log_tail & LOG_RING_MASK];
+        if(e->seq != log_tail + 1) {
+            break;
+        }
+        __sync_synchronize();
+
+        // Copy out so the slot can be released before the slow part
+        LogEntry copy = *e;
+        __sync_synchronize();
+        e->seq = log_tail + LOG_RING_ENTRIES;
+        log_tail++;
+
+        size_t n = log_format(line, sizeof(line), copy.fmt, copy.args, copy.nargs);
+        if(telemetry_owns_serial()) {
+            log_send(copy.timestamp_us, copy.level, line, n);
+        } else {
+            uint32_t ms = copy.timestamp_us / 1000;
+            pc.printf("[%6lu.%03lu] %c %s\r\n", (unsigned long)(ms / 1000), (unsigned long)(ms % 1000),
+                      log_level_tag[copy.level & 3], line);
+        }
+        log_drained++;
+        count++;
+    }
+
+    uint32_t dropped = log_dropped;
+    if(dropped != log_dropped_reported) {
+        int n = snprintf(line, sizeof(line), "[log] %lu messages dropped\r\n",
+                         (unsigned long)(dropped - log_dropped_reported));
+        if(telemetry_owns_serial()) {
+            log_send(us_ticker_read(), TELEMETRY_LOG_TEXT, line, n);
+        } else {
+            pc.printf("%s", line);
+        }
+        log_dropped_reported = dropped;
+    }
+    return count;
+}
+
+void log_drain_thread() {
+    while(1) {
+        if(log_drain() == 0) {
+            ThisThread::sleep_for(LOG_DRAIN_IDLE_MS);
+        }
+    }
+}
+
+LogStats log_stats() {
+    LogStats s;
+    s.written = log_written;
+    s.dropped = log_dropped;
+    s.drained = log_drained;
+    return s;
+}
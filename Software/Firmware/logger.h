@@ -0,0 +1,112 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==================== DEFERRED LOGGER ====================
+// LOG_*() stores the format string pointer and up to LOG_MAX_ARGS raw
+// arguments in a lock-free ring and returns. That takes a few dozen cycles,
+// with no formatting and no UART. log_drain_thread() runs at low priority;
+// it formats each entry and sends it as one timestamped line: printed, or
+// once the binary telemetry stream owns the port, as a log record in it.
+//
+// Safe from any thread or interrupt (multi-producer, single consumer).
+// %s arguments are stored as pointers, so they must outlive the call
+// (literals, static tables). The format string must be a literal.
+// Length modifiers are ignored: every integer argument is 32-bit.
+#define LOG_LEVEL_DEBUG         0
+#define LOG_LEVEL_INFO          1
+#define LOG_LEVEL_WARN          2
+#define LOG_LEVEL_ERROR         3
+#define LOG_LEVEL_NONE          4
+
+// Levels below this compile to nothing (arguments are not even evaluated)
+#ifndef LOG_LEVEL
+#define LOG_LEVEL               LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_ENTRIES        64          // Power of two
+#define LOG_MAX_ARGS            4
+#define LOG_LINE_MAX            128
+#define LOG_DRAIN_IDLE_MS       20
+
+struct LogArg {
+    union {
+        int32_t     i;
+        uint32_t    u;
+        float       f;
+        const char* s;
+    };
+    LogArg() : s(NULL) {}
+    LogArg(int v) : i(v) {}
+    LogArg(unsigned v) : u(v) {}
+    LogArg(long v) : i((int32_t)v) {}
+    LogArg(unsigned long v) : u((uint32_t)v) {}
+    LogArg(double v) : f((float)v) {}
+    LogArg(const char* v) : s(v) {}
+};
+
+struct LogStats {
+    uint32_t written;       // Entries queued
+    uint32_t dropped;       // Entries lost to a full ring
+    uint32_t drained;       // Entries formatted and sent
+};
+
+void log_push(uint8_t level, const char* fmt, const LogArg* args, uint8_t nargs);
+
+inline void log_write(uint8_t level, const char* fmt) {
+    log_push(level, fmt, NULL, 0);
+}
+inline void log_write(uint8_t level, const char* fmt, LogArg a0) {
+    log_push(level, fmt, &a0, 1);
+}
+inline void log_write(uint8_t level, const char* fmt, LogArg a0, LogArg a1) {
+    LogArg a[2] = { a0, a1 };
+    log_push(level, fmt, a, 2);
+}
+inline void log_write(uint8_t level, const char* fmt, LogArg a0, LogArg a1, LogArg a2) {
+    LogArg a[3] = { a0, a1, a2 };
+    log_push(level, fmt, a, 3);
+}
+inline void log_write(uint8_t level, const char* fmt, LogArg a0, LogArg a1, LogArg a2, LogArg a3) {
+    LogArg a[4] = { a0, a1, a2, a3 };
+    log_push(level, fmt, a, 4);
+}
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...)          log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)          do {} while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...)           log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)           do {} while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...)           log_write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...)           do {} while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...)          log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...)          do {} while(0)
+#endif
+
+// Format and send everything queued so far; returns the number of entries
+uint32_t log_drain();
+
+// Low-priority consumer: drains, then sleeps LOG_DRAIN_IDLE_MS when idle
+void log_drain_thread();
+
+LogStats log_stats();
+
+// SRAM the ring takes, for the memory budget (memstats.h)
+uint32_t log_ring_bytes();
+
+#endif
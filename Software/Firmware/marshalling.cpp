@@ -0,0 +1,247 @@
+#include "marshalling.h"
+#include "hmi.h"
+#include "logger.h"
+#include "profiler.h"
+#include "blackbox.h"
+
+TS_StateTypeDef TS_State;
+
+// ==================== HARDWARE PINS ====================
+LdrScanEngine ldr_scan;             // A0..A5 continuous scan, lock-free frames
+Serial pc(USBTX, USBRX); 
+InterruptIn ir_sensor(D8);         // Edges wake the sensor sampler
+#if RANGING_SENSORS > 1
+// HC-SR04s across the stand (ranging.h); the centre one keeps D6/D5
+static RangerPort ranger_centre(D6, D5);
+static RangerPort ranger_left(D15, D14);
+#if RANGING_SENSORS > 2
+static RangerPort ranger_right(D10, D9);
+#endif
+#if RANGING_SENSORS > 3
+static RangerPort ranger_outer(D1, D0);
+#endif
+static RangerPort* const ranger_ports[RANGING_SENSORS] = {
+    &ranger_centre, &ranger_left,
+#if RANGING_SENSORS > 2
+    &ranger_right,
+#endif
+#if RANGING_SENSORS > 3
+    &ranger_outer,
+#endif
+};
+static const RangerConfig ranger_config[RANGER_MAX] = {
+    {0.0f, 0xFF}, {-RANGING_SPACING_CM, 0xFF}, {RANGING_SPACING_CM, 0xFF}, {2.0f * RANGING_SPACING_CM, 0xFF}
+};
+RangerArray ranger(ranger_ports, ranger_config, RANGING_SENSORS);
+#else
+UltrasonicRanger ranger(D6, D5);  // Trig D6, Echo D5 (interrupt-driven)
+#endif
+
+// ==================== THREAD CONTROL FLAGS ====================
+volatile bool serial_thread_running = true;
+volatile bool automation_active = false;
+volatile uint8_t current_directive = DIRECTIVE_NONE;
+volatile bool range_directives = true;
+volatile uint32_t directive_sample_us = 0;
+Mutex lcd_mutex;  // Mutex to protect LCD access
+
+#if PROFILER_ENABLED
+static uint32_t lcd_locked_at = 0;  // Only the holder writes it
+#endif
+
+void lcd_lock() {
+    PROF_START(t);
+    lcd_mutex.lock();
+#if PROFILER_ENABLED
+    lcd_locked_at = prof_cycles();
+    prof_record(PROF_LCD_WAIT, lcd_locked_at - t);
+#endif
+}
+
+void lcd_unlock() {
+    PROF_STOP(PROF_LCD_HOLD, lcd_locked_at);
+    lcd_mutex.unlock();
+}
+
+// ==================== BEEP TONES ====================
+// Queued for the audio engine's next block; returns at once
+void play_beep(uint16_t freq, uint16_t duration) {
+    audio.beep(freq, duration);
+}
+
+// ==================== SENSOR-DRIVEN AUTOMATION ====================
+// The one place a sensor frame becomes a directive: auto mode, the serial
+// monitor and the host simulator's reference all call this. The frame is
+// reduced to DIRECTION_COND_* bits and the rule table (directives.h) does
+// the rest.
+// previous is the directive on screen, so a turn needs a little less
+// deviation to stay than it did to appear.
+uint8_t determine_direction_from_sensors(const SensorFrame& f, uint8_t previous) {
+    // One coherent snapshot from the sampler (no ADC access, no lock)
+    uint8_t conds = (f.ir == 0) ? DIRECTION_COND_IR_BLOCKED : 0;
+    
+    // Range tracker: projected past the stop line by the time the
+    // directive takes effect, or in the SLOW band
+    bool tracked = range_directives && (f.valid & SENSOR_VALID_TRACK);
+    if(tracked) {
+        conds |= (f.range_zone == RANGE_ZONE_STOP) ? DIRECTION_COND_STOP_ZONE : 0;
+        conds |= (f.range_zone == RANGE_ZONE_SLOW) ? DIRECTION_COND_SLOW_ZONE : 0;
+    }
+    conds |= (f.closing_cm_s > SLOW_TRIM_CLOSING_CM_S) ? DIRECTION_COND_FAST : 0;
+    
+    // Spot centroid across A0..A4: how far off the centreline, not just
+    // which side. Positive = toward A0/A1 = turn right.
+    if((f.valid & SENSOR_VALID_LDR) && f.lateral.confidence >= LATERAL_MIN_CONFIDENCE) {
+        int16_t dev = f.lateral.deviation_q8;
+        int8_t side = (previous < DIRECTIVE_COUNT) ? directive_lateral[previous] : 0;
+        uint8_t shown = 0;
+        if(dev > 0 ? side > 0 : side < 0) {
+            shown = (uint8_t)(side < 0 ? -side : side);
+        }
+        uint8_t strength = lateral_strength(dev, shown);
+        conds |= (dev > 0) ? DIRECTION_COND_RIGHT : 0;
+        conds |= (strength == 2) ? DIRECTION_COND_TURN : (strength == 1) ? DIRECTION_COND_TRIM : 0;
+    }
+    
+    return direction_lookup(conds);
+}
+
+static uint8_t auto_shown = 254;    // Directive on screen, 254 = nothing yet
+
+void start_automation() {
+    auto_shown = 254;  // Force initial redraw
+    
+    LOG_INFO("========== AUTO MODE STARTED ==========");
+    LOG_INFO("System is now sensor-driven.");
+    LOG_INFO("LDR spot centroid controlling direction.");
+    LOG_INFO("IR sensor and range tracker controlling STOP.");
+    
+    SensorFrame f;
+    sensor_latest(&f);
+    current_directive = determine_direction_from_sensors(f);
+    automation_active = true;
+    refresh_automation(false);
+}
+
+// Sampler context: called with every new sensor frame, so a new directive
+// is published the moment a sensor changes rather than on the next redraw.
+// Returns true when the screen needs a redraw.
+bool evaluate_automation(const SensorFrame& f) {
+    if(!automation_active) {
+        return false;
+    }
+    uint8_t state = determine_direction_from_sensors(f, current_directive);
+    if(state == current_directive) {
+        return false;
+    }
+    // When the source that woke the sampler was sampled
+    if(f.events & SENSOR_EVENT_LDR) {
+        directive_sample_us = f.ldr_us;
+    } else if(f.events & SENSOR_EVENT_RANGE) {
+        directive_sample_us = f.range_us;
+    } else {
+        directive_sample_us = f.timestamp_us;
+    }
+    current_directive = state;
+    blackbox_directive(state);
+    return true;
+}
+
+// Repaint for the published directive; animate draws an animation frame
+// even if it has not changed
+void refresh_automation(bool animate) {
+    uint8_t state = current_directive;
+    if(state >= DIRECTIVE_COUNT) {
+        return;
+    }
+    
+    // Static chrome is drawn once; a direction change only repaints
+    // the widgets it affects
+    bool changed = (state != auto_shown);
+    if(!changed && !animate) {
+        return;
+    }
+    
+    if(changed) {
+        LOG_INFO("Direction changed to: %s", directive_presentation[state].title);
+        audio.play(directive_presentation[state].cue);
+    }
+    
+    const DirectivePresentation& p = directive_presentation[state];
+    draw_automation_screen(p.title, p.instruction, p.color, state, auto_shown == 254);
+    auto_shown = state;
+}
+
+void stop_automation() {
+    play_beep(500, 100);
+    automation_active = false;
+    current_directive = DIRECTIVE_NONE;
+    LOG_INFO("========== AUTO MODE ABORTED ==========");
+}
+
+// ==================== SERIAL MONITOR THREAD ====================
+void serial_monitor_thread() {
+    while(serial_thread_running) {
+        // One snapshot: every value below was sampled at the same moment
+        SensorFrame frame;
+        if(!sensor_latest(&frame)) {
+            memset(&frame, 0, sizeof(frame));
+        }
+        float a = ldr_to_float(frame.ldr_level[0]);
+        float b = ldr_to_float(frame.ldr_level[1]);
+        float c = ldr_to_float(frame.ldr_level[2]);
+        float d = ldr_to_float(frame.ldr_level[3]);
+        float e = ldr_to_float(frame.ldr_level[4]);
+        float f = ldr_to_float(frame.ldr_level[5]);
+        uint8_t on = frame.ldr_on;
+        
+        int ir_value = frame.ir;
+        
+        const char* ir_status = (ir_value == 0) ? "Obstacle Detected" : "Clear";
+        
+        float distance_cm = frame.distance_cm;
+        
+        // Print all sensor data
+        pc.printf("\r\n========== SENSOR DATA ==========\r\n");
+        pc.printf("Frame #%lu, age %lu us\r\n", (unsigned long)frame.sequence,
+                  (unsigned long)sensor_age_us(frame.timestamp_us));
+        pc.printf("LDR Sensors (filtered):\r\n");
+        pc.printf("  A0 (1st): %.2f %s\r\n", a, (on & (1 << 0)) ? "[ON]" : "");
+        pc.printf("  A1 (2nd): %.2f %s\r\n", b, (on & (1 << 1)) ? "[ON]" : "");
+        pc.printf("  A2 (3rd): %.2f %s\r\n", c, (on & (1 << 2)) ? "[ON]" : "");
+        pc.printf("  A3 (4th): %.2f %s\r\n", d, (on & (1 << 3)) ? "[ON]" : "");
+        pc.printf("  A4 (5th): %.2f %s\r\n", e, (on & (1 << 4)) ? "[ON]" : "");
+        pc.printf("  A5 (6th): %.2f\r\n", f);
+        pc.printf("IR Sensor: %s\r\n", ir_status);
+        
+        if(frame.valid & SENSOR_VALID_RANGE) {
+            pc.printf("Ultrasonic: %.2f cm", distance_cm);
+            if(distance_cm < 10) pc.printf(" [CRITICAL]");
+            else if(distance_cm < 30) pc.printf(" [CAUTION]");
+            else if(distance_cm < 100) pc.printf(" [SAFE]");
+            else pc.printf(" [CLEAR]");
+            pc.printf("\r\n");
+        } else {
+            pc.printf("Ultrasonic: Out of range/Error\r\n");
+        }
+        if(frame.valid & SENSOR_VALID_TRACK) {
+            pc.printf("Track: %.1f cm, closing %.1f cm/s, predicted %.1f cm\r\n",
+                      frame.track_cm, frame.closing_cm_s, frame.predicted_cm);
+        }
+        
+        pc.printf("Lateral: %+.2f pitch, confidence %u\r\n",
+                  frame.lateral.deviation_q8 / 256.0f, frame.lateral.confidence);
+        
+        // Show current direction logic (the same decision auto mode makes)
+        if(automation_active) {
+            uint8_t state = determine_direction_from_sensors(frame, current_directive);
+            pc.printf("\nActive Direction: %s\r\n", directive_presentation[state].title);
+        }
+        
+        pc.printf("=================================\r\n\r\n");
+        
+        // Wait 2 seconds between readings
+        ThisThread::sleep_for(2000);
+    }
+}
+
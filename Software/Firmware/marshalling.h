@@ -0,0 +1,50 @@
+#ifndef MARSHALLING_H
+#define MARSHALLING_H
+
+#include "mbed.h"
+#include "stm32746g_discovery_ts.h"
+#include "ultrasonic.h"
+#include "ranging.h"
+#include "ldr_scan.h"
+#include "sensors.h"
+#include "directives.h"
+
+// LDR threshold for ON detection, centre of the hysteresis band
+#define LDR_THRESHOLD 0.5
+#define LDR_HYSTERESIS 0.05
+#define SLOW_TRIM_CLOSING_CM_S 20.0f  // Slower than this, slight turns outrank SLOW
+
+// ==================== HARDWARE ====================
+extern TS_StateTypeDef TS_State;
+extern LdrScanEngine ldr_scan;
+extern Serial pc;
+extern InterruptIn ir_sensor;
+#if RANGING_SENSORS > 1
+extern RangerArray ranger;          // Same interface, fused range
+#else
+extern UltrasonicRanger ranger;
+#endif
+
+// ==================== THREAD CONTROL FLAGS ====================
+extern volatile bool serial_thread_running;
+extern volatile bool automation_active;
+// DIRECTIVE_* (directives.h); DIRECTIVE_NONE outside auto mode
+extern volatile uint8_t current_directive;
+extern volatile bool range_directives;      // STOP/SLOW from the predicted range
+extern volatile uint32_t directive_sample_us;   // Sample behind current_directive
+extern Mutex lcd_mutex;
+
+// lcd_mutex, with wait and hold times going to the profiler
+void lcd_lock();
+void lcd_unlock();
+
+// ==================== SENSOR-DRIVEN AUTOMATION ====================
+void play_beep(uint16_t freq, uint16_t duration);
+uint8_t determine_direction_from_sensors(const SensorFrame& f, uint8_t previous = 255);
+void start_automation();
+bool evaluate_automation(const SensorFrame& f);   // Sampler context
+void refresh_automation(bool animate);
+void stop_automation();
+void serial_monitor_thread();
+
+#endif
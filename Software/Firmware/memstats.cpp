@@ -0,0 +1,194 @@
+#include "memstats.h"
+#include "display.h"
+#include "sprite.h"
+#include "glyph.h"
+#include "blackbox.h"
+#include "mirror.h"
+#include "audio.h"
+#include "profiler.h"
+#include "logger.h"
+#include <string.h>
+
+#if defined(TARGET_STM32F7)
+#include "mbed_mem_trace.h"
+
+// From the linker script
+extern "C" {
+extern uint32_t __etext[];
+extern uint32_t __data_start__[], __data_end__[];
+extern uint32_t __bss_start__[], __bss_end__[];
+extern uint32_t __end__[], __HeapLimit[];
+extern uint32_t __StackLimit[], __StackTop[];
+}
+
+struct MemThread {
+    osThreadId_t id;
+    const char*  name;
+};
+
+static MemThread mem_threads[MEM_THREADS_MAX];
+#endif
+
+static const char* const mem_where_names[] = {"SRAM", "SDRAM", "flash"};
+
+static volatile bool     mem_sealed = false;
+static volatile uint32_t mem_late = 0;
+
+// ==================== STACKS ====================
+#if defined(TARGET_STM32F7)
+void mem_watch_thread(osThreadId_t id, const char* name) {
+    core_util_critical_section_enter();
+    for(uint8_t i = 0; i < MEM_THREADS_MAX; i++) {
+        if(mem_threads[i].id == NULL || mem_threads[i].id == id) {
+            mem_threads[i].id = id;
+            mem_threads[i].name = name;
+            break;
+        }
+    }
+    core_util_critical_section_exit();
+}
+
+void mem_unwatch_thread(osThreadId_t id) {
+    core_util_critical_section_enter();
+    for(uint8_t i = 0; i < MEM_THREADS_MAX; i++) {
+        if(mem_threads[i].id == id) {
+            mem_threads[i].id = NULL;
+        }
+    }
+    core_util_critical_section_exit();
+}
+#endif
+
+// ==================== HEAP ====================
+#if defined(TARGET_STM32F7) && MBED_MEM_TRACING_ENABLED
+// Called inside every allocation, with the trace lock held
+static void mem_trace(uint8_t op, void* res, void* caller, ...) {
+    if(!mem_sealed || op == MBED_MEM_TRACE_FREE) {
+        return;
+    }
+    mem_late++;
+#if MEM_FAIL_LATE_ALLOC
+    MBED_ERROR1(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, MBED_ERROR_CODE_OUT_OF_MEMORY),
+                "allocation after boot", (uint32_t)(uintptr_t)caller);
+#else
+    LOG_WARN("heap: allocation after boot from %08x", (unsigned)(uintptr_t)caller);
+#endif
+}
+#endif
+
+void mem_seal() {
+#if defined(TARGET_STM32F7) && MBED_MEM_TRACING_ENABLED
+    mbed_mem_trace_set_callback(mem_trace);
+#endif
+    mem_late = 0;
+    mem_sealed = true;
+}
+
+MemHeap mem_heap() {
+    MemHeap h;
+    memset(&h, 0, sizeof(h));
+    h.sealed = mem_sealed;
+    h.late = mem_late;
+#if defined(TARGET_STM32F7) && MBED_HEAP_STATS_ENABLED
+    mbed_stats_heap_t s;
+    mbed_stats_heap_get(&s);
+    h.available = true;
+    h.current = s.current_size;
+    h.peak = s.max_size;
+    h.reserved = s.reserved_size;
+    h.allocs = s.alloc_cnt;
+    h.failed = s.alloc_fail_cnt;
+#endif
+    return h;
+}
+
+// ==================== BUDGET ====================
+static uint8_t mem_add(MemEntry* out, uint8_t n, uint8_t max, const char* name, uint8_t where,
+                       uint32_t size, uint32_t used) {
+    if(n < max) {
+        out[n].name = name;
+        out[n].where = where;
+        out[n].size = size;
+        out[n].used = used;
+        n++;
+    }
+    return n;
+}
+
+uint8_t mem_entries(MemEntry* out, uint8_t max) {
+    uint8_t n = 0;
+
+#if defined(TARGET_STM32F7)
+    // Stacks; a thread's stack is on the heap unless it was given one
+    for(uint8_t i = 0; i < MEM_THREADS_MAX; i++) {
+        osThreadId_t id = mem_threads[i].id;
+        if(id == NULL) {
+            continue;
+        }
+        uint32_t size = osThreadGetStackSize(id);
+#if MBED_STACK_STATS_ENABLED
+        uint32_t used = size - osThreadGetStackSpace(id);
+#else
+        uint32_t used = MEM_NA;
+#endif
+        n = mem_add(out, n, max, mem_threads[i].name, MEM_SRAM, size, used);
+    }
+    n = mem_add(out, n, max, "isr stack", MEM_SRAM,
+                (uint32_t)((uintptr_t)__StackTop - (uintptr_t)__StackLimit), MEM_NA);
+
+    // Sections; the flash image carries .data's initial values too
+    uint32_t data = (uint32_t)((uintptr_t)__data_end__ - (uintptr_t)__data_start__);
+    n = mem_add(out, n, max, "flash", MEM_FLASH, FLASH_END - FLASH_BASE + 1,
+                (uint32_t)((uintptr_t)__etext - FLASH_BASE) + data);
+    n = mem_add(out, n, max, ".data", MEM_SRAM, data, MEM_NA);
+    n = mem_add(out, n, max, ".bss", MEM_SRAM,
+                (uint32_t)((uintptr_t)__bss_end__ - (uintptr_t)__bss_start__), MEM_NA);
+    MemHeap h = mem_heap();
+    n = mem_add(out, n, max, "heap", MEM_SRAM, (uint32_t)((uintptr_t)__HeapLimit - (uintptr_t)__end__),
+                h.available ? h.peak : MEM_NA);
+#endif
+
+    // Fixed buffers in SRAM (inside .bss above)
+    n = mem_add(out, n, max, "log ring", MEM_SRAM, log_ring_bytes(), MEM_NA);
+    n = mem_add(out, n, max, "audio", MEM_SRAM, sizeof(audio), MEM_NA);
+    n = mem_add(out, n, max, "profiler", MEM_SRAM, PROF_PROBES * sizeof(ProfHistogram), MEM_NA);
+
+    // SDRAM, in address order
+    n = mem_add(out, n, max, "frame bufs", MEM_SDRAM, DISPLAY_CHROME_BOOT - DISPLAY_CONTENT_FB0, MEM_NA);
+    n = mem_add(out, n, max, "chrome", MEM_SDRAM, DISPLAY_SDRAM_FREE - DISPLAY_CHROME_BOOT, MEM_NA);
+    n = mem_add(out, n, max, "sprites", MEM_SDRAM, SPRITE_SDRAM_FREE - SPRITE_CANVAS_ADDR,
+                SPRITE_POOL_ADDR - SPRITE_CANVAS_ADDR + sprite_stats().pool_used);
+    n = mem_add(out, n, max, "glyphs", MEM_SDRAM, GLYPH_SDRAM_FREE - GLYPH_CANVAS_ADDR,
+                GLYPH_POOL_ADDR - GLYPH_CANVAS_ADDR + glyph_stats().pool_used);
+#if MIRROR_ENABLED
+    n = mem_add(out, n, max, "mirror", MEM_SDRAM, MIRROR_SDRAM_FREE - MIRROR_SHADOW_ADDR, MEM_NA);
+#endif
+    uint32_t ring = BLACKBOX_BLOCKS * BLACKBOX_BLOCK_BYTES;
+    uint32_t recorded = blackbox_stats().bytes;
+    n = mem_add(out, n, max, "black box", MEM_SDRAM, ring, recorded < ring ? recorded : ring);
+    n = mem_add(out, n, max, "sdram free", MEM_SDRAM, BLACKBOX_SDRAM_END - (BLACKBOX_ADDR + ring), MEM_NA);
+    return n;
+}
+
+const char* mem_where_name(uint8_t where) {
+    return where < sizeof(mem_where_names) / sizeof(mem_where_names[0]) ? mem_where_names[where] : "?";
+}
+
+// ==================== REPORT ====================
+void mem_report() {
+    MemEntry e[MEM_ENTRIES_MAX];
+    uint8_t n = mem_entries(e, MEM_ENTRIES_MAX);
+    LOG_INFO("memory budget, bytes: %u entries", n);
+    for(uint8_t i = 0; i < n; i++) {
+        if(e[i].used != MEM_NA) {
+            LOG_INFO("  %-10s %-5s %8u  used %u", e[i].name, mem_where_name(e[i].where), e[i].size, e[i].used);
+        } else {
+            LOG_INFO("  %-10s %-5s %8u", e[i].name, mem_where_name(e[i].where), e[i].size);
+        }
+    }
+    MemHeap h = mem_heap();
+    if(h.available) {
+        LOG_INFO("  heap in use %u, peak %u, %u allocations, %u failed", h.current, h.peak, h.allocs, h.failed);
+    }
+    LOG_INFO("  %u allocations after boot%s", h.late, h.sealed ? "" : " (not sealed yet)");
+}
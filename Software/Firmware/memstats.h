@@ -0,0 +1,75 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include "mbed.h"
+
+// ==================== MEMORY BUDGET ====================
+// Where the RAM goes, and how close each part gets to its limit.
+//   Stacks   every thread registered with mem_watch_thread(), plus the
+//            interrupt stack. The peak is the RTOS stack watermark: build
+//            with MBED_STACK_STATS_ENABLED=1 so stacks are filled with a
+//            pattern when they are created.
+//   Heap     in use, peak and allocation count from mbed's heap statistics
+//            (MBED_HEAP_STATS_ENABLED=1).
+//   Sections flash image, .data, .bss and the heap reserve, from the
+//            symbols the STM32F746xG linker script defines.
+//   Buffers  the big fixed buffers: frame buffers, chrome cache, sprite and
+//            glyph caches, the mirror shadow and the black box in SDRAM;
+//            the log ring, audio engine and profiler tables in SRAM.
+//
+// Everything the system needs is allocated while it boots. main() calls
+// mem_seal() before the UI loop. With MBED_MEM_TRACING_ENABLED=1, any
+// allocation after that is late: it is counted and logged with its caller.
+// With MEM_FAIL_LATE_ALLOC=1 the system stops on it instead, so a heap that
+// stopped growing at boot is known to stay that way.
+//
+// mem_report() writes the budget to the log. The diagnostics screen has a
+// page for it (hmi.h). The host build has no threads, heap hooks or linker
+// symbols, so only the buffers are reported there.
+#ifndef MEM_FAIL_LATE_ALLOC
+#define MEM_FAIL_LATE_ALLOC     0
+#endif
+
+#define MEM_THREADS_MAX         8
+#define MEM_ENTRIES_MAX         24
+#define MEM_NA                  0xFFFFFFFFU     // No limit or no peak to show
+
+#define MEM_SRAM                0
+#define MEM_SDRAM               1
+#define MEM_FLASH               2
+
+struct MemEntry {
+    const char* name;
+    uint8_t     where;          // MEM_SRAM, MEM_SDRAM, MEM_FLASH
+    uint32_t    size;           // Bytes
+    uint32_t    used;           // Of size: peak for stacks and heap, fill for pools; or MEM_NA
+};
+
+struct MemHeap {
+    bool     available;         // Statistics compiled in
+    bool     sealed;
+    uint32_t current;
+    uint32_t peak;
+    uint32_t reserved;          // The heap region
+    uint32_t allocs;
+    uint32_t failed;
+    uint32_t late;              // Allocations after mem_seal()
+};
+
+#if defined(TARGET_STM32F7)
+// Once the thread is started; the id stays watched until unwatched
+void mem_watch_thread(osThreadId_t id, const char* name);
+void mem_unwatch_thread(osThreadId_t id);
+#endif
+
+// Boot is over: from here on an allocation is late
+void mem_seal();
+
+// Stacks, sections, then buffers; returns the number written
+uint8_t mem_entries(MemEntry* out, uint8_t max);
+MemHeap mem_heap();
+const char* mem_where_name(uint8_t where);
+
+void mem_report();
+
+#endif
@@ -0,0 +1,300 @@
+#include "mirror.h"
+#include "display.h"
+#include "profiler.h"
+#include "logger.h"
+#include "memstats.h"
+#include <string.h>
+
+#define MIRROR_SHADOW           ((uint16_t*)(uintptr_t)MIRROR_SHADOW_ADDR)
+
+static volatile bool mirror_on = false;
+static MirrorStats   mirror_counters;
+
+// Captured but not sent yet: the UI adds, the sender takes
+static Mutex         mirror_lock;
+static DamageTracker mirror_pending(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+// The frame being sent and how far it has got
+static DamageRect    mirror_work[DAMAGE_MAX_RECTS];
+static uint8_t       mirror_work_count = 0;
+static uint8_t       mirror_work_at = 0;
+static int16_t       mirror_tile_x = 0;
+static int16_t       mirror_row_y = 0;
+static uint8_t       mirror_work_flags = 0;
+static uint16_t      mirror_frame = 0;
+
+// Pacing
+static int32_t       mirror_credit = 0;     // Bytes; negative after a tile overdraws it
+static uint32_t      mirror_last_us = 0;
+static uint32_t      mirror_refresh_us = 0;
+
+// ==================== CAPTURE (UI CONTEXT) ====================
+#if defined(TARGET_STM32F7)
+static DMA2D_HandleTypeDef mirror_dma2d;
+
+// DMA2D blends content (foreground, its own alpha) over chrome and writes
+// RGB565; the CPU only sets it up
+static void mirror_blend(uint32_t content, uint32_t chrome, const DamageRect& r) {
+    uint32_t w = r.x1 - r.x0;
+    uint32_t h = r.y1 - r.y0;
+    uint32_t px = r.y0 * DISPLAY_WIDTH + r.x0;
+    uint32_t span = ((h - 1) * DISPLAY_WIDTH + w) * 4;
+
+    // Pixels drawn by the CPU may still sit in the D-cache
+    SCB_CleanDCache_by_Addr((uint32_t*)(content + px * 4), span);
+    SCB_CleanDCache_by_Addr((uint32_t*)(chrome + px * 4), span);
+
+    mirror_dma2d.Instance = DMA2D;
+    mirror_dma2d.Init.Mode = DMA2D_M2M_BLEND;
+    mirror_dma2d.Init.ColorMode = DMA2D_OUTPUT_RGB565;
+    mirror_dma2d.Init.OutputOffset = DISPLAY_WIDTH - w;
+    for(uint32_t layer = 0; layer < 2; layer++) {
+        mirror_dma2d.LayerCfg[layer].InputOffset = DISPLAY_WIDTH - w;
+        mirror_dma2d.LayerCfg[layer].InputColorMode = DMA2D_INPUT_ARGB8888;
+        mirror_dma2d.LayerCfg[layer].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+        mirror_dma2d.LayerCfg[layer].InputAlpha = 0;
+    }
+    if(HAL_DMA2D_Init(&mirror_dma2d) == HAL_OK &&
+       HAL_DMA2D_ConfigLayer(&mirror_dma2d, 0) == HAL_OK &&
+       HAL_DMA2D_ConfigLayer(&mirror_dma2d, 1) == HAL_OK &&
+       HAL_DMA2D_BlendingStart(&mirror_dma2d, content + px * 4, chrome + px * 4,
+                               MIRROR_SHADOW_ADDR + px * 2, w, h) == HAL_OK) {
+        HAL_DMA2D_PollForTransfer(&mirror_dma2d, 10);
+    }
+}
+#else
+// The LTDC's blend as the simulator does it: chrome over black, then content
+static inline uint32_t mirror_blend_channel(uint32_t fg, uint32_t bg, uint32_t a, int shift) {
+    uint32_t f = (fg >> shift) & 0xFF;
+    uint32_t b = (bg >> shift) & 0xFF;
+    return ((f * a + b * (255 - a)) / 255) << shift;
+}
+
+static inline uint32_t mirror_over(uint32_t fg, uint32_t bg) {
+    uint32_t a = fg >> 24;
+    return mirror_blend_channel(fg, bg, a, 16) | mirror_blend_channel(fg, bg, a, 8) |
+           mirror_blend_channel(fg, bg, a, 0);
+}
+
+static void mirror_blend(uint32_t content, uint32_t chrome, const DamageRect& r) {
+    const uint32_t* fg = (const uint32_t*)(uintptr_t)content;
+    const uint32_t* bg = (const uint32_t*)(uintptr_t)chrome;
+    for(int16_t y = r.y0; y < r.y1; y++) {
+        uint32_t i = y * DISPLAY_WIDTH + r.x0;
+        for(int16_t x = r.x0; x < r.x1; x++, i++) {
+            MIRROR_SHADOW[i] = mirror_rgb565(mirror_over(fg[i], mirror_over(bg[i], 0)));
+        }
+    }
+}
+#endif
+
+static void mirror_on_present(uint32_t content, uint32_t chrome, const DamageRect* rects, uint8_t count) {
+    if(!mirror_on) {
+        return;
+    }
+    uint32_t start = prof_cycles();
+    uint32_t px = 0;
+    for(uint8_t i = 0; i < count; i++) {
+        mirror_blend(content, chrome, rects[i]);
+        px += rects[i].area();
+    }
+
+    // After the shadow is written: a tile read before this is sent again
+    mirror_lock.lock();
+    for(uint8_t i = 0; i < count; i++) {
+        mirror_pending.invalidate(rects[i]);
+    }
+    mirror_lock.unlock();
+
+    uint32_t cycles = prof_cycles() - start;
+    mirror_counters.captures++;
+    mirror_counters.captured_px += px;
+    mirror_counters.capture_cycles += cycles;
+    if(cycles > mirror_counters.max_capture_cycles) {
+        mirror_counters.max_capture_cycles = cycles;
+    }
+}
+
+// ==================== SENDER ====================
+// The next frame is whatever is pending; false if nothing is
+static bool mirror_take() {
+    mirror_lock.lock();
+    mirror_work_count = mirror_pending.count();
+    for(uint8_t i = 0; i < mirror_work_count; i++) {
+        mirror_work[i] = mirror_pending.rect(i);
+    }
+    mirror_pending.clear();
+    mirror_lock.unlock();
+
+    mirror_work_at = 0;
+    if(mirror_work_count == 0) {
+        return false;
+    }
+    mirror_frame++;
+    mirror_tile_x = mirror_work[0].x0;
+    mirror_row_y = mirror_work[0].y0;
+    bool whole = mirror_work_count == 1 && mirror_work[0].area() == DISPLAY_WIDTH * DISPLAY_HEIGHT;
+    mirror_work_flags = whole ? TELEMETRY_MIRROR_REFRESH : 0;
+    return true;
+}
+
+static void mirror_read_row(uint16_t* out, int16_t x, int16_t y, uint8_t w) {
+    const uint16_t* row = MIRROR_SHADOW + y * DISPLAY_WIDTH + x;
+#if defined(TARGET_STM32F7)
+    // Written by the DMA2D behind the cache; only ever read here
+    SCB_InvalidateDCache_by_Addr((uint32_t*)row, w * 2);
+#endif
+    memcpy(out, row, w * 2);
+}
+
+// Rows of the current tile column until the record is full. Each row is
+// copied out first, so ABOVE compares against exactly what was sent even
+// if a capture rewrites the shadow meanwhile (it is queued again then).
+static uint32_t mirror_send_tile() {
+    const DamageRect& r = mirror_work[mirror_work_at];
+    uint8_t w = (uint8_t)(r.x1 - mirror_tile_x < MIRROR_TILE_W ? r.x1 - mirror_tile_x : MIRROR_TILE_W);
+    uint16_t rows[2][MIRROR_TILE_W];
+    uint8_t encoded[MIRROR_ROW_MAX(MIRROR_TILE_W)];
+
+    TelemetryMirror m;
+    m.frame = mirror_frame;
+    m.x = (uint16_t)mirror_tile_x;
+    m.y = (uint16_t)mirror_row_y;
+    m.w = w;
+    m.len = 0;
+    uint8_t h = 0;
+    while(mirror_row_y + h < r.y1 && h < 255) {
+        uint16_t* row = rows[h & 1];
+        mirror_read_row(row, mirror_tile_x, mirror_row_y + h, w);
+        size_t n = mirror_encode_row(row, h > 0 ? rows[(h - 1) & 1] : NULL, w, encoded);
+        if(m.len + n > TELEMETRY_CHUNK_MAX) {
+            break;
+        }
+        memcpy(m.data + m.len, encoded, n);
+        m.len = (uint8_t)(m.len + n);
+        h++;
+    }
+    m.h = h;
+
+    // Down the column, then the next column, then the next rect
+    mirror_row_y += h;
+    if(mirror_row_y >= r.y1) {
+        mirror_tile_x += MIRROR_TILE_W;
+        mirror_row_y = r.y0;
+        if(mirror_tile_x >= r.x1 && ++mirror_work_at < mirror_work_count) {
+            mirror_tile_x = mirror_work[mirror_work_at].x0;
+            mirror_row_y = mirror_work[mirror_work_at].y0;
+        }
+    }
+    m.flags = mirror_work_flags;
+    if(mirror_work_at >= mirror_work_count) {
+        m.flags |= TELEMETRY_MIRROR_LAST;
+        mirror_counters.frames++;
+    }
+
+    uint32_t bytes = telemetry_send_mirror(m);
+    mirror_counters.tiles++;
+    mirror_counters.sent_px += (uint32_t)w * h;
+    mirror_counters.bytes += bytes;
+    return bytes;
+}
+
+void mirror_pump() {
+    if(!mirror_on) {
+        return;
+    }
+    uint32_t now = us_ticker_read();
+    mirror_credit += (int32_t)((uint64_t)(now - mirror_last_us) * MIRROR_BYTES_PER_S / 1000000);
+    if(mirror_credit > MIRROR_BURST_BYTES) {
+        mirror_credit = MIRROR_BURST_BYTES;
+    }
+    mirror_last_us = now;
+
+    if(now - mirror_refresh_us >= MIRROR_REFRESH_MS * 1000U) {
+        mirror_refresh_us = now;
+        mirror_lock.lock();
+        mirror_pending.invalidate_all();
+        mirror_lock.unlock();
+    }
+
+    while(mirror_credit > 0) {
+        if(mirror_work_at >= mirror_work_count && !mirror_take()) {
+            return;
+        }
+        mirror_credit -= (int32_t)mirror_send_tile();
+    }
+    if(mirror_work_at < mirror_work_count) {
+        mirror_counters.late++;
+    }
+}
+
+#if defined(TARGET_STM32F7)
+static uint64_t mirror_stack[MIRROR_STACK / 8];
+static Thread   mirror_thread(osPriorityBelowNormal, MIRROR_STACK, (unsigned char*)mirror_stack);
+static bool     mirror_thread_started = false;
+
+static void mirror_main() {
+    uint64_t next = Kernel::get_ms_count();
+    while(1) {
+        mirror_pump();
+        next += MIRROR_PERIOD_MS;
+        ThisThread::sleep_until(next);
+    }
+}
+#else
+static Ticker   mirror_ticker;
+#endif
+
+// ==================== LIFECYCLE ====================
+// Before ui_start(): the shadow starts black and the first screen's chrome
+// change captures all of it
+void mirror_start() {
+#if MIRROR_ENABLED
+    memset(MIRROR_SHADOW, 0, MIRROR_SHADOW_BYTES);
+    mirror_lock.lock();
+    mirror_pending.clear();
+    mirror_lock.unlock();
+    mirror_work_count = mirror_work_at = 0;
+    memset(&mirror_counters, 0, sizeof(mirror_counters));
+    mirror_credit = MIRROR_BURST_BYTES;
+    mirror_last_us = mirror_refresh_us = us_ticker_read();
+    mirror_on = true;
+    display_attach(mirror_on_present);
+
+#if defined(TARGET_STM32F7)
+    if(!mirror_thread_started) {
+        mirror_thread_started = true;
+        mirror_thread.start(mirror_main);
+        mem_watch_thread(mirror_thread.get_id(), "mirror");
+    }
+#else
+    mirror_ticker.attach_us(mirror_pump, MIRROR_PERIOD_MS * 1000);
+#endif
+    LOG_INFO("mirror: %u B/s, every %u ms", MIRROR_BYTES_PER_S, MIRROR_PERIOD_MS);
+#else
+    LOG_WARN("mirror: not in this build (MIRROR_ENABLED=0)");
+#endif
+}
+
+void mirror_stop() {
+    display_attach(NULL);
+    mirror_on = false;
+#if !defined(TARGET_STM32F7)
+    mirror_ticker.detach();
+#endif
+}
+
+bool mirror_running() {
+    return mirror_on;
+}
+
+bool mirror_idle() {
+    mirror_lock.lock();
+    bool idle = !mirror_pending.any() && mirror_work_at >= mirror_work_count;
+    mirror_lock.unlock();
+    return idle;
+}
+
+MirrorStats mirror_stats() {
+    return mirror_counters;
+}
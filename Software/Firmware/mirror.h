@@ -0,0 +1,74 @@
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include "mbed.h"
+#include "glyph.h"
+#include "telemetry.h"
+#include "mirror_codec.h"
+
+// ==================== SCREEN MIRROR ====================
+// Sends what the pilot sees down the telemetry stream, so it can be watched
+// on a PC: telemetry_decode -m rebuilds the screen from it.
+//
+// Capture happens as each frame is presented (display_attach()): the
+// regions that changed are blended, content over chrome as the LTDC does,
+// into an RGB565 shadow of the screen in SDRAM (DMA2D on the board) and
+// added to a pending damage list. That is all the UI pays.
+//
+// A low-priority sender wakes every MIRROR_PERIOD_MS, takes the pending
+// list as one mirror frame and sends it as tiles (mirror_codec.h) from the
+// shadow. Sending is paced to MIRROR_BYTES_PER_S of the UART; a frame that
+// does not fit carries on at the next wakeup while newer damage collects,
+// so a busy screen is sent less often rather than falling behind. Every
+// MIRROR_REFRESH_MS the whole screen is resent for a viewer that joined
+// late.
+//
+// The shadow takes MIRROR_SHADOW_BYTES of SDRAM ahead of the black box.
+// Build with MIRROR_ENABLED=0 to give it back; the text telemetry mode has
+// no stream to mirror into, so it does that by default.
+#ifndef MIRROR_ENABLED
+#define MIRROR_ENABLED          (TELEMETRY_MODE == TELEMETRY_MODE_BINARY)
+#endif
+
+#define MIRROR_PERIOD_MS        50          // Up to 20 mirror frames/s
+#define MIRROR_BYTES_PER_S      24000       // Of ~46 kB/s at TELEMETRY_BAUD; records take ~7
+#define MIRROR_BURST_BYTES      (MIRROR_BYTES_PER_S / 4)    // Credit kept while idle
+#define MIRROR_REFRESH_MS       30000
+#define MIRROR_STACK            2048
+
+#define MIRROR_SHADOW_ADDR      GLYPH_SDRAM_FREE
+#define MIRROR_SHADOW_BYTES     (DISPLAY_WIDTH * DISPLAY_HEIGHT * 2)
+#if MIRROR_ENABLED
+#define MIRROR_SDRAM_FREE       (MIRROR_SHADOW_ADDR + MIRROR_SHADOW_BYTES)
+#else
+#define MIRROR_SDRAM_FREE       MIRROR_SHADOW_ADDR
+#endif
+
+struct MirrorStats {
+    uint32_t frames;            // Mirror frames finished
+    uint32_t tiles;             // Records sent
+    uint32_t bytes;             // On the wire, framing included
+    uint32_t captures;          // Presented frames blended into the shadow
+    uint32_t captured_px;
+    uint32_t sent_px;           // Tile pixels sent, refreshes included
+    uint32_t late;              // Wakeups that ran out of credit mid-frame
+    uint32_t capture_cycles;    // Total, at PROF_CPU_HZ
+    uint32_t max_capture_cycles;
+};
+
+// Starts capturing and sending with a whole-screen frame. On the board the
+// sender is a thread, started once per boot; the host drives mirror_pump()
+// from a Ticker on the simulated clock.
+void mirror_start();
+void mirror_stop();
+bool mirror_running();
+
+// One sender wakeup; sends what the pacing allows
+void mirror_pump();
+
+// Nothing captured is left to send
+bool mirror_idle();
+
+MirrorStats mirror_stats();
+
+#endif
@@ -0,0 +1,113 @@
+#include "mirror_codec.h"
+#include <string.h>
+
+static inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// ==================== ENCODER ====================
+static uint8_t same_run(const uint16_t* row, uint8_t i, uint8_t w, uint8_t max) {
+    uint8_t n = 1;
+    while(i + n < w && n < max && row[i + n] == row[i]) {
+        n++;
+    }
+    return n;
+}
+
+static uint8_t above_run(const uint16_t* row, const uint16_t* above, uint8_t i, uint8_t w) {
+    uint8_t n = 0;
+    if(above != NULL) {
+        while(i + n < w && n < MIRROR_ABOVE_MAX && row[i + n] == above[i + n]) {
+            n++;
+        }
+    }
+    return n;
+}
+
+size_t mirror_encode_row(const uint16_t* row, const uint16_t* above, uint8_t w, uint8_t* out) {
+    size_t o = 0;
+    uint8_t i = 0;
+    while(i < w) {
+        uint8_t a = above_run(row, above, i, w);
+        uint8_t r = same_run(row, i, w, MIRROR_RUN_MAX);
+        if(a > 0 && a >= r) {
+            out[o++] = (uint8_t)(MIRROR_OP_ABOVE | (a - 1));
+            i += a;
+            continue;
+        }
+        if(r >= 2) {
+            out[o++] = (uint8_t)(r - 1);
+            put16(out + o, row[i]);
+            o += 2;
+            i += r;
+            continue;
+        }
+
+        // RAW until a run or a match above is worth an op of its own
+        uint8_t start = i++;
+        while(i < w && i - start < MIRROR_RAW_MAX && above_run(row, above, i, w) < 2 &&
+              same_run(row, i, w, 3) < 3) {
+            i++;
+        }
+        out[o++] = (uint8_t)(MIRROR_OP_RAW | (i - start - 1));
+        for(uint8_t k = start; k < i; k++) {
+            put16(out + o, row[k]);
+            o += 2;
+        }
+    }
+    return o;
+}
+
+// ==================== DECODER ====================
+int mirror_apply(const uint8_t* data, size_t len, uint16_t x, uint16_t y, uint8_t w, uint8_t h,
+                 uint16_t* frame, uint16_t frame_w, uint16_t frame_h) {
+    if(w == 0 || h == 0 || w > MIRROR_TILE_W || x + w > frame_w || y + h > frame_h) {
+        return MIRROR_ERR_BOUNDS;
+    }
+
+    size_t i = 0;
+    for(uint8_t row = 0; row < h; row++) {
+        uint16_t* dst = frame + (uint32_t)(y + row) * frame_w + x;
+        uint8_t col = 0;
+        while(col < w) {
+            if(i >= len) {
+                return MIRROR_ERR_DATA;
+            }
+            uint8_t op = data[i++];
+            uint8_t n;
+            if(op < MIRROR_OP_RAW) {
+                n = (uint8_t)(op + 1);
+                if(col + n > w || i + 2 > len) {
+                    return MIRROR_ERR_DATA;
+                }
+                uint16_t c = get16(data + i);
+                i += 2;
+                for(uint8_t k = 0; k < n; k++) {
+                    dst[col + k] = c;
+                }
+            } else if(op < MIRROR_OP_ABOVE) {
+                n = (uint8_t)((op & 0x3F) + 1);
+                if(col + n > w || i + 2 * n > len) {
+                    return MIRROR_ERR_DATA;
+                }
+                for(uint8_t k = 0; k < n; k++) {
+                    dst[col + k] = get16(data + i);
+                    i += 2;
+                }
+            } else {
+                n = (uint8_t)((op & 0x3F) + 1);
+                if(row == 0 || col + n > w) {
+                    return MIRROR_ERR_DATA;
+                }
+                memcpy(dst + col, dst + col - frame_w, n * sizeof(uint16_t));
+            }
+            col = (uint8_t)(col + n);
+        }
+    }
+    return i == len ? MIRROR_OK : MIRROR_ERR_DATA;
+}
@@ -0,0 +1,51 @@
+#ifndef MIRROR_CODEC_H
+#define MIRROR_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==================== SCREEN MIRROR FORMAT ====================
+// Portable (no mbed): shared by the firmware mirror (mirror.h) and the host
+// viewer.
+//
+// The screen goes out as RGB565 tiles at most MIRROR_TILE_W pixels wide,
+// one tile per telemetry mirror record (telemetry_codec.h), which carries
+// its position and size. The payload is the tile's rows top to bottom,
+// each row left to right as ops that never run past the end of the row:
+//
+//   0x00-0x7F  RUN    (op & 0x7F) + 1 pixels of the u16 colour after it
+//   0x80-0xBF  RAW    (op & 0x3F) + 1 u16 pixels follow
+//   0xC0-0xFF  ABOVE  (op & 0x3F) + 1 pixels as in the row above, which
+//                     must be in the same record (not in its first row)
+//
+// Screens are mostly flat colour, so a row is a few RUNs and a row like
+// the one before it is one ABOVE byte. Colours are little-endian.
+#define MIRROR_TILE_W           64
+#define MIRROR_RUN_MAX          128
+#define MIRROR_RAW_MAX          64
+#define MIRROR_ABOVE_MAX        64
+#define MIRROR_OP_RAW           0x80
+#define MIRROR_OP_ABOVE         0xC0
+
+// Worst case for one row of w pixels: all RAW
+#define MIRROR_ROW_MAX(w)       ((w) * 2 + ((w) + MIRROR_RAW_MAX - 1) / MIRROR_RAW_MAX)
+
+// mirror_apply() results
+#define MIRROR_OK               0
+#define MIRROR_ERR_BOUNDS       1       // Tile outside the frame
+#define MIRROR_ERR_DATA         2       // Ops overrun a row, or rows missing or left over
+
+static inline uint16_t mirror_rgb565(uint32_t argb) {
+    return (uint16_t)(((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F));
+}
+
+// One row of w pixels (w <= MIRROR_TILE_W); above is the row before it in
+// the same record, or NULL. Returns the bytes written to out, at most
+// MIRROR_ROW_MAX(w).
+size_t mirror_encode_row(const uint16_t* row, const uint16_t* above, uint8_t w, uint8_t* out);
+
+// Draws one record's tile into an RGB565 frame of frame_w x frame_h
+int mirror_apply(const uint8_t* data, size_t len, uint16_t x, uint16_t y, uint8_t w, uint8_t h,
+                 uint16_t* frame, uint16_t frame_w, uint16_t frame_h);
+
+#endif
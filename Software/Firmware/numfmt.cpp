@@ -0,0 +1,52 @@
+#include "numfmt.h"
+
+// Digits of magnitude, least significant first, with the point after
+// decimals of them; at least one digit ahead of the point
+static uint8_t format(char* out, uint32_t magnitude, bool negative, uint8_t decimals, uint8_t width) {
+    char rev[NUMFMT_MAX];
+    uint8_t n = 0;
+    do {
+        rev[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+        if(n == decimals) {
+            rev[n++] = '.';
+        }
+    } while(magnitude != 0 || n < (decimals ? decimals + 2 : 1));
+    if(negative) {
+        rev[n++] = '-';
+    }
+
+    uint8_t len = 0;
+    while(len + n < width) {
+        out[len++] = ' ';
+    }
+    while(n > 0) {
+        out[len++] = rev[--n];
+    }
+    out[len] = '\0';
+    return len;
+}
+
+uint8_t numfmt_uint(char* out, uint32_t value) {
+    return format(out, value, false, 0, 0);
+}
+
+uint8_t numfmt_int(char* out, int32_t value) {
+    return numfmt_fixed(out, value, 0, 0);
+}
+
+uint8_t numfmt_fixed(char* out, int32_t value, uint8_t decimals, uint8_t width) {
+    if(decimals > 9) decimals = 9;
+    // Magnitude in unsigned arithmetic so INT32_MIN survives
+    uint32_t magnitude = value < 0 ? 0U - (uint32_t)value : (uint32_t)value;
+    return format(out, magnitude, value < 0, decimals, width);
+}
+
+int32_t numfmt_scale(float v, uint8_t decimals) {
+    while(decimals-- > 0) {
+        v *= 10.0f;
+    }
+    if(v >= 2147483520.0f) return INT32_MAX;      // Largest float below 2^31
+    if(v <= -2147483648.0f) return INT32_MIN;
+    return (int32_t)(v < 0.0f ? v - 0.5f : v + 0.5f);
+}
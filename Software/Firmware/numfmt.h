@@ -0,0 +1,24 @@
+#ifndef NUMFMT_H
+#define NUMFMT_H
+
+#include <stdint.h>
+
+// ==================== NUMBER FORMATTING ====================
+// Portable (no mbed). Integers and fixed-point values to decimal text
+// without printf: no float formatting code pulled in, no heap, and a few
+// bytes of stack. Every function writes a NUL-terminated string and
+// returns its length.
+#define NUMFMT_MAX      13          // "-2147483648.0" and the NUL; more with padding
+
+uint8_t numfmt_uint(char* out, uint32_t value);
+uint8_t numfmt_int(char* out, int32_t value);
+
+// value / 10^decimals: (1234, 2) -> "12.34", (-5, 2) -> "-0.05". Right-
+// aligned in width characters with leading spaces (0 = no padding), so a
+// readout keeps its digits in the same columns as the value changes.
+uint8_t numfmt_fixed(char* out, int32_t value, uint8_t decimals, uint8_t width);
+
+// v * 10^decimals, rounded half away from zero and saturated to int32
+int32_t numfmt_scale(float v, uint8_t decimals);
+
+#endif
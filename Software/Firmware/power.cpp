@@ -0,0 +1,219 @@
+#include "power.h"
+#include "marshalling.h"
+#include "display.h"
+#include "telemetry.h"
+#include "audio.h"
+#include "logger.h"
+#include "ui.h"
+#include <string.h>
+
+static const char* const power_wake_names[POWER_WAKE_SOURCES] = {
+    "touch", "IR", "range", "LDR",
+};
+
+static volatile bool     power_on = false;
+static volatile uint8_t  power_state = POWER_STATE_ACTIVE;
+static uint32_t          power_idle_ms = POWER_IDLE_MS;
+static volatile uint32_t power_last_activity_us = 0;
+static volatile bool     power_wake_taken = false;  // This standby's wake is posted
+static volatile uint32_t power_woke_us = 0;
+static PowerStats        power_counts;
+static uint64_t          power_since_ms = 0;        // Current state entered
+static uint32_t          power_flips_at = 0;
+
+// ==================== ACCOUNTING ====================
+// Closes the current state's time and flips up to now
+static void power_account() {
+    uint64_t now = Kernel::get_ms_count();
+    uint32_t flips = display_flips();
+    PowerStateStats& s = power_counts.states[power_state];
+    s.ms += now - power_since_ms;
+    s.flips += flips - power_flips_at;
+    power_since_ms = now;
+    power_flips_at = flips;
+}
+
+// Interrupt or sampler context; only the first wake of a standby counts
+static bool power_claim_wake(uint8_t source, uint32_t at_us) {
+    core_util_critical_section_enter();
+    bool first = !power_wake_taken;
+    if(first) {
+        power_wake_taken = true;
+        power_woke_us = at_us;
+        power_counts.last_wake = source;
+        power_counts.wakes[source]++;
+    }
+    core_util_critical_section_exit();
+    return first;
+}
+
+static void power_resume_audio() {
+    if(!audio.resume()) {
+        LOG_WARN("standby: codec failed to restart");
+    }
+}
+
+// ==================== LIFECYCLE ====================
+void power_start(uint32_t idle_ms) {
+    memset(&power_counts, 0, sizeof(power_counts));
+    power_idle_ms = idle_ms;
+    power_state = POWER_STATE_ACTIVE;
+    power_wake_taken = false;
+    power_since_ms = Kernel::get_ms_count();
+    power_flips_at = display_flips();
+    power_last_activity_us = us_ticker_read();
+    power_on = true;
+}
+
+void power_stop() {
+    power_exit_standby();
+    power_on = false;
+}
+
+bool power_enabled() {
+    return power_on;
+}
+
+bool power_standby() {
+    return power_state == POWER_STATE_STANDBY;
+}
+
+// ==================== ACTIVITY ====================
+void power_activity() {
+    power_last_activity_us = us_ticker_read();
+}
+
+bool power_on_frame(const SensorFrame& f) {
+    if(!power_on) {
+        return false;
+    }
+    PowerStateStats& s = power_counts.states[power_state];
+    s.passes++;
+    if(f.events & SENSOR_EVENT_RANGE) {
+        s.echoes++;
+    }
+
+    uint8_t source;
+    uint32_t at_us;
+    if(f.ir == 0) {
+        source = POWER_WAKE_IR;
+        at_us = f.timestamp_us;     // The pass the edge woke
+    } else if(f.valid & SENSOR_VALID_RANGE) {
+        source = POWER_WAKE_RANGE;
+        at_us = f.range_us;
+    } else if(f.ldr_on != 0) {
+        source = POWER_WAKE_LDR;
+        at_us = f.ldr_us;
+    } else {
+        return false;
+    }
+    power_activity();
+    return power_state == POWER_STATE_STANDBY && power_claim_wake(source, at_us);
+}
+
+bool power_on_touch() {
+    if(!power_on) {
+        return false;
+    }
+    power_activity();
+    if(power_state != POWER_STATE_STANDBY) {
+        return false;
+    }
+    power_claim_wake(POWER_WAKE_TOUCH, us_ticker_read());
+    return true;
+}
+
+uint32_t power_idle_left_ms() {
+    uint32_t idle = (us_ticker_read() - power_last_activity_us) / 1000;
+    return idle >= power_idle_ms ? 0 : power_idle_ms - idle;
+}
+
+// ==================== STANDBY ====================
+void power_enter_standby() {
+    if(!power_on || power_state == POWER_STATE_STANDBY) {
+        return;
+    }
+    // The last frame lands before the LTDC stops, so none is left waiting
+    display_begin_frame();
+    power_account();
+    lcd_lock();
+    BSP_LCD_DisplayOff();
+    lcd_unlock();
+
+    ldr_scan.set_rate(POWER_STANDBY_LDR_HZ);
+    ranger.stop();
+    ranger.start(POWER_STANDBY_RANGE_MS);
+    telemetry_set_rate(POWER_STANDBY_TELEMETRY_HZ);
+    audio.pause();
+
+    power_wake_taken = false;
+    power_counts.standbys++;
+    power_state = POWER_STATE_STANDBY;
+
+    uint32_t ma10 = power_estimate_ma10(power_counts, POWER_STATE_ACTIVE);
+    LOG_INFO("standby: idle %u s, active draw ~%u.%u mA", power_idle_ms / 1000, ma10 / 10, ma10 % 10);
+}
+
+void power_exit_standby() {
+    if(power_state != POWER_STATE_STANDBY) {
+        return;
+    }
+    power_account();
+    power_state = POWER_STATE_ACTIVE;
+    power_activity();               // A fresh idle period from here
+
+    ldr_scan.set_rate(LDR_SCAN_RATE_HZ);
+    ranger.stop();
+#if RANGING_SENSORS > 1
+    ranger.start();
+#else
+    ranger.start(US_DEFAULT_PERIOD_MS);
+#endif
+    telemetry_set_rate(TELEMETRY_RATE_HZ);
+    lcd_lock();
+    BSP_LCD_DisplayOn();
+    lcd_unlock();
+
+    // Codec init is slow; it waits until the UI's first frame is queued
+    ui_queue.call(power_resume_audio);
+
+    uint32_t ma10 = power_estimate_ma10(power_counts, POWER_STATE_STANDBY);
+    LOG_INFO("standby: woken by %s, standby draw ~%u.%u mA",
+             power_wake_names[power_counts.last_wake], ma10 / 10, ma10 % 10);
+}
+
+uint32_t power_wake_us() {
+    return power_woke_us;
+}
+
+// ==================== REPORTING ====================
+PowerStats power_stats() {
+    PowerStats s = power_counts;
+    if(power_on) {
+        PowerStateStats& cur = s.states[power_state];
+        cur.ms += Kernel::get_ms_count() - power_since_ms;
+        cur.flips += display_flips() - power_flips_at;
+    }
+    s.state = power_state;
+    return s;
+}
+
+const char* power_wake_name(uint8_t source) {
+    return source < POWER_WAKE_SOURCES ? power_wake_names[source] : "?";
+}
+
+uint32_t power_estimate_ma10(const PowerStats& s, uint8_t state) {
+    const PowerStateStats& t = s.states[state];
+    if(t.ms == 0) {
+        return 0;
+    }
+    float span_us = t.ms * 1000.0f;
+    float cpu = ((float)t.passes * POWER_PASS_US + (float)t.flips * POWER_FRAME_US) / span_us;
+    float ranger_duty = (float)t.echoes * POWER_ECHO_US / span_us;
+    float ma = POWER_MA_BOARD + POWER_MA_CPU * (cpu > 1.0f ? 1.0f : cpu) +
+               POWER_MA_RANGER * (ranger_duty > 1.0f ? 1.0f : ranger_duty);
+    if(state == POWER_STATE_ACTIVE) {
+        ma += POWER_MA_DISPLAY + POWER_MA_BACKLIGHT + POWER_MA_CODEC;
+    }
+    return (uint32_t)(ma * 10.0f + 0.5f);
+}
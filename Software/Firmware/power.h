@@ -0,0 +1,111 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "mbed.h"
+#include "sensors.h"
+
+// ==================== LOW-POWER STANDBY ====================
+// With no aircraft on the stand the system still scans the LDRs at 2 kHz,
+// ranges every 60 ms, streams telemetry and keeps the panel lit. After
+// POWER_IDLE_MS with no sign of one, the UI (ui.h) goes to standby:
+//   - the panel and backlight go off (LTDC disabled, so no SDRAM scan-out);
+//   - the LDR scan drops to POWER_STANDBY_LDR_HZ, ranging to one slot per
+//     POWER_STANDBY_RANGE_MS, telemetry to POWER_STANDBY_TELEMETRY_HZ;
+//   - the codec is powered down;
+//   - screen ticks stop, so the only wakeups left are the slowed sensors.
+// A sign of one means a valid distance, a lit LDR channel, a blocked IR
+// beam or a touch. IR edges (D8) and the touch controller's INT line are
+// interrupts, so either ends standby at once. A distance or a light ends
+// it at the slowed rates. The UI then restores everything, and in auto
+// mode redraws the directive first.
+//
+// Tickless idle: build with MBED_TICKLESS (target.macros_add in
+// mbed_app.json). The idle thread then sleeps until the next timer event
+// instead of waking on every 1 ms SysTick, and standby leaves very few
+// timer events. Only sleep (WFI) is used, not deep sleep, because the ADC
+// timer, DMA and us_ticker must keep running.
+//
+// The board has no current sensor, so the draw is estimated. Time in each
+// state, sampler passes, echoes and flips are counted, and
+// power_estimate_ma10() converts them with the per-part currents below.
+// Replace those with bench measurements where they differ. The wake latency
+// (wake event to the directive on glass) is measured by the profiler's
+// PROF_WAKE probe.
+#define POWER_IDLE_MS                   60000
+#define POWER_STANDBY_LDR_HZ            64      // 8 DMA blocks/s; light seen within ~0.1 s
+#define POWER_STANDBY_RANGE_MS          1000
+#define POWER_STANDBY_TELEMETRY_HZ      2
+
+// Current model, mA from the 5 V USB supply
+#define POWER_MA_BOARD          75      // Core in WFI at 216 MHz, SDRAM, ST-LINK
+#define POWER_MA_CPU            110     // Added while the core runs
+#define POWER_MA_DISPLAY        35      // LTDC scan-out and panel logic
+#define POWER_MA_BACKLIGHT      95
+#define POWER_MA_CODEC          12      // WM8994 playing silence
+#define POWER_MA_RANGER         13      // Per HC-SR04 while a burst is out
+#define POWER_PASS_US           25      // CPU per sampler pass (profiler: sampler pass)
+#define POWER_FRAME_US          1800    // CPU per presented frame (profiler: auto draw)
+#define POWER_ECHO_US           12000   // HC-SR04 busy per measurement
+
+#define POWER_STATE_ACTIVE      0
+#define POWER_STATE_STANDBY     1
+#define POWER_STATES            2
+
+// What ended a standby
+#define POWER_WAKE_TOUCH        0
+#define POWER_WAKE_IR           1
+#define POWER_WAKE_RANGE        2
+#define POWER_WAKE_LDR          3
+#define POWER_WAKE_SOURCES      4
+
+struct PowerStateStats {
+    uint64_t ms;                // Time spent in the state
+    uint32_t passes;            // Sampler passes
+    uint32_t echoes;            // Completed measurements
+    uint32_t flips;             // Frames put on glass
+};
+
+struct PowerStats {
+    uint8_t         state;      // POWER_STATE_*
+    uint32_t        standbys;
+    uint32_t        wakes[POWER_WAKE_SOURCES];
+    uint8_t         last_wake;  // POWER_WAKE_*
+    PowerStateStats states[POWER_STATES];   // Up to now
+};
+
+// Enables standby with the given idle period. Call before ui_start().
+void power_start(uint32_t idle_ms = POWER_IDLE_MS);
+void power_stop();              // Leaves standby first if need be
+bool power_enabled();
+bool power_standby();
+
+// Any context: something happened that means the stand is in use
+void power_activity();
+
+// Sampler context, every frame. Returns true on the first sign of an
+// aircraft while in standby: the caller wakes the UI.
+bool power_on_frame(const SensorFrame& f);
+
+// Touch interrupt. Returns true if it came in standby: the caller wakes
+// the UI, and the touch is not a tap.
+bool power_on_touch();
+
+// Milliseconds until the idle period runs out, 0 once it has
+uint32_t power_idle_left_ms();
+
+// Queue context, from the UI with its drawing stopped / about to resume.
+// Exit restores the sensors and the panel at once; the codec restarts on
+// the queue after the UI's first frame.
+void power_enter_standby();
+void power_exit_standby();
+
+// When the event that ended the last standby happened (us_ticker)
+uint32_t power_wake_us();
+
+PowerStats  power_stats();
+const char* power_wake_name(uint8_t source);
+
+// Estimated average draw in a state, in 0.1 mA
+uint32_t power_estimate_ma10(const PowerStats& s, uint8_t state);
+
+#endif
@@ -0,0 +1,161 @@
+#include "profiler.h"
+#include "logger.h"
+#include <string.h>
+
+// ==================== CYCLE PROFILER ====================
+static const char* const prof_names[PROF_PROBES] = {
+    "home draw",
+    "distance draw",
+    "auto draw",
+    "diag draw",
+    "lcd wait",
+    "lcd hold",
+    "snapshot read",
+    "sampler pass",
+    "echo",
+    "directive",
+    "wake",
+};
+
+static ProfHistogram     prof_hist[PROF_PROBES];
+static uint32_t          prof_span_cost = 0;
+static uint32_t          prof_record_cost = 0;
+static volatile uint32_t prof_pending_us[PROF_PROBES];
+static volatile uint32_t prof_pending = 0;         // Bit per probe
+
+// Two bins per octave: [2^k, 1.5 * 2^k) and [1.5 * 2^k, 2^(k+1))
+static inline uint8_t bin_of(uint32_t v) {
+    if(v < 2) {
+        return 0;
+    }
+    uint8_t k = 31 - __builtin_clz(v);
+    return (uint8_t)(2 * k + ((v >> (k - 1)) & 1));
+}
+
+static uint32_t bin_top(uint8_t b) {
+    uint8_t k = b / 2;
+    if(k == 0) {
+        return 2;
+    }
+    if(b & 1) {
+        return k >= 31 ? 0xFFFFFFFFU : (1U << (k + 1));
+    }
+    return (1U << k) + (1U << (k - 1));
+}
+
+void prof_record(uint8_t probe, uint32_t cycles) {
+    ProfHistogram* h = &prof_hist[probe];
+    cycles = cycles > prof_span_cost ? cycles - prof_span_cost : 0;
+    if(h->count == 0 || cycles < h->min) h->min = cycles;
+    if(cycles > h->max) h->max = cycles;
+    h->count++;
+    h->sum += cycles;
+    h->bins[bin_of(cycles)]++;
+}
+
+void prof_record_us(uint8_t probe, uint32_t us) {
+    uint64_t cycles = (uint64_t)us * PROF_CYCLES_PER_US + prof_span_cost;
+    prof_record(probe, cycles > 0xFFFFFFFFU ? 0xFFFFFFFFU : (uint32_t)cycles);
+}
+
+void prof_pixels_pending(uint8_t probe, uint32_t since_us) {
+    prof_pending_us[probe] = since_us;
+    prof_pending = prof_pending | (1U << probe);
+}
+
+// LTDC interrupt: the frame presented after prof_pixels_pending() is on glass
+void prof_flipped() {
+    uint32_t pending = prof_pending;
+    if(pending == 0) {
+        return;
+    }
+    prof_pending = 0;
+    uint32_t now = us_ticker_read();
+    for(uint8_t p = 0; p < PROF_PROBES; p++) {
+        if(pending & (1U << p)) {
+            prof_record_us(p, now - prof_pending_us[p]);
+        }
+    }
+}
+
+void prof_reset() {
+    memset(prof_hist, 0, sizeof(prof_hist));
+    prof_pending = 0;
+}
+
+void prof_init() {
+#if defined(TARGET_STM32F7)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55;          // Unlock; the M7 ignores DWT writes until then
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    // Cheapest of a few empty spans: what the counter reads add by themselves
+    prof_span_cost = 0;
+    uint32_t best = 0xFFFFFFFFU;
+    for(int i = 0; i < 16; i++) {
+        uint32_t t = prof_cycles();
+        uint32_t d = prof_cycles() - t;
+        if(d < best) best = d;
+    }
+    prof_span_cost = best;
+
+    // One record, averaged over a batch into a probe that is then cleared
+    uint32_t t = prof_cycles();
+    for(int i = 0; i < 64; i++) {
+        prof_record(PROF_DIRECTIVE, (uint32_t)i);
+    }
+    prof_record_cost = (prof_cycles() - t) / 64;
+    prof_reset();
+}
+
+const ProfHistogram* prof_histogram(uint8_t probe) {
+    return &prof_hist[probe];
+}
+
+const char* prof_name(uint8_t probe) {
+    return prof_names[probe];
+}
+
+uint32_t prof_percentile(const ProfHistogram* h, uint8_t pct) {
+    if(h->count == 0) {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(((uint64_t)h->count * pct + 99) / 100);
+    uint32_t seen = 0;
+    for(uint8_t b = 0; b < PROF_BINS; b++) {
+        seen += h->bins[b];
+        if(seen >= rank) {
+            uint32_t top = bin_top(b);
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
+
+uint32_t prof_span_overhead() {
+    return prof_span_cost;
+}
+
+uint32_t prof_record_overhead() {
+    return prof_record_cost;
+}
+
+void prof_dump() {
+    LOG_INFO("profile, times in us: empty span %u cycles, record %u cycles, enabled %u",
+             prof_span_cost, prof_record_cost, (unsigned)PROFILER_ENABLED);
+    for(uint8_t p = 0; p < PROF_PROBES; p++) {
+        const ProfHistogram* h = &prof_hist[p];
+        if(h->count == 0) {
+            continue;
+        }
+        float mean = (float)(h->sum / h->count) / PROF_CYCLES_PER_US;
+        LOG_INFO("  %-14s n %6u  mean %9.1f  max %9.1f", prof_names[p], h->count,
+                 mean, (float)h->max / PROF_CYCLES_PER_US);
+        LOG_INFO("  %-14s p50 %8.1f  p90 %8.1f  p99 %8.1f", prof_names[p],
+                 (float)prof_percentile(h, 50) / PROF_CYCLES_PER_US,
+                 (float)prof_percentile(h, 90) / PROF_CYCLES_PER_US,
+                 (float)prof_percentile(h, 99) / PROF_CYCLES_PER_US);
+    }
+}
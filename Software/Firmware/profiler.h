@@ -0,0 +1,105 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "mbed.h"
+
+// ==================== CYCLE PROFILER ====================
+// Spans are timed with the Cortex-M7 DWT cycle counter (the host build
+// uses its own clock, scaled to the same rate) and accumulated in fixed-
+// size histograms, one per probe: two bins per octave from 1 cycle up, so
+// a percentile is known to within a factor of 1.5 and costs no memory
+// beyond the table.
+// Every span has the measured cost of an empty span subtracted.
+//
+// Recording is a few dozen cycles and takes no lock. Two contexts
+// recording into one probe at the same instant can lose a count, which
+// does not matter for statistics.
+//
+// Build with -DPROFILER_ENABLED=0 and every PROF_* macro compiles to
+// nothing; the diagnostics screen then just says so.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED        1
+#endif
+
+#define PROF_CPU_HZ             216000000U
+#define PROF_CYCLES_PER_US      (PROF_CPU_HZ / 1000000U)
+#define PROF_BINS               64          // 2 per octave, 32 octaves
+#define PROF_NAME_MAX           14
+
+// Probes
+#define PROF_RENDER_HOME        0           // Screen functions, begin_frame to present
+#define PROF_RENDER_DISTANCE    1
+#define PROF_RENDER_AUTO        2
+#define PROF_RENDER_DIAG        3
+#define PROF_LCD_WAIT           4           // lcd_mutex
+#define PROF_LCD_HOLD           5
+#define PROF_SENSOR_READ        6           // Snapshot seqlock, reader side (retries included)
+#define PROF_SENSOR_PASS        7           // Sampler pass, writer side
+#define PROF_ECHO               8           // Ultrasonic trigger to result
+#define PROF_DIRECTIVE          9           // Sensor sample to the flip showing the directive
+#define PROF_WAKE               10          // Standby wake event to the flip showing the directive
+#define PROF_PROBES             11
+
+struct ProfHistogram {
+    uint32_t count;
+    uint64_t sum;               // Cycles
+    uint32_t min;
+    uint32_t max;
+    uint32_t bins[PROF_BINS];
+};
+
+#if defined(TARGET_STM32F7)
+inline uint32_t prof_cycles() {
+    return DWT->CYCCNT;
+}
+#else
+inline uint32_t prof_cycles() {
+    return sim_cycle_count();
+}
+#endif
+
+// Starts the cycle counter and measures the probe overhead
+void prof_init();
+void prof_reset();
+
+void prof_record(uint8_t probe, uint32_t cycles);
+void prof_record_us(uint8_t probe, uint32_t us);
+
+// Latency to glass: when the event behind the frame about to be presented
+// happened (the directive's sensor sample, a wake); the display's flip
+// interrupt closes every probe pending with prof_flipped()
+void prof_pixels_pending(uint8_t probe, uint32_t since_us);
+void prof_flipped();
+
+const ProfHistogram* prof_histogram(uint8_t probe);
+const char*          prof_name(uint8_t probe);
+
+// Upper edge of the bin holding the pct-th percentile, in cycles
+uint32_t prof_percentile(const ProfHistogram* h, uint8_t pct);
+
+// Empty span, and one prof_record() call, in cycles
+uint32_t prof_span_overhead();
+uint32_t prof_record_overhead();
+
+// Summary of every probe through the logger
+void prof_dump();
+
+inline uint32_t prof_cycles_to_us10(uint32_t cycles) {
+    return (uint32_t)((uint64_t)cycles * 10 / PROF_CYCLES_PER_US);
+}
+
+#if PROFILER_ENABLED
+#define PROF_START(t)               uint32_t t = prof_cycles()
+#define PROF_STOP(probe, t)         prof_record(probe, prof_cycles() - (t))
+#define PROF_RECORD_US(probe, us)   prof_record_us(probe, us)
+#define PROF_PIXELS_PENDING(p, us)  prof_pixels_pending(p, us)
+#define PROF_FLIPPED()              prof_flipped()
+#else
+#define PROF_START(t)
+#define PROF_STOP(probe, t)         do {} while(0)
+#define PROF_RECORD_US(probe, us)   do {} while(0)
+#define PROF_PIXELS_PENDING(p, us)  do {} while(0)
+#define PROF_FLIPPED()              do {} while(0)
+#endif
+
+#endif
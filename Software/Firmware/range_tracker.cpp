@@ -0,0 +1,115 @@
+#include "range_tracker.h"
+#include <string.h>
+
+#define RANGE_R         (RANGE_MEAS_SIGMA_CM * RANGE_MEAS_SIGMA_CM)
+#define RANGE_Q         (RANGE_ACCEL_SIGMA_CM_S2 * RANGE_ACCEL_SIGMA_CM_S2)
+
+RangeTracker::RangeTracker() {
+    reset();
+}
+
+void RangeTracker::reset() {
+    _valid = false;
+    _stop_latched = false;
+    _d = _v = 0.0f;
+    _p00 = _p01 = _p11 = 0.0f;
+    _t_us = 0;
+    _rejects = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void RangeTracker::restart(float distance_cm, uint32_t t_us) {
+    _valid = true;
+    _d = distance_cm;
+    _v = 0.0f;
+    _p00 = RANGE_R;
+    _p01 = 0.0f;
+    _p11 = RANGE_INIT_SIGMA_CM_S * RANGE_INIT_SIGMA_CM_S;
+    _t_us = t_us;
+    _rejects = 0;
+    _stats.restarts++;
+}
+
+// ==================== MEASUREMENT UPDATE ====================
+bool RangeTracker::update(float distance_cm, uint32_t t_us) {
+    if(!_valid || (uint32_t)(t_us - _t_us) > RANGE_TRACK_TIMEOUT_US) {
+        restart(distance_cm, t_us);
+        _stats.accepted++;
+        return true;
+    }
+
+    // Predict to the echo time (an out-of-order echo is taken as simultaneous)
+    int32_t dt_us = (int32_t)(t_us - _t_us);
+    float dt = dt_us > 0 ? dt_us * 1e-6f : 0.0f;
+    float dt2 = dt * dt;
+    float d = _d + _v * dt;
+    float p00 = _p00 + dt * (2.0f * _p01 + dt * _p11) + RANGE_Q * dt2 * dt2 * 0.25f;
+    float p01 = _p01 + dt * _p11 + RANGE_Q * dt2 * dt * 0.5f;
+    float p11 = _p11 + RANGE_Q * dt2;
+
+    // Gate on the normalised innovation
+    float y = distance_cm - d;
+    float s = p00 + RANGE_R;
+    if(y * y > RANGE_GATE_SIGMA * RANGE_GATE_SIGMA * s) {
+        _stats.rejected++;
+        if(++_rejects >= RANGE_MAX_REJECTS) {
+            restart(distance_cm, t_us);     // Consistently elsewhere: a new target
+            _stats.accepted++;
+            return true;
+        }
+        return false;
+    }
+
+    float k0 = p00 / s;
+    float k1 = p01 / s;
+    _d = d + k0 * y;
+    _v = _v + k1 * y;
+    _p00 = (1.0f - k0) * p00;
+    _p01 = (1.0f - k0) * p01;
+    _p11 = p11 - k1 * p01;
+    if(dt_us > 0) {
+        _t_us = t_us;
+    }
+    _rejects = 0;
+    _stats.accepted++;
+    return true;
+}
+
+// ==================== PROJECTION ====================
+RangeEstimate RangeTracker::estimate(uint32_t now_us) {
+    RangeEstimate e;
+    memset(&e, 0, sizeof(e));
+    uint32_t age_us = now_us - _t_us;
+    if(!_valid || age_us > RANGE_TRACK_TIMEOUT_US) {
+        _valid = false;
+        _stop_latched = false;
+        e.distance_cm = -1.0f;
+        e.predicted_cm = -1.0f;
+        e.zone = RANGE_ZONE_NONE;
+        return e;
+    }
+
+    float horizon_s = (age_us + RANGE_DISPLAY_LATENCY_US + RANGE_REACTION_US) * 1e-6f;
+    e.distance_cm = _d + _v * (age_us * 1e-6f);
+    e.closing_cm_s = -_v;
+    e.predicted_cm = _d + _v * horizon_s;
+    e.echo_us = _t_us;
+
+    if(_stop_latched && e.distance_cm > RANGE_SLOW_CM) {
+        _stop_latched = false;      // Pulled back: a new approach
+    }
+    if(e.predicted_cm <= RANGE_STOP_CM) {
+        _stop_latched = true;
+    }
+
+    if(_stop_latched) {
+        e.zone = RANGE_ZONE_STOP;
+    } else if(e.predicted_cm <= RANGE_SLOW_CM ||
+              (e.closing_cm_s > 0.0f &&
+               e.distance_cm - RANGE_STOP_CM < e.closing_cm_s * RANGE_SLOW_TTC_S)) {
+        e.zone = RANGE_ZONE_SLOW;
+    } else {
+        e.zone = RANGE_ZONE_CLEAR;
+    }
+    return e;
+}
@@ -0,0 +1,79 @@
+#ifndef RANGE_TRACKER_H
+#define RANGE_TRACKER_H
+
+#include <stdint.h>
+
+// ==================== RANGE TRACKER ====================
+// Portable (no mbed). Constant-velocity Kalman filter over timestamped
+// ultrasonic echoes: estimates distance and closing speed, gates out echoes
+// that do not fit the track, and projects the distance forward to when a
+// directive issued now would take effect.
+//
+// Projection horizon = age of the last echo + RANGE_DISPLAY_LATENCY_US
+// (sampler to pixels) + RANGE_REACTION_US (pilot acting on it). STOP is
+// issued once the projected distance reaches RANGE_STOP_CM, and it stays
+// latched until the aircraft backs off past RANGE_SLOW_CM or the track is
+// lost. SLOW is issued inside RANGE_SLOW_CM, or when the time to reach the
+// stop line is under RANGE_SLOW_TTC_S.
+#define RANGE_STOP_CM               15.0f       // Stop line, where the IR sensor trips
+#define RANGE_SLOW_CM               100.0f
+#define RANGE_SLOW_TTC_S            3.0f
+#define RANGE_DISPLAY_LATENCY_US    20000       // Redraw plus the flip at vertical blank
+#define RANGE_REACTION_US           500000
+
+// Filter tuning
+#define RANGE_MEAS_SIGMA_CM         1.0f        // HC-SR04 echo jitter
+#define RANGE_ACCEL_SIGMA_CM_S2     60.0f       // Braking / throttle changes
+#define RANGE_INIT_SIGMA_CM_S       200.0f      // Speed unknown on the first echo
+#define RANGE_GATE_SIGMA            4.0f        // Innovation gate
+#define RANGE_MAX_REJECTS           3           // Consecutive, then restart the track
+#define RANGE_TRACK_TIMEOUT_US      500000      // No accepted echo for this long = lost
+
+// RangeEstimate::zone
+#define RANGE_ZONE_NONE             0           // No track
+#define RANGE_ZONE_CLEAR            1
+#define RANGE_ZONE_SLOW             2
+#define RANGE_ZONE_STOP             3
+
+struct RangeEstimate {
+    float    distance_cm;       // Filtered, at the time asked for
+    float    closing_cm_s;      // Positive while approaching
+    float    predicted_cm;      // Distance at the end of the projection horizon
+    uint32_t echo_us;           // Time of the last accepted echo
+    uint8_t  zone;              // RANGE_ZONE_*
+};
+
+struct RangeTrackerStats {
+    uint32_t accepted;
+    uint32_t rejected;          // Outside the gate
+    uint32_t restarts;          // Track restarted (first echo, lost, or rejects)
+};
+
+class RangeTracker {
+public:
+    RangeTracker();
+
+    void reset();
+
+    // One echo, reflected at t_us. Returns false when it was gated out.
+    bool update(float distance_cm, uint32_t t_us);
+
+    // Estimate at now_us; advances the STOP latch. zone is NONE without a track.
+    RangeEstimate estimate(uint32_t now_us);
+
+    RangeTrackerStats stats() const { return _stats; }
+
+private:
+    void restart(float distance_cm, uint32_t t_us);
+
+    bool     _valid;
+    bool     _stop_latched;
+    float    _d;                // State: distance (cm) and its rate (cm/s)
+    float    _v;
+    float    _p00, _p01, _p11;  // Covariance (symmetric)
+    uint32_t _t_us;
+    uint8_t  _rejects;
+    RangeTrackerStats _stats;
+};
+
+#endif
@@ -0,0 +1,468 @@
+#include "ranging.h"
+#include <math.h>
+#include <string.h>
+
+RangingTiming ranging_timing(uint32_t slot_us) {
+    RangingTiming t;
+    t.window_us = RANGING_WINDOW_US;
+    t.guard_us = RANGING_GUARD_US;
+    t.dither_us = RANGING_DITHER_US;
+    t.slot_us = slot_us;
+    return t;
+}
+
+// ==================== SCHEDULER ====================
+RangingScheduler::RangingScheduler()
+    : _count(0), _slot_count(0), _slot(0), _timing(ranging_timing()), _running(false),
+      _listening(false), _pending(0), _line(0), _span_us(0), _slot_us(0), _next_us(0), _rng(1),
+      _fn(NULL), _ctx(NULL) {
+    memset(_seen, 0, sizeof(_seen));
+    memset(_slots, 0, sizeof(_slots));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool RangingScheduler::configure(const RangerConfig* config, uint8_t count, const RangingTiming& timing) {
+    if(_running || count == 0 || count > RANGER_MAX) {
+        return false;
+    }
+    _count = count;
+    _timing = timing;
+
+    // First slot where nobody hears the sensor and it hears nobody
+    _slot_count = 0;
+    _span_us = 0;
+    for(uint8_t i = 0; i < count; i++) {
+        for(uint8_t k = 0; k < count; k++) {
+            if((config[i].hears & (1u << k)) || (config[k].hears & (1u << i))) {
+                uint32_t us = (uint32_t)(fabsf(config[i].x_cm - config[k].x_cm) / (2.0f * US_CM_PER_US));
+                if(us > _span_us) {
+                    _span_us = us;
+                }
+            }
+        }
+        uint8_t s = 0;
+        for(; s < _slot_count; s++) {
+            bool clash = false;
+            for(uint8_t k = 0; k < count; k++) {
+                if((_slots[s] & (1u << k)) &&
+                   ((config[i].hears & (1u << k)) || (config[k].hears & (1u << i)))) {
+                    clash = true;
+                }
+            }
+            if(!clash) {
+                break;
+            }
+        }
+        if(s == _slot_count) {
+            _slots[_slot_count++] = 0;
+        }
+        _slots[s] |= (uint8_t)(1u << i);
+    }
+    return true;
+}
+
+void RangingScheduler::start(uint32_t now_us) {
+    if(_count == 0) {
+        return;
+    }
+    _slot = 0;
+    _listening = false;
+    _pending = 0;
+    _next_us = now_us;
+    _rng = now_us * 2654435761u | 1;    // Boards started together still dither apart
+    memset(&_stats, 0, sizeof(_stats));
+    _running = true;
+}
+
+void RangingScheduler::stop() {
+    _running = false;
+    _listening = false;
+    _pending = 0;
+    for(uint8_t i = 0; i < _count; i++) {
+        _trackers[i].cancel();
+    }
+}
+
+uint8_t RangingScheduler::due(uint32_t now_us) {
+    if(!_running || _listening || (int32_t)(now_us - _next_us) < 0) {
+        return 0;
+    }
+    uint8_t mask = 0;
+    for(uint8_t i = 0; i < _count; i++) {
+        uint8_t bit = (uint8_t)(1u << i);
+        if(!(_slots[_slot] & bit)) {
+            continue;
+        }
+        // An HC-SR04 ignores its trigger until the last echo line drops
+        if((_line & bit) || _trackers[i].busy()) {
+            _stats.skipped++;
+        } else {
+            mask |= bit;
+        }
+    }
+    if(mask == 0) {
+        _slot_us = now_us;
+        end_slot(now_us);
+    }
+    return mask;
+}
+
+void RangingScheduler::arm(uint8_t mask, uint32_t now_us) {
+    if(!_running || mask == 0) {
+        return;
+    }
+    for(uint8_t i = 0; i < _count; i++) {
+        if(mask & (1u << i)) {
+            _trackers[i].arm(now_us);
+        }
+    }
+    _pending = mask;
+    _listening = true;
+    _slot_us = now_us;
+    _next_us = now_us + _timing.window_us;
+    _stats.slots++;
+}
+
+void RangingScheduler::echo_rise(uint8_t sensor, uint32_t now_us) {
+    if(sensor >= _count) {
+        return;
+    }
+    _line |= (uint8_t)(1u << sensor);
+    _trackers[sensor].echo_rise(now_us);
+}
+
+void RangingScheduler::echo_fall(uint8_t sensor, uint32_t now_us) {
+    if(sensor >= _count) {
+        return;
+    }
+    uint8_t bit = (uint8_t)(1u << sensor);
+    _line &= (uint8_t)~bit;
+    _trackers[sensor].echo_fall(now_us);
+    collect(sensor);
+
+    // A fall with no rise this slot is the last cycle's line dropping
+    if(_listening && (_pending & bit) && !_trackers[sensor].busy()) {
+        _pending &= (uint8_t)~bit;
+        if(_pending == 0) {
+            end_slot(now_us);
+        }
+    }
+}
+
+void RangingScheduler::poll(uint32_t now_us) {
+    if(!_listening) {
+        return;
+    }
+    bool window = (int32_t)(now_us - _next_us) >= 0;
+    for(uint8_t i = 0; i < _count; i++) {
+        uint8_t bit = (uint8_t)(1u << i);
+        if(!(_pending & bit)) {
+            continue;
+        }
+        if(_trackers[i].poll(now_us) || (window && _trackers[i].close(now_us))) {
+            collect(i);
+        }
+        if(!_trackers[i].busy()) {
+            _pending &= (uint8_t)~bit;
+        }
+    }
+    if(window) {
+        _stats.windows++;
+    }
+    if(_pending == 0) {
+        end_slot(now_us);
+    }
+}
+
+void RangingScheduler::end_slot(uint32_t now_us) {
+    _listening = false;
+    _pending = 0;
+    _slot = (uint8_t)((_slot + 1) % _slot_count);
+
+    uint32_t gap = _span_us + _timing.guard_us;
+    if(_timing.dither_us > 0) {
+        _rng ^= _rng << 13;
+        _rng ^= _rng >> 17;
+        _rng ^= _rng << 5;
+        gap += _rng % (_timing.dither_us + 1);
+    }
+    _next_us = now_us + gap;
+    if(_timing.slot_us > 0) {
+        uint32_t fixed = _slot_us + _timing.slot_us;
+        if((int32_t)(fixed - _next_us) > 0) {
+            _next_us = fixed;
+        }
+    }
+}
+
+void RangingScheduler::collect(uint8_t sensor) {
+    UltrasonicMeasurement m;
+    if(!_trackers[sensor].latest(&m) || m.sequence == _seen[sensor]) {
+        return;
+    }
+    _seen[sensor] = m.sequence;
+    _stats.measurements++;
+    if(_fn != NULL) {
+        _fn(_ctx, sensor, m);
+    }
+}
+
+bool RangingScheduler::latest(uint8_t sensor, UltrasonicMeasurement* out) const {
+    return sensor < _count && _trackers[sensor].latest(out);
+}
+
+// ==================== FUSION ====================
+RangingFusion::RangingFusion() : _count(0) {
+    memset(_x, 0, sizeof(_x));
+    reset();
+}
+
+void RangingFusion::configure(const RangerConfig* config, uint8_t count) {
+    _count = count > RANGER_MAX ? RANGER_MAX : count;
+    for(uint8_t i = 0; i < _count; i++) {
+        _x[i] = config[i].x_cm;
+    }
+    reset();
+}
+
+void RangingFusion::reset() {
+    memset(_readings, 0, sizeof(_readings));
+    _confirmed = 0;
+    _unconfirmed = 0;
+}
+
+bool RangingFusion::update(uint8_t sensor, const UltrasonicMeasurement& m) {
+    if(sensor >= _count) {
+        return false;
+    }
+    Reading& r = _readings[sensor];
+    if(m.status != US_STATUS_OK) {
+        // Nothing in view: the next echo starts over
+        r.have = false;
+        r.confirmed = false;
+        return false;
+    }
+    bool agree = r.have && m.complete_us - r.at_us <= RANGING_MAX_AGE_US &&
+                 fabsf(m.distance_cm - r.distance_cm) <= RANGING_CONFIRM_CM;
+    r.distance_cm = m.distance_cm;
+    r.at_us = m.complete_us;
+    r.have = true;
+    r.confirmed = agree;
+    if(agree) {
+        _confirmed++;
+    } else {
+        _unconfirmed++;
+    }
+    return agree;
+}
+
+RangingFix RangingFusion::fix(uint32_t now_us) const {
+    RangingFix f;
+    memset(&f, 0, sizeof(f));
+    f.nearest_cm = -1.0f;
+    f.forward_cm = -1.0f;
+    f.timestamp_us = now_us;
+
+    // Least squares of b = d^2 - x^2 against x
+    float sx = 0.0f, sxx = 0.0f, sb = 0.0f, sxb = 0.0f;
+    uint8_t n = 0;
+    for(uint8_t i = 0; i < _count; i++) {
+        const Reading& r = _readings[i];
+        if(!r.confirmed || now_us - r.at_us > RANGING_MAX_AGE_US) {
+            continue;
+        }
+        if(n == 0 || r.distance_cm < f.nearest_cm) {
+            f.nearest_cm = r.distance_cm;
+            f.nearest = i;
+        }
+        float b = r.distance_cm * r.distance_cm - _x[i] * _x[i];
+        sx += _x[i];
+        sxx += _x[i] * _x[i];
+        sb += b;
+        sxb += _x[i] * b;
+        n++;
+    }
+    f.sensors = n;
+    if(n == 0) {
+        return f;
+    }
+    f.valid = RANGING_FIX_NEAREST;
+    f.forward_cm = f.nearest_cm;
+
+    float den = n * sxx - sx * sx;
+    if(n >= 2 && den > 1.0f) {
+        float slope = (n * sxb - sx * sb) / den;
+        float x = -0.5f * slope;
+        float y2 = (sb - slope * sx) / n - x * x;
+        if(y2 > 0.0f) {
+            f.lateral_cm = x;
+            f.forward_cm = sqrtf(y2);
+            f.valid |= RANGING_FIX_LATERAL;
+        }
+    }
+    return f;
+}
+
+// ==================== RANGER ARRAY ====================
+RangerPort::RangerPort(PinName trig, PinName echo)
+    : _trig(trig, 0), _echo(echo), _owner(NULL), _index(0) {
+    _echo.mode(PullNone);
+}
+
+void RangerPort::on_rise() {
+    _owner->on_rise(_index);
+}
+
+void RangerPort::on_fall() {
+    _owner->on_fall(_index);
+}
+
+RangerArray::RangerArray(RangerPort* const* ports, const RangerConfig* config, uint8_t count)
+    : _count(count > RANGER_MAX ? RANGER_MAX : count), _callback(NULL), _sensor_fn(NULL),
+      _sensor_ctx(NULL), _published(0), _snap_seq(0) {
+    for(uint8_t i = 0; i < _count; i++) {
+        _ports[i] = ports[i];
+        _ports[i]->_owner = this;
+        _ports[i]->_index = i;
+        _config[i] = config[i];
+    }
+    _snap.distance_cm = -1.0f;
+    _snap.pulse_us = 0;
+    _snap.trigger_us = 0;
+    _snap.complete_us = 0;
+    _snap.sequence = 0;
+    _snap.status = US_STATUS_NO_ECHO;
+    memset(&_snap_fix, 0, sizeof(_snap_fix));
+}
+
+void RangerArray::start(uint32_t slot_ms) {
+    if(!_sched.configure(_config, _count, ranging_timing(slot_ms * 1000))) {
+        return;
+    }
+    _fusion.configure(_config, _count);
+    _sched.attach(&RangerArray::on_sensor, this);
+    for(uint8_t i = 0; i < _count; i++) {
+        _ports[i]->_echo.rise(callback(_ports[i], &RangerPort::on_rise));
+        _ports[i]->_echo.fall(callback(_ports[i], &RangerPort::on_fall));
+    }
+    _sched.start(us_ticker_read());
+    service();
+}
+
+void RangerArray::stop() {
+    _timeout.detach();
+    for(uint8_t i = 0; i < _count; i++) {
+        _ports[i]->_echo.rise(NULL);
+        _ports[i]->_echo.fall(NULL);
+    }
+    _sched.stop();
+}
+
+void RangerArray::on_rise(uint8_t sensor) {
+    uint32_t now = us_ticker_read();
+    core_util_critical_section_enter();
+    _sched.echo_rise(sensor, now);
+    core_util_critical_section_exit();
+}
+
+void RangerArray::on_fall(uint8_t sensor) {
+    uint32_t now = us_ticker_read();
+    core_util_critical_section_enter();
+    _sched.echo_fall(sensor, now);
+    rearm();        // The slot may have ended early
+    core_util_critical_section_exit();
+}
+
+void RangerArray::service() {
+    core_util_critical_section_enter();
+    uint32_t now = us_ticker_read();
+    _sched.poll(now);
+    uint8_t mask = _sched.due(now);
+    if(mask != 0) {
+        // One 10 us pulse for the whole slot; short enough for an ISR
+        for(uint8_t i = 0; i < _count; i++) {
+            if(mask & (1u << i)) {
+                _ports[i]->_trig = 1;
+            }
+        }
+        wait_us(US_TRIGGER_PULSE_US);
+        for(uint8_t i = 0; i < _count; i++) {
+            _ports[i]->_trig = 0;
+        }
+        _sched.arm(mask, us_ticker_read());
+    }
+    rearm();
+    core_util_critical_section_exit();
+}
+
+void RangerArray::rearm() {
+    if(!_sched.running()) {
+        return;
+    }
+    int32_t wait = (int32_t)(_sched.next_us() - us_ticker_read());
+    _timeout.attach_us(callback(this, &RangerArray::service), wait > 0 ? (uint32_t)wait : 1);
+}
+
+// Scheduler context: one sensor's result into the fix
+void RangerArray::on_sensor(void* ctx, uint8_t sensor, const UltrasonicMeasurement& m) {
+    RangerArray* self = (RangerArray*)ctx;
+    if(self->_sensor_fn != NULL) {
+        self->_sensor_fn(self->_sensor_ctx, sensor, m);
+    }
+    bool confirmed = self->_fusion.update(sensor, m);
+    RangingFix f = self->_fusion.fix(m.complete_us);
+
+    // Each confirmed echo once, and the moment the last one goes stale
+    if(!confirmed && (f.sensors > 0 || self->_snap.status != US_STATUS_OK)) {
+        return;
+    }
+    UltrasonicMeasurement out;
+    out.trigger_us = m.trigger_us;
+    out.complete_us = m.complete_us;
+    out.sequence = ++self->_published;
+    if(f.valid & RANGING_FIX_NEAREST) {
+        out.status = US_STATUS_OK;
+        out.distance_cm = f.forward_cm;
+        out.pulse_us = m.pulse_us;
+    } else {
+        out.status = US_STATUS_NO_ECHO;
+        out.distance_cm = -1.0f;
+        out.pulse_us = 0;
+    }
+
+    self->_snap_seq = self->_snap_seq + 1;
+    __sync_synchronize();
+    self->_snap = out;
+    self->_snap_fix = f;
+    __sync_synchronize();
+    self->_snap_seq = self->_snap_seq + 1;
+
+    if(self->_callback != NULL) {
+        self->_callback(out);
+    }
+}
+
+bool RangerArray::latest(UltrasonicMeasurement* out) const {
+    uint32_t before, after;
+    do {
+        before = _snap_seq;
+        __sync_synchronize();
+        *out = _snap;
+        __sync_synchronize();
+        after = _snap_seq;
+    } while((before & 1) || before != after);
+    return out->sequence != 0;
+}
+
+bool RangerArray::fix(RangingFix* out) const {
+    uint32_t before, after, sequence;
+    do {
+        before = _snap_seq;
+        __sync_synchronize();
+        *out = _snap_fix;
+        sequence = _snap.sequence;
+        __sync_synchronize();
+        after = _snap_seq;
+    } while((before & 1) || before != after);
+    return sequence != 0;
+}
@@ -0,0 +1,256 @@
+#ifndef RANGING_H
+#define RANGING_H
+
+#include "mbed.h"
+#include "ultrasonic.h"
+#include <stdint.h>
+
+// ==================== MULTI-SENSOR RANGING ====================
+// Several HC-SR04s across the stand, for wide-body coverage and
+// redundancy. They share the air, so a sensor that listens while another
+// one's burst is still travelling can time that burst's echo as its own
+// (crosstalk). The scheduler keeps them apart and keeps the air busy:
+//  - Stagger: sensors that can hear each other never listen at the same
+//    time. Sensors are packed into slots at start. A sensor joins the first
+//    slot where nobody hears it and it hears nobody, so isolated sensors
+//    fire together.
+//  - Pipeline: a slot ends as soon as all of its echoes are in. The next
+//    slot fires a gap later. It does not wait out the HC-SR04's 60 ms
+//    cycle, so a near target is ranged much faster than a far one. The
+//    same burst can still be on its way to a sensor further along the
+//    line. It arrives there at most (that sensor's distance along the line)
+//    / (speed of sound) after the echo, by the triangle inequality. So the
+//    gap is that time across the widest pair that can hear each other,
+//    plus a guard.
+//    A slot with no echo is closed when its window ends. The window is the
+//    round trip to US_MAX_RANGE_CM, because nothing further returns an
+//    echo the sensor can hear.
+//  - Code: each gap also gets a random dither. A burst from outside the
+//    array, such as a neighbouring stand's, then lands at a different
+//    point in the window on each cycle. The fusion step only accepts a
+//    reading that agrees with the same sensor's previous one, so such
+//    echoes rarely get through twice in a row.
+//
+// RangingScheduler and RangingFusion are pure timing and arithmetic, like
+// EchoTracker. They are driven by edge and timer calls, so
+// Host/build/ranging_bench can run them against simulated echoes.
+// RangerArray wires them to pins.
+#define RANGER_MAX              4
+#define RANGING_BURST_US        500         // Trigger to echo rise: the 40 kHz burst
+#define RANGING_WINDOW_US       (RANGING_BURST_US + (uint32_t)(US_MAX_RANGE_CM / US_CM_PER_US))
+#define RANGING_GUARD_US        2000        // Reverberation, on top of the array's span
+#define RANGING_DITHER_US       1000        // Random extra gap, 0..this
+#define RANGING_CONFIRM_CM      15.0f       // Within this of the sensor's last echo: confirmed
+#define RANGING_MAX_AGE_US      250000      // Older readings drop out of the fix
+
+// HC-SR04s wired to the board (1 = the single D6/D5 ranger, no scheduler).
+// Sensor 0 is on D6/D5 in the centre, 1 on D15/D14 to one side, 2 on
+// D10/D9 to the other and 3 on D1/D0 beyond it.
+#ifndef RANGING_SENSORS
+#define RANGING_SENSORS         1
+#endif
+#define RANGING_SPACING_CM      100.0f      // Between neighbouring sensors on the stand
+
+#if RANGING_SENSORS > RANGER_MAX
+#error "RANGING_SENSORS is more than RANGER_MAX"
+#endif
+
+struct RangerConfig {
+    float   x_cm;                           // Mounting offset across the stand
+    uint8_t hears;                          // Bit k: picks up sensor k's bursts
+};
+
+struct RangingTiming {
+    uint32_t window_us;                     // Longest a slot listens
+    uint32_t guard_us;
+    uint32_t dither_us;
+    uint32_t slot_us;                       // 0 = pipelined; else one slot per slot_us
+};
+
+RangingTiming ranging_timing(uint32_t slot_us = 0);
+
+struct RangingStats {
+    uint32_t slots;
+    uint32_t measurements;                  // Published by the sensors, any status
+    uint32_t skipped;                       // Sensor's echo line still high at its turn
+    uint32_t windows;                       // Slots closed by the window, not the echoes
+};
+
+// Called for every sensor result, in the context of the call that ended it
+typedef void (*ranging_sensor_fn)(void* ctx, uint8_t sensor, const UltrasonicMeasurement& m);
+
+// ==================== SCHEDULER ====================
+class RangingScheduler {
+public:
+    RangingScheduler();
+
+    bool configure(const RangerConfig* config, uint8_t count, const RangingTiming& timing);
+    void start(uint32_t now_us);
+    void stop();
+    void attach(ranging_sensor_fn fn, void* ctx) { _fn = fn; _ctx = ctx; }
+
+    // Sensors to trigger at now_us (0 = none due). The caller pulses their
+    // trigger pins, then calls arm() with the time the pulses ended.
+    uint8_t due(uint32_t now_us);
+    void    arm(uint8_t mask, uint32_t now_us);
+
+    void echo_rise(uint8_t sensor, uint32_t now_us);
+    void echo_fall(uint8_t sensor, uint32_t now_us);
+
+    // Closes the slot when its window ends
+    void poll(uint32_t now_us);
+
+    // When due() or poll() next has work
+    uint32_t next_us() const { return _next_us; }
+    bool     running() const { return _running; }
+
+    uint8_t count() const { return _count; }
+    uint8_t slots() const { return _slot_count; }
+    uint8_t slot_mask(uint8_t slot) const { return slot < _slot_count ? _slots[slot] : 0; }
+    bool    latest(uint8_t sensor, UltrasonicMeasurement* out) const;
+    RangingStats stats() const { return _stats; }
+
+private:
+    void collect(uint8_t sensor);
+    void end_slot(uint32_t now_us);
+
+    EchoTracker       _trackers[RANGER_MAX];
+    uint32_t          _seen[RANGER_MAX];    // Last result passed to _fn
+    uint8_t           _count;
+    uint8_t           _slots[RANGER_MAX];
+    uint8_t           _slot_count;
+    uint8_t           _slot;
+    RangingTiming     _timing;
+    volatile bool     _running;
+    bool              _listening;
+    uint8_t           _pending;             // Slot sensors still listening
+    uint8_t           _line;                // Echo lines seen high
+    uint32_t          _span_us;             // Sound across the widest pair that hear each other
+    uint32_t          _slot_us;             // Current slot's start
+    uint32_t          _next_us;
+    uint32_t          _rng;
+    ranging_sensor_fn _fn;
+    void*             _ctx;
+    RangingStats      _stats;
+};
+
+// ==================== FUSION ====================
+// With every sensor on one line across the stand, a target at (x, y) is
+// d_i^2 = (x - x_i)^2 + y^2 from sensor i, so d_i^2 - x_i^2 is a straight
+// line in x_i with slope -2x. A least-squares fit over the fresh readings
+// gives the lateral offset x and then the forward range y. Two sensors
+// solve it exactly, and more average out the echo jitter.
+#define RANGING_FIX_NEAREST     0x01        // nearest_cm valid
+#define RANGING_FIX_LATERAL     0x02        // lateral_cm and forward_cm from two or more sensors
+
+struct RangingFix {
+    float    nearest_cm;                    // Shortest confirmed echo; -1 if none
+    float    forward_cm;                    // Out from the sensor line; nearest_cm without a lateral fix
+    float    lateral_cm;                    // Along the sensor line, same axis as x_cm
+    uint8_t  nearest;                       // Sensor behind nearest_cm
+    uint8_t  sensors;                       // Fresh confirmed readings used
+    uint8_t  valid;                         // RANGING_FIX_*
+    uint32_t timestamp_us;
+};
+
+class RangingFusion {
+public:
+    RangingFusion();
+
+    void configure(const RangerConfig* config, uint8_t count);
+    void reset();
+
+    // One sensor result; returns true if it was a confirmed echo
+    bool update(uint8_t sensor, const UltrasonicMeasurement& m);
+
+    RangingFix fix(uint32_t now_us) const;
+
+    uint32_t confirmed() const { return _confirmed; }
+    uint32_t unconfirmed() const { return _unconfirmed; }
+
+private:
+    struct Reading {
+        float    distance_cm;
+        uint32_t at_us;                     // Complete time
+        bool     have;                      // A previous echo to compare with
+        bool     confirmed;
+    };
+
+    float    _x[RANGER_MAX];
+    uint8_t  _count;
+    Reading  _readings[RANGER_MAX];
+    uint32_t _confirmed;
+    uint32_t _unconfirmed;
+};
+
+// ==================== RANGER ARRAY ====================
+// The scheduler and fusion on pins: one Timeout runs the slots, InterruptIn
+// edges feed the echoes. It looks like UltrasonicRanger from outside. Its
+// results are the fused range (forward_cm, or nearest_cm without a lateral
+// fix), one per confirmed echo, so the sampler's RangeTracker gets the
+// array's aggregate rate. pulse_us and trigger_us are the newest echo's.
+class RangerArray;
+
+class RangerPort {
+public:
+    RangerPort(PinName trig, PinName echo);
+
+private:
+    friend class RangerArray;
+    void on_rise();
+    void on_fall();
+
+    DigitalOut   _trig;
+    InterruptIn  _echo;
+    RangerArray* _owner;
+    uint8_t      _index;
+};
+
+class RangerArray {
+public:
+    RangerArray(RangerPort* const* ports, const RangerConfig* config, uint8_t count);
+
+    // slot_ms 0: pipelined; otherwise one slot every slot_ms
+    void start(uint32_t slot_ms = 0);
+    void stop();
+
+    void attach(ultrasonic_callback_t cb) { _callback = cb; }
+    void attach_sensor(ranging_sensor_fn fn, void* ctx) { _sensor_fn = fn; _sensor_ctx = ctx; }
+
+    // Newest fused result and fix. Returns false if none yet.
+    bool latest(UltrasonicMeasurement* out) const;
+    bool fix(RangingFix* out) const;
+    bool sensor_latest(uint8_t sensor, UltrasonicMeasurement* out) const { return _sched.latest(sensor, out); }
+
+    uint8_t      count() const { return _count; }
+    RangingStats stats() const { return _sched.stats(); }
+    const RangingScheduler& scheduler() const { return _sched; }
+    const RangingFusion&    fusion() const { return _fusion; }
+
+private:
+    friend class RangerPort;
+    static void on_sensor(void* ctx, uint8_t sensor, const UltrasonicMeasurement& m);
+    void on_rise(uint8_t sensor);
+    void on_fall(uint8_t sensor);
+    void service();
+    void rearm();
+    void publish(const UltrasonicMeasurement& m);
+
+    RangerPort*           _ports[RANGER_MAX];
+    RangerConfig          _config[RANGER_MAX];
+    uint8_t               _count;
+    RangingScheduler      _sched;
+    RangingFusion         _fusion;
+    Timeout               _timeout;
+    ultrasonic_callback_t _callback;
+    ranging_sensor_fn     _sensor_fn;
+    void*                 _sensor_ctx;
+    uint32_t              _published;
+
+    // Seqlock protected snapshot: odd _snap_seq means a write is in progress
+    volatile uint32_t     _snap_seq;
+    UltrasonicMeasurement _snap;
+    RangingFix            _snap_fix;
+};
+
+#endif
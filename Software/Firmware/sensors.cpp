@@ -0,0 +1,282 @@
+#include "sensors.h"
+#include "marshalling.h"
+#include "profiler.h"
+#include "blackbox.h"
+#include "memstats.h"
+
+static sensor_listener_t sensor_listener = NULL;
+static uint32_t          sensor_count = 0;
+static LdrFilter         sensor_ldr_filter;
+static uint32_t          sensor_ldr_cursor = 0;     // Next LDR frame to filter
+static RangeTracker      sensor_range;
+static uint32_t          sensor_range_seq = 0;      // Last echo fed to the tracker
+static uint32_t          sensor_replay_seq = 0;     // Echo numbering during replay
+static LdrFrame          sensor_ldr_last;           // Newest LDR frame filtered
+static bool              sensor_have_ldr = false;
+static uint8_t           sensor_ir = 1;
+static UltrasonicMeasurement sensor_echo;           // Newest echo
+static bool              sensor_have_echo = false;
+
+// Seqlock protected snapshot: odd sensor_seq means a write is in progress.
+// The sampler is the only writer.
+static volatile uint32_t sensor_seq = 0;
+static SensorFrame       sensor_snap;
+
+// ==================== SAMPLER ====================
+static void sensor_publish(const SensorFrame& f) {
+    sensor_seq = sensor_seq + 1;
+    __sync_synchronize();
+    sensor_snap = f;
+    __sync_synchronize();
+    sensor_seq = sensor_seq + 1;
+}
+
+// ==================== PASS INPUTS ====================
+// Each source's newest sample, as the sampler last took it in. Live passes
+// fill these from the hardware, replay from a recording; both then build
+// the frame the same way.
+static void sensor_take_ldr(const LdrFrame& frame) {
+    ldr_filter_run(&sensor_ldr_filter, frame.raw, 1);
+    sensor_ldr_last = frame;
+    sensor_have_ldr = true;
+}
+
+static void sensor_take_echo(const UltrasonicMeasurement& m) {
+    sensor_echo = m;
+    sensor_have_echo = true;
+
+    // Each echo once; it reflected half-way through the pulse
+    if(m.sequence != sensor_range_seq) {
+        sensor_range_seq = m.sequence;
+        PROF_RECORD_US(PROF_ECHO, m.complete_us - m.trigger_us);
+        if(m.status == US_STATUS_OK) {
+            sensor_range.update(m.distance_cm, m.complete_us - m.pulse_us / 2);
+        }
+    }
+}
+
+// Frame from the current inputs at now_us, published and recorded
+static void sensor_compose(SensorFrame& f, uint32_t events, uint32_t now_us) {
+    memset(&f, 0, sizeof(f));
+    f.events = (uint8_t)(events & SENSOR_EVENT_ALL);
+
+    if(sensor_have_ldr && sensor_ldr_filter.primed) {
+        memcpy(f.ldr, sensor_ldr_last.raw, sizeof(f.ldr));
+        ldr_filter_levels(&sensor_ldr_filter, f.ldr_level);
+        f.ldr_on = sensor_ldr_filter.on;
+        f.lateral = lateral_estimate(f.ldr_level, lateral_cal);
+        f.ldr_us = sensor_ldr_last.timestamp_us;
+        f.valid |= SENSOR_VALID_LDR;
+    }
+
+    f.ir = sensor_ir;
+    f.valid |= SENSOR_VALID_IR;
+
+    f.distance_cm = -1.0f;
+    if(sensor_have_echo) {
+        const UltrasonicMeasurement& m = sensor_echo;
+        f.range_us = m.complete_us;
+        if(m.status == US_STATUS_OK && now_us - m.complete_us <= SENSOR_RANGE_MAX_AGE_US) {
+            f.distance_cm = m.distance_cm;
+            f.valid |= SENSOR_VALID_RANGE;
+        }
+    }
+
+    f.timestamp_us = now_us;
+    RangeEstimate est = sensor_range.estimate(f.timestamp_us);
+    f.track_cm = est.distance_cm;
+    f.closing_cm_s = est.closing_cm_s;
+    f.predicted_cm = est.predicted_cm;
+    f.range_zone = est.zone;
+    if(est.zone != RANGE_ZONE_NONE) {
+        f.valid |= SENSOR_VALID_TRACK;
+    }
+
+    f.sequence = ++sensor_count;
+    sensor_publish(f);
+    blackbox_pass(f.events, now_us);
+}
+
+// One pass: gather the newest value from every source into one frame
+static void sensor_sample(uint32_t events) {
+    PROF_START(prof_t);
+
+    // Catch the filter up on everything scanned since the last pass
+    LdrFrame block[LDR_DMA_HALF_FRAMES];
+    uint32_t n;
+    while((n = ldr_scan.read_since(&sensor_ldr_cursor, block, LDR_DMA_HALF_FRAMES)) > 0) {
+        for(uint32_t i = 0; i < n; i++) {
+            sensor_take_ldr(block[i]);
+        }
+        blackbox_ldr(block, n);
+    }
+
+    sensor_ir = (uint8_t)ir_sensor.read();
+    blackbox_ir(sensor_ir);
+
+    UltrasonicMeasurement m;
+    if(ranger.latest(&m)) {
+        if(m.sequence != sensor_range_seq) {
+            blackbox_echo(m, false);
+        }
+        sensor_take_echo(m);
+    }
+
+    SensorFrame f;
+    sensor_compose(f, events, us_ticker_read());
+    PROF_STOP(PROF_SENSOR_PASS, prof_t);
+
+    if(sensor_listener != NULL) {
+        sensor_listener(f);
+    }
+}
+
+#if defined(TARGET_STM32F7)
+static Thread     sensor_thread(osPriorityRealtime, SENSOR_SAMPLER_STACK);
+static EventFlags sensor_flags;
+
+static void sensor_sampler_main() {
+    while(1) {
+        uint32_t events = sensor_flags.wait_any(SENSOR_EVENT_ALL | SENSOR_EVENT_STOP);
+        if(events & SENSOR_EVENT_STOP) {
+            return;
+        }
+        sensor_sample(events);
+    }
+}
+#endif
+
+void sensor_notify(uint32_t events) {
+#if defined(TARGET_STM32F7)
+    sensor_flags.set(events);
+#else
+    // No preemptive threads on the host: run the pass at once, which is
+    // what the top-priority sampler does on the board
+    sensor_sample(events);
+#endif
+}
+
+// ==================== SOURCE HOOKS (INTERRUPT CONTEXT) ====================
+static void sensor_on_ldr_block() {
+    sensor_notify(SENSOR_EVENT_LDR);
+}
+
+static void sensor_on_ir_edge() {
+    sensor_notify(SENSOR_EVENT_IR);
+}
+
+static void sensor_on_range(const UltrasonicMeasurement& m) {
+    sensor_notify(SENSOR_EVENT_RANGE);
+}
+
+static void sensor_reset() {
+    ldr_filter_init(&sensor_ldr_filter, ldr_filter_config(LDR_THRESHOLD, LDR_HYSTERESIS));
+    sensor_have_ldr = false;
+    sensor_have_echo = false;
+    sensor_ir = 1;
+    sensor_range.reset();
+    sensor_range_seq = 0;
+}
+
+void sensor_sampler_start() {
+    // Start from the newest frame already scanned, if any
+    sensor_reset();
+    uint32_t scanned = ldr_scan.frame_count();
+    sensor_ldr_cursor = scanned > 0 ? scanned - 1 : 0;
+    blackbox_start();
+    UltrasonicMeasurement m;
+    if(ranger.latest(&m)) {
+        sensor_range_seq = m.sequence;
+        blackbox_echo(m, true);
+    }
+
+#if defined(TARGET_STM32F7)
+    sensor_thread.start(sensor_sampler_main);
+    mem_watch_thread(sensor_thread.get_id(), "sampler");
+#endif
+    ldr_scan.attach(sensor_on_ldr_block);
+    ir_sensor.rise(sensor_on_ir_edge);
+    ir_sensor.fall(sensor_on_ir_edge);
+    ranger.attach(sensor_on_range);
+
+    // First frame straight away so readers never wait for a source
+    sensor_notify(SENSOR_EVENT_ALL);
+}
+
+void sensor_sampler_stop() {
+    ldr_scan.attach(NULL);
+    ir_sensor.rise(Callback<void()>());
+    ir_sensor.fall(Callback<void()>());
+    ranger.attach(NULL);
+#if defined(TARGET_STM32F7)
+    mem_unwatch_thread(sensor_thread.get_id());
+    sensor_flags.set(SENSOR_EVENT_STOP);
+    sensor_thread.join();
+#endif
+}
+
+// ==================== REPLAY ====================
+void sensor_replay_begin() {
+    blackbox_stop();
+    sensor_reset();
+    sensor_replay_seq = 0;
+}
+
+void sensor_replay_ldr(const LdrFrame& frame) {
+    sensor_take_ldr(frame);
+}
+
+void sensor_replay_ir(uint8_t level) {
+    sensor_ir = level;
+}
+
+void sensor_replay_echo(const UltrasonicMeasurement& m, bool held) {
+    UltrasonicMeasurement r = m;
+    if(!held) {
+        sensor_replay_seq++;
+    }
+    r.sequence = sensor_replay_seq;
+    sensor_take_echo(r);
+}
+
+void sensor_replay_pass(uint32_t events, uint32_t now_us) {
+    PROF_START(prof_t);
+    SensorFrame f;
+    sensor_compose(f, events, now_us);
+    PROF_STOP(PROF_SENSOR_PASS, prof_t);
+
+    if(sensor_listener != NULL) {
+        sensor_listener(f);
+    }
+}
+
+void sensor_attach(sensor_listener_t fn) {
+    sensor_listener = fn;
+}
+
+// ==================== READERS ====================
+bool sensor_latest(SensorFrame* out) {
+    PROF_START(prof_t);
+    uint32_t before, after;
+    do {
+        before = sensor_seq;
+        __sync_synchronize();
+        *out = sensor_snap;
+        __sync_synchronize();
+        after = sensor_seq;
+    } while((before & 1) || before != after);
+    PROF_STOP(PROF_SENSOR_READ, prof_t);
+    return out->sequence != 0;
+}
+
+float sensor_distance_cm() {
+    SensorFrame f;
+    if(!sensor_latest(&f) || !(f.valid & SENSOR_VALID_RANGE)) {
+        return -1.0f;
+    }
+    return f.distance_cm;
+}
+
+RangeTrackerStats sensor_range_stats() {
+    return sensor_range.stats();
+}
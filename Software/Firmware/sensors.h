@@ -0,0 +1,98 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include "mbed.h"
+#include "ldr_scan.h"
+#include "ultrasonic.h"
+#include "ldr_filter.h"
+#include "range_tracker.h"
+#include "lateral.h"
+
+// ==================== SENSOR SNAPSHOT ====================
+// One high-priority sampler owns the sensors. Interrupts (LDR DMA block,
+// IR edge, ultrasonic result) only wake it. Each wake, it composes a
+// SensorFrame from the latest data of every source and publishes it
+// through a seqlock, then hands it to the attached listener. Readers
+// therefore always see LDR, IR and distance values from the same instant,
+// together with the time each one was sampled.
+//
+// Every scanned LDR frame, not just the newest, goes through the
+// ldr_filter pipeline, and into the black box (blackbox.h) along with the
+// other inputs of each pass.
+// Each frame also carries the spot centroid computed from the filtered
+// levels. Every echo likewise feeds a RangeTracker, and each frame carries
+// its estimate projected to the frame's timestamp.
+#define SENSOR_SAMPLER_STACK    1024
+#define SENSOR_RANGE_MAX_AGE_US (3 * US_DEFAULT_PERIOD_MS * 1000)  // Older is not valid
+
+// SensorFrame::valid
+#define SENSOR_VALID_LDR        0x01    // At least one LDR frame captured
+#define SENSOR_VALID_IR         0x02
+#define SENSOR_VALID_RANGE      0x04    // Echo in range and not stale
+#define SENSOR_VALID_TRACK      0x08    // Range tracker has a live track
+
+// Sampler wake reasons, also reported in SensorFrame::events
+#define SENSOR_EVENT_LDR        0x01
+#define SENSOR_EVENT_IR         0x02
+#define SENSOR_EVENT_RANGE      0x04
+#define SENSOR_EVENT_ALL        0x07
+#define SENSOR_EVENT_STOP       0x80    // Internal: ends the sampler thread
+
+struct SensorFrame {
+    uint16_t ldr[LDR_CHANNELS];     // Raw ADC, 0..LDR_ADC_FULL_SCALE
+    uint16_t ldr_level[LDR_CHANNELS];   // Filtered, same scale
+    uint8_t  ldr_on;                // Bit ch set: channel ch lit (after hysteresis)
+    LateralEstimate lateral;        // Spot centroid from ldr_level
+    uint8_t  ir;                    // Pin level; 0 = obstacle (active low)
+    uint8_t  valid;                 // SENSOR_VALID_*
+    uint8_t  events;                // SENSOR_EVENT_* that produced this frame
+    float    distance_cm;           // -1.0f unless SENSOR_VALID_RANGE
+    float    track_cm;              // Tracked distance now, -1.0f unless SENSOR_VALID_TRACK
+    float    closing_cm_s;          // Positive while approaching
+    float    predicted_cm;          // Where the directive will take effect
+    uint8_t  range_zone;            // RANGE_ZONE_*
+    uint32_t timestamp_us;          // When the frame was published
+    uint32_t ldr_us;                // Conversion time of the LDR values
+    uint32_t range_us;              // Completion time of the measurement
+    uint32_t sequence;              // 1-based, increments per frame
+};
+
+// Microseconds between a sample time in the frame and now
+inline uint32_t sensor_age_us(uint32_t sample_us) {
+    return us_ticker_read() - sample_us;
+}
+
+typedef void (*sensor_listener_t)(const SensorFrame& f);
+
+// Hooks the LDR engine, IR pin and ranger (which must be started by the
+// caller) and starts the sampler
+void sensor_sampler_start();
+void sensor_sampler_stop();
+
+// Runs on the sampler after every publish. Keep it short.
+void sensor_attach(sensor_listener_t fn);
+
+// Interrupt-safe: wake the sampler for the given SENSOR_EVENT_* sources
+void sensor_notify(uint32_t events);
+
+// Most recent frame; false until the first one. Thread context only.
+bool sensor_latest(SensorFrame* out);
+
+// Latest valid distance, -1.0f when there is none. Thread context only.
+float sensor_distance_cm();
+
+RangeTrackerStats sensor_range_stats();
+
+// ==================== REPLAY ====================
+// Drives the sampler from a recording (blackbox_codec.h) instead of the
+// sources: feed each source's samples as they were taken, then a pass at
+// the time it was made. The pass composes, publishes and hands on the
+// frame exactly as a live one would, so the same inputs in the same order
+// give the same frames. Stop the live sampler first. Recording stops too.
+void sensor_replay_begin();
+void sensor_replay_ldr(const LdrFrame& frame);
+void sensor_replay_ir(uint8_t level);
+void sensor_replay_echo(const UltrasonicMeasurement& m, bool held);    // held: seen by a pass already
+void sensor_replay_pass(uint32_t events, uint32_t now_us);
+
+#endif
@@ -0,0 +1,187 @@
+#include "sprite.h"
+#include <string.h>
+
+// ==================== SPRITE CACHE ====================
+static Sprite      sprite_slots[SPRITE_CACHE_SLOTS];
+static uint8_t     sprite_count = 0;
+static uint32_t    sprite_pool_next = SPRITE_POOL_ADDR;
+static SpriteStats sprite_counters;
+
+// Same arithmetic as the DMA2D blender, so both paths give identical pixels
+static inline uint32_t blend_pixel(uint32_t fg, uint32_t bg) {
+    uint32_t fa = fg >> 24;
+    if(fa == 0xFF) return fg;
+    if(fa == 0) return bg;
+    uint32_t ba = bg >> 24;
+    uint32_t mult = fa * ba / 255;
+    uint32_t oa = fa + ba - mult;
+    uint32_t out = oa << 24;
+    for(int shift = 0; shift <= 16; shift += 8) {
+        uint32_t fc = (fg >> shift) & 0xFF;
+        uint32_t bc = (bg >> shift) & 0xFF;
+        uint32_t c = (fc * fa + bc * ba - bc * mult) / oa;
+        out |= (c & 0xFF) << shift;
+    }
+    return out;
+}
+
+void sprite_blend_soft(uint32_t dst, uint32_t src, uint16_t w, uint16_t h, uint16_t src_stride) {
+    uint32_t* d = (uint32_t*)(uintptr_t)dst;
+    const uint32_t* s = (const uint32_t*)(uintptr_t)src;
+    for(uint16_t row = 0; row < h; row++) {
+        for(uint16_t col = 0; col < w; col++) {
+            d[col] = blend_pixel(s[col], d[col]);
+        }
+        d += DISPLAY_WIDTH;
+        s += src_stride;
+    }
+}
+
+#if defined(TARGET_STM32F7)
+static DMA2D_HandleTypeDef sprite_dma2d;
+
+// Foreground = sprite, background = framebuffer, output over the background
+static bool blend_dma2d(uint32_t dst, uint32_t src, uint16_t w, uint16_t h, uint16_t src_stride) {
+    // The framebuffer may hold CPU-drawn pixels still in the D-cache
+    SCB_CleanDCache_by_Addr((uint32_t*)dst, ((h - 1) * DISPLAY_WIDTH + w) * 4);
+
+    sprite_dma2d.Instance = DMA2D;
+    sprite_dma2d.Init.Mode = DMA2D_M2M_BLEND;
+    sprite_dma2d.Init.ColorMode = DMA2D_OUTPUT_ARGB8888;
+    sprite_dma2d.Init.OutputOffset = DISPLAY_WIDTH - w;
+    sprite_dma2d.LayerCfg[1].InputOffset = src_stride - w;
+    sprite_dma2d.LayerCfg[1].InputColorMode = DMA2D_INPUT_ARGB8888;
+    sprite_dma2d.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+    sprite_dma2d.LayerCfg[1].InputAlpha = 0xFF;
+    sprite_dma2d.LayerCfg[0].InputOffset = DISPLAY_WIDTH - w;
+    sprite_dma2d.LayerCfg[0].InputColorMode = DMA2D_INPUT_ARGB8888;
+    sprite_dma2d.LayerCfg[0].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+    sprite_dma2d.LayerCfg[0].InputAlpha = 0xFF;
+    if(HAL_DMA2D_Init(&sprite_dma2d) != HAL_OK ||
+       HAL_DMA2D_ConfigLayer(&sprite_dma2d, 0) != HAL_OK ||
+       HAL_DMA2D_ConfigLayer(&sprite_dma2d, 1) != HAL_OK ||
+       HAL_DMA2D_BlendingStart(&sprite_dma2d, src, dst, dst, w, h) != HAL_OK) {
+        return false;
+    }
+    return HAL_DMA2D_PollForTransfer(&sprite_dma2d, 10) == HAL_OK;
+}
+#endif
+
+// Renders into the canvas with the icon origin at SPRITE_ANCHOR, then keeps
+// only the bounding box of the pixels it touched
+static const Sprite* rasterise(sprite_render_fn render, uint32_t color) {
+    if(sprite_count >= SPRITE_CACHE_SLOTS) {
+        return NULL;
+    }
+
+    uint32_t target = display_draw_to(SPRITE_CANVAS_ADDR);
+    BSP_LCD_SetTextColor(LCD_COLOR_TRANSPARENT);
+    BSP_LCD_FillRect(0, 0, SPRITE_CANVAS_SIZE, SPRITE_CANVAS_SIZE);
+    render(SPRITE_ANCHOR, SPRITE_ANCHOR, color);
+    display_draw_to(target);
+
+    const uint32_t* canvas = (const uint32_t*)(uintptr_t)SPRITE_CANVAS_ADDR;
+#if defined(TARGET_STM32F7)
+    SCB_InvalidateDCache_by_Addr((uint32_t*)canvas, SPRITE_CANVAS_SIZE * DISPLAY_WIDTH * 4);
+#endif
+    int x0 = SPRITE_CANVAS_SIZE, y0 = SPRITE_CANVAS_SIZE, x1 = 0, y1 = 0;
+    for(int y = 0; y < SPRITE_CANVAS_SIZE; y++) {
+        for(int x = 0; x < SPRITE_CANVAS_SIZE; x++) {
+            if(canvas[y * DISPLAY_WIDTH + x] >> 24) {
+                if(x < x0) x0 = x;
+                if(x >= x1) x1 = x + 1;
+                if(y < y0) y0 = y;
+                if(y >= y1) y1 = y + 1;
+            }
+        }
+    }
+    if(x1 <= x0) {
+        x0 = y0 = 0;
+        x1 = y1 = 1;                // Nothing drawn; keep a 1x1 transparent sprite
+    }
+
+    uint32_t w = x1 - x0;
+    uint32_t h = y1 - y0;
+    if(sprite_pool_next + w * h * 4 > SPRITE_POOL_ADDR + SPRITE_POOL_BYTES) {
+        return NULL;
+    }
+
+    Sprite* sp = &sprite_slots[sprite_count++];
+    sp->addr = sprite_pool_next;
+    sp->dx = x0 - SPRITE_ANCHOR;
+    sp->dy = y0 - SPRITE_ANCHOR;
+    sp->w = w;
+    sp->h = h;
+    sp->render = render;
+    sp->color = color;
+
+    uint32_t* pixels = (uint32_t*)(uintptr_t)sp->addr;
+    for(uint32_t row = 0; row < h; row++) {
+        memcpy(&pixels[row * w], &canvas[(y0 + row) * DISPLAY_WIDTH + x0], w * 4);
+    }
+#if defined(TARGET_STM32F7)
+    SCB_CleanDCache_by_Addr(pixels, w * h * 4);
+#endif
+
+    sprite_pool_next += (w * h * 4 + 31) & ~31U;   // Keep slots cache-line aligned
+    sprite_counters.rasterised++;
+    sprite_counters.pool_used = sprite_pool_next - SPRITE_POOL_ADDR;
+    return sp;
+}
+
+const Sprite* sprite_get(sprite_render_fn render, uint32_t color) {
+    for(uint8_t i = 0; i < sprite_count; i++) {
+        if(sprite_slots[i].render == render && sprite_slots[i].color == color) {
+            return &sprite_slots[i];
+        }
+    }
+    return rasterise(render, color);
+}
+
+void sprite_draw(const Sprite* sprite, int16_t x, int16_t y) {
+    // Clip against the screen
+    int sx = 0, sy = 0;
+    int dx = x + sprite->dx;
+    int dy = y + sprite->dy;
+    int w = sprite->w;
+    int h = sprite->h;
+    if(dx < 0) { sx = -dx; w += dx; dx = 0; }
+    if(dy < 0) { sy = -dy; h += dy; dy = 0; }
+    if(dx + w > DISPLAY_WIDTH) w = DISPLAY_WIDTH - dx;
+    if(dy + h > DISPLAY_HEIGHT) h = DISPLAY_HEIGHT - dy;
+    if(w <= 0 || h <= 0) {
+        return;
+    }
+
+    uint32_t src = sprite->addr + (sy * sprite->w + sx) * 4;
+    uint32_t dst = display_target() + (dy * DISPLAY_WIDTH + dx) * 4;
+
+    sprite_counters.blits++;
+    sprite_counters.pixels += w * h;
+#if defined(TARGET_STM32F7)
+    if(blend_dma2d(dst, src, w, h, sprite->w)) {
+        sprite_counters.dma2d_blits++;
+        return;
+    }
+#endif
+    sprite_blend_soft(dst, src, w, h, sprite->w);
+}
+
+void sprite_draw_icon(sprite_render_fn render, uint32_t color, int16_t x, int16_t y) {
+    const Sprite* sp = sprite_get(render, color);
+    if(sp != NULL) {
+        sprite_draw(sp, x, y);
+    } else {
+        render(x, y, color);
+    }
+}
+
+void sprite_cache_reset() {
+    sprite_count = 0;
+    sprite_pool_next = SPRITE_POOL_ADDR;
+    memset(&sprite_counters, 0, sizeof(sprite_counters));
+}
+
+SpriteStats sprite_stats() {
+    return sprite_counters;
+}
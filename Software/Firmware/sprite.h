@@ -0,0 +1,56 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include "mbed.h"
+#include "display.h"
+
+// ==================== SPRITE CACHE ====================
+// Icons are rasterised once per colour, by their ordinary BSP drawing
+// routine, into an off-screen canvas; the touched pixels are trimmed to a
+// bounding box and kept in an SDRAM pool as ARGB8888 with alpha. Drawing
+// one afterwards is a single alpha-blended blit: Chrom-ART (DMA2D) on the
+// board, or the software blitter when DMA2D is unavailable or fails.
+#define SPRITE_CACHE_SLOTS      24
+#define SPRITE_CANVAS_SIZE      128                 // Largest icon box, pixels
+#define SPRITE_ANCHOR           48                  // Icon origin inside the canvas
+#define SPRITE_CANVAS_ADDR      DISPLAY_SDRAM_FREE  // Screen stride, SPRITE_CANVAS_SIZE rows
+#define SPRITE_POOL_ADDR        (SPRITE_CANVAS_ADDR + SPRITE_CANVAS_SIZE * DISPLAY_WIDTH * 4)
+#define SPRITE_POOL_BYTES       (512 * 1024)
+#define SPRITE_SDRAM_FREE       (SPRITE_POOL_ADDR + SPRITE_POOL_BYTES)
+
+// Draws an icon with its origin at (x, y), the same call the screens make
+typedef void (*sprite_render_fn)(uint16_t x, uint16_t y, uint32_t color);
+
+struct Sprite {
+    uint32_t         addr;      // Pixels in the pool, stride = w
+    int16_t          dx, dy;    // Top-left relative to the icon origin
+    uint16_t         w, h;
+    sprite_render_fn render;    // Cache key
+    uint32_t         color;
+};
+
+struct SpriteStats {
+    uint32_t rasterised;        // Cache misses
+    uint32_t blits;
+    uint32_t dma2d_blits;
+    uint32_t pixels;            // Blended pixels, both paths
+    uint32_t pool_used;         // Bytes
+};
+
+// Cached sprite for render/color, rasterised now on a miss. Only between
+// display_begin_frame() and display_present(). NULL if the pool is full.
+const Sprite* sprite_get(sprite_render_fn render, uint32_t color);
+
+// Blend onto the layer being drawn at origin (x, y), clipped to the screen
+void sprite_draw(const Sprite* sprite, int16_t x, int16_t y);
+
+// Cache lookup + blit; draws directly with render() if the cache is full
+void sprite_draw_icon(sprite_render_fn render, uint32_t color, int16_t x, int16_t y);
+
+// Software blend of an ARGB8888 block onto a surface with DISPLAY_WIDTH stride
+void sprite_blend_soft(uint32_t dst, uint32_t src, uint16_t w, uint16_t h, uint16_t src_stride);
+
+void        sprite_cache_reset();
+SpriteStats sprite_stats();
+
+#endif
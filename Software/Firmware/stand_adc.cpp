@@ -0,0 +1,280 @@
+#include "stand_adc.h"
+#include <string.h>
+
+// Same words for every chip; DMA reads them, so they live in RAM
+static uint16_t stand_adc_tx[STAND_ADC_CHANNELS] __attribute__((aligned(32)));
+
+uint16_t stand_adc_command(uint8_t word) {
+    // ADD2..ADD0 in bits 13..11 select the channel for the next word
+    return (uint16_t)(((word + 1) % STAND_ADC_CHANNELS) << 11);
+}
+
+// ==================== SCAN ENGINE ====================
+SpiAdcChain::SpiAdcChain(uint32_t rate_hz)
+    : _bus(NULL), _on_scan(NULL), _period_us(1000000UL / rate_hz), _chips(0), _chip(0),
+      _busy(false), _head(0) {
+    memset(&_scan, 0, sizeof(_scan));
+    memset(&_stats, 0, sizeof(_stats));
+    memset(_ring, 0, sizeof(_ring));
+}
+
+bool SpiAdcChain::start(SpiAdcBus* bus, uint8_t chips) {
+    for(uint8_t i = 0; i < STAND_ADC_CHANNELS; i++) {
+        stand_adc_tx[i] = stand_adc_command(i);
+    }
+    _bus = bus;
+    _chips = chips > STAND_ADC_MAX ? STAND_ADC_MAX : chips;
+    _busy = false;
+    memset(&_stats, 0, sizeof(_stats));
+    if(_chips == 0 || !_bus->start(this)) {
+        return false;
+    }
+    _ticker.attach_us(callback(this, &SpiAdcChain::trigger), _period_us);
+    return true;
+}
+
+void SpiAdcChain::stop() {
+    _ticker.detach();
+    if(_bus != NULL) {
+        _bus->stop();
+        _bus = NULL;
+    }
+    _busy = false;
+}
+
+// Ticker: start a scan with chip 0 unless the last one is still running
+void SpiAdcChain::trigger() {
+    if(_busy) {
+        _stats.overruns++;
+        return;
+    }
+    _busy = true;
+    _chip = 0;
+    _scan.timestamp_us = us_ticker_read();
+    begin_chip();
+}
+
+void SpiAdcChain::begin_chip() {
+    _bus->transfer(_chip, stand_adc_tx, _rx, STAND_ADC_CHANNELS);
+}
+
+void SpiAdcChain::on_transfer_done() {
+    if(!_busy) {
+        return;                         // Stopped mid-scan
+    }
+    for(uint8_t i = 0; i < STAND_ADC_CHANNELS; i++) {
+        _scan.raw[_chip][i] = stand_adc_result(_rx[i]);
+    }
+    if(++_chip < _chips) {
+        begin_chip();
+        return;
+    }
+
+    // Last chip: publish the scan
+    uint32_t head = _head;
+    _scan.sequence = head + 1;
+    _ring[head & (STAND_SCAN_RING - 1)] = _scan;
+    __sync_synchronize();
+    _head = head + 1;
+
+    _stats.scans++;
+    _stats.chain_us = us_ticker_read() - _scan.timestamp_us;
+    if(_stats.chain_us > _stats.max_chain_us) {
+        _stats.max_chain_us = _stats.chain_us;
+    }
+    _busy = false;
+
+    if(_on_scan != NULL) {
+        _on_scan();
+    }
+}
+
+bool SpiAdcChain::latest(StandScan* out) const {
+    while(1) {
+        uint32_t head = _head;
+        if(head == 0) {
+            return false;
+        }
+        __sync_synchronize();
+        *out = _ring[(head - 1) & (STAND_SCAN_RING - 1)];
+        __sync_synchronize();
+
+        // Slot head-1 is only rewritten once the producer wraps the ring
+        if(_head - head < STAND_SCAN_RING - 1) {
+            return true;
+        }
+    }
+}
+
+uint32_t SpiAdcChain::read_since(uint32_t* cursor, StandScan* out, uint32_t max, uint32_t* dropped) const {
+    uint32_t head = _head;
+    uint32_t start = *cursor;
+
+    // Oldest scan still safely in the ring (leave one slot for the writer)
+    uint32_t oldest = (head > STAND_SCAN_RING - 1) ? head - (STAND_SCAN_RING - 1) : 0;
+    if(start < oldest) {
+        if(dropped != NULL) *dropped += oldest - start;
+        start = oldest;
+    }
+
+    uint32_t n = head - start;
+    if(n > max) n = max;
+
+    __sync_synchronize();
+    for(uint32_t i = 0; i < n; i++) {
+        out[i] = _ring[(start + i) & (STAND_SCAN_RING - 1)];
+    }
+    __sync_synchronize();
+
+    // Discard anything the producer lapped while we were copying
+    uint32_t lapped_before = (_head > STAND_SCAN_RING - 1) ? _head - (STAND_SCAN_RING - 1) : 0;
+    uint32_t skip = 0;
+    if(lapped_before > start) {
+        skip = lapped_before - start;
+        if(skip > n) skip = n;
+        if(dropped != NULL) *dropped += skip;
+        memmove(out, out + skip, (n - skip) * sizeof(StandScan));
+    }
+
+    *cursor = start + n;
+    return n - skip;
+}
+
+#if defined(TARGET_STM32F7)
+// ==================== SPI2 + DMA BUS ====================
+static SPI_HandleTypeDef stand_hspi;
+static DMA_HandleTypeDef stand_hdma_rx;
+static DMA_HandleTypeDef stand_hdma_tx;
+static SpiDmaAdcBus*     stand_active_bus = NULL;
+
+static void stand_dma_rx_irq_handler() {
+    HAL_DMA_IRQHandler(&stand_hdma_rx);
+}
+
+static void stand_dma_tx_irq_handler() {
+    HAL_DMA_IRQHandler(&stand_hdma_tx);
+}
+
+static void stand_spi_irq_handler() {
+    HAL_SPI_IRQHandler(&stand_hspi);
+}
+
+extern "C" void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef* hspi) {
+    if(hspi == &stand_hspi && stand_active_bus != NULL) {
+        stand_active_bus->done();
+    }
+}
+
+SpiDmaAdcBus::SpiDmaAdcBus(const PinName* cs, uint8_t count)
+    : _count(count > STAND_ADC_MAX ? STAND_ADC_MAX : count), _selected(0), _rx(NULL), _words(0),
+      _chain(NULL) {
+    for(uint8_t i = 0; i < _count; i++) {
+        gpio_init_out_ex(&_cs[i], cs[i], 1);
+    }
+}
+
+bool SpiDmaAdcBus::start(SpiAdcChain* chain) {
+    _chain = chain;
+    stand_active_bus = this;
+
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    __HAL_RCC_GPIOI_CLK_ENABLE();
+    __HAL_RCC_SPI2_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    // D13 = PI1 SCK, D12 = PB14 MISO, D11 = PB15 MOSI
+    GPIO_InitTypeDef gpio;
+    memset(&gpio, 0, sizeof(gpio));
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    gpio.Alternate = GPIO_AF5_SPI2;
+    gpio.Pin = GPIO_PIN_1;
+    HAL_GPIO_Init(GPIOI, &gpio);
+    gpio.Pin = GPIO_PIN_14 | GPIO_PIN_15;
+    HAL_GPIO_Init(GPIOB, &gpio);
+
+    // ADC128S102: mode 3 (CPOL 1, CPHA 1), 16-bit frames, MSB first
+    stand_hspi.Instance = SPI2;
+    stand_hspi.Init.Mode = SPI_MODE_MASTER;
+    stand_hspi.Init.Direction = SPI_DIRECTION_2LINES;
+    stand_hspi.Init.DataSize = SPI_DATASIZE_16BIT;
+    stand_hspi.Init.CLKPolarity = SPI_POLARITY_HIGH;
+    stand_hspi.Init.CLKPhase = SPI_PHASE_2EDGE;
+    stand_hspi.Init.NSS = SPI_NSS_SOFT;
+    stand_hspi.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_4;
+    stand_hspi.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    stand_hspi.Init.TIMode = SPI_TIMODE_DISABLE;
+    stand_hspi.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    stand_hspi.Init.NSSPMode = SPI_NSS_PULSE_DISABLE;
+    if(HAL_SPI_Init(&stand_hspi) != HAL_OK) {
+        return false;
+    }
+
+    // DMA1 Stream3 Channel0 = SPI2_RX, Stream4 Channel0 = SPI2_TX
+    stand_hdma_rx.Instance = DMA1_Stream3;
+    stand_hdma_rx.Init.Channel = DMA_CHANNEL_0;
+    stand_hdma_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    stand_hdma_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+    stand_hdma_rx.Init.MemInc = DMA_MINC_ENABLE;
+    stand_hdma_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    stand_hdma_rx.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    stand_hdma_rx.Init.Mode = DMA_NORMAL;
+    stand_hdma_rx.Init.Priority = DMA_PRIORITY_HIGH;
+    stand_hdma_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    stand_hdma_tx.Instance = DMA1_Stream4;
+    stand_hdma_tx.Init = stand_hdma_rx.Init;
+    stand_hdma_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    stand_hdma_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
+    if(HAL_DMA_Init(&stand_hdma_rx) != HAL_OK || HAL_DMA_Init(&stand_hdma_tx) != HAL_OK) {
+        return false;
+    }
+    __HAL_LINKDMA(&stand_hspi, hdmarx, stand_hdma_rx);
+    __HAL_LINKDMA(&stand_hspi, hdmatx, stand_hdma_tx);
+
+    NVIC_SetVector(DMA1_Stream3_IRQn, (uint32_t)&stand_dma_rx_irq_handler);
+    NVIC_SetVector(DMA1_Stream4_IRQn, (uint32_t)&stand_dma_tx_irq_handler);
+    NVIC_SetVector(SPI2_IRQn, (uint32_t)&stand_spi_irq_handler);
+    HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 5, 0);
+    HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 5, 0);
+    HAL_NVIC_SetPriority(SPI2_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+    HAL_NVIC_EnableIRQ(SPI2_IRQn);
+    return true;
+}
+
+void SpiDmaAdcBus::stop() {
+    HAL_SPI_DMAStop(&stand_hspi);
+    HAL_NVIC_DisableIRQ(DMA1_Stream3_IRQn);
+    HAL_NVIC_DisableIRQ(DMA1_Stream4_IRQn);
+    HAL_NVIC_DisableIRQ(SPI2_IRQn);
+    for(uint8_t i = 0; i < _count; i++) {
+        gpio_write(&_cs[i], 1);
+    }
+    stand_active_bus = NULL;
+    _chain = NULL;
+}
+
+void SpiDmaAdcBus::transfer(uint8_t chip, const uint16_t* tx, uint16_t* rx, uint32_t words) {
+    _selected = chip;
+    _rx = rx;
+    _words = words;
+
+    // TX is written once at start; RX lines must not be dirty when DMA lands
+    SCB_CleanDCache_by_Addr((uint32_t*)tx, words * sizeof(uint16_t));
+    SCB_InvalidateDCache_by_Addr((uint32_t*)rx, words * sizeof(uint16_t));
+    gpio_write(&_cs[chip], 0);
+    HAL_SPI_TransmitReceive_DMA(&stand_hspi, (uint8_t*)tx, (uint8_t*)rx, words);
+}
+
+void SpiDmaAdcBus::done() {
+    gpio_write(&_cs[_selected], 1);
+
+    // DMA wrote behind the D-cache's back
+    SCB_InvalidateDCache_by_Addr((uint32_t*)_rx, _words * sizeof(uint16_t));
+    if(_chain != NULL) {
+        _chain->on_transfer_done();
+    }
+}
+#endif
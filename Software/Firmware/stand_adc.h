@@ -0,0 +1,134 @@
+#ifndef STAND_ADC_H
+#define STAND_ADC_H
+
+#include "mbed.h"
+#include <stdint.h>
+
+// ==================== EXTERNAL SPI ADC CHAIN ====================
+// Extra stands are wired to ADC128S102s (8 channels, 12 bit) sharing one
+// SPI bus, one chip select each. A scan reads every channel of every chip:
+// the chain selects chip 0, clocks eight 16-bit words through it in one
+// DMA transaction, and the transaction's complete interrupt starts the
+// next chip's, so the CPU only sees one interrupt per chip.
+//
+// The ADC converts the channel addressed in the previous word (IN0 in the
+// first one), so word i carries the address of channel i + 1 and the
+// result of channel i.
+//
+// Scans are published into a ring with the same single-producer,
+// lock-free-reader rules as LdrScanEngine.
+#define STAND_ADC_CHANNELS      8           // IN0..IN7
+#define STAND_ADC_MAX           8           // Chip selects on the bus
+#define STAND_ADC_FULL_SCALE    4095
+#define STAND_ADC_SCLK_HZ       13500000    // SPI2, PCLK1 / 4 (ADC128S102 max 16 MHz)
+#define STAND_ADC_RX_WORDS      ((STAND_ADC_CHANNELS * 2 + 31) / 32 * 16)  // Whole 32-byte cache lines
+#define STAND_SCAN_RATE_HZ      500         // Every chip, every channel
+#define STAND_SCAN_RING         16          // Must be a power of two
+
+struct StandScan {
+    uint16_t raw[STAND_ADC_MAX][STAND_ADC_CHANNELS];
+    uint32_t timestamp_us;                  // Chip 0 selected; chip k is k transactions later
+    uint32_t sequence;                      // 1-based scan counter
+};
+
+struct StandAdcStats {
+    uint32_t scans;
+    uint32_t overruns;                      // Scan due while the last one was still running
+    uint32_t chain_us;                      // Last scan, first select to last complete
+    uint32_t max_chain_us;
+};
+
+class SpiAdcChain;
+
+// Called from the producer's context after each scan is published
+typedef void (*stand_scan_fn)(void);
+
+// ==================== BUS INTERFACE ====================
+// One transaction: select chip, exchange words, deselect, then call
+// chain->on_transfer_done() from the completion interrupt. On the board
+// that is SPI2 with DMA; on the host it is SimSpiAdc (sim_spi_adc.h).
+class SpiAdcBus {
+public:
+    virtual ~SpiAdcBus() {}
+    virtual bool start(SpiAdcChain* chain) = 0;
+    virtual void stop() = 0;
+    virtual void transfer(uint8_t chip, const uint16_t* tx, uint16_t* rx, uint32_t words) = 0;
+};
+
+// ==================== SCAN ENGINE ====================
+class SpiAdcChain {
+public:
+    SpiAdcChain(uint32_t rate_hz = STAND_SCAN_RATE_HZ);
+
+    bool start(SpiAdcBus* bus, uint8_t chips);
+    void stop();
+    void attach(stand_scan_fn fn) { _on_scan = fn; }
+
+    // Bus side, interrupt context
+    void on_transfer_done();
+
+    // Latest complete scan. Returns false until the first one.
+    bool latest(StandScan* out) const;
+
+    // Scans newer than *cursor, oldest first; advances *cursor. Scans
+    // overwritten before they were read are counted in *dropped.
+    uint32_t read_since(uint32_t* cursor, StandScan* out, uint32_t max, uint32_t* dropped = NULL) const;
+
+    uint32_t scan_count() const { return _head; }
+    uint8_t  chips() const { return _chips; }
+    StandAdcStats stats() const { return _stats; }
+
+private:
+    void trigger();
+    void begin_chip();
+
+    SpiAdcBus*        _bus;
+    stand_scan_fn     _on_scan;
+    uint32_t          _period_us;
+    uint8_t           _chips;
+    uint8_t           _chip;                // Transaction in flight
+    volatile bool     _busy;
+    Ticker            _ticker;
+    StandScan         _scan;                // Being filled
+    // DMA target: 32-byte aligned and whole cache lines, so invalidating
+    // it never throws away a write to the members next to it
+    uint16_t          _rx[STAND_ADC_RX_WORDS] __attribute__((aligned(32)));
+    StandAdcStats     _stats;
+    volatile uint32_t _head;                // Scans published so far
+    StandScan         _ring[STAND_SCAN_RING];
+};
+
+// Transaction words for one chip: address of the next channel in each
+uint16_t stand_adc_command(uint8_t word);
+
+// 12-bit result in a received word
+inline uint16_t stand_adc_result(uint16_t word) {
+    return word & STAND_ADC_FULL_SCALE;
+}
+
+#if defined(TARGET_STM32F7)
+// ==================== SPI2 + DMA BUS ====================
+// Arduino header D13/D12/D11 (SPI2 SCK/MISO/MOSI), chip selects on GPIOs.
+// DMA1 Stream3 (RX) and Stream4 (TX), channel 0.
+class SpiDmaAdcBus : public SpiAdcBus {
+public:
+    SpiDmaAdcBus(const PinName* cs, uint8_t count);
+
+    virtual bool start(SpiAdcChain* chain);
+    virtual void stop();
+    virtual void transfer(uint8_t chip, const uint16_t* tx, uint16_t* rx, uint32_t words);
+
+    // Called from the SPI DMA complete interrupt
+    void done();
+
+private:
+    gpio_t       _cs[STAND_ADC_MAX];
+    uint8_t      _count;
+    uint8_t      _selected;
+    uint16_t*    _rx;
+    uint32_t     _words;
+    SpiAdcChain* _chain;
+};
+#endif
+
+#endif
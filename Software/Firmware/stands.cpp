@@ -0,0 +1,256 @@
+#include "stands.h"
+#include "marshalling.h"
+#include "hmi.h"
+#include "logger.h"
+#include "profiler.h"
+#include "memstats.h"
+#include <string.h>
+
+struct Stand {
+    StandConfig       config;
+    LdrFilter         filter;
+    volatile uint8_t  directive;
+    uint32_t          count;
+    StandStats        stats;
+
+    // Seqlock protected snapshot: odd seq means a write is in progress
+    volatile uint32_t seq;
+    SensorFrame       snap;
+};
+
+SpiAdcChain stand_adc;
+
+static Stand            stands[STAND_MAX];
+static uint8_t          stands_n = 0;
+static SpiAdcChain*     stands_chain = NULL;
+static uint32_t         stands_cursor = 0;      // Next scan to decide on
+static uint8_t          stands_first = 0;       // Head of the next pass
+static stand_listener_t stands_listener = NULL;
+static StandPassStats   stands_pass;
+
+// ==================== DECISION ====================
+static void stand_publish(Stand& s, const SensorFrame& f) {
+    s.seq = s.seq + 1;
+    __sync_synchronize();
+    s.snap = f;
+    __sync_synchronize();
+    s.seq = s.seq + 1;
+}
+
+// Filter this stand's rows of the new scans and decide on the newest
+static void stand_decide(uint8_t i, const StandScan* scans, uint32_t n) {
+    Stand& s = stands[i];
+    uint16_t rows[STAND_BACKLOG_MAX * LDR_CHANNELS];
+    for(uint32_t k = 0; k < n; k++) {
+        memcpy(rows + k * LDR_CHANNELS, &scans[k].raw[s.config.adc][STAND_LDR_CHANNEL],
+               LDR_CHANNELS * sizeof(uint16_t));
+    }
+    ldr_filter_run(&s.filter, rows, n);
+
+    const StandScan& last = scans[n - 1];
+    SensorFrame f;
+    memset(&f, 0, sizeof(f));
+    f.events = SENSOR_EVENT_LDR;
+    memcpy(f.ldr, rows + (n - 1) * LDR_CHANNELS, sizeof(f.ldr));
+    ldr_filter_levels(&s.filter, f.ldr_level);
+    f.ldr_on = s.filter.on;
+    f.lateral = lateral_estimate(f.ldr_level, s.config.cal != NULL ? s.config.cal : lateral_cal);
+    f.ldr_us = last.timestamp_us;
+    f.ir = last.raw[s.config.adc][STAND_IR_CHANNEL] > STAND_IR_CLEAR_RAW ? 1 : 0;
+    f.valid = SENSOR_VALID_LDR | SENSOR_VALID_IR;
+    f.distance_cm = -1.0f;
+    f.track_cm = -1.0f;
+    f.predicted_cm = -1.0f;
+    f.range_zone = RANGE_ZONE_NONE;
+    f.timestamp_us = us_ticker_read();
+    f.sequence = ++s.count;
+
+    uint8_t d = determine_direction_from_sensors(f, s.directive);
+    stand_publish(s, f);
+
+    uint32_t latency = f.timestamp_us - last.timestamp_us;
+    s.stats.decisions++;
+    s.stats.latency_us = latency;
+    s.stats.sum_latency_us += latency;
+    if(latency > s.stats.max_latency_us) {
+        s.stats.max_latency_us = latency;
+    }
+    if(d != s.directive) {
+        s.directive = d;
+        s.stats.changes++;
+        LOG_INFO("stand %s: %s", s.config.name, directive_presentation[d].title);
+    }
+    if(stands_listener != NULL) {
+        stands_listener(i, f, d);
+    }
+}
+
+// One pass over every stand; see stands.h for the order
+static void stand_pass() {
+    uint32_t start = prof_cycles();
+
+    uint32_t head = stands_chain->scan_count();
+    if(head - stands_cursor > STAND_BACKLOG_MAX) {
+        uint32_t skip = head - stands_cursor - STAND_BACKLOG_MAX;
+        for(uint8_t i = 0; i < stands_n; i++) {
+            stands[i].stats.shed += skip;
+        }
+        stands_cursor = head - STAND_BACKLOG_MAX;
+    }
+    StandScan scans[STAND_BACKLOG_MAX];
+    uint32_t n = stands_chain->read_since(&stands_cursor, scans, STAND_BACKLOG_MAX, &stands_pass.dropped);
+    if(n == 0) {
+        return;
+    }
+
+    // Newly broken beams first, then everyone else from the rotating head
+    bool done[STAND_MAX];
+    memset(done, 0, sizeof(done));
+    const StandScan& last = scans[n - 1];
+    for(uint8_t i = 0; i < stands_n; i++) {
+        bool broken = last.raw[stands[i].config.adc][STAND_IR_CHANNEL] <= STAND_IR_CLEAR_RAW;
+        if(broken && stands[i].directive != DIRECTIVE_STOP) {
+            stand_decide(i, scans, n);
+            done[i] = true;
+        }
+    }
+    for(uint8_t k = 0; k < stands_n; k++) {
+        uint8_t i = (uint8_t)((stands_first + k) % stands_n);
+        if(!done[i]) {
+            stand_decide(i, scans, n);
+        }
+    }
+    stands_first = (uint8_t)((stands_first + 1) % stands_n);
+
+    uint32_t cycles = prof_cycles() - start;
+    stands_pass.passes++;
+    stands_pass.cycles = cycles;
+    stands_pass.sum_cycles += cycles;
+    if(cycles > stands_pass.max_cycles) {
+        stands_pass.max_cycles = cycles;
+    }
+}
+
+#if defined(TARGET_STM32F7)
+// Above the UI and telemetry, below the on-board stand's sampler
+static Thread     stands_thread(osPriorityAboveNormal, STAND_WORKER_STACK);
+static EventFlags stands_flags;
+
+#define STANDS_FLAG_SCAN    0x01
+#define STANDS_FLAG_STOP    0x80
+
+static void stand_worker_main() {
+    while(1) {
+        uint32_t flags = stands_flags.wait_any(STANDS_FLAG_SCAN | STANDS_FLAG_STOP);
+        if(flags & STANDS_FLAG_STOP) {
+            return;
+        }
+        stand_pass();
+    }
+}
+#endif
+
+// Scan engine context
+static void stand_on_scan() {
+#if defined(TARGET_STM32F7)
+    stands_flags.set(STANDS_FLAG_SCAN);
+#else
+    // No preemptive threads on the host: the pass runs at once
+    stand_pass();
+#endif
+}
+
+// ==================== CONTROL ====================
+bool stand_manager_start(const StandConfig* configs, uint8_t count, SpiAdcChain* chain) {
+    if(count == 0 || count > STAND_MAX || chain == NULL) {
+        return false;
+    }
+    LdrFilterConfig filter = ldr_filter_config(LDR_THRESHOLD, LDR_HYSTERESIS);
+    for(uint8_t i = 0; i < count; i++) {
+        Stand& s = stands[i];
+        memset(&s, 0, sizeof(s));
+        s.config = configs[i];
+        s.config.name[STAND_NAME_MAX - 1] = '\0';
+        ldr_filter_init(&s.filter, filter);
+        s.directive = DIRECTIVE_NONE;
+    }
+    stands_n = count;
+    stands_chain = chain;
+    stands_cursor = chain->scan_count();
+    stands_first = 0;
+    memset(&stands_pass, 0, sizeof(stands_pass));
+
+#if defined(TARGET_STM32F7)
+    stands_thread.start(stand_worker_main);
+    mem_watch_thread(stands_thread.get_id(), "stands");
+#endif
+    chain->attach(stand_on_scan);
+    LOG_INFO("stands: %u on the SPI ADC bus", count);
+    return true;
+}
+
+void stand_manager_stop() {
+    if(stands_chain == NULL) {
+        return;
+    }
+    stands_chain->attach(NULL);
+#if defined(TARGET_STM32F7)
+    mem_unwatch_thread(stands_thread.get_id());
+    stands_flags.set(STANDS_FLAG_STOP);
+    stands_thread.join();
+#endif
+    stands_chain = NULL;
+}
+
+void stand_attach(stand_listener_t fn) {
+    stands_listener = fn;
+}
+
+// ==================== READERS ====================
+uint8_t stand_count() {
+    return stands_n;
+}
+
+const StandConfig* stand_config(uint8_t stand) {
+    return stand < stands_n ? &stands[stand].config : NULL;
+}
+
+bool stand_latest(uint8_t stand, SensorFrame* out) {
+    if(stand >= stands_n) {
+        return false;
+    }
+    const Stand& s = stands[stand];
+    uint32_t before, after;
+    do {
+        before = s.seq;
+        __sync_synchronize();
+        *out = s.snap;
+        __sync_synchronize();
+        after = s.seq;
+    } while((before & 1) || before != after);
+    return out->sequence != 0;
+}
+
+uint8_t stand_directive(uint8_t stand) {
+    return stand < stands_n ? stands[stand].directive : DIRECTIVE_NONE;
+}
+
+StandStats stand_stats(uint8_t stand) {
+    StandStats st;
+    memset(&st, 0, sizeof(st));
+    if(stand < stands_n) {
+        st = stands[stand].stats;
+    }
+    return st;
+}
+
+StandPassStats stand_pass_stats() {
+    return stands_pass;
+}
+
+void stand_reset_stats() {
+    for(uint8_t i = 0; i < stands_n; i++) {
+        memset(&stands[i].stats, 0, sizeof(stands[i].stats));
+    }
+    memset(&stands_pass, 0, sizeof(stands_pass));
+}
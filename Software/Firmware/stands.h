@@ -0,0 +1,87 @@
+#ifndef STANDS_H
+#define STANDS_H
+
+#include "mbed.h"
+#include "stand_adc.h"
+#include "sensors.h"
+#include "lateral.h"
+
+// ==================== STAND MANAGER ====================
+// Extra stands run by the same board, one ADC128S102 each (stand_adc.h):
+// IN0..IN5 are that stand's LDR row, wired like A0..A5, and IN6 its IR
+// module's output. The on-board stand (A0..A5, D8, D6/D5) keeps its own
+// sampler, screens and black box; these stands get the same filter,
+// centroid and direction rules, and publish a SensorFrame and a directive
+// each.
+//
+// One worker serves every stand. Each scan wakes it, and a pass decides
+// every stand from the scans that arrived since the last pass:
+//  - a stand whose IR beam has just been broken goes first, so STOP
+//    never waits for the others;
+//  - the rest take turns at the head of the pass, so no stand is always
+//    decided last;
+//  - a pass filters at most STAND_BACKLOG_MAX scans per stand. A worker
+//    that fell further behind drops the oldest (counted as shed) rather
+//    than growing the next pass.
+// A decision therefore comes at most one scan period plus one pass after
+// its scan, and a pass grows linearly with the number of stands;
+// Host/build/stand_bench measures both from 1 to STAND_MAX stands.
+#define STAND_MAX               STAND_ADC_MAX
+#define STAND_NAME_MAX          8
+#define STAND_LDR_CHANNEL       0           // IN0..IN5 = A0..A5
+#define STAND_IR_CHANNEL        6
+#define STAND_IR_CLEAR_RAW      (STAND_ADC_FULL_SCALE / 2)  // At or below: beam broken (active low)
+#define STAND_BACKLOG_MAX       4           // Scans filtered per stand per pass
+#define STAND_WORKER_STACK      1536
+
+// Extra stands built into the board image (0 = single stand, manager off)
+#ifndef STAND_EXTRA
+#define STAND_EXTRA             0
+#endif
+
+struct StandConfig {
+    char                      name[STAND_NAME_MAX];
+    uint8_t                   adc;          // Chip select on the stand ADC bus
+    const LateralCalibration* cal;          // IN0..IN4; NULL = the board's lateral_cal
+};
+
+struct StandStats {
+    uint32_t decisions;
+    uint32_t changes;                       // Directive changes
+    uint32_t shed;                          // Scans skipped to catch up
+    uint32_t latency_us;                    // Last decision, scan to directive
+    uint32_t max_latency_us;
+    uint64_t sum_latency_us;
+};
+
+struct StandPassStats {
+    uint32_t passes;
+    uint32_t cycles;                        // Last pass, CPU cycles
+    uint32_t max_cycles;
+    uint64_t sum_cycles;
+    uint32_t dropped;                       // Scans lost to the ring wrapping
+};
+
+// Runs on the worker after each stand's decision. Keep it short.
+typedef void (*stand_listener_t)(uint8_t stand, const SensorFrame& f, uint8_t directive);
+
+extern SpiAdcChain stand_adc;
+
+// Starts the worker on scans from chain, which the caller starts
+bool stand_manager_start(const StandConfig* configs, uint8_t count, SpiAdcChain* chain);
+void stand_manager_stop();
+void stand_attach(stand_listener_t fn);
+
+uint8_t            stand_count();
+const StandConfig* stand_config(uint8_t stand);
+
+// Newest frame and directive; false until the stand's first decision.
+// Thread context only.
+bool    stand_latest(uint8_t stand, SensorFrame* out);
+uint8_t stand_directive(uint8_t stand);     // DIRECTIVE_NONE before the first
+
+StandStats     stand_stats(uint8_t stand);
+StandPassStats stand_pass_stats();
+void           stand_reset_stats();
+
+#endif
@@ -0,0 +1,221 @@
+#include "telemetry.h"
+#include "marshalling.h"
+#include <stdarg.h>
+
+// TX ring: the thread appends whole frames at the head, the DMA drains
+// from the tail one contiguous chunk at a time
+#define TELEMETRY_TX_MASK   (TELEMETRY_TX_BYTES - 1)
+
+static uint8_t telemetry_ring[TELEMETRY_TX_BYTES] __attribute__((aligned(32)));
+static volatile uint32_t telemetry_head = 0;
+static volatile uint32_t telemetry_tail = 0;
+static volatile uint32_t telemetry_in_flight = 0;     // Bytes the DMA owns
+static volatile uint32_t telemetry_period_ms = 1000 / TELEMETRY_RATE_HZ;
+static bool telemetry_started = false;
+static uint32_t telemetry_sequence = 0;
+static TelemetryStats telemetry_counters;
+static Mutex telemetry_producer;
+
+static void telemetry_kick();
+
+// ==================== DMA TRANSPORT ====================
+#if defined(TARGET_STM32F7)
+// USART1 TX is DMA2 stream 7, channel 4. Only the DMA interrupt is used;
+// the USART interrupt stays with mbed's Serial, which must not write once
+// this owns the port: its bytes would go into TDR in the middle of a
+// frame. Text goes through the ring as log records (telemetry_printf).
+static DMA_HandleTypeDef telemetry_dma;
+
+static void telemetry_dma_done(DMA_HandleTypeDef* hdma) {
+    telemetry_tail = telemetry_tail + telemetry_in_flight;
+    telemetry_in_flight = 0;
+    telemetry_kick();
+}
+
+static void telemetry_dma_irq_handler() {
+    HAL_DMA_IRQHandler(&telemetry_dma);
+}
+#endif
+
+// Start the next chunk if the DMA is idle. Thread (in a critical section)
+// or DMA interrupt context.
+static void telemetry_kick() {
+    while(telemetry_in_flight == 0 && telemetry_head != telemetry_tail) {
+        uint32_t start = telemetry_tail & TELEMETRY_TX_MASK;
+        uint32_t n = telemetry_head - telemetry_tail;
+        if(start + n > TELEMETRY_TX_BYTES) {
+            n = TELEMETRY_TX_BYTES - start;     // Up to the wrap; rest next time
+        }
+        telemetry_counters.bytes += n;
+
+#if defined(TARGET_STM32F7)
+        telemetry_in_flight = n;
+        uint32_t line = (uint32_t)&telemetry_ring[start] & ~31UL;
+        SCB_CleanDCache_by_Addr((uint32_t*)line, (uint32_t)&telemetry_ring[start] + n - line);
+        HAL_DMA_Start_IT(&telemetry_dma, (uint32_t)&telemetry_ring[start],
+                         (uint32_t)&USART1->TDR, n);
+#else
+        // No DMA: hand the bytes to the serial driver
+        for(uint32_t i = 0; i < n; i++) {
+            pc.putc(telemetry_ring[start + i]);
+        }
+        telemetry_tail = telemetry_tail + n;
+#endif
+    }
+}
+
+void telemetry_set_rate(uint32_t rate_hz) {
+    telemetry_period_ms = (rate_hz > 0 && rate_hz <= 1000) ? 1000 / rate_hz : 1000 / TELEMETRY_RATE_HZ;
+}
+
+void telemetry_init(uint32_t rate_hz) {
+    telemetry_set_rate(rate_hz);
+    telemetry_head = telemetry_tail = 0;
+    telemetry_in_flight = 0;
+    telemetry_sequence = 0;
+    memset(&telemetry_counters, 0, sizeof(telemetry_counters));
+
+#if defined(TARGET_STM32F7)
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    telemetry_dma.Instance = DMA2_Stream7;
+    telemetry_dma.Init.Channel = DMA_CHANNEL_4;
+    telemetry_dma.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    telemetry_dma.Init.PeriphInc = DMA_PINC_DISABLE;
+    telemetry_dma.Init.MemInc = DMA_MINC_ENABLE;
+    telemetry_dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    telemetry_dma.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    telemetry_dma.Init.Mode = DMA_NORMAL;
+    telemetry_dma.Init.Priority = DMA_PRIORITY_LOW;
+    telemetry_dma.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    HAL_DMA_Init(&telemetry_dma);
+    telemetry_dma.XferCpltCallback = telemetry_dma_done;
+
+    NVIC_SetVector(DMA2_Stream7_IRQn, (uint32_t)&telemetry_dma_irq_handler);
+    HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, 7, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+
+    USART1->CR3 |= USART_CR3_DMAT;
+#endif
+    telemetry_started = true;
+}
+
+bool telemetry_owns_serial() {
+    return telemetry_started;
+}
+
+// Whole frames only: a partial one would corrupt the next as well. False
+// when the ring has no room for all of it. Several threads produce
+// (records, black-box pieces, mirror tiles), so the head is theirs one at
+// a time.
+static bool telemetry_queue(const uint8_t* frame, uint32_t n) {
+    telemetry_producer.lock();
+    if(TELEMETRY_TX_BYTES - (telemetry_head - telemetry_tail) < n) {
+        telemetry_producer.unlock();
+        return false;
+    }
+    uint32_t head = telemetry_head;
+    for(uint32_t i = 0; i < n; i++) {
+        telemetry_ring[(head + i) & TELEMETRY_TX_MASK] = frame[i];
+    }
+
+    core_util_critical_section_enter();
+    telemetry_head = head + n;
+    telemetry_kick();
+    core_util_critical_section_exit();
+    telemetry_producer.unlock();
+    return true;
+}
+
+// ==================== RECORDS ====================
+void telemetry_sample() {
+    SensorFrame f;
+    if(!sensor_latest(&f)) {
+        return;
+    }
+
+    TelemetrySensors r;
+    r.sequence = ++telemetry_sequence;
+    r.timestamp_us = f.timestamp_us;
+    memcpy(r.ldr, f.ldr, sizeof(r.ldr));
+    r.ir = f.ir;
+    r.valid = f.valid;
+    r.distance_mm = (f.valid & SENSOR_VALID_RANGE) ? (uint16_t)(f.distance_cm * 10.0f + 0.5f)
+                                                   : TELEMETRY_NO_DISTANCE;
+    r.directive = current_directive;
+    uint32_t age = sensor_age_us(f.timestamp_us);
+    r.age_us = (age > 0xFFFF) ? 0xFFFF : (uint16_t)age;
+
+    uint8_t frame[TELEMETRY_FRAME_MAX];
+    uint32_t n = telemetry_frame(r, frame);
+    if(telemetry_queue(frame, n)) {
+        telemetry_counters.records++;
+    } else {
+        telemetry_counters.dropped++;
+    }
+}
+
+void telemetry_send_chunk(const TelemetryChunk& c) {
+    uint8_t frame[TELEMETRY_CHUNK_FRAME_MAX];
+    uint32_t n = telemetry_frame_chunk(c, frame);
+    while(!telemetry_queue(frame, n)) {
+        ThisThread::sleep_for(1);
+    }
+    telemetry_counters.chunks++;
+}
+
+uint32_t telemetry_send_mirror(const TelemetryMirror& m) {
+    uint8_t frame[TELEMETRY_MIRROR_FRAME_MAX];
+    uint32_t n = telemetry_frame_mirror(m, frame);
+    while(!telemetry_queue(frame, n)) {
+        ThisThread::sleep_for(1);
+    }
+    telemetry_counters.mirrors++;
+    return n;
+}
+
+void telemetry_send_log(const TelemetryLog& l) {
+    uint8_t frame[TELEMETRY_LOG_FRAME_MAX];
+    uint32_t n = telemetry_frame_log(l, frame);
+    while(!telemetry_queue(frame, n)) {
+        ThisThread::sleep_for(1);
+    }
+    telemetry_counters.logs++;
+}
+
+void telemetry_printf(const char* fmt, ...) {
+    char text[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(text, sizeof(text), fmt, ap);
+    va_end(ap);
+    if(n <= 0) {
+        return;
+    }
+    if(!telemetry_started) {
+        pc.printf("%s", text);
+        return;
+    }
+
+    uint32_t len = ((uint32_t)n < sizeof(text)) ? (uint32_t)n : sizeof(text) - 1;
+    TelemetryLog l;
+    l.timestamp_us = us_ticker_read();
+    l.level = TELEMETRY_LOG_TEXT;
+    for(uint32_t at = 0; at < len; at += l.len) {
+        l.len = (uint8_t)((len - at < TELEMETRY_LOG_MAX) ? len - at : TELEMETRY_LOG_MAX);
+        memcpy(l.text, text + at, l.len);
+        telemetry_send_log(l);
+    }
+}
+
+void telemetry_thread() {
+    uint64_t next = Kernel::get_ms_count();
+    while(serial_thread_running) {
+        telemetry_sample();
+        next += telemetry_period_ms;
+        ThisThread::sleep_until(next);
+    }
+}
+
+TelemetryStats telemetry_stats() {
+    return telemetry_counters;
+}
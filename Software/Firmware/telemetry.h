@@ -0,0 +1,69 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "mbed.h"
+#include "telemetry_codec.h"
+
+// ==================== SERIAL TELEMETRY ====================
+// TELEMETRY_MODE_BINARY streams a framed record (telemetry_codec.h) from the
+// latest SensorFrame at TELEMETRY_RATE_HZ. The frames are queued in a ring,
+// and on the board DMA2 stream 7 feeds them into USART1 (the ST-LINK
+// virtual COM port), so the CPU never waits on the UART. Black-box pieces,
+// screen mirror tiles (mirror.h) and log lines (logger.h) share the ring.
+// Decode the stream on a PC with Host/build/telemetry_decode.
+// TELEMETRY_MODE_TEXT keeps the original human-readable dump every 2 s.
+#define TELEMETRY_MODE_TEXT     0
+#define TELEMETRY_MODE_BINARY   1
+
+#ifndef TELEMETRY_MODE
+#define TELEMETRY_MODE          TELEMETRY_MODE_BINARY
+#endif
+
+#define TELEMETRY_RATE_HZ       200         // Up to ~1400 Hz at TELEMETRY_BAUD
+#define TELEMETRY_BAUD          460800
+#define TELEMETRY_TX_BYTES      2048        // Ring size, power of two
+
+struct TelemetryStats {
+    uint32_t records;       // Frames queued
+    uint32_t dropped;       // Frames lost because the ring was full
+    uint32_t bytes;         // Bytes handed to the UART
+    uint32_t chunks;        // Black-box pieces queued
+    uint32_t mirrors;       // Screen mirror tiles queued
+    uint32_t logs;          // Log lines queued
+};
+
+// Sets up the TX DMA; rate_hz is the record rate of telemetry_thread()
+void telemetry_init(uint32_t rate_hz = TELEMETRY_RATE_HZ);
+
+// True once telemetry_init() has given USART1 to the stream. Nothing may
+// write to pc from then on; text goes as log records (telemetry_send_log).
+bool telemetry_owns_serial();
+
+// New record rate for telemetry_thread(), from its next sleep on (standby)
+void telemetry_set_rate(uint32_t rate_hz);
+
+// Encode the latest SensorFrame and queue it. Thread context.
+void telemetry_sample();
+
+// Fixed-rate loop calling telemetry_sample() until serial_thread_running
+// clears. Start it in place of serial_monitor_thread in binary mode.
+void telemetry_thread();
+
+// Queue one piece of a black-box block, waiting for ring space rather
+// than dropping it. Thread context; shares the ring with telemetry_sample().
+void telemetry_send_chunk(const TelemetryChunk& c);
+
+// The same for a screen mirror tile (mirror.h); returns the bytes queued
+uint32_t telemetry_send_mirror(const TelemetryMirror& m);
+
+// And for a log line or piece of console text
+void telemetry_send_log(const TelemetryLog& l);
+
+// printf for the console: on pc until the stream owns the port, then as
+// TELEMETRY_LOG_TEXT records. Thread context. Use it rather than pc in
+// anything that runs in binary mode.
+void telemetry_printf(const char* fmt, ...);
+
+TelemetryStats telemetry_stats();
+
+#endif
@@ -0,0 +1,274 @@
+#include "telemetry_codec.h"
+#include <string.h>
+
+static inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// ==================== CRC-16/CCITT-FALSE ====================
+// Poly 0x1021, init 0xFFFF; bitwise, since a record is only 29 bytes and
+// black-box blocks are only checked when exported
+uint16_t crc16_ccitt(const uint8_t* data, size_t len) {
+    return crc16_ccitt_update(0xFFFF, data, len);
+}
+
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t* data, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for(uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// ==================== COBS ====================
+size_t cobs_encode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t code_at = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+
+    for(size_t i = 0; i < len; i++) {
+        if(in[i] == 0) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+            continue;
+        }
+        out[o++] = in[i];
+        if(++code == 0xFF) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        }
+    }
+    out[code_at] = code;
+    return o;
+}
+
+size_t cobs_decode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t i = 0;
+    size_t o = 0;
+
+    while(i < len) {
+        uint8_t code = in[i++];
+        if(code == 0 || i + code - 1 > len) {
+            return 0;
+        }
+        for(uint8_t k = 1; k < code; k++) {
+            out[o++] = in[i++];
+        }
+        if(code != 0xFF && i < len) {
+            out[o++] = 0;
+        }
+    }
+    return o;
+}
+
+// ==================== RECORDS ====================
+size_t telemetry_pack(const TelemetrySensors& r, uint8_t* out) {
+    out[0] = TELEMETRY_VERSION;
+    out[1] = TELEMETRY_RECORD_SENSORS;
+    put32(out + 2, r.sequence);
+    put32(out + 6, r.timestamp_us);
+    for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+        put16(out + 10 + ch * 2, r.ldr[ch]);
+    }
+    out[22] = r.ir;
+    out[23] = r.valid;
+    put16(out + 24, r.distance_mm);
+    out[26] = r.directive;
+    put16(out + 27, r.age_us);
+    put16(out + 29, crc16_ccitt(out, 29));
+    return TELEMETRY_SENSORS_BYTES;
+}
+
+int telemetry_unpack(const uint8_t* in, size_t len, TelemetrySensors* r) {
+    if(len < 4) {
+        return TELEMETRY_ERR_LENGTH;
+    }
+    if(crc16_ccitt(in, len - 2) != get16(in + len - 2)) {
+        return TELEMETRY_ERR_CRC;
+    }
+    if(in[0] != TELEMETRY_VERSION) {
+        return TELEMETRY_ERR_VERSION;
+    }
+    if(in[1] != TELEMETRY_RECORD_SENSORS) {
+        return TELEMETRY_ERR_TYPE;
+    }
+    if(len != TELEMETRY_SENSORS_BYTES) {
+        return TELEMETRY_ERR_LENGTH;
+    }
+
+    r->sequence = get32(in + 2);
+    r->timestamp_us = get32(in + 6);
+    for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+        r->ldr[ch] = get16(in + 10 + ch * 2);
+    }
+    r->ir = in[22];
+    r->valid = in[23];
+    r->distance_mm = get16(in + 24);
+    r->directive = in[26];
+    r->age_us = get16(in + 27);
+    return TELEMETRY_OK;
+}
+
+uint8_t telemetry_type(const uint8_t* in, size_t len) {
+    return len >= 4 ? in[1] : 0;
+}
+
+size_t telemetry_frame(const TelemetrySensors& r, uint8_t* out) {
+    uint8_t raw[TELEMETRY_SENSORS_BYTES];
+    size_t n = telemetry_pack(r, raw);
+    out[0] = 0x00;
+    n = 1 + cobs_encode(raw, n, out + 1);
+    out[n++] = 0x00;
+    return n;
+}
+
+size_t telemetry_pack_chunk(const TelemetryChunk& c, uint8_t* out) {
+    out[0] = TELEMETRY_VERSION;
+    out[1] = TELEMETRY_RECORD_BLACKBOX;
+    put32(out + 2, c.block);
+    put16(out + 6, c.offset);
+    put16(out + 8, c.total);
+    memcpy(out + 10, c.data, c.len);
+    size_t n = 10 + c.len;
+    put16(out + n, crc16_ccitt(out, n));
+    return n + 2;
+}
+
+int telemetry_unpack_chunk(const uint8_t* in, size_t len, TelemetryChunk* c) {
+    if(len < TELEMETRY_CHUNK_BYTES(0) || len > TELEMETRY_CHUNK_BYTES(TELEMETRY_CHUNK_MAX)) {
+        return TELEMETRY_ERR_LENGTH;
+    }
+    if(crc16_ccitt(in, len - 2) != get16(in + len - 2)) {
+        return TELEMETRY_ERR_CRC;
+    }
+    if(in[0] != TELEMETRY_VERSION) {
+        return TELEMETRY_ERR_VERSION;
+    }
+    if(in[1] != TELEMETRY_RECORD_BLACKBOX) {
+        return TELEMETRY_ERR_TYPE;
+    }
+
+    c->block = get32(in + 2);
+    c->offset = get16(in + 6);
+    c->total = get16(in + 8);
+    c->len = (uint8_t)(len - TELEMETRY_CHUNK_BYTES(0));
+    memcpy(c->data, in + 10, c->len);
+    return TELEMETRY_OK;
+}
+
+size_t telemetry_frame_chunk(const TelemetryChunk& c, uint8_t* out) {
+    uint8_t raw[TELEMETRY_CHUNK_BYTES(TELEMETRY_CHUNK_MAX)];
+    size_t n = telemetry_pack_chunk(c, raw);
+    out[0] = 0x00;
+    n = 1 + cobs_encode(raw, n, out + 1);
+    out[n++] = 0x00;
+    return n;
+}
+
+size_t telemetry_pack_mirror(const TelemetryMirror& m, uint8_t* out) {
+    out[0] = TELEMETRY_VERSION;
+    out[1] = TELEMETRY_RECORD_MIRROR;
+    put16(out + 2, m.frame);
+    out[4] = m.flags;
+    put16(out + 5, m.x);
+    put16(out + 7, m.y);
+    out[9] = m.w;
+    out[10] = m.h;
+    memcpy(out + 11, m.data, m.len);
+    size_t n = 11 + m.len;
+    put16(out + n, crc16_ccitt(out, n));
+    return n + 2;
+}
+
+int telemetry_unpack_mirror(const uint8_t* in, size_t len, TelemetryMirror* m) {
+    if(len < TELEMETRY_MIRROR_BYTES(0) || len > TELEMETRY_MIRROR_BYTES(TELEMETRY_CHUNK_MAX)) {
+        return TELEMETRY_ERR_LENGTH;
+    }
+    if(crc16_ccitt(in, len - 2) != get16(in + len - 2)) {
+        return TELEMETRY_ERR_CRC;
+    }
+    if(in[0] != TELEMETRY_VERSION) {
+        return TELEMETRY_ERR_VERSION;
+    }
+    if(in[1] != TELEMETRY_RECORD_MIRROR) {
+        return TELEMETRY_ERR_TYPE;
+    }
+
+    m->frame = get16(in + 2);
+    m->flags = in[4];
+    m->x = get16(in + 5);
+    m->y = get16(in + 7);
+    m->w = in[9];
+    m->h = in[10];
+    m->len = (uint8_t)(len - TELEMETRY_MIRROR_BYTES(0));
+    memcpy(m->data, in + 11, m->len);
+    return TELEMETRY_OK;
+}
+
+size_t telemetry_frame_mirror(const TelemetryMirror& m, uint8_t* out) {
+    uint8_t raw[TELEMETRY_MIRROR_BYTES(TELEMETRY_CHUNK_MAX)];
+    size_t n = telemetry_pack_mirror(m, raw);
+    out[0] = 0x00;
+    n = 1 + cobs_encode(raw, n, out + 1);
+    out[n++] = 0x00;
+    return n;
+}
+
+size_t telemetry_pack_log(const TelemetryLog& l, uint8_t* out) {
+    out[0] = TELEMETRY_VERSION;
+    out[1] = TELEMETRY_RECORD_LOG;
+    put32(out + 2, l.timestamp_us);
+    out[6] = l.level;
+    memcpy(out + 7, l.text, l.len);
+    size_t n = 7 + l.len;
+    put16(out + n, crc16_ccitt(out, n));
+    return n + 2;
+}
+
+int telemetry_unpack_log(const uint8_t* in, size_t len, TelemetryLog* l) {
+    if(len < TELEMETRY_LOG_BYTES(0) || len > TELEMETRY_LOG_BYTES(TELEMETRY_LOG_MAX)) {
+        return TELEMETRY_ERR_LENGTH;
+    }
+    if(crc16_ccitt(in, len - 2) != get16(in + len - 2)) {
+        return TELEMETRY_ERR_CRC;
+    }
+    if(in[0] != TELEMETRY_VERSION) {
+        return TELEMETRY_ERR_VERSION;
+    }
+    if(in[1] != TELEMETRY_RECORD_LOG) {
+        return TELEMETRY_ERR_TYPE;
+    }
+
+    l->timestamp_us = get32(in + 2);
+    l->level = in[6];
+    l->len = (uint8_t)(len - TELEMETRY_LOG_BYTES(0));
+    memcpy(l->text, in + 7, l->len);
+    return TELEMETRY_OK;
+}
+
+size_t telemetry_frame_log(const TelemetryLog& l, uint8_t* out) {
+    uint8_t raw[TELEMETRY_LOG_BYTES(TELEMETRY_LOG_MAX)];
+    size_t n = telemetry_pack_log(l, raw);
+    out[0] = 0x00;
+    n = 1 + cobs_encode(raw, n, out + 1);
+    out[n++] = 0x00;
+    return n;
+}
@@ -0,0 +1,161 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ldr_scan.h"
+
+// ==================== TELEMETRY WIRE FORMAT ====================
+// Portable (no mbed): shared by the firmware and the host decoder.
+//
+// Stream = frames between 0x00 delimiters, one before and one after each
+// frame so anything else on the line (boot text printed before the stream
+// starts) can't run into it.
+// A frame is the COBS encoding of one record; a record is little-endian
+// fields followed by CRC-16/CCITT-FALSE over everything before it. Byte 0 is the schema version and byte 1 the
+// record type, so a decoder can skip what it does not know.
+//
+// Sensors record, version 1 (31 bytes):
+//   0  u8   version           TELEMETRY_VERSION
+//   1  u8   type              TELEMETRY_RECORD_SENSORS
+//   2  u32  sequence          Record counter; gaps = dropped records
+//   6  u32  timestamp_us      When the SensorFrame was published
+//  10  u16  ldr[6]            Raw ADC A0..A5
+//  22  u8   ir                Pin level, 0 = obstacle
+//  23  u8   valid             SENSOR_VALID_* flags
+//  24  u16  distance_mm       TELEMETRY_NO_DISTANCE when not valid
+//  26  u8   directive         0-6, 255 outside auto mode
+//  27  u16  age_us            Frame age when sent, saturates at 0xFFFF
+//  29  u16  crc
+//
+// Black-box record, version 1 (12 + n bytes): one piece of a recorder
+// block (blackbox_codec.h), sent in order when a capture is streamed
+//   0  u8   version           TELEMETRY_VERSION
+//   1  u8   type              TELEMETRY_RECORD_BLACKBOX
+//   2  u32  block             Block sequence number
+//   6  u16  offset            Of this piece in the block
+//   8  u16  total             Block length, header included
+//  10  u8   data[n]           n <= TELEMETRY_CHUNK_MAX
+//  10+n u16 crc
+//
+// Mirror record, version 1 (13 + n bytes): one tile of the screen mirror
+// (mirror_codec.h), rows y..y+h-1 of columns x..x+w-1
+//   0  u8   version           TELEMETRY_VERSION
+//   1  u8   type              TELEMETRY_RECORD_MIRROR
+//   2  u16  frame             Mirror frame counter
+//   4  u8   flags             TELEMETRY_MIRROR_*
+//   5  u16  x
+//   7  u16  y
+//   9  u8   w
+//  10  u8   h
+//  11  u8   data[n]           n <= TELEMETRY_CHUNK_MAX
+//  11+n u16 crc
+//
+// Log record, version 1 (9 + n bytes): one line of the deferred log
+// (logger.h), or console text, once the stream owns the port
+//   0  u8   version           TELEMETRY_VERSION
+//   1  u8   type              TELEMETRY_RECORD_LOG
+//   2  u32  timestamp_us      When it was logged
+//   6  u8   level             LOG_LEVEL_*, or TELEMETRY_LOG_TEXT
+//   7  u8   text[n]           n <= TELEMETRY_LOG_MAX, no terminator
+//   7+n u16 crc
+#define TELEMETRY_VERSION           1
+#define TELEMETRY_RECORD_SENSORS    1
+#define TELEMETRY_RECORD_BLACKBOX   2
+#define TELEMETRY_RECORD_MIRROR     3
+#define TELEMETRY_RECORD_LOG        4
+#define TELEMETRY_SENSORS_BYTES     31
+#define TELEMETRY_CHUNK_MAX         224
+#define TELEMETRY_CHUNK_BYTES(n)    (12 + (n))
+#define TELEMETRY_MIRROR_BYTES(n)   (13 + (n))
+#define TELEMETRY_LOG_MAX           128
+#define TELEMETRY_LOG_BYTES(n)      (9 + (n))
+#define TELEMETRY_LOG_TEXT          0xFF    // Console text with its own line ends, printed as it is
+#define TELEMETRY_MIRROR_LAST       0x01    // Frame complete: the picture is whole
+#define TELEMETRY_MIRROR_REFRESH    0x02    // Part of a whole-screen resend
+#define TELEMETRY_NO_DISTANCE       0xFFFF
+
+// Worst-case COBS output for n input bytes (one code byte per 254), and a
+// whole frame including both delimiters
+#define COBS_MAX_ENCODED(n)         ((n) + (n) / 254 + 1)
+#define TELEMETRY_FRAME_MAX         (COBS_MAX_ENCODED(TELEMETRY_SENSORS_BYTES) + 2)
+#define TELEMETRY_CHUNK_FRAME_MAX   (COBS_MAX_ENCODED(TELEMETRY_CHUNK_BYTES(TELEMETRY_CHUNK_MAX)) + 2)
+#define TELEMETRY_MIRROR_FRAME_MAX  (COBS_MAX_ENCODED(TELEMETRY_MIRROR_BYTES(TELEMETRY_CHUNK_MAX)) + 2)
+#define TELEMETRY_LOG_FRAME_MAX     (COBS_MAX_ENCODED(TELEMETRY_LOG_BYTES(TELEMETRY_LOG_MAX)) + 2)
+
+// telemetry_unpack() results
+#define TELEMETRY_OK                0
+#define TELEMETRY_ERR_LENGTH        1
+#define TELEMETRY_ERR_CRC           2
+#define TELEMETRY_ERR_VERSION       3
+#define TELEMETRY_ERR_TYPE          4
+
+struct TelemetrySensors {
+    uint32_t sequence;
+    uint32_t timestamp_us;
+    uint16_t ldr[LDR_CHANNELS];
+    uint8_t  ir;
+    uint8_t  valid;
+    uint16_t distance_mm;
+    uint8_t  directive;
+    uint16_t age_us;
+};
+
+struct TelemetryChunk {
+    uint32_t block;
+    uint16_t offset;
+    uint16_t total;
+    uint8_t  len;
+    uint8_t  data[TELEMETRY_CHUNK_MAX];
+};
+
+struct TelemetryMirror {
+    uint16_t frame;
+    uint8_t  flags;
+    uint16_t x, y;
+    uint8_t  w, h;
+    uint8_t  len;
+    uint8_t  data[TELEMETRY_CHUNK_MAX];
+};
+
+struct TelemetryLog {
+    uint32_t timestamp_us;
+    uint8_t  level;
+    uint8_t  len;
+    char     text[TELEMETRY_LOG_MAX];
+};
+
+uint16_t crc16_ccitt(const uint8_t* data, size_t len);
+// Continues a CRC over more data
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t* data, size_t len);
+
+// COBS: encode never writes a 0x00; decode returns 0 on a malformed frame
+size_t cobs_encode(const uint8_t* in, size_t len, uint8_t* out);
+size_t cobs_decode(const uint8_t* in, size_t len, uint8_t* out);
+
+// Record <-> bytes (with CRC)
+size_t telemetry_pack(const TelemetrySensors& r, uint8_t* out);
+int    telemetry_unpack(const uint8_t* in, size_t len, TelemetrySensors* r);
+
+// Record type of a packed record, 0 if too short to have one
+uint8_t telemetry_type(const uint8_t* in, size_t len);
+
+// Delimiter + COBS(pack) + delimiter; out must hold TELEMETRY_FRAME_MAX bytes
+size_t telemetry_frame(const TelemetrySensors& r, uint8_t* out);
+
+// The same for black-box pieces; TELEMETRY_CHUNK_FRAME_MAX bytes
+size_t telemetry_pack_chunk(const TelemetryChunk& c, uint8_t* out);
+int    telemetry_unpack_chunk(const uint8_t* in, size_t len, TelemetryChunk* c);
+size_t telemetry_frame_chunk(const TelemetryChunk& c, uint8_t* out);
+
+// And for screen mirror tiles; TELEMETRY_MIRROR_FRAME_MAX bytes
+size_t telemetry_pack_mirror(const TelemetryMirror& m, uint8_t* out);
+int    telemetry_unpack_mirror(const uint8_t* in, size_t len, TelemetryMirror* m);
+size_t telemetry_frame_mirror(const TelemetryMirror& m, uint8_t* out);
+
+// And for log lines; TELEMETRY_LOG_FRAME_MAX bytes
+size_t telemetry_pack_log(const TelemetryLog& l, uint8_t* out);
+int    telemetry_unpack_log(const uint8_t* in, size_t len, TelemetryLog* l);
+size_t telemetry_frame_log(const TelemetryLog& l, uint8_t* out);
+
+#endif
@@ -0,0 +1,332 @@
+#include "ui.h"
+#include "marshalling.h"
+#include "hmi.h"
+#include "logger.h"
+#include "profiler.h"
+#include "blackbox.h"
+#include "power.h"
+#include "memstats.h"
+
+EventQueue ui_queue(UI_QUEUE_EVENTS * EVENTS_EVENT_SIZE);
+
+static InterruptIn ts_int(UI_TS_INT_PIN);
+
+static volatile uint8_t ui_current = UI_SCREEN_NONE;
+static int      ui_tick_id = 0;
+static int      ui_release_id = 0;
+static int      ui_retry_id = 0;
+static int      ui_idle_id = 0;
+static bool     ui_touch_held = false;      // Tap taken, finger not yet lifted
+static uint64_t ui_touch_ready_ms = 0;      // No new tap before this
+
+static volatile bool ui_touch_queued = false;
+static volatile bool ui_sensors_queued = false;
+static volatile bool ui_range_queued = false;
+static volatile bool ui_wake_queued = false;
+static volatile bool ui_wake_touch = false;    // The finger that woke it is still down
+
+static void ui_on_sensor_frame(const SensorFrame& f);
+static void ui_post_wake();
+
+// ==================== HANDLERS (QUEUE CONTEXT) ====================
+static void ui_on_tick() {
+    if(ui_current == UI_SCREEN_AUTO) {
+        refresh_automation(true);
+    } else if(ui_current == UI_SCREEN_DIAG) {
+        refresh_diag_screen();
+    }
+}
+
+static void ui_on_sensors() {
+    ui_sensors_queued = false;
+    if(ui_current == UI_SCREEN_AUTO && !power_standby()) {
+        refresh_automation(false);
+    }
+}
+
+static void ui_on_range() {
+    ui_range_queued = false;
+    if(power_standby()) {
+        return;     // Posted just before standby; the wake redraws
+    }
+    if(ui_current == UI_SCREEN_HOME) {
+        refresh_home_screen();
+    } else if(ui_current == UI_SCREEN_DISTANCE) {
+        refresh_distance_screen();
+    }
+}
+
+static void ui_on_tap(uint16_t x, uint16_t y) {
+    switch(ui_current) {
+    case UI_SCREEN_HOME:
+        switch(check_touch(x, y)) {
+        case 1:
+            LOG_INFO(">>> AUTO MODE SELECTED <<<");
+            ui_show(UI_SCREEN_AUTO);
+            break;
+        case 2:
+            LOG_INFO(">>> DISTANCE MONITOR SELECTED <<<");
+            ui_show(UI_SCREEN_DISTANCE);
+            break;
+        case 3:
+            ui_show(UI_SCREEN_SHUTDOWN);
+            break;
+        case 4:
+            ui_show(UI_SCREEN_DIAG);
+            break;
+        }
+        break;
+    case UI_SCREEN_AUTO:
+        stop_automation();
+        ui_show(UI_SCREEN_HOME);
+        break;
+    case UI_SCREEN_DISTANCE:
+        play_beep(1000, 50);
+        ui_show(UI_SCREEN_HOME);
+        break;
+    case UI_SCREEN_DIAG:
+        switch(check_diag_touch(x, y)) {
+        case 1:
+            ui_show(UI_SCREEN_HOME);
+            break;
+        case 2:
+            prof_reset();
+            refresh_diag_screen();
+            break;
+        case 3:
+            if(diag_memory_page()) {
+                mem_report();
+            } else {
+                prof_dump();
+            }
+            break;
+        case 4:
+            blackbox_stream_async();
+            refresh_diag_screen();
+            break;
+        case 5:
+            next_diag_page();
+            refresh_diag_screen();
+            break;
+        }
+        break;
+    }
+}
+
+// The controller keeps signalling while a finger stays down, so one press is
+// one tap: after a tap, further touches are ignored until a release has been
+// seen and UI_TOUCH_DEBOUNCE_MS has passed.
+static void ui_on_release_check() {
+    BSP_TS_GetState(&TS_State);
+    if(TS_State.touchDetected) {
+        ui_release_id = ui_queue.call_in(UI_TOUCH_RELEASE_MS, ui_on_release_check);
+        return;
+    }
+    ui_release_id = 0;
+    ui_touch_held = false;
+    ui_touch_ready_ms = Kernel::get_ms_count() + UI_TOUCH_DEBOUNCE_MS;
+}
+
+static void ui_on_touch() {
+    ui_touch_queued = false;
+    if(ui_touch_held) {
+        return;
+    }
+
+    uint64_t now = Kernel::get_ms_count();
+    if(now < ui_touch_ready_ms) {
+        // Bounce, or a new press inside the quiet time: look again after it
+        ui_retry_id = ui_queue.call_in((int)(ui_touch_ready_ms - now), ui_post_touch);
+        return;
+    }
+
+    BSP_TS_GetState(&TS_State);
+    if(!TS_State.touchDetected) {
+        return;
+    }
+
+    ui_touch_held = true;
+    ui_release_id = ui_queue.call_in(UI_TOUCH_RELEASE_MS, ui_on_release_check);
+    ui_on_tap(TS_State.touchX[0], TS_State.touchY[0]);
+}
+
+// ==================== STANDBY (power.h) ====================
+// Checked once per idle period rather than polled: activity only moves the
+// deadline, and the check reschedules itself for whatever is left of it.
+// Screens that show live data to someone (diagnostics) count as activity.
+static void ui_on_idle_check() {
+    ui_idle_id = 0;
+    uint32_t left = power_idle_left_ms();
+    if(left == 0 && !power_standby()) {
+        uint8_t screen = ui_current;
+        if(screen == UI_SCREEN_HOME || screen == UI_SCREEN_AUTO || screen == UI_SCREEN_DISTANCE) {
+            if(ui_tick_id != 0) {
+                ui_queue.cancel(ui_tick_id);
+                ui_tick_id = 0;
+            }
+            power_enter_standby();
+            return;     // Re-armed on wake
+        }
+        power_activity();
+        left = power_idle_left_ms();
+    }
+    ui_idle_id = ui_queue.call_in((int)left, ui_on_idle_check);
+}
+
+// Back from standby: the screen is still in the framebuffer, so only what
+// changed meanwhile is redrawn. In auto mode the directive goes up first.
+static void ui_on_wake() {
+    ui_wake_queued = false;
+    if(!power_standby()) {
+        return;
+    }
+    power_exit_standby();
+    if(ui_wake_touch) {
+        ui_wake_touch = false;
+        ui_touch_held = true;
+        ui_release_id = ui_queue.call_in(UI_TOUCH_RELEASE_MS, ui_on_release_check);
+    }
+
+    switch(ui_current) {
+    case UI_SCREEN_AUTO:
+        PROF_PIXELS_PENDING(PROF_WAKE, power_wake_us());
+        anim_frames_resume();
+        refresh_automation(true);
+        ui_tick_id = ui_queue.call_every(UI_TICK_MS, ui_on_tick);
+        break;
+    case UI_SCREEN_HOME:
+        refresh_home_screen();
+        break;
+    case UI_SCREEN_DISTANCE:
+        refresh_distance_screen();
+        break;
+    }
+    ui_idle_id = ui_queue.call_in((int)power_idle_left_ms(), ui_on_idle_check);
+}
+
+// ==================== SCREEN STATE MACHINE ====================
+void ui_show(uint8_t screen) {
+    if(ui_tick_id != 0) {
+        ui_queue.cancel(ui_tick_id);
+        ui_tick_id = 0;
+    }
+    ui_current = screen;
+
+    switch(screen) {
+    case UI_SCREEN_HOME:
+        show_home_screen();
+        break;
+    case UI_SCREEN_AUTO:
+        anim_frames_resume();
+        start_automation();
+        ui_tick_id = ui_queue.call_every(UI_TICK_MS, ui_on_tick);
+        break;
+    case UI_SCREEN_DISTANCE:
+        show_distance_screen();
+        break;
+    case UI_SCREEN_DIAG:
+        show_diag_screen();
+        ui_tick_id = ui_queue.call_every(UI_DIAG_TICK_MS, ui_on_tick);
+        break;
+    case UI_SCREEN_SHUTDOWN:
+        show_shutdown_screen();
+        play_beep(800, 200);
+        ui_queue.break_dispatch();
+        break;
+    }
+}
+
+uint8_t ui_screen() {
+    return ui_current;
+}
+
+void ui_start() {
+    // Puts the controller in interrupt mode. It also sets up the EXTI line
+    // for the BSP's own handler, so arm the InterruptIn edge afterwards.
+    BSP_TS_ITConfig();
+    ts_int.fall(ui_post_touch);
+
+    sensor_attach(ui_on_sensor_frame);
+
+    ui_show(UI_SCREEN_HOME);
+    if(power_enabled()) {
+        ui_idle_id = ui_queue.call_in((int)power_idle_left_ms(), ui_on_idle_check);
+    }
+}
+
+void ui_stop() {
+    ts_int.fall(Callback<void()>());
+    sensor_attach(NULL);
+
+    if(ui_tick_id != 0) {
+        ui_queue.cancel(ui_tick_id);
+        ui_tick_id = 0;
+    }
+    if(ui_release_id != 0) {
+        ui_queue.cancel(ui_release_id);
+        ui_release_id = 0;
+    }
+    if(ui_retry_id != 0) {
+        ui_queue.cancel(ui_retry_id);
+        ui_retry_id = 0;
+    }
+    if(ui_idle_id != 0) {
+        ui_queue.cancel(ui_idle_id);
+        ui_idle_id = 0;
+    }
+    ui_current = UI_SCREEN_NONE;
+
+    // Run whatever is already posted; the handlers ignore it now
+    ui_queue.dispatch(0);
+    ui_touch_held = false;
+    ui_touch_ready_ms = 0;
+    ui_wake_touch = false;
+}
+
+// ==================== EVENT SOURCES (INTERRUPT / SAMPLER CONTEXT) ====================
+// call() returns 0 when the queue is full; the flag is dropped so the next
+// event tries again.
+void ui_post_touch() {
+    if(power_on_touch()) {
+        ui_wake_touch = true;
+        ui_post_wake();
+        return;
+    }
+    if(!ui_touch_queued) {
+        ui_touch_queued = true;
+        if(ui_queue.call(ui_on_touch) == 0) {
+            ui_touch_queued = false;
+        }
+    }
+}
+
+static void ui_post_wake() {
+    if(!ui_wake_queued) {
+        ui_wake_queued = true;
+        if(ui_queue.call(ui_on_wake) == 0) {
+            ui_wake_queued = false;
+        }
+    }
+}
+
+// Sampler context: a new directive is decided here, before any redraw
+static void ui_on_sensor_frame(const SensorFrame& f) {
+    if(power_on_frame(f)) {
+        ui_post_wake();
+    }
+    if(evaluate_automation(f) && !ui_sensors_queued) {
+        ui_sensors_queued = true;
+        if(ui_queue.call(ui_on_sensors) == 0) {
+            ui_sensors_queued = false;
+        }
+    }
+
+    uint8_t screen = ui_current;
+    if((f.events & SENSOR_EVENT_RANGE) && !ui_range_queued && !power_standby() &&
+       (screen == UI_SCREEN_HOME || screen == UI_SCREEN_DISTANCE)) {
+        ui_range_queued = true;
+        if(ui_queue.call(ui_on_range) == 0) {
+            ui_range_queued = false;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef UI_H
+#define UI_H
+
+#include "mbed.h"
+#include "anim.h"
+
+// ==================== EVENT-DRIVEN UI ====================
+// Every screen runs as a handler on ui_queue, which main() dispatches.
+// Nothing polls: interrupts post events and the thread sleeps in between.
+//   touch   FT5336 INT line (one I2C read per press, not per frame)
+//   sensors any sensor frame (the range projection moves between echoes);
+//           the directive is re-evaluated on the sampler and a redraw
+//           posted only on change
+//   range   a frame caused by a completed ultrasonic measurement
+//   tick    UI_TICK_MS animation frame (anim.h), auto mode only; UI_DIAG_TICK_MS
+//           table refresh on the diagnostics screen
+#define UI_TS_INT_PIN           PI_13   // FT5336 INT, active low
+#define UI_QUEUE_EVENTS         16
+#define UI_TICK_MS              (ANIM_FRAME_US / 1000)  // Auto mode animation frame
+#define UI_DIAG_TICK_MS         500     // Diagnostics table refresh
+#define UI_TOUCH_DEBOUNCE_MS    150     // Quiet time after a release
+#define UI_TOUCH_RELEASE_MS     50      // Release check while a finger is down
+
+#define UI_SCREEN_NONE          0
+#define UI_SCREEN_HOME          1
+#define UI_SCREEN_AUTO          2
+#define UI_SCREEN_DISTANCE      3
+#define UI_SCREEN_SHUTDOWN      4       // Breaks dispatch once shown
+#define UI_SCREEN_DIAG          5       // Profiler histograms, memory budget
+
+extern EventQueue ui_queue;
+
+void ui_start();                        // Hooks the interrupts, shows home
+void ui_stop();                         // Unhooks them, drains the queue
+void ui_show(uint8_t screen);           // Queue context only
+uint8_t ui_screen();
+
+// Touch INT handler, safe from interrupt context. Sensor events arrive as
+// SensorFrames from the sampler (sensors.h). Each kind coalesces: at most
+// one event of a kind is queued at a time.
+void ui_post_touch();
+
+#endif
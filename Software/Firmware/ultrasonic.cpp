@@ -0,0 +1,174 @@
+#include "ultrasonic.h"
+
+// ==================== ECHO EDGE DECODER ====================
+EchoTracker::EchoTracker()
+    : _phase(PHASE_IDLE), _trigger_us(0), _rise_us(0), _deadline_us(0),
+      _count(0), _callback(NULL), _snap_seq(0) {
+    _snap.distance_cm = -1.0f;
+    _snap.pulse_us = 0;
+    _snap.trigger_us = 0;
+    _snap.complete_us = 0;
+    _snap.sequence = 0;
+    _snap.status = US_STATUS_NO_ECHO;
+}
+
+bool EchoTracker::arm(uint32_t now_us) {
+    if(_phase != PHASE_IDLE) {
+        return false;
+    }
+    _trigger_us = now_us;
+    _deadline_us = now_us + US_ECHO_TIMEOUT_US;
+    _phase = PHASE_WAIT_RISE;
+    return true;
+}
+
+void EchoTracker::echo_rise(uint32_t now_us) {
+    if(_phase != PHASE_WAIT_RISE) {
+        return;  // Stray edge (noise or crosstalk) - ignore
+    }
+    _rise_us = now_us;
+    _deadline_us = now_us + US_ECHO_TIMEOUT_US;
+    _phase = PHASE_WAIT_FALL;
+}
+
+void EchoTracker::echo_fall(uint32_t now_us) {
+    if(_phase != PHASE_WAIT_FALL) {
+        return;
+    }
+    uint32_t pulse_us = now_us - _rise_us;
+    if(pulse_us > US_ECHO_TIMEOUT_US) {
+        publish(US_STATUS_ECHO_TOO_LONG, 0, now_us);
+        return;
+    }
+    float distance_cm = pulse_us * US_CM_PER_US;
+    if(distance_cm < US_MIN_RANGE_CM || distance_cm > US_MAX_RANGE_CM) {
+        publish(US_STATUS_OUT_OF_RANGE, pulse_us, now_us);
+        return;
+    }
+    publish(US_STATUS_OK, pulse_us, now_us);
+}
+
+bool EchoTracker::poll(uint32_t now_us) {
+    if(_phase == PHASE_IDLE) {
+        return false;
+    }
+    // Signed difference keeps this correct across 32-bit timer wrap
+    if((int32_t)(now_us - _deadline_us) < 0) {
+        return false;
+    }
+    if(_phase == PHASE_WAIT_RISE) {
+        publish(US_STATUS_NO_ECHO, 0, now_us);
+    } else {
+        publish(US_STATUS_ECHO_TOO_LONG, 0, now_us);
+    }
+    return true;
+}
+
+bool EchoTracker::close(uint32_t now_us) {
+    if(_phase == PHASE_IDLE) {
+        return false;
+    }
+    if(_phase == PHASE_WAIT_RISE) {
+        publish(US_STATUS_NO_ECHO, 0, now_us);
+    } else {
+        publish(US_STATUS_OUT_OF_RANGE, 0, now_us);
+    }
+    return true;
+}
+
+uint32_t EchoTracker::time_to_deadline(uint32_t now_us) const {
+    if(_phase == PHASE_IDLE) {
+        return 0;
+    }
+    int32_t remaining = (int32_t)(_deadline_us - now_us);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+void EchoTracker::publish(uint8_t status, uint32_t pulse_us, uint32_t now_us) {
+    UltrasonicMeasurement m;
+    m.status = status;
+    m.pulse_us = pulse_us;
+    m.distance_cm = (status == US_STATUS_OK) ? pulse_us * US_CM_PER_US : -1.0f;
+    m.trigger_us = _trigger_us;
+    m.complete_us = now_us;
+    m.sequence = ++_count;
+
+    _snap_seq = _snap_seq + 1;
+    __sync_synchronize();
+    _snap = m;
+    __sync_synchronize();
+    _snap_seq = _snap_seq + 1;
+
+    _phase = PHASE_IDLE;
+
+    if(_callback != NULL) {
+        _callback(m);
+    }
+}
+
+bool EchoTracker::latest(UltrasonicMeasurement* out) const {
+    uint32_t before, after;
+    do {
+        before = _snap_seq;
+        __sync_synchronize();
+        *out = _snap;
+        __sync_synchronize();
+        after = _snap_seq;
+    } while((before & 1) || before != after);
+    return out->sequence != 0;
+}
+
+// ==================== INTERRUPT-DRIVEN RANGER ====================
+UltrasonicRanger::UltrasonicRanger(PinName trig_pin, PinName echo_pin)
+    : _trig(trig_pin, 0), _echo(echo_pin) {
+    _echo.mode(PullNone);
+}
+
+void UltrasonicRanger::start(uint32_t period_ms) {
+    _echo.rise(callback(this, &UltrasonicRanger::on_rise));
+    _echo.fall(callback(this, &UltrasonicRanger::on_fall));
+    _ticker.attach_us(callback(this, &UltrasonicRanger::fire), period_ms * 1000);
+}
+
+void UltrasonicRanger::stop() {
+    _ticker.detach();
+    _timeout.detach();
+    _echo.rise(NULL);
+    _echo.fall(NULL);
+    _tracker.cancel();     // Its fall edge or timeout will never be seen now
+}
+
+void UltrasonicRanger::fire() {
+    uint32_t now = us_ticker_read();
+    _tracker.poll(now);
+    if(_tracker.busy()) {
+        return;  // Previous cycle still in flight - skip this slot
+    }
+
+    // 10 us trigger pulse; short enough to issue from the ticker ISR
+    _trig = 1;
+    wait_us(US_TRIGGER_PULSE_US);
+    _trig = 0;
+
+    _tracker.arm(us_ticker_read());
+    rearm_timeout();
+}
+
+void UltrasonicRanger::on_rise() {
+    _tracker.echo_rise(us_ticker_read());
+    rearm_timeout();
+}
+
+void UltrasonicRanger::on_fall() {
+    _timeout.detach();
+    _tracker.echo_fall(us_ticker_read());
+}
+
+void UltrasonicRanger::on_timeout() {
+    _tracker.poll(us_ticker_read());
+}
+
+void UltrasonicRanger::rearm_timeout() {
+    uint32_t remaining = _tracker.time_to_deadline(us_ticker_read());
+    _timeout.attach_us(callback(this, &UltrasonicRanger::on_timeout), remaining + 1);
+}
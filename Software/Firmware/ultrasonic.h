@@ -0,0 +1,113 @@
+#ifndef ULTRASONIC_H
+#define ULTRASONIC_H
+
+#include "mbed.h"
+#include <stdint.h>
+
+// ==================== HC-SR04 LIMITS ====================
+#define US_MIN_RANGE_CM         2.0f
+#define US_MAX_RANGE_CM         400.0f
+#define US_ECHO_TIMEOUT_US      30000       // Per phase: wait-for-rise and pulse width
+#define US_CM_PER_US            0.01715f    // Speed of sound / 2 (round trip)
+#define US_TRIGGER_PULSE_US     10
+#define US_DEFAULT_PERIOD_MS    60          // HC-SR04 recommended cycle time
+
+// Measurement result codes
+#define US_STATUS_OK            0
+#define US_STATUS_NO_ECHO       1           // Echo never went high
+#define US_STATUS_ECHO_TOO_LONG 2           // Echo stayed high past timeout
+#define US_STATUS_OUT_OF_RANGE  3           // Pulse decoded but outside 2-400 cm
+
+struct UltrasonicMeasurement {
+    float    distance_cm;       // -1.0f when status != US_STATUS_OK
+    uint32_t pulse_us;          // Echo high time (0 on timeout)
+    uint32_t trigger_us;        // Timestamp of the trigger pulse
+    uint32_t complete_us;       // Timestamp when the result was published
+    uint32_t sequence;          // Increments once per published measurement
+    uint8_t  status;
+};
+
+typedef void (*ultrasonic_callback_t)(const UltrasonicMeasurement& m);
+
+// ==================== ECHO EDGE DECODER ====================
+// Pure timing state machine. Has no knowledge of pins or timers, so it can be
+// driven from InterruptIn edges on the board or from scripted edges on a host.
+// All methods are safe to call from interrupt context; latest() is wait-free
+// for readers in thread context.
+class EchoTracker {
+public:
+    EchoTracker();
+
+    // Trigger pulse was issued at now_us. Returns false if still busy.
+    bool arm(uint32_t now_us);
+    void echo_rise(uint32_t now_us);
+    void echo_fall(uint32_t now_us);
+
+    // Expire the current phase if its deadline passed. Returns true if a
+    // timeout result was published.
+    bool poll(uint32_t now_us);
+
+    bool busy() const { return _phase != PHASE_IDLE; }
+
+    // Abandon an in-flight measurement without publishing it
+    void cancel() { _phase = PHASE_IDLE; }
+
+    // End the measurement before its deadline (a scheduler's listening
+    // window closed): NO_ECHO if the echo never rose, OUT_OF_RANGE if it is
+    // still high. Returns true if a result was published.
+    bool close(uint32_t now_us);
+
+    // Microseconds until the current phase times out (0 when idle/expired).
+    uint32_t time_to_deadline(uint32_t now_us) const;
+
+    // Called from publish() in the same context as the edge/poll call.
+    void attach(ultrasonic_callback_t cb) { _callback = cb; }
+
+    // Copy the most recent published measurement. Returns false if none yet.
+    bool latest(UltrasonicMeasurement* out) const;
+
+private:
+    enum { PHASE_IDLE, PHASE_WAIT_RISE, PHASE_WAIT_FALL };
+
+    void publish(uint8_t status, uint32_t pulse_us, uint32_t now_us);
+
+    volatile uint8_t  _phase;
+    uint32_t          _trigger_us;
+    uint32_t          _rise_us;
+    uint32_t          _deadline_us;
+    uint32_t          _count;
+    ultrasonic_callback_t _callback;
+
+    // Seqlock protected snapshot: odd _snap_seq means a write is in progress
+    volatile uint32_t _snap_seq;
+    UltrasonicMeasurement _snap;
+};
+
+// ==================== INTERRUPT-DRIVEN RANGER ====================
+// Fires the trigger from a Ticker, timestamps echo edges with InterruptIn and
+// expires missing/long echoes with a Timeout. Nothing here blocks or locks.
+class UltrasonicRanger {
+public:
+    UltrasonicRanger(PinName trig_pin, PinName echo_pin);
+
+    void start(uint32_t period_ms = US_DEFAULT_PERIOD_MS);
+    void stop();
+
+    void attach(ultrasonic_callback_t cb) { _tracker.attach(cb); }
+    bool latest(UltrasonicMeasurement* out) const { return _tracker.latest(out); }
+
+private:
+    void fire();
+    void on_rise();
+    void on_fall();
+    void on_timeout();
+    void rearm_timeout();
+
+    DigitalOut  _trig;
+    InterruptIn _echo;
+    Ticker      _ticker;
+    Timeout     _timeout;
+    EchoTracker _tracker;
+};
+
+#endif
@@ -0,0 +1,183 @@
+// ==================== ANIMATION BENCHMARK ====================
+// Runs the firmware's UI on the auto-mode screen and measures its animation
+// (anim.h): each directive held in turn with the sensors idle, so only the
+// animation draws, then an aircraft approach with the sampler redrawing on
+// every directive change as well.
+//
+// Per run it reports frames presented per second, the longest gap between
+// frames and the frames that came later than ANIM_LATE_US, and the UI CPU
+// per frame against ANIM_BUDGET_US. The clock starts BENCH_WRAP_LEAD_MS
+// short of the 32-bit us_ticker wrap, so the held directives cross it: a
+// timeline that was not continuous there would show a frame out of time.
+// Exits 1 if a run is outside 30-60 frames/s, drops a frame, or averages
+// over the budget.
+//
+//   anim_bench [-p prefix]
+//     -p prefix  write each held directive's last frame to <prefix><n>.ppm
+
+#include "mbed.h"
+#include "marshalling.h"
+#include "hmi.h"
+#include "ui.h"
+#include "logger.h"
+#include "profiler.h"
+#include "anim.h"
+#include "sim_lcd.h"
+#include "approach.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_HOLD_MS           2000
+#define BENCH_WRAP_LEAD_MS      7000        // Clock start before the wrap
+#define BENCH_TIMEOUT_MS        60000
+#define BENCH_DWELL_MS          1000        // Parked this long ends the approach
+#define BENCH_MIN_FPS           30.0
+#define BENCH_MAX_FPS           60.0
+
+static const ApproachScenario bench_scenario =
+    {"offset-port", 300.0f, 15.0f, 40.0f, 60.0f, 4.5f, 0.0f, 1.5f, 600.0f, 0.10f, 0.02f, 0.0f, 2};
+
+struct BenchRun {
+    uint64_t  ui_us;
+    uint32_t  flips;
+    AnimStats anim;
+};
+
+static void bench_begin(BenchRun& r) {
+    memset(&r, 0, sizeof(r));
+    r.flips = display_flips();
+    r.ui_us = sim_now_us();
+    anim_stats_reset();
+    anim_frames_resume();
+}
+
+static void bench_end(BenchRun& r) {
+    r.ui_us = sim_now_us() - r.ui_us;
+    r.flips = display_flips() - r.flips;
+    r.anim = anim_stats();
+}
+
+static uint32_t print_run(const char* name, const BenchRun& r) {
+    double secs = r.ui_us / 1e6;
+    double fps = secs > 0 ? r.flips / secs : 0.0;
+    double avg_us = r.anim.frames ? r.anim.cycles / (double)r.anim.frames / PROF_CYCLES_PER_US : 0.0;
+    printf("%-18s %5.1f  %6.1f  %6u  %7.1f  %4u  %8.1f  %8.1f  %5u\n", name, secs, fps, r.anim.frames,
+           r.anim.max_interval_us / 1000.0, r.anim.late, avg_us, r.anim.max_cycles / (double)PROF_CYCLES_PER_US,
+           r.anim.over_budget);
+
+    uint32_t failures = 0;
+    if(fps < BENCH_MIN_FPS || fps > BENCH_MAX_FPS) {
+        printf("  ^ outside %.0f-%.0f frames/s\n", BENCH_MIN_FPS, BENCH_MAX_FPS);
+        failures++;
+    }
+    if(r.anim.late != 0) {
+        printf("  ^ frames later than %u ms\n", ANIM_LATE_US / 1000);
+        failures++;
+    }
+    if(avg_us > ANIM_BUDGET_US) {
+        printf("  ^ over the %u us budget on average\n", ANIM_BUDGET_US);
+        failures++;
+    }
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    const char* ppm_prefix = NULL;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            ppm_prefix = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-p ppm_prefix]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sim_serial_sink = NULL;     // Directive changes are logged; not wanted here
+    printf("==================== ANIMATION BENCHMARK ====================\n");
+    printf("%u ms frames, %u us CPU budget per frame, late after %u ms\n\n", UI_TICK_MS, ANIM_BUDGET_US,
+           ANIM_LATE_US / 1000);
+
+    sim_reset();
+    sim_advance_us(0x100000000ULL - BENCH_WRAP_LEAD_MS * 1000ULL);
+    sim_touch_set(false, 0, 0);
+    lcd_init();
+    ui_start();
+    ui_queue.dispatch(0);
+
+    Ticker log_tick;
+    log_tick.attach_us([]() { log_drain(); }, LOG_DRAIN_IDLE_MS * 1000);
+    prof_reset();
+
+    printf("run                 secs  frames/s  drawn  max gap  late  avg us    max us   over\n");
+    uint32_t failures = 0;
+
+    // Each directive on its own: the sensors are not running, so nothing
+    // but the ticks draws and current_directive stays where it is put
+    ui_queue.call([]() { ui_show(UI_SCREEN_AUTO); });
+    ui_queue.dispatch(0);
+    bool wrapped = false;
+    for(uint8_t d = 0; d < DIRECTIVE_COUNT; d++) {
+        current_directive = d;
+        BenchRun r;
+        bench_begin(r);
+        uint32_t before = us_ticker_read();
+        ui_queue.dispatch(BENCH_HOLD_MS);
+        bench_end(r);
+        char name[32];
+        snprintf(name, sizeof(name), "%s%s", directive_presentation[d].title,
+                 us_ticker_read() < before ? " *" : "");
+        wrapped = wrapped || us_ticker_read() < before;
+        failures += print_run(name, r);
+        if(ppm_prefix != NULL) {
+            char path[256];
+            snprintf(path, sizeof(path), "%s%u.ppm", ppm_prefix, d);
+            sim_lcd_write_ppm(path);
+        }
+    }
+    ui_queue.call([]() { stop_automation(); ui_show(UI_SCREEN_HOME); });
+    ui_queue.dispatch(0);
+
+    // The approach, until the aircraft has been parked a while
+    approach_begin(bench_scenario);
+    ldr_scan.start(&approach_ldr_source());
+    ranger.start(US_DEFAULT_PERIOD_MS);
+    sensor_sampler_start();
+    ui_queue.call([]() { ui_show(UI_SCREEN_AUTO); });
+    BenchRun r;
+    bench_begin(r);
+    uint64_t halted_since = 0;
+    while(sim_now_us() - r.ui_us < BENCH_TIMEOUT_MS * 1000ULL) {
+        ui_queue.dispatch(UI_TICK_MS);
+        const ApproachState& st = approach_state();
+        if(!st.halted) {
+            halted_since = 0;
+        } else if(halted_since == 0) {
+            halted_since = sim_now_us();
+        } else if(sim_now_us() - halted_since >= BENCH_DWELL_MS * 1000ULL) {
+            break;
+        }
+    }
+    bench_end(r);
+    failures += print_run(bench_scenario.name, r);
+
+    ui_stop();
+    log_drain();
+    log_tick.detach();
+    sensor_sampler_stop();
+    ranger.stop();
+    ldr_scan.stop();
+    approach_end();
+
+    const ProfHistogram* h = prof_histogram(PROF_RENDER_AUTO);
+    printf("\nauto draw (profiler): %u frames, p50 %.1f us, p99 %.1f us\n", h->count,
+           prof_percentile(h, 50) / (double)PROF_CYCLES_PER_US, prof_percentile(h, 99) / (double)PROF_CYCLES_PER_US);
+    printf("* us_ticker wrapped during the run\n");
+    if(!wrapped) {
+        printf("clock never crossed the us_ticker wrap\n");
+        failures++;
+    }
+    if(failures) {
+        printf("\n%u failures\n", failures);
+    }
+    return failures ? 1 : 0;
+}
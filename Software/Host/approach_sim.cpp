@@ -0,0 +1,335 @@
+// ==================== APPROACH SIMULATOR ====================
+// Runs the unmodified firmware event loop (ui_queue) on auto mode, or the
+// distance screen, against a modelled aircraft approach on a virtual clock,
+// as fast as the host allows. The operator leaves the screen with a tap.
+// Reports sensor-to-decision latency and redraw cost per approach.
+//
+//   approach_sim [-v] [-d] [-P] [-D] [-m] [-s name] [-p prefix] [-t file] [-b prefix] [-w prefix]
+//     -v         echo the firmware's serial output
+//     -P         no range STOP/SLOW (IR STOP only), for comparison
+//     -D         print every profiler probe (host cycles at 216 MHz, so
+//                render times are the host's, latencies virtual time)
+//     -t file    stream binary telemetry (log lines included) to file;
+//                decode it with telemetry_decode
+//     -m         mirror the screen into the stream (mirror.h);
+//                telemetry_decode -m rebuilds it
+//     -d         drive the distance screen instead of auto mode
+//     -s name    run only the named scenario
+//     -p prefix  write the final frame of each scenario to <prefix><name>.ppm
+//     -b prefix  write each scenario's black-box recording to <prefix><name>.bbx;
+//                play it back with blackbox_replay
+//     -w prefix  write each scenario's operator cues to <prefix><name>.wav
+
+#include "mbed.h"
+#include "marshalling.h"
+#include "hmi.h"
+#include "ui.h"
+#include "telemetry.h"
+#include "logger.h"
+#include "profiler.h"
+#include "blackbox.h"
+#include "mirror.h"
+#include "sim_lcd.h"
+#include "sim_wav.h"
+#include "approach.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static const ApproachScenario scenarios[] = {
+    // name            start  stop  speed brake  lat   drift steer react amb  noise ghost seed
+    {"centreline",     300.0f, 15.0f, 40.0f, 60.0f,  0.0f,  0.0f, 1.5f, 600.0f, 0.10f, 0.02f, 0.0f, 1},
+    {"offset-port",    300.0f, 15.0f, 40.0f, 60.0f,  4.5f,  0.0f, 1.5f, 600.0f, 0.10f, 0.02f, 0.0f, 2},
+    {"crosswind",      350.0f, 15.0f, 35.0f, 60.0f,  0.0f, -0.6f, 1.5f, 600.0f, 0.10f, 0.02f, 0.0f, 3},
+    {"fast-taxi",      380.0f, 15.0f, 120.0f, 80.0f, -3.0f, 0.0f, 2.0f, 400.0f, 0.10f, 0.02f, 0.0f, 4},
+    {"bright-noisy",   300.0f, 15.0f, 40.0f, 60.0f,  2.0f,  0.3f, 1.5f, 600.0f, 0.30f, 0.20f, 0.05f, 5},
+};
+
+#define SCENARIO_COUNT       (sizeof(scenarios) / sizeof(scenarios[0]))
+#define SCENARIO_TIMEOUT_US  (120ULL * 1000000ULL)
+#define SCENARIO_DWELL_US    (1000000ULL)         // Tap once halted this long
+
+static bool mirror_screen = false;
+
+// One wakeup = one event handler run
+struct FrameStats {
+    uint32_t frames;
+    uint64_t pixels;
+    uint64_t max_pixels;
+    uint64_t host_ns;
+    uint64_t max_host_ns;
+};
+
+typedef std::chrono::steady_clock host_clock;
+
+static uint64_t elapsed_ns(host_clock::time_point a, host_clock::time_point b) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+}
+
+static void print_probe(uint8_t probe) {
+    const ProfHistogram* h = prof_histogram(probe);
+    printf("  %-14s    %8u       p50 %.1f us  p99 %.1f us  max %.1f us\n", prof_name(probe), h->count,
+           prof_percentile(h, 50) / (double)PROF_CYCLES_PER_US,
+           prof_percentile(h, 99) / (double)PROF_CYCLES_PER_US, h->max / (double)PROF_CYCLES_PER_US);
+}
+
+static bool write_block(const uint8_t* block, uint32_t len, void* ctx) {
+    return fwrite(block, 1, len, (FILE*)ctx) == len;
+}
+
+static void run_scenario(const ApproachScenario& sc, uint8_t screen, const char* ppm_prefix, bool telemetry,
+                         bool profile, const char* bbx_prefix, const char* wav_prefix) {
+    sim_reset();
+    sim_touch_set(false, 0, 0);
+    lcd_init();
+
+    FrameStats fs;
+    memset(&fs, 0, sizeof(fs));
+    uint64_t frame_start_pixels = 0;
+    host_clock::time_point frame_start = host_clock::now();
+
+    // Firmware work per wakeup = wall time spent in one event handler
+    sim_set_sleep_hook([&](uint32_t) {
+        host_clock::time_point now = host_clock::now();
+        uint64_t px = sim_lcd_stats().pixel_writes - frame_start_pixels;
+        uint64_t ns = elapsed_ns(frame_start, now);
+        fs.frames++;
+        fs.pixels += px;
+        fs.host_ns += ns;
+        if(px > fs.max_pixels) fs.max_pixels = px;
+        if(ns > fs.max_host_ns) fs.max_host_ns = ns;
+    });
+    sim_set_wake_hook([&]() {
+        frame_start_pixels = sim_lcd_stats().pixel_writes;
+        frame_start = host_clock::now();
+    });
+
+    // Cues into a WAV file, the codec's double buffer on the virtual clock
+    char wav_path[256];
+    snprintf(wav_path, sizeof(wav_path), "%s%s.wav", wav_prefix != NULL ? wav_prefix : "", sc.name);
+    WavAudioSink wav(wav_path);
+    if(wav_prefix != NULL && !audio.start(&wav)) {
+        perror(wav_path);
+    }
+
+    approach_begin(sc);
+    ldr_scan.start(&approach_ldr_source());
+    ranger.start(US_DEFAULT_PERIOD_MS);
+    sensor_sampler_start();
+    if(mirror_screen) {
+        mirror_start();
+    }
+    ui_start();
+
+    // Low-priority log drain, as log_drain_thread would
+    Ticker log_tick;
+    log_tick.attach_us([]() { log_drain(); }, LOG_DRAIN_IDLE_MS * 1000);
+    LogStats log_before = log_stats();
+
+    // Binary telemetry at its configured rate, as telemetry_thread would
+    Ticker telemetry_tick;
+    if(telemetry) {
+        telemetry_init(TELEMETRY_RATE_HZ);
+        telemetry_tick.attach_us(telemetry_sample, 1000000 / TELEMETRY_RATE_HZ);
+    }
+
+    // Operator taps the screen once the aircraft has been parked a while;
+    // the final frame is captured just before the tap leaves the screen
+    uint64_t halted_since = 0;
+    Ticker operator_check;
+    operator_check.attach_us([&]() {
+        const ApproachState& st = approach_state();
+        uint64_t now = sim_now_us();
+        if(!st.halted) {
+            halted_since = 0;
+        } else if(halted_since == 0) {
+            halted_since = now;
+        }
+        bool done = (halted_since != 0 && now - halted_since >= SCENARIO_DWELL_US) || now >= SCENARIO_TIMEOUT_US;
+        if(done && ui_screen() == screen) {
+            if(ppm_prefix != NULL) {
+                char path[256];
+                snprintf(path, sizeof(path), "%s%s.ppm", ppm_prefix, sc.name);
+                sim_lcd_write_ppm(path);
+            }
+            sim_touch_set(true, SCREEN_W / 2, SCREEN_H / 2);
+        }
+    }, 10000);
+
+    uint64_t touch_polls_before = sim_touch_polls();
+    uint64_t serial_before = sim_serial_bytes;
+    uint32_t copied_before = display_copied_pixels();
+    host_clock::time_point wall_start = host_clock::now();
+    sim_lcd_reset_stats();
+    prof_reset();
+
+    ui_queue.call([screen]() { ui_show(screen); });
+    do {
+        ui_queue.dispatch(UI_TICK_MS);
+    } while(ui_screen() != UI_SCREEN_HOME);
+
+    uint64_t wall_ns = elapsed_ns(wall_start, host_clock::now());
+    if(bbx_prefix != NULL) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s%s.bbx", bbx_prefix, sc.name);
+        FILE* f = fopen(path, "wb");
+        if(f != NULL) {
+            blackbox_export(write_block, f);
+            fclose(f);
+        } else {
+            perror(path);
+        }
+    }
+    operator_check.detach();
+    telemetry_tick.detach();
+    ui_stop();
+    mirror_stop();
+    log_drain();
+    log_tick.detach();
+    sensor_sampler_stop();
+    ranger.stop();
+    ldr_scan.stop();
+    approach_end();
+    sim_touch_set(false, 0, 0);
+    AudioStats as = audio.stats();
+    audio.stop();
+
+    const ApproachState& st = approach_state();
+    SimLcdStats ls = sim_lcd_stats();
+    double virt_s = sim_now_us() / 1e6;
+
+    printf("\n--- %s ---\n", sc.name);
+    printf("  virtual time      %8.2f s   (host %.1f ms, %.0fx real time)\n",
+           virt_s, wall_ns / 1e6, wall_ns ? virt_s * 1e9 / wall_ns : 0.0);
+    printf("  wakeups           %8u       clears %llu, draw calls %llu\n",
+           fs.frames, (unsigned long long)ls.clears, (unsigned long long)ls.draw_calls);
+    printf("  pixels / wakeup   %8.0f avg  %llu max   (%llu total)\n",
+           fs.frames ? (double)fs.pixels / fs.frames : 0.0,
+           (unsigned long long)fs.max_pixels, (unsigned long long)fs.pixels);
+    printf("  tearing exposure  %8llu px written to the scanned-out buffer\n",
+           (unsigned long long)ls.visible_writes);
+    printf("  flips             %8llu       back-buffer sync %u px copied\n",
+           (unsigned long long)ls.flips, display_copied_pixels() - copied_before);
+    SpriteStats ss = sprite_stats();
+    printf("  sprites           %8u blits %u px, %u rasterised (%u B pool)\n",
+           ss.blits, ss.pixels, ss.rasterised, ss.pool_used);
+    GlyphStats gs = glyph_stats();
+    printf("  glyphs            %8u blits %u px, %u rasterised (%u B pool)\n",
+           gs.blits, gs.pixels, gs.rasterised, gs.pool_used);
+    printf("  host cost / wake  %8.1f us avg  %.1f us max\n",
+           fs.frames ? fs.host_ns / 1e3 / fs.frames : 0.0, fs.max_host_ns / 1e3);
+    printf("  decisions         %8u       latency %.1f ms avg  %.1f ms max\n",
+           st.decisions, st.decisions ? st.latency_sum_us / 1e3 / st.decisions : 0.0,
+           st.latency_max_us / 1e3);
+    if(st.stop_shown_us >= 0) {
+        printf("  STOP issued       %8.1f cm before the line", st.stop_shown_cm);
+        if(st.stop_known) {
+            printf(" (%+.0f ms vs IR trip)", st.stop_latency_us / 1e3);
+        } else {
+            printf(" (IR never tripped)");
+        }
+        printf("   overshoot %.1f cm, lateral %+.2f cm\n", st.overshoot_cm, st.lateral_cm);
+    } else {
+        printf("  STOP issued           never   (final range %.1f cm)\n", st.distance_cm);
+    }
+    if(profile) {
+        for(uint8_t p = 0; p < PROF_PROBES; p++) {
+            if(prof_histogram(p)->count != 0) {
+                print_probe(p);
+            }
+        }
+    } else if(prof_histogram(PROF_DIRECTIVE)->count != 0) {
+        print_probe(PROF_DIRECTIVE);
+    }
+    RangeTrackerStats rs = sensor_range_stats();
+    printf("  range track       %8u echoes, %u gated out, %u restarts; SLOW shown %.1f s\n",
+           rs.accepted, rs.rejected, rs.restarts, st.slow_shown_us / 1e6);
+    BlackboxStats bs = blackbox_stats();
+    double bb_rate = bs.span_us ? bs.bytes * 1e6 / bs.span_us : 0.0;
+    printf("  black box         %8u B in %u blocks, %.1f kB/s: the ring holds %.0f s\n",
+           bs.bytes, bs.blocks, bb_rate / 1e3,
+           bb_rate > 0 ? BLACKBOX_BLOCKS * (double)BLACKBOX_BLOCK_BYTES / bb_rate : 0.0);
+    LogStats log_after = log_stats();
+    printf("  touch polls       %8llu       serial bytes %llu, log %u lines (%u dropped)\n",
+           (unsigned long long)(sim_touch_polls() - touch_polls_before),
+           (unsigned long long)(sim_serial_bytes - serial_before),
+           log_after.drained - log_before.drained, log_after.dropped - log_before.dropped);
+    if(wav_prefix != NULL) {
+        printf("  audio             %8u cues, %u of %u blocks rendered, %.1f us max per block\n",
+               as.commands, as.blocks - as.silent, as.blocks, as.max_cycles / (double)PROF_CYCLES_PER_US);
+    }
+    if(telemetry) {
+        TelemetryStats ts = telemetry_stats();
+        printf("  telemetry         %8u records, %u dropped, %u B (%.0f%% of %d baud)\n",
+               ts.records, ts.dropped, ts.bytes,
+               virt_s > 0 ? ts.bytes * 10.0 / virt_s / TELEMETRY_BAUD * 100.0 : 0.0, TELEMETRY_BAUD);
+    }
+    if(mirror_screen) {
+        MirrorStats ms = mirror_stats();
+        printf("  mirror            %8u frames, %.1f/s, %u tiles, %.1f kB/s, %.1fx smaller than RGB565\n",
+               ms.frames, virt_s > 0 ? ms.frames / virt_s : 0.0, ms.tiles, virt_s > 0 ? ms.bytes / virt_s / 1e3 : 0.0,
+               ms.bytes ? ms.sent_px * 2.0 / ms.bytes : 0.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* only = NULL;
+    const char* ppm_prefix = NULL;
+    const char* telemetry_path = NULL;
+    const char* bbx_prefix = NULL;
+    const char* wav_prefix = NULL;
+    uint8_t screen = UI_SCREEN_AUTO;
+    bool profile = false;
+    sim_serial_sink = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-v") == 0) {
+            sim_serial_sink = stdout;
+        } else if(strcmp(argv[i], "-d") == 0) {
+            screen = UI_SCREEN_DISTANCE;
+        } else if(strcmp(argv[i], "-P") == 0) {
+            range_directives = false;
+        } else if(strcmp(argv[i], "-D") == 0) {
+            profile = true;
+        } else if(strcmp(argv[i], "-m") == 0) {
+            mirror_screen = true;
+        } else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            ppm_prefix = argv[++i];
+        } else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            telemetry_path = argv[++i];
+        } else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            bbx_prefix = argv[++i];
+        } else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            wav_prefix = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-v] [-d] [-P] [-D] [-m] [-s scenario] [-p ppm_prefix] [-t telemetry_file] [-b bbx_prefix] [-w wav_prefix]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    FILE* telemetry_file = NULL;
+    if(telemetry_path != NULL) {
+        telemetry_file = fopen(telemetry_path, "wb");
+        if(telemetry_file == NULL) {
+            perror(telemetry_path);
+            return 1;
+        }
+        sim_serial_sink = telemetry_file;
+    }
+
+    prof_init();
+    printf("==================== APPROACH SIMULATOR ====================\n");
+    for(size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if(only != NULL && strcmp(only, scenarios[i].name) != 0) {
+            continue;
+        }
+        run_scenario(scenarios[i], screen, ppm_prefix, telemetry_file != NULL, profile, bbx_prefix, wav_prefix);
+    }
+
+    if(telemetry_file != NULL) {
+        fclose(telemetry_file);
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+// ==================== AUDIO ENGINE RENDER CHECK ====================
+// Runs the audio engine (audio.h) into the WAV sink (sim_wav.h) on the
+// virtual clock and plays a short script: a plain beep, each cue pattern,
+// and a beep on top of the STOP cue. Every call is timed on the virtual
+// clock, which must not move while it runs. The rendered stream is then
+// measured: when each cue starts (after the call), how long it sounds, its
+// pitch from the zero crossings, and the peak of the two voices mixed.
+// Also reports the cost of a rendered block as a share of its 16 ms.
+// Exits 1 if a call blocked or a cue came out wrong.
+//
+//   audio_render [-o file.wav]
+
+#include "mbed.h"
+#include "audio.h"
+#include "profiler.h"
+#include "sim_wav.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define RENDER_SECONDS          5
+#define RENDER_THRESHOLD        200         // |sample| above this is sound
+#define RENDER_LATENCY_FRAMES   (2 * AUDIO_BLOCK_FRAMES)  // Into the next half, then played
+#define RENDER_TIME_TOL_MS      6.0         // Ramps and block edges
+#define RENDER_PITCH_TOL        0.03        // Relative
+
+struct RenderCue {
+    const char* name;
+    uint32_t    at_ms;                      // When it is called
+    uint8_t     pattern;                    // AUDIO_PATTERN_*, or NONE for a beep
+    uint16_t    freq_hz;                    // Beep only
+    uint16_t    ms;
+    bool        blocked;
+};
+
+static RenderCue cues[] = {
+    {"beep 1000 Hz", 200, AUDIO_PATTERN_NONE, 1000, 50, false},
+    {"change", 800, AUDIO_PATTERN_CHANGE, 0, 0, false},
+    {"caution", 1400, AUDIO_PATTERN_CAUTION, 0, 0, false},
+    {"stop", 2200, AUDIO_PATTERN_STOP, 0, 0, false},
+    {"stop", 3400, AUDIO_PATTERN_STOP, 0, 0, false},
+    {"beep over stop", 3420, AUDIO_PATTERN_NONE, 1000, 120, false},
+};
+
+#define RENDER_CUES     (sizeof(cues) / sizeof(cues[0]))
+
+static std::vector<int16_t> stream;         // Left channel, as written
+static uint64_t stream_us = 0;              // When its first frame plays
+static uint32_t active_blocks = 0;
+static uint64_t active_cycles = 0;
+
+// A half is filled as the DMA leaves it and plays after the other half
+static void render_tap(const int16_t* block, uint32_t frames, uint32_t t_us, void*) {
+    static uint32_t seen = 0;
+    if(stream.empty()) {
+        stream_us = t_us + (uint64_t)frames * 1000000 / AUDIO_RATE_HZ;
+    }
+    AudioStats st = audio.stats();
+    if(st.blocks - st.silent != seen) {
+        seen = st.blocks - st.silent;
+        active_blocks++;
+        active_cycles += st.cycles;
+    }
+    for(uint32_t f = 0; f < frames; f++) {
+        stream.push_back(block[f * AUDIO_CHANNELS]);
+    }
+}
+
+static void render_call(RenderCue* c) {
+    uint64_t before = sim_now_us();
+    if(c->pattern == AUDIO_PATTERN_NONE) {
+        audio.beep(c->freq_hz, c->ms);
+    } else {
+        audio.play(c->pattern);
+    }
+    c->blocked = (sim_now_us() != before);
+}
+
+// Sounding span of a pattern: its steps, less a trailing rest
+static uint32_t pattern_ms(uint8_t pattern) {
+    const AudioPattern& p = audio_patterns[pattern];
+    uint32_t ms = 0;
+    uint32_t last_tone = 0;
+    for(uint8_t i = 0; i < p.count; i++) {
+        ms += p.steps[i].ms;
+        if(p.steps[i].start_hz != 0) last_tone = ms;
+    }
+    return last_tone;
+}
+
+// Frequency of the first tone step, 0 for a chirp
+static uint16_t pattern_hz(uint8_t pattern) {
+    const AudioStep& s = audio_patterns[pattern].steps[0];
+    return s.start_hz == s.end_hz ? s.start_hz : 0;
+}
+
+static uint32_t frame_at(uint32_t ms) {
+    uint64_t us = (uint64_t)ms * 1000;
+    return us > stream_us ? (uint32_t)((us - stream_us) * AUDIO_RATE_HZ / 1000000) : 0;
+}
+
+static uint32_t first_sound(uint32_t from, uint32_t to) {
+    for(uint32_t i = from; i < to; i++) {
+        if(abs(stream[i]) > RENDER_THRESHOLD) return i;
+    }
+    return to;
+}
+
+static uint32_t last_sound(uint32_t from, uint32_t to) {
+    for(uint32_t i = to; i > from; i--) {
+        if(abs(stream[i - 1]) > RENDER_THRESHOLD) return i;
+    }
+    return from;
+}
+
+// Rising zero crossings per second over [from, to)
+static double pitch_hz(uint32_t from, uint32_t to) {
+    uint32_t first = 0, last = 0, n = 0;
+    for(uint32_t i = from + 1; i < to; i++) {
+        if(stream[i - 1] < 0 && stream[i] >= 0) {
+            if(n == 0) first = i;
+            last = i;
+            n++;
+        }
+    }
+    if(n < 2) return 0.0;
+    return (n - 1) * (double)AUDIO_RATE_HZ / (last - first);
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-o file.wav]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("==================== AUDIO ENGINE RENDER CHECK ====================\n");
+    printf("%u Hz, %u frames per block, %u voices\n\n", AUDIO_RATE_HZ, AUDIO_BLOCK_FRAMES, AUDIO_VOICES);
+
+    sim_reset();
+    WavAudioSink sink(path, render_tap, NULL);
+    if(!audio.start(&sink)) {
+        perror(path);
+        return 1;
+    }
+    for(uint32_t i = 0; i < RENDER_CUES; i++) {
+        RenderCue* c = &cues[i];
+        sim_schedule((uint64_t)c->at_ms * 1000, [c]() { render_call(c); });
+    }
+    sim_advance_to((uint64_t)RENDER_SECONDS * 1000000);
+    audio.stop();
+    AudioStats st = audio.stats();
+
+    printf("cue              call ms  blocked  latency ms  sound ms  expect  pitch Hz  expect  peak\n");
+    uint32_t failures = 0;
+    for(uint32_t i = 0; i < RENDER_CUES; i++) {
+        const RenderCue& c = cues[i];
+        // Up to the next call, or the end of the stream
+        uint32_t from = frame_at(c.at_ms);
+        uint32_t to = (uint32_t)stream.size();
+        if(i + 1 < RENDER_CUES) {
+            to = frame_at(cues[i + 1].at_ms);
+        }
+        bool overlapped = (i + 1 < RENDER_CUES && cues[i + 1].at_ms < c.at_ms + pattern_ms(c.pattern));
+        bool overlay = (i > 0 && c.at_ms < cues[i - 1].at_ms + pattern_ms(cues[i - 1].pattern));
+        if(overlapped) {
+            to = (uint32_t)stream.size() < from + AUDIO_RATE_HZ ? (uint32_t)stream.size() : from + AUDIO_RATE_HZ;
+        }
+
+        uint32_t start = first_sound(from, to);
+        uint32_t end = last_sound(start, to);
+        double latency = (start - from) * 1000.0 / AUDIO_RATE_HZ;
+        double sound = (end - start) * 1000.0 / AUDIO_RATE_HZ;
+        uint32_t expect_ms = c.pattern == AUDIO_PATTERN_NONE ? c.ms : pattern_ms(c.pattern);
+        uint16_t expect_hz = c.pattern == AUDIO_PATTERN_NONE ? c.freq_hz : pattern_hz(c.pattern);
+        int32_t peak = 0;
+        for(uint32_t f = start; f < end; f++) {
+            if(abs(stream[f]) > peak) peak = abs(stream[f]);
+        }
+
+        bool ok = !c.blocked && start < to && peak < 32767;
+        double hz = 0.0;
+        if(overlay) {
+            // Mixed with the pattern already playing: only the mix's
+            // headroom can be told apart
+            printf("%-16s %7u  %7s  %10s  %8s  %6s  %8s  %6s  %5d\n", c.name, c.at_ms,
+                   c.blocked ? "yes" : "no", "-", "-", "-", "-", "-", peak);
+        } else {
+            ok = ok && start - from <= RENDER_LATENCY_FRAMES && fabs(sound - expect_ms) <= RENDER_TIME_TOL_MS;
+            // Pitch from the first step, inside its ramps; not with another
+            // voice on top
+            if(expect_hz != 0 && !overlapped) {
+                uint32_t step_ms = c.pattern == AUDIO_PATTERN_NONE ? c.ms : audio_patterns[c.pattern].steps[0].ms;
+                uint32_t step_end = start + step_ms * AUDIO_RATE_HZ / 1000;
+                hz = pitch_hz(start + AUDIO_RAMP_FRAMES / 2, step_end - AUDIO_RAMP_FRAMES / 2);
+                ok = ok && fabs(hz - expect_hz) <= expect_hz * RENDER_PITCH_TOL;
+            }
+            char hz_s[16], expect_s[16];
+            snprintf(hz_s, sizeof(hz_s), hz > 0.0 ? "%.1f" : "-", hz);
+            snprintf(expect_s, sizeof(expect_s), hz > 0.0 ? "%u" : "-", expect_hz);
+            printf("%-16s %7u  %7s  %10.1f  %8.1f  %6u  %8s  %6s  %5d\n", c.name, c.at_ms,
+                   c.blocked ? "yes" : "no", latency, sound, expect_ms, hz_s, expect_s, peak);
+        }
+        if(!ok) {
+            printf("  ^ wrong\n");
+            failures++;
+        }
+    }
+
+    double avg_us = active_blocks ? active_cycles / (double)active_blocks / PROF_CYCLES_PER_US : 0.0;
+    double block_us = AUDIO_BLOCK_FRAMES * 1e6 / AUDIO_RATE_HZ;
+    printf("\nblocks %u: %u rendered, %u left silent; %u commands, %u dropped\n",
+           st.blocks, st.blocks - st.silent, st.silent, st.commands, st.dropped);
+    printf("rendered block: %.1f us average, %.1f us max, %.2f%% of a %.0f us block at %u MHz\n",
+           avg_us, st.max_cycles / (double)PROF_CYCLES_PER_US, 100.0 * avg_us / block_us, block_us,
+           PROF_CYCLES_PER_US);
+    if(path != NULL) {
+        printf("wrote %s, %u frames\n", path, sink.frames());
+    }
+    if(failures) {
+        printf("\n%u cues wrong\n", failures);
+    }
+    return failures ? 1 : 0;
+}
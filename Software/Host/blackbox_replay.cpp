@@ -0,0 +1,354 @@
+// ==================== BLACK-BOX REPLAY ====================
+// Plays a black-box recording (blackbox_codec.h) back through the unmodified
+// sampler, directive logic and auto-mode screen on the virtual clock. Each
+// recorded pass is made again at its recorded time from the samples the
+// live one took in, so the frames, and the directives decided from them,
+// come out as they did when recorded. The directives in the file are checked
+// against the replayed ones, and a digest of every frame is printed: the
+// same file always gives the same digest.
+//
+// Recordings come from approach_sim -b, or from the board: blackbox_stream()
+// over the serial port, turned back into a file by telemetry_decode -b.
+//
+//   blackbox_replay [-v] [-P] [-l] [-p file.ppm] recording.bbx
+//     -v         echo the firmware's serial output
+//     -P         no range STOP/SLOW, for recordings made that way
+//     -l         list the decoded records instead of replaying them
+//     -p file    write the final frame to file as a PPM
+
+#include "mbed.h"
+#include "marshalling.h"
+#include "hmi.h"
+#include "ui.h"
+#include "logger.h"
+#include "profiler.h"
+#include "blackbox_codec.h"
+#include "sim_lcd.h"
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#define REPLAY_LEAD_US      10000       // Virtual time for the screen to come up first
+#define REPLAY_SETTLE_US    200000      // And to finish drawing after the last pass
+
+typedef std::chrono::steady_clock host_clock;
+
+struct ReplayFile {
+    std::vector<BlackboxRecord> records;
+    uint32_t blocks;
+    uint32_t first_block;
+    uint32_t last_block;
+    uint32_t missing;           // Blocks absent by sequence number
+    uint32_t bytes;
+    uint32_t counts[BLACKBOX_AUTO + 1];
+};
+
+struct ReplayState {
+    size_t   next;              // First record not applied yet
+    uint32_t t0;                // Recorded time of the first pass
+    uint64_t v0;                // Virtual time it is replayed at
+    bool     done;
+    uint32_t passes;
+    uint32_t recorded_changes;
+    uint32_t replayed_changes;
+    uint32_t differing;
+    uint32_t digest;            // FNV-1a over the published frames
+};
+
+static ReplayFile  replay_file;
+static ReplayState replay;
+
+static const char* const record_names[] = {"?", "LDR", "IR", "ECHO", "PASS", "DIRECTIVE", "AUTO"};
+
+static bool load(const char* path, ReplayFile* rf) {
+    FILE* in = fopen(path, "rb");
+    if(in == NULL) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(in);
+
+    memset(rf->counts, 0, sizeof(rf->counts));
+    rf->blocks = rf->missing = 0;
+    rf->bytes = (uint32_t)data.size();
+    size_t at = 0;
+    uint8_t ir_level = 0xFF;
+    while(at < data.size()) {
+        BlackboxReader r;
+        BlackboxHeader h;
+        int rc = blackbox_open(&r, &data[at], data.size() - at, &h);
+        if(rc != BLACKBOX_OK) {
+            fprintf(stderr, "%s: bad block at byte %zu (error %d), stopping there\n", path, at, rc);
+            break;
+        }
+        if(rf->blocks == 0) {
+            rf->first_block = h.sequence;
+        } else if(h.sequence > rf->last_block + 1) {
+            rf->missing += h.sequence - rf->last_block - 1;
+        }
+        rf->last_block = h.sequence;
+        rf->blocks++;
+        at += BLACKBOX_HEADER_BYTES + h.used;
+
+        // Counted as recorded, not as restated at the top of a block
+        BlackboxRecord rec;
+        while((rc = blackbox_next(&r, &rec)) == 1) {
+            rf->records.push_back(rec);
+            if(rec.type == BLACKBOX_IR) {
+                if(rec.arg != ir_level) rf->counts[BLACKBOX_IR]++;
+                ir_level = rec.arg;
+            } else if(rec.type == BLACKBOX_ECHO) {
+                if(!(rec.arg & BLACKBOX_ECHO_HELD)) rf->counts[BLACKBOX_ECHO]++;
+            } else if(rec.type <= BLACKBOX_AUTO) {
+                rf->counts[rec.type]++;
+            }
+        }
+        if(rc != 0) {
+            fprintf(stderr, "%s: block %u: bad record, rest of the block skipped\n", path, h.sequence);
+        }
+    }
+    return rf->blocks > 0;
+}
+
+static void list(const ReplayFile& rf) {
+    for(size_t i = 0; i < rf.records.size(); i++) {
+        const BlackboxRecord& r = rf.records[i];
+        printf("%-9s", record_names[r.type <= BLACKBOX_AUTO ? r.type : 0]);
+        switch(r.type) {
+        case BLACKBOX_LDR:
+            printf(" %10u  %4u %4u %4u %4u %4u %4u\n", r.t_us, r.ldr[0], r.ldr[1], r.ldr[2], r.ldr[3], r.ldr[4], r.ldr[5]);
+            break;
+        case BLACKBOX_ECHO:
+            printf(" %10u  status %u%s  pulse %u us  trigger %u\n", r.t_us, r.arg & 0x07,
+                   (r.arg & BLACKBOX_ECHO_HELD) ? " held" : "", r.pulse_us, r.trigger_us);
+            break;
+        case BLACKBOX_PASS:
+            printf(" %10u  events 0x%x\n", r.t_us, r.arg);
+            break;
+        default:
+            printf("             %u\n", r.arg);
+            break;
+        }
+    }
+}
+
+// ==================== REPLAY ====================
+static inline uint32_t fnv1a(uint32_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for(size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619U;
+    }
+    return h;
+}
+
+// Recorded time on the firmware's clock, as the virtual clock runs now
+static inline uint32_t replay_time(uint32_t t_us) {
+    return (uint32_t)replay.v0 + (t_us - replay.t0);
+}
+
+static void digest_frame(const SensorFrame& f) {
+    uint32_t h = replay.digest;
+    h = fnv1a(h, f.ldr, sizeof(f.ldr));
+    h = fnv1a(h, f.ldr_level, sizeof(f.ldr_level));
+    h = fnv1a(h, &f.ldr_on, sizeof(f.ldr_on));
+    h = fnv1a(h, &f.lateral.deviation_q8, sizeof(f.lateral.deviation_q8));
+    h = fnv1a(h, &f.lateral.confidence, sizeof(f.lateral.confidence));
+    h = fnv1a(h, &f.ir, sizeof(f.ir));
+    h = fnv1a(h, &f.valid, sizeof(f.valid));
+    h = fnv1a(h, &f.distance_cm, sizeof(f.distance_cm));
+    h = fnv1a(h, &f.track_cm, sizeof(f.track_cm));
+    h = fnv1a(h, &f.closing_cm_s, sizeof(f.closing_cm_s));
+    h = fnv1a(h, &f.predicted_cm, sizeof(f.predicted_cm));
+    h = fnv1a(h, &f.range_zone, sizeof(f.range_zone));
+    uint8_t directive = current_directive;
+    replay.digest = fnv1a(h, &directive, sizeof(directive));
+}
+
+static void apply(const BlackboxRecord& r) {
+    switch(r.type) {
+    case BLACKBOX_LDR: {
+        LdrFrame f;
+        memcpy(f.raw, r.ldr, sizeof(f.raw));
+        f.timestamp_us = replay_time(r.t_us);
+        f.sequence = 0;
+        sensor_replay_ldr(f);
+        break;
+    }
+    case BLACKBOX_IR:
+        sensor_replay_ir(r.arg);
+        break;
+    case BLACKBOX_ECHO: {
+        UltrasonicMeasurement m;
+        m.status = r.arg & 0x07;
+        m.pulse_us = r.pulse_us;
+        m.distance_cm = (m.status == US_STATUS_OK) ? r.pulse_us * US_CM_PER_US : -1.0f;
+        m.trigger_us = replay_time(r.trigger_us);
+        m.complete_us = replay_time(r.t_us);
+        m.sequence = 0;
+        sensor_replay_echo(m, (r.arg & BLACKBOX_ECHO_HELD) != 0);
+        break;
+    }
+    case BLACKBOX_DIRECTIVE:
+        replay.recorded_changes++;
+        if(current_directive != r.arg) {
+            replay.differing++;
+        }
+        break;
+    case BLACKBOX_AUTO:
+        // What the operator did: automation started with this directive, or stopped
+        if(r.arg == BLACKBOX_AUTO_OFF) {
+            automation_active = false;
+        } else {
+            current_directive = r.arg;
+            automation_active = true;
+        }
+        break;
+    }
+}
+
+// The inputs recorded since the last pass, then the pass itself, at its
+// recorded time. Directives are checked as they come up: the ones the live
+// run decided from a pass follow it (perhaps after a new block has
+// restated the state), and nothing else changes them in between.
+static void replay_step() {
+    const std::vector<BlackboxRecord>& recs = replay_file.records;
+    while(replay.next < recs.size() && recs[replay.next].type != BLACKBOX_PASS) {
+        apply(recs[replay.next++]);
+    }
+    if(replay.next >= recs.size()) {
+        replay.done = true;
+        return;
+    }
+
+    const BlackboxRecord& pass = recs[replay.next++];
+    uint8_t before = current_directive;
+    bool active = automation_active;
+    sensor_replay_pass(pass.arg, replay_time(pass.t_us));
+    replay.passes++;
+    if(active && current_directive != before) {
+        replay.replayed_changes++;
+    }
+    SensorFrame f;
+    sensor_latest(&f);
+    digest_frame(f);
+
+    // Wake again for the next pass, or for whatever follows the last one
+    uint32_t at = pass.t_us;
+    for(size_t i = replay.next; i < recs.size(); i++) {
+        if(recs[i].type == BLACKBOX_PASS) {
+            at = recs[i].t_us;
+            break;
+        }
+    }
+    sim_schedule(replay.v0 + (uint32_t)(at - replay.t0), replay_step);
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    const char* ppm = NULL;
+    bool listing = false;
+    sim_serial_sink = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-v") == 0) {
+            sim_serial_sink = stdout;
+        } else if(strcmp(argv[i], "-P") == 0) {
+            range_directives = false;
+        } else if(strcmp(argv[i], "-l") == 0) {
+            listing = true;
+        } else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            ppm = argv[++i];
+        } else if(argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if(path == NULL) {
+        fprintf(stderr, "usage: %s [-v] [-P] [-l] [-p file.ppm] recording.bbx\n", argv[0]);
+        return 2;
+    }
+    if(!load(path, &replay_file)) {
+        fprintf(stderr, "%s: no readable blocks\n", path);
+        return 1;
+    }
+    if(listing) {
+        list(replay_file);
+        return 0;
+    }
+
+    const std::vector<BlackboxRecord>& recs = replay_file.records;
+    size_t first = 0;
+    while(first < recs.size() && recs[first].type != BLACKBOX_PASS) {
+        first++;
+    }
+    if(first == recs.size()) {
+        fprintf(stderr, "%s: no sampler passes recorded\n", path);
+        return 1;
+    }
+
+    prof_init();
+    sim_reset();
+    sim_touch_set(false, 0, 0);
+    lcd_init();
+    ui_start();
+    sensor_replay_begin();
+
+    Ticker log_tick;
+    log_tick.attach_us([]() { log_drain(); }, LOG_DRAIN_IDLE_MS * 1000);
+
+    memset(&replay, 0, sizeof(replay));
+    replay.t0 = recs[first].t_us;
+    replay.v0 = sim_now_us() + REPLAY_LEAD_US;
+    uint32_t span_us = recs.back().t_us - replay.t0;
+    for(size_t i = recs.size(); i-- > first; ) {
+        if(recs[i].type == BLACKBOX_PASS) {
+            span_us = recs[i].t_us - replay.t0;
+            break;
+        }
+    }
+    sim_schedule(replay.v0, replay_step);
+
+    host_clock::time_point wall_start = host_clock::now();
+    sim_lcd_reset_stats();
+    ui_queue.call([]() { ui_show(UI_SCREEN_AUTO); });
+    uint64_t settled = 0;
+    do {
+        ui_queue.dispatch(UI_TICK_MS);
+        if(replay.done && settled == 0) {
+            settled = sim_now_us() + REPLAY_SETTLE_US;
+        }
+    } while(settled == 0 || sim_now_us() < settled);
+    double wall_ms = std::chrono::duration_cast<std::chrono::microseconds>(host_clock::now() - wall_start).count() / 1e3;
+
+    if(ppm != NULL) {
+        sim_lcd_write_ppm(ppm);
+    }
+    log_tick.detach();
+    ui_stop();
+    log_drain();
+
+    const ReplayFile& rf = replay_file;
+    SimLcdStats ls = sim_lcd_stats();
+    printf("==================== BLACK-BOX REPLAY ====================\n");
+    printf("  file              %8u B   blocks %u (#%u-#%u), %u missing\n",
+           rf.bytes, rf.blocks, rf.first_block, rf.last_block, rf.missing);
+    printf("  recorded          %8.2f s   %u LDR frames, %u echoes, %u IR changes, %u passes\n",
+           span_us / 1e6, rf.counts[BLACKBOX_LDR], rf.counts[BLACKBOX_ECHO], rf.counts[BLACKBOX_IR],
+           rf.counts[BLACKBOX_PASS]);
+    printf("  replayed          %8u passes (host %.1f ms)\n", replay.passes, wall_ms);
+    printf("  directives        %8u recorded, %u replayed, %u differing\n",
+           replay.recorded_changes, replay.replayed_changes, replay.differing);
+    printf("  frame digest      %08x\n", replay.digest);
+    printf("  screen            %8llu flips, %llu draw calls\n",
+           (unsigned long long)ls.flips, (unsigned long long)ls.draw_calls);
+    return replay.differing == 0 && replay.recorded_changes == replay.replayed_changes ? 0 : 3;
+}
@@ -0,0 +1,196 @@
+// ==================== LDR FILTER BENCHMARK ====================
+// Feeds a synthetic six-channel LDR capture through ldr_filter.h. The capture
+// has slow light changes across the threshold, uniform noise and single-frame
+// spikes. The benchmark does two things:
+//  - golden check: the packed path must match the scalar reference bit for
+//    bit (on/off bits and IIR state after every frame);
+//  - cost: ns per six-channel frame for each path, and on/off transitions
+//    against the noise-free truth and a bare threshold.
+// Exits 1 on any mismatch.
+//
+//   ldr_filter_bench [-n frames]
+
+#include "ldr_filter.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define BENCH_FRAMES        (1u << 18)      // ~131 s at the 2 kHz scan rate
+#define BENCH_THRESHOLD     0.5f
+#define BENCH_HYSTERESIS    0.05f
+#define BENCH_NOISE         0.08f           // Uniform, +/- of full scale
+#define BENCH_SPIKE_ODDS    500             // One frame in N per channel
+
+typedef std::chrono::steady_clock bench_clock;
+
+static uint32_t bench_rng = 1;
+
+static uint32_t xorshift() {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return bench_rng;
+}
+
+// Each channel ramps between 0.2 and 0.8 with its own period, so every
+// channel crosses the threshold a few hundred times
+static float bench_truth(uint8_t ch, uint32_t i) {
+    uint32_t period = 1500 + 700 * ch;
+    uint32_t t = i % period;
+    float phase = (float)t / period;
+    float tri = phase < 0.5f ? phase * 2.0f : 2.0f - phase * 2.0f;
+    return 0.2f + 0.6f * tri;
+}
+
+static void bench_capture(std::vector<uint16_t>& raw, std::vector<uint8_t>& truth, uint32_t frames) {
+    raw.resize(frames * LDR_CHANNELS);
+    truth.resize(frames);
+    for(uint32_t i = 0; i < frames; i++) {
+        uint8_t bits = 0;
+        for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+            float v = bench_truth(ch, i);
+            if(v > BENCH_THRESHOLD) bits |= 1 << ch;
+            v += BENCH_NOISE * ((xorshift() >> 8) * (2.0f / 16777216.0f) - 1.0f);
+            if(xorshift() % BENCH_SPIKE_ODDS == 0) {
+                v = (v > BENCH_THRESHOLD) ? 0.0f : 1.0f;    // Dropout or glint
+            }
+            if(v < 0.0f) v = 0.0f;
+            if(v > 1.0f) v = 1.0f;
+            raw[i * LDR_CHANNELS + ch] = (uint16_t)(v * LDR_ADC_FULL_SCALE);
+        }
+        truth[i] = bits;
+    }
+}
+
+static uint32_t count_transitions(uint8_t prev, uint8_t bits) {
+    return (uint32_t)__builtin_popcount(prev ^ bits);
+}
+
+typedef uint8_t (*filter_fn)(LdrFilter*, const uint16_t*, uint32_t);
+
+// Best of three passes, in DMA half-buffer blocks as the sampler sees them
+static double bench_time(filter_fn fn, const LdrFilterConfig& cfg, const uint16_t* raw, uint32_t frames) {
+    double best = 0.0;
+    for(int pass = 0; pass < 3; pass++) {
+        LdrFilter f;
+        ldr_filter_init(&f, cfg);
+        volatile uint8_t sink = 0;
+        bench_clock::time_point t0 = bench_clock::now();
+        for(uint32_t i = 0; i < frames; i += LDR_DMA_HALF_FRAMES) {
+            uint32_t n = (frames - i < LDR_DMA_HALF_FRAMES) ? frames - i : LDR_DMA_HALF_FRAMES;
+            sink = sink ^ fn(&f, raw + i * LDR_CHANNELS, n);
+        }
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - t0).count();
+        if(pass == 0 || ns < best) best = ns;
+    }
+    return best / frames;
+}
+
+int main(int argc, char** argv) {
+    uint32_t frames = BENCH_FRAMES;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            frames = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(frames == 0) {
+        frames = BENCH_FRAMES;
+    }
+
+    std::vector<uint16_t> raw;
+    std::vector<uint8_t> truth;
+    bench_capture(raw, truth, frames);
+
+    // Noise-free and bare-threshold transition counts for comparison
+    uint32_t truth_transitions = 0;
+    uint32_t bare_transitions = 0;
+    uint8_t bare_prev = 0;
+    uint16_t bare_th = (uint16_t)(BENCH_THRESHOLD * LDR_ADC_FULL_SCALE);
+    for(uint32_t i = 0; i < frames; i++) {
+        uint8_t bits = 0;
+        for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+            if(raw[i * LDR_CHANNELS + ch] > bare_th) bits |= 1 << ch;
+        }
+        if(i > 0) {
+            truth_transitions += count_transitions(truth[i - 1], truth[i]);
+            bare_transitions += count_transitions(bare_prev, bits);
+        }
+        bare_prev = bits;
+    }
+
+    printf("==================== LDR FILTER BENCHMARK ====================\n");
+    printf("%u frames x %d channels, noise +/-%.2f, spikes 1/%d\n",
+           frames, LDR_CHANNELS, BENCH_NOISE, BENCH_SPIKE_ODDS);
+    printf("transitions: truth %u, bare threshold %u\n\n", truth_transitions, bare_transitions);
+    printf("median  alpha   transitions  lag ms   ref ns/frame  packed ns/frame  golden\n");
+
+    static const uint8_t medians[] = { 1, 3, 5 };
+    static const uint16_t alphas[] = { 32767, 8192, 4096, 1024 };
+    uint32_t failures = 0;
+
+    for(size_t mi = 0; mi < sizeof(medians); mi++) {
+        for(size_t ai = 0; ai < sizeof(alphas) / sizeof(alphas[0]); ai++) {
+            LdrFilterConfig cfg = ldr_filter_config(BENCH_THRESHOLD, BENCH_HYSTERESIS);
+            cfg.median = medians[mi];
+            cfg.alpha_q15 = alphas[ai];
+
+            // Golden check, frame by frame
+            LdrFilter ref, packed;
+            ldr_filter_init(&ref, cfg);
+            ldr_filter_init(&packed, cfg);
+            uint32_t mismatches = 0;
+            uint32_t transitions = 0;
+            uint64_t lag_frames = 0;
+            uint32_t lag_count = 0;
+            uint8_t prev = 0;
+            uint32_t truth_at[LDR_CHANNELS];
+            uint8_t pending = 0;
+            memset(truth_at, 0, sizeof(truth_at));
+            for(uint32_t i = 0; i < frames; i++) {
+                uint8_t a = ldr_filter_run_ref(&ref, &raw[i * LDR_CHANNELS], 1);
+                uint8_t b = ldr_filter_run(&packed, &raw[i * LDR_CHANNELS], 1);
+                if(a != b || memcmp(ref.state, packed.state, sizeof(ref.state)) != 0) {
+                    if(mismatches == 0) {
+                        printf("  first mismatch at frame %u: ref 0x%02x packed 0x%02x\n", i, a, b);
+                    }
+                    mismatches++;
+                }
+
+                // Lag: truth edge to the first filtered output that agrees
+                for(uint8_t ch = 0; ch < LDR_CHANNELS && i > 0; ch++) {
+                    uint8_t bit = 1 << ch;
+                    if((truth[i] ^ truth[i - 1]) & bit) {
+                        truth_at[ch] = i;
+                        pending |= bit;
+                    }
+                    if((pending & bit) && ((a ^ truth[i]) & bit) == 0) {
+                        lag_frames += i - truth_at[ch];
+                        lag_count++;
+                        pending &= ~bit;
+                    }
+                }
+                if(i > 0) transitions += count_transitions(prev, a);
+                prev = a;
+            }
+
+            double ref_ns = bench_time(ldr_filter_run_ref, cfg, &raw[0], frames);
+            double packed_ns = bench_time(ldr_filter_run, cfg, &raw[0], frames);
+            double lag_ms = lag_count ? lag_frames * 1000.0 / lag_count / LDR_SCAN_RATE_HZ : 0.0;
+
+            printf("   %u    %5u   %9u   %6.2f   %10.1f   %12.1f     %s\n",
+                   cfg.median, cfg.alpha_q15, transitions, lag_ms, ref_ns, packed_ns,
+                   mismatches ? "FAIL" : "ok");
+            if(mismatches) failures++;
+        }
+    }
+
+    LdrFilterConfig def = ldr_filter_config(BENCH_THRESHOLD, BENCH_HYSTERESIS);
+    printf("\nfirmware default: median %u, alpha %u, band %u..%u raw\n",
+           def.median, def.alpha_q15, def.off_raw, def.on_raw);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,291 @@
+// ==================== SCREEN MIRROR BENCHMARK ====================
+// Runs the firmware's UI with the screen mirror (mirror.h) on, sending into
+// the telemetry stream alongside the sensor records, and rebuilds the
+// screen from the stream the way telemetry_decode -m does. Two phases:
+// auto mode over an aircraft approach (the directive screens) and the
+// diagnostics screen, whose figures change every tick.
+//
+// Every BENCH_CHECK_MS the UI is held while the mirror catches up, and the
+// rebuilt picture must then equal the panel (in RGB565) pixel for pixel.
+// Per phase it reports the frames presented and mirrored per second, the
+// bytes on the wire against MIRROR_BYTES_PER_S, the compression against raw
+// RGB565 and what a capture costs the UI per presented frame.
+// Exits 1 on a mismatch, a rate over budget or a mirror slower than
+// BENCH_MIN_FPS on the directive screens.
+//
+//   mirror_bench [-p prefix]
+//     -p prefix  write the last check's panel and mirror to
+//                <prefix>lcd.ppm and <prefix>mirror.ppm
+
+#include "mbed.h"
+#include "marshalling.h"
+#include "hmi.h"
+#include "ui.h"
+#include "telemetry.h"
+#include "logger.h"
+#include "profiler.h"
+#include "mirror.h"
+#include "sim_lcd.h"
+#include "approach.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_CHECK_MS          1000
+#define BENCH_CATCHUP_MS        10000       // Longest a catch-up may take
+#define BENCH_DIAG_MS           5000
+#define BENCH_TIMEOUT_MS        60000
+#define BENCH_DWELL_MS          1000        // Parked this long ends the approach
+#define BENCH_MIN_FPS           5.0
+
+static const ApproachScenario bench_scenario =
+    {"offset-port", 300.0f, 15.0f, 40.0f, 60.0f, 4.5f, 0.0f, 1.5f, 600.0f, 0.10f, 0.02f, 0.0f, 2};
+
+// ==================== STREAM DECODER ====================
+struct BenchView {
+    FILE*    wire;
+    long     read_to;
+    uint8_t  frame[256];
+    size_t   len;
+    uint32_t tiles;
+    uint32_t bad;
+    uint16_t pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+};
+
+static BenchView view;
+
+// Takes whatever the firmware has written since the last call
+static void bench_decode() {
+    fflush(view.wire);
+    fseek(view.wire, view.read_to, SEEK_SET);
+    int c;
+    while((c = fgetc(view.wire)) != EOF) {
+        view.read_to++;
+        if(c != 0) {
+            if(view.len < sizeof(view.frame)) {
+                view.frame[view.len++] = (uint8_t)c;
+            }
+            continue;
+        }
+        uint8_t raw[sizeof(view.frame)];
+        size_t n = view.len ? cobs_decode(view.frame, view.len, raw) : 0;
+        view.len = 0;
+        TelemetryMirror m;
+        if(n == 0 || telemetry_type(raw, n) != TELEMETRY_RECORD_MIRROR) {
+            continue;
+        }
+        if(telemetry_unpack_mirror(raw, n, &m) != TELEMETRY_OK ||
+           mirror_apply(m.data, m.len, m.x, m.y, m.w, m.h, view.pixels, DISPLAY_WIDTH, DISPLAY_HEIGHT) != MIRROR_OK) {
+            view.bad++;
+        } else {
+            view.tiles++;
+        }
+    }
+    fseek(view.wire, 0, SEEK_END);
+}
+
+static void bench_write_ppm(const char* path, const uint16_t* px) {
+    FILE* f = fopen(path, "wb");
+    if(f == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    for(int i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; i++) {
+        uint8_t rgb[3] = {
+            (uint8_t)((px[i] >> 8) & 0xF8), (uint8_t)((px[i] >> 3) & 0xFC), (uint8_t)(px[i] << 3)
+        };
+        fwrite(rgb, 1, 3, f);
+    }
+    fclose(f);
+}
+
+// ==================== PHASES ====================
+struct BenchPhase {
+    const char* name;
+    uint64_t    ui_us;          // Virtual time with the UI running
+    uint32_t    flips;
+    uint32_t    frames;
+    uint32_t    bytes;
+    uint32_t    sent_px;
+    uint32_t    captures;
+    uint32_t    capture_cycles;
+    uint32_t    max_capture_cycles;
+    uint32_t    checks;
+    uint32_t    mismatched_px;
+    uint32_t    max_catchup_ms;
+};
+
+static const char* bench_prefix = NULL;
+
+// Holds the UI, lets the mirror drain, then compares. One sender period
+// at least, so the last frame presented has reached the panel too.
+static void bench_check(BenchPhase& p) {
+    uint64_t start = sim_now_us();
+    do {
+        sim_advance_us(MIRROR_PERIOD_MS * 1000);
+    } while(!mirror_idle() && sim_now_us() - start < BENCH_CATCHUP_MS * 1000ULL);
+    uint32_t ms = (uint32_t)((sim_now_us() - start) / 1000);
+    if(ms > p.max_catchup_ms) {
+        p.max_catchup_ms = ms;
+    }
+    bench_decode();
+
+    static uint16_t lcd[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+    const uint32_t* panel = sim_lcd_pixels();
+    for(int i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; i++) {
+        lcd[i] = mirror_rgb565(panel[i]);
+        if(lcd[i] != view.pixels[i]) {
+            p.mismatched_px++;
+        }
+    }
+    p.checks++;
+    if(bench_prefix != NULL) {
+        char path[256];
+        snprintf(path, sizeof(path), "%slcd.ppm", bench_prefix);
+        bench_write_ppm(path, lcd);
+        snprintf(path, sizeof(path), "%smirror.ppm", bench_prefix);
+        bench_write_ppm(path, view.pixels);
+    }
+}
+
+// Runs the UI for ms, counting only what happens while it runs
+static void bench_run(BenchPhase& p, uint32_t ms) {
+    MirrorStats before = mirror_stats();
+    uint32_t flips = display_flips();
+    uint64_t start = sim_now_us();
+    ui_queue.dispatch((int)ms);
+    MirrorStats after = mirror_stats();
+    p.ui_us += sim_now_us() - start;
+    p.flips += display_flips() - flips;
+    p.frames += after.frames - before.frames;
+    p.bytes += after.bytes - before.bytes;
+    p.sent_px += after.sent_px - before.sent_px;
+    p.captures += after.captures - before.captures;
+    p.capture_cycles += after.capture_cycles - before.capture_cycles;
+    if(after.max_capture_cycles > p.max_capture_cycles) {
+        p.max_capture_cycles = after.max_capture_cycles;
+    }
+}
+
+static uint32_t print_phase(const BenchPhase& p, bool directive) {
+    double secs = p.ui_us / 1e6;
+    double fps = secs > 0 ? p.frames / secs : 0.0;
+    double rate = secs > 0 ? p.bytes / secs : 0.0;
+    printf("%-6s %6.1f  %7.1f  %8.1f  %7.0f  %6.1fx  %8.1f  %7.1f  %6u  %6u  %10u\n", p.name, secs,
+           secs > 0 ? p.flips / secs : 0.0, fps, rate, p.bytes ? p.sent_px * 2.0 / p.bytes : 0.0,
+           p.captures ? p.capture_cycles / (double)p.captures / PROF_CYCLES_PER_US : 0.0,
+           p.max_capture_cycles / (double)PROF_CYCLES_PER_US, p.checks, p.mismatched_px, p.max_catchup_ms);
+
+    uint32_t failures = 0;
+    if(p.mismatched_px != 0) {
+        printf("  ^ mirror differs from the panel\n");
+        failures++;
+    }
+    if(rate > MIRROR_BYTES_PER_S * 1.05) {
+        printf("  ^ over the %u B/s budget\n", MIRROR_BYTES_PER_S);
+        failures++;
+    }
+    if(directive && fps < BENCH_MIN_FPS) {
+        printf("  ^ under %.0f mirror frames/s\n", BENCH_MIN_FPS);
+        failures++;
+    }
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            bench_prefix = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-p ppm_prefix]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("==================== SCREEN MIRROR BENCHMARK ====================\n");
+    printf("%u B/s budget, sender every %u ms, %u px tiles, telemetry %u Hz alongside\n\n", MIRROR_BYTES_PER_S,
+           MIRROR_PERIOD_MS, MIRROR_TILE_W, TELEMETRY_RATE_HZ);
+
+    view.wire = tmpfile();
+    if(view.wire == NULL) {
+        perror("tmpfile");
+        return 1;
+    }
+    sim_serial_sink = view.wire;
+
+    sim_reset();
+    sim_touch_set(false, 0, 0);
+    lcd_init();
+    telemetry_init(TELEMETRY_RATE_HZ);
+    mirror_start();
+
+    approach_begin(bench_scenario);
+    ldr_scan.start(&approach_ldr_source());
+    ranger.start(US_DEFAULT_PERIOD_MS);
+    sensor_sampler_start();
+    ui_start();
+
+    Ticker log_tick;
+    log_tick.attach_us([]() { log_drain(); }, LOG_DRAIN_IDLE_MS * 1000);
+    Ticker telemetry_tick;
+    telemetry_tick.attach_us(telemetry_sample, 1000000 / TELEMETRY_RATE_HZ);
+    prof_reset();
+
+    BenchPhase auto_phase, diag_phase;
+    memset(&auto_phase, 0, sizeof(auto_phase));
+    memset(&diag_phase, 0, sizeof(diag_phase));
+    auto_phase.name = "auto";
+    diag_phase.name = "diag";
+
+    // The approach, until the aircraft has been parked a while
+    ui_queue.call([]() { ui_show(UI_SCREEN_AUTO); });
+    uint64_t halted_since = 0;
+    while(auto_phase.ui_us < BENCH_TIMEOUT_MS * 1000ULL) {
+        bench_run(auto_phase, BENCH_CHECK_MS);
+        bench_check(auto_phase);
+        const ApproachState& st = approach_state();
+        if(!st.halted) {
+            halted_since = 0;
+        } else if(halted_since == 0) {
+            halted_since = sim_now_us();
+        } else if(sim_now_us() - halted_since >= BENCH_DWELL_MS * 1000ULL) {
+            break;
+        }
+    }
+
+    ui_queue.call([]() { stop_automation(); ui_show(UI_SCREEN_DIAG); });
+    for(uint32_t ms = 0; ms < BENCH_DIAG_MS; ms += BENCH_CHECK_MS) {
+        bench_run(diag_phase, BENCH_CHECK_MS);
+        bench_check(diag_phase);
+    }
+
+    telemetry_tick.detach();
+    ui_stop();
+    mirror_stop();
+    log_drain();
+    log_tick.detach();
+    sensor_sampler_stop();
+    ranger.stop();
+    ldr_scan.stop();
+    approach_end();
+    sim_serial_sink = NULL;
+
+    printf("screen   secs  flips/s  mirror/s      B/s   vs raw  capt. us   max us  checks  bad px  catchup ms\n");
+    uint32_t failures = print_phase(auto_phase, true);
+    failures += print_phase(diag_phase, false);
+
+    MirrorStats ms = mirror_stats();
+    TelemetryStats ts = telemetry_stats();
+    printf("\n%u mirror frames in %u tiles (%u decoded, %u bad), %u of them late\n", ms.frames, ms.tiles,
+           view.tiles, view.bad, ms.late);
+    printf("telemetry: %u records, %u dropped alongside the mirror\n", ts.records, ts.dropped);
+    if(view.bad != 0 || view.tiles != ms.tiles) {
+        printf("tiles lost or malformed\n");
+        failures++;
+    }
+    fclose(view.wire);
+    if(failures) {
+        printf("\n%u failures\n", failures);
+    }
+    return failures ? 1 : 0;
+}
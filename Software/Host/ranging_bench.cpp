@@ -0,0 +1,174 @@
+// ==================== MULTI-SENSOR RANGING BENCHMARK ====================
+// Runs RangerArray (ranging.h) against simulated HC-SR04s that share the
+// air (sim_sonar.h) while a target approaches and sways across the line.
+// The sensors always hear each other. The same approach runs under three
+// schedules:
+//  - together:  the scheduler is told the sensors are isolated, so they all
+//               fire at once, as independent rangers would;
+//  - fixed:     staggered, one slot every US_DEFAULT_PERIOD_MS;
+//  - pipelined: staggered, each slot as soon as the last one's echoes are in.
+// For each one it reports the burst and echo rates, crosstalk (echoes more
+// than BENCH_WRONG_CM off the sensor's true range), how many of those got
+// past the fusion's confirmation, and the fused forward/lateral error.
+// Exits 1 if a staggered schedule let crosstalk through.
+//
+//   ranging_bench [-s seconds] [-n sensors]
+
+#include "mbed.h"
+#include "ranging.h"
+#include "sim_sonar.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SECONDS       12
+#define BENCH_SPACING_CM    120.0f          // Between neighbouring sensors
+#define BENCH_START_CM      450.0f          // Target out of range at first
+#define BENCH_STOP_CM       40.0f
+#define BENCH_SPEED_CM_S    50.0f
+#define BENCH_SWAY_CM       60.0f
+#define BENCH_SWAY_S        6.0f
+#define BENCH_WRONG_CM      5.0f
+
+// Same pins as the board's array (marshalling.cpp)
+static const PinName bench_trig[RANGER_MAX] = {D6, D15, D10, D1};
+static const PinName bench_echo[RANGER_MAX] = {D5, D14, D9, D0};
+
+struct BenchRun {
+    uint32_t echoes;
+    uint32_t wrong;                         // Crosstalk
+    uint32_t wrong_passed;                  // ...confirmed by the fusion
+    uint32_t fused;
+    double   fwd_sq;
+    double   fwd_max;
+    double   lat_sq;
+    uint32_t lat_n;
+};
+
+static BenchRun       run;
+static SimSonarField* bench_field = NULL;
+static RangerArray*   bench_array = NULL;
+static bool           bench_wrong_last = false;  // The echo the fusion is taking now
+
+static void bench_target(uint32_t t_us, float* x, float* y, void*) {
+    float t = t_us / 1e6f;
+    float d = BENCH_START_CM - BENCH_SPEED_CM_S * t;
+    *y = d > BENCH_STOP_CM ? d : BENCH_STOP_CM;
+    *x = BENCH_SWAY_CM * sinf(6.2832f * t / BENCH_SWAY_S);
+}
+
+// Every sensor result, before the fusion sees it
+static void bench_sensor(void*, uint8_t sensor, const UltrasonicMeasurement& m) {
+    bench_wrong_last = false;
+    if(m.status != US_STATUS_OK) {
+        return;
+    }
+    run.echoes++;
+    float truth = bench_field->range_cm(sensor, m.trigger_us + SIM_SONAR_BURST_US);
+    if(fabsf(m.distance_cm - truth) > BENCH_WRONG_CM) {
+        run.wrong++;
+        bench_wrong_last = true;
+    }
+}
+
+// Fused results: one per confirmed echo, straight after bench_sensor saw it
+static void bench_fused(const UltrasonicMeasurement& m) {
+    if(m.status != US_STATUS_OK) {
+        return;
+    }
+    run.fused++;
+    if(bench_wrong_last) {
+        run.wrong_passed++;
+    }
+    RangingFix f;
+    bench_array->fix(&f);
+    float x, y;
+    bench_target(m.complete_us, &x, &y, NULL);
+    double e = fabs(f.forward_cm - y);
+    run.fwd_sq += e * e;
+    if(e > run.fwd_max) run.fwd_max = e;
+    if(f.valid & RANGING_FIX_LATERAL) {
+        run.lat_sq += (f.lateral_cm - x) * (f.lateral_cm - x);
+        run.lat_n++;
+    }
+}
+
+// Returns the crosstalk echoes the fusion let through
+static uint32_t bench_run(const char* name, uint8_t n, bool stagger, uint32_t slot_ms, uint32_t seconds) {
+    sim_reset();
+    memset(&run, 0, sizeof(run));
+    bench_wrong_last = false;
+
+    SimSonar sonars[RANGER_MAX];
+    RangerConfig config[RANGER_MAX];
+    RangerPort* ports[RANGER_MAX];
+    for(uint8_t i = 0; i < n; i++) {
+        float x = (i - (n - 1) / 2.0f) * BENCH_SPACING_CM;
+        sonars[i].trig = bench_trig[i];
+        sonars[i].echo = bench_echo[i];
+        sonars[i].x_cm = x;
+        sonars[i].hears = 0xFF;
+        config[i].x_cm = x;
+        config[i].hears = stagger ? 0xFF : 0;
+        ports[i] = new RangerPort(bench_trig[i], bench_echo[i]);
+    }
+
+    SimSonarField field(sonars, n, bench_target, NULL);
+    RangerArray array(ports, config, n);
+    bench_field = &field;
+    bench_array = &array;
+    array.attach(bench_fused);
+    array.attach_sensor(bench_sensor, NULL);
+
+    field.begin();
+    array.start(slot_ms);
+    sim_advance_to((uint64_t)seconds * 1000000);
+    array.stop();
+    field.end();
+
+    RangingStats st = array.stats();
+    double lat_rms = run.lat_n ? sqrt(run.lat_sq / run.lat_n) : 0.0;
+    double fwd_rms = run.fused ? sqrt(run.fwd_sq / run.fused) : 0.0;
+    printf("%-10s %5u  %7.1f  %8.1f  %7.1f  %9u  %6u  %7.1f  %7.1f  %7.1f  %7u\n",
+           name, array.scheduler().slots(), (double)field.bursts() / seconds,
+           (double)run.echoes / seconds, (double)run.fused / seconds, run.wrong, run.wrong_passed,
+           fwd_rms, run.fwd_max, lat_rms, st.skipped);
+
+    for(uint8_t i = 0; i < n; i++) {
+        delete ports[i];
+    }
+    bench_field = NULL;
+    bench_array = NULL;
+    return run.wrong_passed;
+}
+
+int main(int argc, char** argv) {
+    uint32_t seconds = BENCH_SECONDS;
+    uint32_t n = 3;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-s seconds] [-n sensors]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(seconds == 0) seconds = BENCH_SECONDS;
+    if(n < 2 || n > RANGER_MAX) n = 3;
+
+    printf("==================== MULTI-SENSOR RANGING BENCHMARK ====================\n");
+    printf("%u sensors %.0f cm apart, target %.0f -> %.0f cm at %.0f cm/s swaying +/-%.0f cm, %u s\n\n",
+           n, BENCH_SPACING_CM, BENCH_START_CM, BENCH_STOP_CM, BENCH_SPEED_CM_S, BENCH_SWAY_CM, seconds);
+    printf("schedule   slots  burst/s  echoes/s  fused/s  crosstalk  passed  fwd rms  fwd max  lat rms  skipped\n");
+
+    bench_run("together", (uint8_t)n, false, 0, seconds);
+    uint32_t passed = bench_run("fixed", (uint8_t)n, true, US_DEFAULT_PERIOD_MS, seconds);
+    passed += bench_run("pipelined", (uint8_t)n, true, 0, seconds);
+    if(passed) {
+        printf("\n%u crosstalk echoes got through a staggered schedule\n", passed);
+    }
+    return passed ? 1 : 0;
+}
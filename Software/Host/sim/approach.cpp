@@ -0,0 +1,229 @@
+#include "approach.h"
+#include "mbed.h"
+#include "marshalling.h"
+#include <math.h>
+#include <string.h>
+#include <deque>
+#include <utility>
+
+// ==================== WORLD STATE ====================
+static ApproachScenario world_sc;
+static ApproachState    world;
+static uint32_t         world_rng;
+static uint32_t         world_tick_handle = 0;
+static std::deque<std::pair<uint64_t, uint8_t> > world_seen;   // (time, directive)
+static uint64_t         world_pending_since = 0;
+static bool             world_pending = false;
+
+static float world_noise() {
+    // xorshift32, uniform in [-1, 1)
+    world_rng ^= world_rng << 13;
+    world_rng ^= world_rng >> 17;
+    world_rng ^= world_rng << 5;
+    return (world_rng >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+float approach_ldr_level(const ApproachScenario& sc, uint8_t ch, float lateral_cm) {
+    if(ch > 4) {
+        return sc.ambient;     // A5 is not on the alignment row
+    }
+    float pos = (2 - (int)ch) * APPROACH_LDR_SPACING_CM;   // A0 = +2s .. A4 = -2s
+    float d = pos - lateral_cm;
+    float level = sc.ambient + APPROACH_SPOT_PEAK *
+                  expf(-(d * d) / (2.0f * APPROACH_SPOT_SIGMA_CM * APPROACH_SPOT_SIGMA_CM));
+    return level > 1.0f ? 1.0f : level;
+}
+
+static uint16_t world_ldr_generator(uint8_t channel, uint32_t, void*) {
+    float v = approach_ldr_level(world_sc, channel, world.lateral_cm) + world_sc.noise * world_noise();
+    if(v < 0.0f) v = 0.0f;
+    if(v > 1.0f) v = 1.0f;
+    return (uint16_t)(v * LDR_ADC_FULL_SCALE);
+}
+
+static SyntheticLdrSource world_ldr(world_ldr_generator, NULL);
+
+// The firmware's own decision on noise-free levels and the IR line, with
+// no range directives (those depend on the pilot, not the geometry)
+static uint8_t world_ideal_directive() {
+    SensorFrame f;
+    memset(&f, 0, sizeof(f));
+    for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+        f.ldr_level[ch] = (uint16_t)(approach_ldr_level(world_sc, ch, world.lateral_cm) * LDR_ADC_FULL_SCALE);
+    }
+    f.lateral = lateral_estimate(f.ldr_level, lateral_cal);
+    f.ir = world.ir_tripped ? 0 : 1;
+    f.valid = SENSOR_VALID_LDR | SENSOR_VALID_IR;
+    return determine_direction_from_sensors(f, world.ideal_directive);
+}
+
+// Directive the pilot is acting on: what was displayed reaction_ms ago
+static uint8_t world_pilot_directive() {
+    uint64_t horizon = world.t_us > (uint64_t)(world_sc.reaction_ms * 1000.0f)
+                     ? world.t_us - (uint64_t)(world_sc.reaction_ms * 1000.0f) : 0;
+    uint8_t d = DIRECTIVE_NONE;
+    while(!world_seen.empty() && world_seen.front().first <= horizon) {
+        d = world_seen.front().second;
+        if(world_seen.size() > 1 && world_seen[1].first <= horizon) {
+            world_seen.pop_front();
+        } else {
+            break;
+        }
+    }
+    return d;
+}
+
+// ==================== PHYSICS TICK (1 ms) ====================
+static void world_tick() {
+    const float dt = 0.001f;
+    world.t_us = sim_now_us();
+
+    // Outside auto mode the pilot judges the stop line from the distance
+    // readout instead, which is the same as acting on the ideal directive
+    uint8_t shown = current_directive;
+    uint8_t cue = (shown == DIRECTIVE_NONE) ? world.ideal_directive : shown;
+    if(world_seen.empty() || world_seen.back().second != cue) {
+        world_seen.push_back(std::make_pair(world.t_us, cue));
+    }
+    uint8_t acting = world_pilot_directive();
+
+    // Longitudinal: taxi until STOP is seen, then brake; SLOW brakes down
+    // to a crawl
+    if(acting == DIRECTIVE_STOP && world.speed_cm_s > 0.0f) {
+        world.speed_cm_s -= world_sc.brake_cm_s2 * dt;
+        if(world.speed_cm_s < 0.0f) world.speed_cm_s = 0.0f;
+    }
+    if(acting == DIRECTIVE_SLOW && world.speed_cm_s > APPROACH_SLOW_TAXI_CM_S) {
+        world.speed_cm_s -= world_sc.brake_cm_s2 * dt;
+        if(world.speed_cm_s < APPROACH_SLOW_TAXI_CM_S) world.speed_cm_s = APPROACH_SLOW_TAXI_CM_S;
+    }
+    bool was_halted = world.halted;
+    world.distance_cm -= world.speed_cm_s * dt;
+    world.halted = world.speed_cm_s <= 0.0f;
+
+    // Lateral: drift plus correction on TURN directives
+    float lat_v = world_sc.lateral_drift_cm_s;
+    if(acting == DIRECTIVE_RIGHT) lat_v -= world_sc.steer_cm_s;
+    if(acting == DIRECTIVE_LEFT) lat_v += world_sc.steer_cm_s;
+    if(acting == DIRECTIVE_SLIGHT_RIGHT) lat_v -= world_sc.steer_cm_s * 0.5f;
+    if(acting == DIRECTIVE_SLIGHT_LEFT) lat_v += world_sc.steer_cm_s * 0.5f;
+    if(!world.halted) {
+        world.lateral_cm += lat_v * dt;
+    }
+
+    if(world.halted && !was_halted) {
+        world.overshoot_cm = world_sc.stop_distance_cm - world.distance_cm;
+    }
+
+    bool tripped = world.distance_cm <= world_sc.stop_distance_cm;
+    if(tripped != world.ir_tripped) {
+        world.ir_tripped = tripped;
+        if(tripped) world.ir_trip_us = world.t_us;
+        sim_pin_set(D8, tripped ? 0 : 1);   // Active low
+    }
+
+    // Sensor edges above may have changed the directive already
+    shown = current_directive;
+    if(shown == DIRECTIVE_STOP && world.stop_shown_us < 0) {
+        world.stop_shown_us = (int64_t)world.t_us;
+        world.stop_shown_cm = world.distance_cm - world_sc.stop_distance_cm;
+    }
+    if(shown == DIRECTIVE_SLOW) {
+        world.slow_shown_us += 1000;
+    }
+    if(!world.stop_known && world.stop_shown_us >= 0 && world.ir_tripped) {
+        world.stop_latency_us = world.stop_shown_us - (int64_t)world.ir_trip_us;
+        world.stop_known = true;
+    }
+
+    // The ideal only knows the LDR and IR rules. SLOW stands in for straight
+    // and slight turns, which it outranks; a range STOP before the trip
+    // overrides whatever was pending.
+    uint8_t ideal = world_ideal_directive();
+    if(ideal != world.ideal_directive) {
+        world.ideal_directive = ideal;
+        world_pending = true;
+        world_pending_since = world.t_us;
+    }
+    bool slow_covers = (shown == DIRECTIVE_SLOW) &&
+                       (ideal == DIRECTIVE_STRAIGHT || ideal == DIRECTIVE_SLIGHT_LEFT ||
+                        ideal == DIRECTIVE_SLIGHT_RIGHT);
+    if(shown == DIRECTIVE_STOP && !world.ir_tripped) {
+        world_pending = false;
+    }
+    if(world_pending && (shown == ideal || slow_covers)) {
+        uint32_t lat = (uint32_t)(world.t_us - world_pending_since);
+        world.decisions++;
+        world.latency_sum_us += lat;
+        if(lat > world.latency_max_us) world.latency_max_us = lat;
+        world_pending = false;
+    }
+
+    // LDR DMA half-buffer cadence: 8 frames at 2 kHz = 4 ms
+    if((world.t_us / 1000) % 4 == 0) {
+        world_ldr.pump((uint32_t)world.t_us);
+    }
+
+    world_tick_handle = sim_schedule(world.t_us + 1000, world_tick);
+}
+
+// ==================== HC-SR04 ECHO MODEL ====================
+static void world_on_trigger(int level) {
+    if(level != 0) {
+        return;     // Echo burst starts on the trigger's falling edge
+    }
+    uint64_t now = sim_now_us();
+    float d = world.distance_cm + APPROACH_ECHO_JITTER_CM * world_noise();
+    if(world_sc.ghosts > 0.0f && (world_noise() + 1.0f) * 0.5f < world_sc.ghosts) {
+        d = 20.0f + 60.0f * (world_noise() + 1.0f);     // Something else answered
+    }
+    uint32_t pulse_us = (d >= US_MIN_RANGE_CM && d <= US_MAX_RANGE_CM)
+                      ? (uint32_t)(d / US_CM_PER_US) : APPROACH_NO_ECHO_US;
+    uint64_t rise_at = now + APPROACH_ECHO_DELAY_US;
+    sim_schedule(rise_at, []() { sim_pin_set(D5, 1); });
+    sim_schedule(rise_at + pulse_us, []() { sim_pin_set(D5, 0); });
+}
+
+// ==================== LIFECYCLE ====================
+void approach_begin(const ApproachScenario& sc) {
+    world_sc = sc;
+    world_rng = sc.seed ? sc.seed : 1;
+    world_seen.clear();
+
+    world.t_us = sim_now_us();
+    world.distance_cm = sc.start_distance_cm;
+    world.lateral_cm = sc.lateral_start_cm;
+    world.speed_cm_s = sc.speed_cm_s;
+    world.ir_tripped = false;
+    world.halted = false;
+    world.ideal_directive = DIRECTIVE_NONE;
+    world.decisions = 0;
+    world.latency_sum_us = 0;
+    world.latency_max_us = 0;
+    world.ir_trip_us = 0;
+    world.stop_shown_us = -1;
+    world.stop_shown_cm = 0.0f;
+    world.stop_latency_us = -1;
+    world.stop_known = false;
+    world.slow_shown_us = 0;
+    world.overshoot_cm = 0.0f;
+    world_pending = false;
+
+    sim_pin_set(D8, 1);
+    sim_pin_set(D5, 0);
+    sim_pin_listen(D6, &world, world_on_trigger);
+    world_tick_handle = sim_schedule(world.t_us, world_tick);
+}
+
+void approach_end() {
+    sim_cancel(world_tick_handle);
+    sim_pin_listen(D6, &world, sim_pin_fn());
+}
+
+const ApproachState& approach_state() {
+    return world;
+}
+
+SyntheticLdrSource& approach_ldr_source() {
+    return world_ldr;
+}
@@ -0,0 +1,69 @@
+#ifndef SIM_APPROACH_H
+#define SIM_APPROACH_H
+
+#include <stdint.h>
+#include "ldr_scan.h"
+
+// ==================== APPROACH SCENARIO ====================
+// Physical model of one aircraft taxiing onto the stand. Lateral offset is
+// measured across the LDR row: positive puts the laser spot toward A0/A1
+// (the firmware answers TURN RIGHT), negative toward A3/A4 (TURN LEFT).
+struct ApproachScenario {
+    const char* name;
+    float start_distance_cm;    // Range to the sensor head at t = 0
+    float stop_distance_cm;     // IR obstacle sensor trips at or below this
+    float speed_cm_s;           // Taxi speed while not told to stop
+    float brake_cm_s2;          // Deceleration once the pilot reacts to STOP
+    float lateral_start_cm;     // Initial laser spot offset
+    float lateral_drift_cm_s;   // Uncommanded lateral drift
+    float steer_cm_s;           // Lateral correction rate on TURN directives
+    float reaction_ms;          // Pilot delay from directive to action
+    float ambient;              // LDR ambient level, 0..1
+    float noise;                // LDR noise amplitude, 0..1
+    float ghosts;               // Fraction of pings answered by a stray short echo
+    uint32_t seed;
+};
+
+#define APPROACH_LDR_SPACING_CM   2.0f    // Centre-to-centre across A0..A4
+#define APPROACH_SPOT_SIGMA_CM    1.0f    // Laser spot radius on the array
+#define APPROACH_SPOT_PEAK        0.85f
+#define APPROACH_ECHO_DELAY_US    450     // HC-SR04 burst before echo rises
+#define APPROACH_NO_ECHO_US       38000   // Pulse width when nothing returns
+#define APPROACH_ECHO_JITTER_CM   0.5f
+#define APPROACH_SLOW_TAXI_CM_S   15.0f   // Pilot brakes to this on SLOW
+
+struct ApproachState {
+    uint64_t t_us;
+    float distance_cm;
+    float lateral_cm;
+    float speed_cm_s;
+    bool  ir_tripped;
+    bool  halted;
+    uint8_t ideal_directive;    // What a zero-latency system would show
+
+    // Sensor-to-decision latency: ideal directive change -> current_directive
+    uint32_t decisions;
+    uint64_t latency_sum_us;
+    uint32_t latency_max_us;
+    uint64_t ir_trip_us;        // When the aircraft crossed the stop line
+    int64_t  stop_shown_us;     // First time STOP was on screen, -1 if never
+    float    stop_shown_cm;     // Distance to the stop line at that moment
+    int64_t  stop_latency_us;   // Trip -> STOP shown (negative = shown before
+                                // the trip), -1 if never shown
+    bool     stop_known;        // stop_latency_us is meaningful
+    uint64_t slow_shown_us;     // Time SLOW was on screen
+    float    overshoot_cm;      // Past the stop line at rest (negative = short)
+};
+
+// Installs pin listeners and a 1 ms physics tick on the virtual clock.
+// The LDR source must be started on the firmware's engine by the caller.
+void approach_begin(const ApproachScenario& sc);
+void approach_end();
+
+const ApproachState& approach_state();
+SyntheticLdrSource&  approach_ldr_source();
+
+// Noise-free LDR level for channel ch at lateral offset (0..1)
+float approach_ldr_level(const ApproachScenario& sc, uint8_t ch, float lateral_cm);
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef SIM_MBED_H
+#define SIM_MBED_H
+
+// ==================== HOST STAND-IN FOR mbed.h ====================
+// Only the subset of the mbed OS 5 API the firmware uses, backed by the
+// virtual clock and virtual pins in sim_clock.h. Everything runs on one
+// host thread; Mutex is a no-op and ISRs are plain scheduled callbacks.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <functional>
+#include <map>
+#include <utility>
+#include "sim_clock.h"
+
+// ==================== PINS ====================
+typedef int PinName;
+
+enum {
+    A0 = 0, A1, A2, A3, A4, A5,
+    D0 = 100, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10, D11, D12, D13, D14, D15,
+    USBTX = 200, USBRX,
+    PI_13 = 300,                // Touch controller INT on the Discovery board
+    NC = -1
+};
+
+typedef enum { PullNone, PullUp, PullDown, OpenDrain } PinMode;
+
+// ==================== CALLBACKS ====================
+template<typename F> using Callback = std::function<F>;
+
+template<typename T, typename R>
+std::function<R()> callback(T* obj, R (T::*method)()) {
+    return [obj, method]() { return (obj->*method)(); };
+}
+
+template<typename R>
+std::function<R()> callback(R (*fn)()) {
+    return std::function<R()>(fn);
+}
+
+// ==================== TIME ====================
+inline uint32_t us_ticker_read() {
+    return (uint32_t)sim_now_us();
+}
+
+// The HAL's 64-bit microsecond ticker: the same virtual clock, never wrapping
+typedef uint64_t us_timestamp_t;
+typedef struct ticker_data_s ticker_data_t;
+
+inline const ticker_data_t* get_us_ticker_data() {
+    return NULL;
+}
+
+inline us_timestamp_t ticker_read_us(const ticker_data_t* ticker) {
+    return sim_now_us();
+}
+
+inline void wait_us(int us) {
+    sim_spin_us(us);
+}
+
+inline void wait_ms(int ms) {
+    sim_spin_us((uint64_t)ms * 1000);
+}
+
+namespace ThisThread {
+    inline void sleep_for(uint32_t ms) {
+        sim_sleep_ms(ms);
+    }
+    inline void sleep_until(uint64_t ms) {
+        uint64_t now = sim_now_us() / 1000;
+        sim_sleep_ms(ms > now ? (uint32_t)(ms - now) : 0);
+    }
+}
+
+namespace Kernel {
+    inline uint64_t get_ms_count() {
+        return sim_now_us() / 1000;
+    }
+}
+
+class Timer {
+public:
+    Timer() : _running(false), _start(0), _acc(0) {}
+    void start() { if(!_running) { _start = sim_now_us(); _running = true; } }
+    void stop() { if(_running) { _acc += sim_now_us() - _start; _running = false; } }
+    void reset() { _acc = 0; _start = sim_now_us(); }
+    int read_us() { return (int)elapsed(); }
+    int read_ms() { return (int)(elapsed() / 1000); }
+    float read() { return elapsed() / 1000000.0f; }
+private:
+    uint64_t elapsed() { return _acc + (_running ? sim_now_us() - _start : 0); }
+    bool _running;
+    uint64_t _start;
+    uint64_t _acc;
+};
+
+class Timeout {
+public:
+    Timeout() : _handle(0) {}
+    ~Timeout() { detach(); }
+    void attach_us(Callback<void()> fn, uint32_t us) {
+        detach();
+        _handle = sim_schedule(sim_now_us() + us, [this, fn]() { _handle = 0; fn(); });
+    }
+    void detach() { if(_handle) { sim_cancel(_handle); _handle = 0; } }
+protected:
+    uint32_t _handle;
+};
+
+class Ticker {
+public:
+    Ticker() : _handle(0), _period(0) {}
+    ~Ticker() { detach(); }
+    void attach_us(Callback<void()> fn, uint32_t us) {
+        detach();
+        _fn = fn;
+        _period = us;
+        arm(sim_now_us() + us);
+    }
+    void detach() { if(_handle) { sim_cancel(_handle); _handle = 0; } }
+private:
+    void arm(uint64_t at) {
+        _handle = sim_schedule(at, [this, at]() { arm(at + _period); _fn(); });
+    }
+    uint32_t _handle;
+    uint32_t _period;
+    Callback<void()> _fn;
+};
+
+// ==================== DIGITAL I/O ====================
+class DigitalIn {
+public:
+    DigitalIn(PinName pin) : _pin(pin) {}
+    void mode(PinMode) {}
+    int read() { return sim_pin_get(_pin); }
+    operator int() { return read(); }
+private:
+    PinName _pin;
+};
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin, int value = 0) : _pin(pin) { write(value); }
+    void write(int value) { sim_pin_set(_pin, value); }
+    int read() { return sim_pin_get(_pin); }
+    DigitalOut& operator=(int value) { write(value); return *this; }
+    operator int() { return read(); }
+private:
+    PinName _pin;
+};
+
+class InterruptIn {
+public:
+    InterruptIn(PinName pin) : _pin(pin) {}
+    ~InterruptIn() { sim_pin_listen(_pin, this, sim_pin_fn()); }
+    void mode(PinMode) {}
+    int read() { return sim_pin_get(_pin); }
+    void rise(Callback<void()> fn) { _rise = fn; relisten(); }
+    void fall(Callback<void()> fn) { _fall = fn; relisten(); }
+private:
+    void relisten() {
+        if(!_rise && !_fall) {
+            sim_pin_listen(_pin, this, sim_pin_fn());
+            return;
+        }
+        sim_pin_listen(_pin, this, [this](int level) {
+            if(level && _rise) _rise();
+            if(!level && _fall) _fall();
+        });
+    }
+    PinName _pin;
+    Callback<void()> _rise;
+    Callback<void()> _fall;
+};
+
+// Single host thread and ISRs never preempt: nothing to mask
+inline void core_util_critical_section_enter() {}
+inline void core_util_critical_section_exit() {}
+
+// ==================== RTOS ====================
+#define osWaitForever           0xFFFFFFFFU
+#define osFlagsError            0x80000000U
+#define osFlagsErrorTimeout     0xFFFFFFFEU
+
+class Mutex {
+public:
+    void lock() {}
+    bool trylock() { return true; }
+    void unlock() {}
+};
+
+// A wait lets virtual time (and every scheduled ISR) run until a flag is set
+class EventFlags {
+public:
+    EventFlags() : _flags(0) {}
+    uint32_t set(uint32_t flags) { _flags |= flags; return _flags; }
+    uint32_t clear(uint32_t flags = 0x7FFFFFFF) { uint32_t old = _flags; _flags &= ~flags; return old; }
+    uint32_t get() const { return _flags; }
+    uint32_t wait_any(uint32_t flags, uint32_t millisec = osWaitForever, bool clear = true) {
+        uint64_t timeout_us = (millisec == osWaitForever) ? UINT64_MAX : (uint64_t)millisec * 1000;
+        if(!sim_block_until([&]() { return (_flags & flags) != 0; }, timeout_us)) {
+            return osFlagsErrorTimeout;
+        }
+        uint32_t got = _flags;
+        if(clear) _flags &= ~flags;
+        return got;
+    }
+private:
+    volatile uint32_t _flags;
+};
+
+// ==================== EVENT QUEUE ====================
+// Events only run inside dispatch(), in due-time order, never nested inside
+// another event - even when a handler blocks and lets ISRs run meanwhile.
+// Each handler counts as one wake/sleep for the sim's frame hooks.
+#define EVENTS_EVENT_SIZE       64
+#define EVENTS_QUEUE_SIZE       (32 * EVENTS_EVENT_SIZE)
+
+class EventQueue {
+public:
+    EventQueue(unsigned size = EVENTS_QUEUE_SIZE, unsigned char* buffer = NULL)
+        : _next_id(1), _break(false) {}
+
+    int call(Callback<void()> fn) { return post(0, 0, fn); }
+    int call_in(int ms, Callback<void()> fn) { return post((uint64_t)ms * 1000, 0, fn); }
+    int call_every(int ms, Callback<void()> fn) {
+        return post((uint64_t)ms * 1000, (uint64_t)ms * 1000, fn);
+    }
+
+    void cancel(int id) {
+        for(EventMap::iterator it = _events.begin(); it != _events.end(); ++it) {
+            if(it->first.second == id) {
+                _events.erase(it);
+                return;
+            }
+        }
+    }
+
+    void dispatch(int ms = -1) {
+        uint64_t end = (ms < 0) ? UINT64_MAX : sim_now_us() + (uint64_t)ms * 1000;
+        _break = false;
+        while(!_break) {
+            if(due()) {
+                EventMap::iterator it = _events.begin();
+                Event ev = it->second;
+                int id = it->first.second;
+                uint64_t at = it->first.first;
+                _events.erase(it);
+                if(ev.period_us) {
+                    _events[Key(at + ev.period_us, id)] = ev;
+                }
+                sim_note_wake();
+                ev.fn();
+                sim_note_sleep(0);
+                continue;
+            }
+            uint64_t now = sim_now_us();
+            if(now >= end) {
+                break;
+            }
+            uint64_t until = end;
+            if(!_events.empty() && _events.begin()->first.first < until) {
+                until = _events.begin()->first.first;
+            }
+            sim_block_until([this]() { return _break || due(); },
+                            until == UINT64_MAX ? UINT64_MAX : until - now);
+        }
+    }
+    void dispatch_forever() { dispatch(-1); }
+    void break_dispatch() { _break = true; }
+
+private:
+    struct Event {
+        uint64_t period_us;
+        Callback<void()> fn;
+    };
+    typedef std::pair<uint64_t, int> Key;
+    typedef std::map<Key, Event> EventMap;
+
+    int post(uint64_t delay_us, uint64_t period_us, Callback<void()> fn) {
+        int id = _next_id++;
+        Event ev;
+        ev.period_us = period_us;
+        ev.fn = fn;
+        _events[Key(sim_now_us() + delay_us, id)] = ev;
+        return id;
+    }
+    bool due() const {
+        return !_events.empty() && _events.begin()->first.first <= sim_now_us();
+    }
+
+    EventMap _events;
+    int _next_id;
+    volatile bool _break;
+};
+
+// ==================== SERIAL ====================
+// Output goes to sim_serial_sink (stdout by default, NULL to discard);
+// sim_serial_bytes counts everything the firmware tried to send.
+extern FILE* sim_serial_sink;
+extern uint64_t sim_serial_bytes;
+
+class Serial {
+public:
+    Serial(PinName, PinName) {}
+    void baud(int) {}
+    int printf(const char* fmt, ...) {
+        char buf[512];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if(n > 0) {
+            write(buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf) - 1);
+        }
+        return n;
+    }
+    int putc(int c) { char ch = (char)c; write(&ch, 1); return c; }
+    void write(const char* data, size_t len) {
+        sim_serial_bytes += len;
+        if(sim_serial_sink != NULL) fwrite(data, 1, len, sim_serial_sink);
+    }
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "sim_clock.h"
+#include <chrono>
+#include <map>
+#include <utility>
+
+// ==================== VIRTUAL CLOCK ====================
+struct SimEvent {
+    uint32_t     handle;
+    sim_event_fn fn;
+};
+
+// Ordered by (time, insertion) so same-time events run FIFO
+static std::map<std::pair<uint64_t, uint32_t>, SimEvent> sim_events;
+static std::map<uint32_t, std::pair<uint64_t, uint32_t> > sim_handles;
+static uint64_t sim_time_us = 0;
+static uint32_t sim_next_handle = 1;
+static std::function<void(uint32_t)> sim_sleep_hook;
+static std::function<void()> sim_wake_hook;
+
+uint64_t sim_now_us() {
+    return sim_time_us;
+}
+
+uint32_t sim_cycle_count() {
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return (uint32_t)(ns * 216 / 1000);
+}
+
+uint32_t sim_schedule(uint64_t at_us, sim_event_fn fn) {
+    if(at_us < sim_time_us) {
+        at_us = sim_time_us;
+    }
+    uint32_t handle = sim_next_handle++;
+    std::pair<uint64_t, uint32_t> key(at_us, handle);
+    SimEvent ev;
+    ev.handle = handle;
+    ev.fn = fn;
+    sim_events[key] = ev;
+    sim_handles[handle] = key;
+    return handle;
+}
+
+void sim_cancel(uint32_t handle) {
+    std::map<uint32_t, std::pair<uint64_t, uint32_t> >::iterator it = sim_handles.find(handle);
+    if(it == sim_handles.end()) {
+        return;
+    }
+    sim_events.erase(it->second);
+    sim_handles.erase(it);
+}
+
+void sim_advance_to(uint64_t t_us) {
+    while(!sim_events.empty()) {
+        std::map<std::pair<uint64_t, uint32_t>, SimEvent>::iterator it = sim_events.begin();
+        if(it->first.first > t_us) {
+            break;
+        }
+        sim_time_us = it->first.first;
+        sim_event_fn fn = it->second.fn;
+        sim_handles.erase(it->second.handle);
+        sim_events.erase(it);
+        fn();
+    }
+    if(t_us > sim_time_us) {
+        sim_time_us = t_us;
+    }
+}
+
+void sim_advance_us(uint64_t dt_us) {
+    sim_advance_to(sim_time_us + dt_us);
+}
+
+bool sim_block_until(std::function<bool()> ready, uint64_t timeout_us) {
+    uint64_t deadline = sim_time_us + timeout_us;
+    if(deadline < sim_time_us) {
+        deadline = UINT64_MAX;          // Wait forever
+    }
+    while(!ready()) {
+        if(sim_events.empty() || sim_events.begin()->first.first > deadline) {
+            if(deadline != UINT64_MAX) {
+                sim_time_us = deadline;
+            }
+            return ready();
+        }
+        sim_advance_to(sim_events.begin()->first.first);
+    }
+    return true;
+}
+
+void sim_spin_us(uint64_t dt_us) {
+    sim_time_us += dt_us;
+}
+
+void sim_set_sleep_hook(std::function<void(uint32_t ms)> hook) {
+    sim_sleep_hook = hook;
+}
+
+void sim_set_wake_hook(std::function<void()> hook) {
+    sim_wake_hook = hook;
+}
+
+void sim_note_wake() {
+    if(sim_wake_hook) {
+        sim_wake_hook();
+    }
+}
+
+void sim_note_sleep(uint32_t ms) {
+    if(sim_sleep_hook) {
+        sim_sleep_hook(ms);
+    }
+}
+
+void sim_sleep_ms(uint32_t ms) {
+    sim_note_sleep(ms);
+    sim_advance_us((uint64_t)ms * 1000);
+    sim_note_wake();
+}
+
+// ==================== VIRTUAL PINS ====================
+struct SimPin {
+    int level;
+    std::map<void*, sim_pin_fn> listeners;
+    SimPin() : level(0) {}
+};
+
+// Function-local so pins touched by static constructors (DigitalOut with an
+// initial value) never see an unconstructed map, and never freed so static
+// InterruptIn destructors running after it can still detach
+static std::map<int, SimPin>& sim_pins() {
+    static std::map<int, SimPin>* pins = new std::map<int, SimPin>();
+    return *pins;
+}
+
+int sim_pin_get(int pin) {
+    return sim_pins()[pin].level;
+}
+
+void sim_pin_set(int pin, int level) {
+    SimPin& p = sim_pins()[pin];
+    level = level ? 1 : 0;
+    if(p.level == level) {
+        return;
+    }
+    p.level = level;
+
+    // Copy first: a listener may detach itself
+    std::map<void*, sim_pin_fn> listeners = p.listeners;
+    for(std::map<void*, sim_pin_fn>::iterator it = listeners.begin(); it != listeners.end(); ++it) {
+        it->second(level);
+    }
+}
+
+void sim_pin_listen(int pin, void* owner, sim_pin_fn fn) {
+    if(fn) {
+        sim_pins()[pin].listeners[owner] = fn;
+    } else {
+        sim_pins()[pin].listeners.erase(owner);
+    }
+}
+
+// Handles keep counting across resets so a stale handle held by a static
+// Ticker/Timeout can never cancel an event from the next run
+void sim_reset() {
+    sim_events.clear();
+    sim_handles.clear();
+    sim_pins().clear();
+    sim_time_us = 0;
+    sim_sleep_hook = std::function<void(uint32_t)>();
+    sim_wake_hook = std::function<void()>();
+}
@@ -0,0 +1,54 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+#include <functional>
+
+// ==================== VIRTUAL CLOCK ====================
+// Single-threaded discrete-event clock standing in for the mbed tickers.
+// Firmware time only moves when the firmware sleeps/waits or when the
+// simulator advances it, so runs are deterministic and as fast as the host.
+
+typedef std::function<void()> sim_event_fn;
+
+uint64_t sim_now_us();
+
+// Schedule fn at absolute time at_us. Returns a handle for sim_cancel().
+uint32_t sim_schedule(uint64_t at_us, sim_event_fn fn);
+void     sim_cancel(uint32_t handle);
+
+// Dispatch every event due up to and including t_us, then set now = t_us
+void sim_advance_to(uint64_t t_us);
+void sim_advance_us(uint64_t dt_us);
+
+// Blocking-wait semantics (RTOS waits): dispatch events in order until
+// ready() holds or timeout_us passes. Returns ready(). No sleep/wake hooks.
+bool sim_block_until(std::function<bool()> ready, uint64_t timeout_us);
+
+// Busy-wait semantics (wait_us): time passes, but nothing is dispatched
+void sim_spin_us(uint64_t dt_us);
+
+// Called at the start and end of every ThisThread::sleep_for, so the time
+// between a wake and the next sleep is the firmware's own work for a frame
+void sim_set_sleep_hook(std::function<void(uint32_t ms)> hook);
+void sim_set_wake_hook(std::function<void()> hook);
+void sim_sleep_ms(uint32_t ms);
+
+// Same hooks for an event-loop thread: one wake/sleep pair per handler
+void sim_note_wake();
+void sim_note_sleep(uint32_t ms);
+
+// Stand-in for the DWT cycle counter: the host's own clock at the board's
+// 216 MHz, wrapping like CYCCNT. It measures host work, not virtual time.
+uint32_t sim_cycle_count();
+
+// ==================== VIRTUAL PINS ====================
+typedef std::function<void(int level)> sim_pin_fn;
+
+int  sim_pin_get(int pin);
+void sim_pin_set(int pin, int level);                   // Fires edge listeners
+void sim_pin_listen(int pin, void* owner, sim_pin_fn fn); // NULL fn removes
+
+void sim_reset();
+
+#endif
@@ -0,0 +1,362 @@
+#include "stm32746g_discovery_lcd.h"
+#include "sim_lcd.h"
+#include "sim_sdram.h"
+#include "sim_clock.h"
+#include <stdio.h>
+#include <string.h>
+
+// ==================== SOFTWARE FRAMEBUFFER ====================
+// Framebuffers live in the mapped SDRAM at whatever address each layer is
+// given, exactly as on the board. Like the LTDC, each layer has a render
+// address (what the BSP draws into), a shadow address (written by
+// SetLayerAddress*) and an active address (what is scanned out); reload
+// copies shadow to active, immediately or at the next vertical blank.
+#define SIM_LCD_LAYERS 2
+
+LTDC_HandleTypeDef hLtdcHandler;
+
+static uint32_t sim_render_addr[SIM_LCD_LAYERS];
+static uint32_t sim_shadow_addr[SIM_LCD_LAYERS];
+static uint32_t sim_active_addr[SIM_LCD_LAYERS];
+static bool     sim_layer_on[SIM_LCD_LAYERS];
+static uint32_t sim_composite[SIM_LCD_W * SIM_LCD_H];
+static uint32_t sim_layer = 0;
+static uint32_t* sim_fb = (uint32_t*)(uintptr_t)LCD_FB_START_ADDRESS;
+static bool sim_fb_visible = true;          // Drawing into the scanned-out buffer
+static bool sim_reload_pending = false;
+static bool sim_display_on = true;
+static bool sim_reload_deferred = false;    // Asked for while the LTDC was off
+static SimLcdStats sim_stats;
+
+static uint32_t sim_text_color = 0xFF000000;
+static uint32_t sim_back_color = 0xFFFFFFFF;
+static sFONT*   sim_font = &Font24;
+
+static void update_target() {
+    sim_fb = (uint32_t*)(uintptr_t)sim_render_addr[sim_layer];
+    sim_fb_visible = (sim_render_addr[sim_layer] == sim_active_addr[sim_layer]);
+}
+
+static void apply_reload() {
+    for(int i = 0; i < SIM_LCD_LAYERS; i++) {
+        if(sim_active_addr[i] != sim_shadow_addr[i]) {
+            sim_active_addr[i] = sim_shadow_addr[i];
+            sim_stats.flips++;
+        }
+    }
+    update_target();
+}
+
+static inline void count_writes(uint64_t n) {
+    sim_stats.pixel_writes += n;
+    if(sim_fb_visible) {
+        sim_stats.visible_writes += n;
+    }
+}
+
+static inline void put_pixel(int x, int y, uint32_t color) {
+    if(x < 0 || y < 0 || x >= SIM_LCD_W || y >= SIM_LCD_H) {
+        return;
+    }
+    sim_fb[y * SIM_LCD_W + x] = color;
+    count_writes(1);
+}
+
+static void fill_span(int x, int y, int w, int h, uint32_t color) {
+    if(x < 0) { w += x; x = 0; }
+    if(y < 0) { h += y; y = 0; }
+    if(x + w > SIM_LCD_W) w = SIM_LCD_W - x;
+    if(y + h > SIM_LCD_H) h = SIM_LCD_H - y;
+    if(w <= 0 || h <= 0) {
+        return;
+    }
+    for(int row = 0; row < h; row++) {
+        uint32_t* p = &sim_fb[(y + row) * SIM_LCD_W + x];
+        for(int col = 0; col < w; col++) {
+            p[col] = color;
+        }
+    }
+    count_writes((uint64_t)w * h);
+}
+
+// LTDC blending with the BSP's default factors (pixel alpha x constant
+// alpha 255): each enabled layer goes over the result below it, starting
+// from a black background
+static inline uint32_t blend_channel(uint32_t fg, uint32_t bg, uint32_t a, int shift) {
+    uint32_t f = (fg >> shift) & 0xFF;
+    uint32_t b = (bg >> shift) & 0xFF;
+    return ((f * a + b * (255 - a)) / 255) << shift;
+}
+
+const uint32_t* sim_lcd_pixels() {
+    for(int i = 0; i < SIM_LCD_W * SIM_LCD_H; i++) {
+        sim_composite[i] = 0xFF000000;
+    }
+    for(int l = 0; l < SIM_LCD_LAYERS; l++) {
+        if(!sim_layer_on[l]) {
+            continue;
+        }
+        const uint32_t* fb = (const uint32_t*)(uintptr_t)sim_active_addr[l];
+        for(int i = 0; i < SIM_LCD_W * SIM_LCD_H; i++) {
+            uint32_t a = fb[i] >> 24;
+            uint32_t bg = sim_composite[i];
+            sim_composite[i] = 0xFF000000 | blend_channel(fb[i], bg, a, 16) |
+                               blend_channel(fb[i], bg, a, 8) | blend_channel(fb[i], bg, a, 0);
+        }
+    }
+    return sim_composite;
+}
+
+SimLcdStats sim_lcd_stats() {
+    return sim_stats;
+}
+
+void sim_lcd_reset_stats() {
+    memset(&sim_stats, 0, sizeof(sim_stats));
+}
+
+bool sim_lcd_write_ppm(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if(f == NULL) {
+        return false;
+    }
+    const uint32_t* fb = sim_lcd_pixels();
+    fprintf(f, "P6\n%d %d\n255\n", SIM_LCD_W, SIM_LCD_H);
+    for(int i = 0; i < SIM_LCD_W * SIM_LCD_H; i++) {
+        uint8_t rgb[3] = {
+            (uint8_t)(fb[i] >> 16), (uint8_t)(fb[i] >> 8), (uint8_t)fb[i]
+        };
+        fwrite(rgb, 1, 3, f);
+    }
+    fclose(f);
+    return true;
+}
+
+// ==================== BSP ENTRY POINTS ====================
+uint8_t BSP_LCD_Init(void) {
+    sim_sdram_map();
+    for(int i = 0; i < SIM_LCD_LAYERS; i++) {
+        sim_render_addr[i] = sim_shadow_addr[i] = sim_active_addr[i] = LCD_FB_START_ADDRESS;
+        sim_layer_on[i] = false;
+    }
+    sim_layer = 0;
+    sim_reload_pending = false;
+    sim_display_on = true;
+    sim_reload_deferred = false;
+    update_target();
+    memset(sim_fb, 0, SIM_LCD_W * SIM_LCD_H * 4);
+    sim_lcd_reset_stats();
+    return LCD_OK;
+}
+
+uint32_t BSP_LCD_GetXSize(void) { return SIM_LCD_W; }
+uint32_t BSP_LCD_GetYSize(void) { return SIM_LCD_H; }
+
+// Layer configuration reloads immediately, as HAL_LTDC_ConfigLayer does
+void BSP_LCD_LayerDefaultInit(uint16_t LayerIndex, uint32_t FB_Address) {
+    sim_render_addr[LayerIndex] = sim_shadow_addr[LayerIndex] = FB_Address;
+    sim_layer_on[LayerIndex] = true;
+    apply_reload();
+}
+
+void BSP_LCD_SelectLayer(uint32_t LayerIndex) {
+    sim_layer = LayerIndex;
+    update_target();
+}
+
+void BSP_LCD_SetLayerAddress_NoReload(uint32_t LayerIndex, uint32_t Address) {
+    sim_render_addr[LayerIndex] = sim_shadow_addr[LayerIndex] = Address;
+    update_target();
+}
+
+static void schedule_vblank_reload() {
+    uint64_t vblank = (sim_now_us() / SIM_LCD_FRAME_US + 1) * SIM_LCD_FRAME_US;
+    sim_schedule(vblank, []() {
+        sim_reload_pending = false;
+        apply_reload();
+        HAL_LTDC_ReloadEventCallback(&hLtdcHandler);
+    });
+}
+
+// Vertical-blank reloads land on the next SIM_LCD_FRAME_US boundary and
+// then raise the reload event, like the LTDC register-reload interrupt.
+// With the LTDC off there is no blanking, so the reload waits for it.
+void BSP_LCD_Reload(uint32_t ReloadType) {
+    if(ReloadType == BSP_LCD_RELOAD_IMMEDIATE) {
+        apply_reload();
+        return;
+    }
+    if(ReloadType != BSP_LCD_RELOAD_VERTICAL_BLANKING || sim_reload_pending) {
+        return;
+    }
+    sim_reload_pending = true;
+    if(!sim_display_on) {
+        sim_reload_deferred = true;
+        return;
+    }
+    schedule_vblank_reload();
+}
+
+void BSP_LCD_DisplayOn(void) {
+    sim_display_on = true;
+    if(sim_reload_deferred) {
+        sim_reload_deferred = false;
+        schedule_vblank_reload();
+    }
+}
+
+void BSP_LCD_DisplayOff(void) {
+    sim_display_on = false;
+}
+
+bool sim_lcd_display_on() {
+    return sim_display_on;
+}
+
+void BSP_LCD_SetTextColor(uint32_t Color) { sim_text_color = Color; }
+uint32_t BSP_LCD_GetTextColor(void) { return sim_text_color; }
+void BSP_LCD_SetBackColor(uint32_t Color) { sim_back_color = Color; }
+uint32_t BSP_LCD_GetBackColor(void) { return sim_back_color; }
+void BSP_LCD_SetFont(sFONT* fonts) { sim_font = fonts; }
+sFONT* BSP_LCD_GetFont(void) { return sim_font; }
+
+uint32_t BSP_LCD_ReadPixel(uint16_t Xpos, uint16_t Ypos) {
+    if(Xpos >= SIM_LCD_W || Ypos >= SIM_LCD_H) {
+        return 0;
+    }
+    return sim_fb[Ypos * SIM_LCD_W + Xpos];
+}
+
+void BSP_LCD_Clear(uint32_t Color) {
+    sim_stats.draw_calls++;
+    sim_stats.clears++;
+    fill_span(0, 0, SIM_LCD_W, SIM_LCD_H, Color);
+}
+
+void BSP_LCD_DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t pixel) {
+    sim_stats.draw_calls++;
+    put_pixel(Xpos, Ypos, pixel);
+}
+
+void BSP_LCD_DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length) {
+    sim_stats.draw_calls++;
+    fill_span(Xpos, Ypos, Length, 1, sim_text_color);
+}
+
+void BSP_LCD_DrawVLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length) {
+    sim_stats.draw_calls++;
+    fill_span(Xpos, Ypos, 1, Length, sim_text_color);
+}
+
+// Matches the BSP: the outline covers Width+1 x Height+1 pixels
+void BSP_LCD_DrawRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height) {
+    BSP_LCD_DrawHLine(Xpos, Ypos, Width);
+    BSP_LCD_DrawHLine(Xpos, Ypos + Height, Width);
+    BSP_LCD_DrawVLine(Xpos, Ypos, Height);
+    BSP_LCD_DrawVLine(Xpos + Width, Ypos, Height);
+}
+
+void BSP_LCD_FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height) {
+    sim_stats.draw_calls++;
+    fill_span(Xpos, Ypos, Width, Height, sim_text_color);
+}
+
+// Same midpoint walk as the BSP so pixel counts line up with the board
+void BSP_LCD_DrawCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius) {
+    sim_stats.draw_calls++;
+    int decision = 3 - (Radius << 1);
+    int cx = 0;
+    int cy = Radius;
+    int x = Xpos;
+    int y = Ypos;
+    while(cx <= cy) {
+        put_pixel(x + cx, y - cy, sim_text_color);
+        put_pixel(x - cx, y - cy, sim_text_color);
+        put_pixel(x + cy, y - cx, sim_text_color);
+        put_pixel(x - cy, y - cx, sim_text_color);
+        put_pixel(x + cx, y + cy, sim_text_color);
+        put_pixel(x - cx, y + cy, sim_text_color);
+        put_pixel(x + cy, y + cx, sim_text_color);
+        put_pixel(x - cy, y + cx, sim_text_color);
+        if(decision < 0) {
+            decision += (cx << 2) + 6;
+        } else {
+            decision += ((cx - cy) << 2) + 10;
+            cy--;
+        }
+        cx++;
+    }
+}
+
+void BSP_LCD_FillCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius) {
+    sim_stats.draw_calls++;
+    int decision = 3 - (Radius << 1);
+    int cx = 0;
+    int cy = Radius;
+    int x = Xpos;
+    int y = Ypos;
+    while(cx <= cy) {
+        if(cy > 0) {
+            fill_span(x - cy, y + cx, 2 * cy, 1, sim_text_color);
+            fill_span(x - cy, y - cx, 2 * cy, 1, sim_text_color);
+        }
+        if(cx > 0) {
+            fill_span(x - cx, y - cy, 2 * cx, 1, sim_text_color);
+            fill_span(x - cx, y + cy, 2 * cx, 1, sim_text_color);
+        }
+        if(decision < 0) {
+            decision += (cx << 2) + 6;
+        } else {
+            decision += ((cx - cy) << 2) + 10;
+            cy--;
+        }
+        cx++;
+    }
+    BSP_LCD_DrawCircle(Xpos, Ypos, Radius);
+}
+
+// Every pixel of the character cell is written (glyph or back colour), as
+// the BSP does. Glyph shapes come from the 5x7 table scaled to the cell.
+void BSP_LCD_DisplayChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii) {
+    sim_stats.draw_calls++;
+    const uint8_t* glyph = (Ascii >= ' ' && Ascii <= '~') ? sim_font_5x7[Ascii - ' '] : sim_font_5x7[0];
+    int w = sim_font->Width;
+    int h = sim_font->Height;
+    for(int py = 0; py < h; py++) {
+        int gy = py * 8 / h;
+        for(int px = 0; px < w; px++) {
+            int gx = px * 6 / w;
+            bool on = gx < 5 && ((glyph[gx] >> gy) & 1);
+            put_pixel(Xpos + px, Ypos + py, on ? sim_text_color : sim_back_color);
+        }
+    }
+}
+
+void BSP_LCD_DisplayStringAt(uint16_t Xpos, uint16_t Ypos, uint8_t* Text, Text_AlignModeTypdef Mode) {
+    uint16_t ref_column = 1;
+    uint32_t size = strlen((const char*)Text);
+    uint32_t xsize = BSP_LCD_GetXSize() / sim_font->Width;
+
+    switch(Mode) {
+    case CENTER_MODE:
+        ref_column = Xpos + ((xsize - size) * sim_font->Width) / 2;
+        break;
+    case RIGHT_MODE:
+        ref_column = -Xpos + ((xsize - size) * sim_font->Width);
+        break;
+    default:
+        ref_column = Xpos;
+        break;
+    }
+    if(ref_column < 1 || ref_column >= 0x8000) {
+        ref_column = 1;
+    }
+
+    uint32_t i = 0;
+    while(*Text != 0 && ((BSP_LCD_GetXSize() - (i * sim_font->Width)) & 0xFFFF) >= sim_font->Width) {
+        BSP_LCD_DisplayChar(ref_column, Ypos, *Text);
+        ref_column += sim_font->Width;
+        Text++;
+        i++;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef SIM_LCD_FB_H
+#define SIM_LCD_FB_H
+
+#include <stdint.h>
+
+// ==================== SOFTWARE FRAMEBUFFER ====================
+#define SIM_LCD_W 480
+#define SIM_LCD_H 272
+#define SIM_LCD_FRAME_US 16667      // ~60 Hz panel refresh
+
+struct SimLcdStats {
+    uint64_t pixel_writes;      // Every in-bounds pixel store, any primitive
+    uint64_t draw_calls;        // BSP_LCD_* drawing entry points
+    uint64_t clears;            // Full-screen BSP_LCD_Clear calls
+    uint64_t visible_writes;    // Pixel stores into a scanned-out buffer (tearing)
+    uint64_t flips;             // Layer address changes taking effect
+};
+
+// What the panel shows: the enabled layers' scanned-out buffers composited
+const uint32_t* sim_lcd_pixels();
+SimLcdStats     sim_lcd_stats();
+void            sim_lcd_reset_stats();
+bool            sim_lcd_display_on();   // LTDC and backlight (BSP_LCD_DisplayOn/Off)
+
+// Binary PPM (P6) snapshot of sim_lcd_pixels(), alpha dropped
+bool sim_lcd_write_ppm(const char* path);
+
+// 5x7 base glyphs for ' '..'~', five column bytes each, LSB at the top
+extern const uint8_t sim_font_5x7[95][5];
+
+#endif
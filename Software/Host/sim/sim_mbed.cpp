@@ -0,0 +1,5 @@
+#include "mbed.h"
+
+// ==================== SERIAL SINK ====================
+FILE*    sim_serial_sink = stdout;
+uint64_t sim_serial_bytes = 0;
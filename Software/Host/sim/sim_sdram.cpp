@@ -0,0 +1,29 @@
+#include "sim_sdram.h"
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ==================== EXTERNAL SDRAM ====================
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+void sim_sdram_map() {
+    static bool mapped = false;
+    if(mapped) {
+        return;
+    }
+    void* want = (void*)(uintptr_t)SIM_SDRAM_BASE;
+    void* got = mmap(want, SIM_SDRAM_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if(got != want) {
+        fprintf(stderr, "sim: cannot map SDRAM at 0x%08X\n", SIM_SDRAM_BASE);
+        abort();
+    }
+    mapped = true;
+}
+
+// Mapped before main() so static objects can already point into it
+static struct SimSdramInit {
+    SimSdramInit() { sim_sdram_map(); }
+} sim_sdram_init;
@@ -0,0 +1,16 @@
+#ifndef SIM_SDRAM_H
+#define SIM_SDRAM_H
+
+#include <stdint.h>
+
+// ==================== EXTERNAL SDRAM ====================
+// The board's 8 MB SDRAM lives at 0xC0000000. The host maps real memory at
+// the same address so firmware can use the BSP's framebuffer addresses (and
+// anything else it keeps in SDRAM) as plain pointers.
+#define SIM_SDRAM_BASE  0xC0000000U
+#define SIM_SDRAM_SIZE  (8U * 1024U * 1024U)
+
+// Idempotent; aborts the process if the address range is taken
+void sim_sdram_map();
+
+#endif
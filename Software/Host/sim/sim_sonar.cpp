@@ -0,0 +1,110 @@
+#include "sim_sonar.h"
+#include "ultrasonic.h"
+#include <math.h>
+#include <string.h>
+
+SimSonarField::SimSonarField(const SimSonar* sonars, uint8_t count, sim_target_fn target, void* ctx)
+    : _count(count > SIM_SONAR_MAX ? SIM_SONAR_MAX : count), _target(target), _ctx(ctx),
+      _bursts(0), _ignored(0), _rng(1) {
+    memcpy(_sonars, sonars, _count * sizeof(SimSonar));
+    memset(_listening, 0, sizeof(_listening));
+    memset(_burst_us, 0, sizeof(_burst_us));
+    memset(_arrive, 0, sizeof(_arrive));
+    memset(_fall_us, 0, sizeof(_fall_us));
+    memset(_fall, 0, sizeof(_fall));
+}
+
+float SimSonarField::noise() {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return (_rng >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+float SimSonarField::range_cm(uint8_t i, uint32_t t_us) const {
+    float x, y;
+    _target(t_us, &x, &y, _ctx);
+    float dx = x - _sonars[i].x_cm;
+    return sqrtf(dx * dx + y * y);
+}
+
+void SimSonarField::begin() {
+    for(uint8_t i = 0; i < _count; i++) {
+        sim_pin_set(_sonars[i].echo, 0);
+        sim_pin_listen(_sonars[i].trig, this, [this, i](int level) { on_trigger(i, level); });
+    }
+}
+
+void SimSonarField::end() {
+    for(uint8_t i = 0; i < _count; i++) {
+        sim_pin_listen(_sonars[i].trig, this, sim_pin_fn());
+        if(_fall[i]) {
+            sim_cancel(_fall[i]);
+            _fall[i] = 0;
+        }
+        _listening[i] = false;
+    }
+}
+
+void SimSonarField::on_trigger(uint8_t i, int level) {
+    if(level != 0) {
+        return;     // Burst starts on the trigger's falling edge
+    }
+    if(_listening[i]) {
+        _ignored++;
+        return;
+    }
+    _listening[i] = true;   // Busy from here, even before the line rises
+    sim_schedule(sim_now_us() + SIM_SONAR_BURST_US, [this, i]() { burst(i); });
+}
+
+// Sensor i's burst leaves now: when it reaches every sensor, off the target
+void SimSonarField::burst(uint8_t i) {
+    uint64_t now = sim_now_us();
+    _bursts++;
+    _burst_us[i] = now;
+    float out = range_cm(i, (uint32_t)now);
+    for(uint8_t j = 0; j < _count; j++) {
+        _arrive[i][j] = 0;
+        if(j != i && !(_sonars[j].hears & (1u << i))) {
+            continue;
+        }
+        float path = out + range_cm(j, (uint32_t)now) + SIM_SONAR_JITTER_CM * noise();
+        if(path > 2.0f * US_MAX_RANGE_CM) {
+            continue;   // Too weak to trip the receiver
+        }
+        _arrive[i][j] = now + (uint64_t)(path / SIM_SONAR_CM_PER_US);
+    }
+
+    sim_pin_set(_sonars[i].echo, 1);
+    _fall_us[i] = now + SIM_SONAR_NO_ECHO_US;
+    listen(i, now);
+    for(uint8_t j = 0; j < _count; j++) {
+        if(j != i && _listening[j] && _burst_us[j] < now) {
+            listen(j, now);
+        }
+    }
+}
+
+// Earliest sound to reach sensor j after its own burst ends its pulse
+void SimSonarField::listen(uint8_t j, uint64_t now_us) {
+    uint64_t fall = _fall_us[j];
+    for(uint8_t k = 0; k < _count; k++) {
+        uint64_t at = _arrive[k][j];
+        if(at > _burst_us[j] && at > now_us && at < fall) {
+            fall = at;
+        }
+    }
+    if(fall == _fall_us[j] && _fall[j]) {
+        return;
+    }
+    _fall_us[j] = fall;
+    if(_fall[j]) {
+        sim_cancel(_fall[j]);
+    }
+    _fall[j] = sim_schedule(fall, [this, j]() {
+        _fall[j] = 0;
+        _listening[j] = false;
+        sim_pin_set(_sonars[j].echo, 0);
+    });
+}
@@ -0,0 +1,66 @@
+#ifndef SIM_SONAR_H
+#define SIM_SONAR_H
+
+#include <stdint.h>
+#include "mbed.h"
+
+// ==================== SIMULATED HC-SR04 FIELD ====================
+// Several HC-SR04s on virtual pins sharing the same air. A trigger's
+// falling edge sends a burst SIM_SONAR_BURST_US later and raises that
+// sensor's echo line, which falls at the first sound to reach it after its
+// own burst. That sound can be the sensor's own echo off the target, or
+// another sensor's burst off the target (crosstalk) if this sensor hears
+// that one. With nothing back, the line falls after SIM_SONAR_NO_ECHO_US.
+// Like the real module, a trigger while the echo line is high is ignored.
+// The target is one reflector; paths longer than the HC-SR04's range are
+// lost.
+#define SIM_SONAR_MAX           4
+#define SIM_SONAR_BURST_US      450
+#define SIM_SONAR_NO_ECHO_US    38000
+#define SIM_SONAR_CM_PER_US     0.0343f     // Speed of sound, one way
+#define SIM_SONAR_JITTER_CM     0.5f
+
+struct SimSonar {
+    PinName trig;
+    PinName echo;
+    float   x_cm;                           // Along the sensor line; the target is at (x, y)
+    uint8_t hears;                          // Bit k: picks up sensor k's bursts (own always)
+};
+
+// Target position at t_us
+typedef void (*sim_target_fn)(uint32_t t_us, float* x_cm, float* y_cm, void* ctx);
+
+class SimSonarField {
+public:
+    SimSonarField(const SimSonar* sonars, uint8_t count, sim_target_fn target, void* ctx);
+
+    void begin();
+    void end();
+
+    uint32_t bursts() const { return _bursts; }
+    uint32_t ignored() const { return _ignored; }   // Triggers while the line was high
+
+    // Noise-free range from sensor i to the target at t_us
+    float range_cm(uint8_t i, uint32_t t_us) const;
+
+private:
+    void on_trigger(uint8_t i, int level);
+    void burst(uint8_t i);
+    void listen(uint8_t j, uint64_t at_us);
+    float noise();
+
+    SimSonar      _sonars[SIM_SONAR_MAX];
+    uint8_t       _count;
+    sim_target_fn _target;
+    void*         _ctx;
+    bool          _listening[SIM_SONAR_MAX];
+    uint64_t      _burst_us[SIM_SONAR_MAX];
+    uint64_t      _arrive[SIM_SONAR_MAX][SIM_SONAR_MAX];    // [from][to], 0 = none
+    uint64_t      _fall_us[SIM_SONAR_MAX];
+    uint32_t      _fall[SIM_SONAR_MAX];     // Pending fall event
+    uint32_t      _bursts;
+    uint32_t      _ignored;
+    uint32_t      _rng;
+};
+
+#endif
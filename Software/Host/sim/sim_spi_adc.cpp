@@ -0,0 +1,42 @@
+#include "sim_spi_adc.h"
+#include "sim_clock.h"
+#include <string.h>
+
+SimSpiAdc::SimSpiAdc(sim_adc_generator_t generator, void* ctx)
+    : _generator(generator), _ctx(ctx), _chain(NULL), _pending(0), _transfers(0) {
+    memset(_mux, 0, sizeof(_mux));
+}
+
+bool SimSpiAdc::start(SpiAdcChain* chain) {
+    _chain = chain;
+    memset(_mux, 0, sizeof(_mux));
+    return true;
+}
+
+void SimSpiAdc::stop() {
+    if(_pending != 0) {
+        sim_cancel(_pending);
+        _pending = 0;
+    }
+    _chain = NULL;
+}
+
+void SimSpiAdc::transfer(uint8_t chip, const uint16_t* tx, uint16_t* rx, uint32_t words) {
+    uint64_t start = sim_now_us() + SIM_SPI_ADC_SETUP_US;
+    uint64_t bit_ns = 1000000000ULL / STAND_ADC_SCLK_HZ;
+    for(uint32_t i = 0; i < words; i++) {
+        uint32_t t_us = (uint32_t)(start + i * 16 * bit_ns / 1000);
+        uint16_t v = _generator(chip, _mux[chip], t_us, _ctx);
+        rx[i] = v > STAND_ADC_FULL_SCALE ? STAND_ADC_FULL_SCALE : v;
+        _mux[chip] = (tx[i] >> 11) & (STAND_ADC_CHANNELS - 1);
+    }
+    _transfers++;
+
+    uint64_t done = start + (words * 16 * bit_ns + 999) / 1000;
+    _pending = sim_schedule(done, [this]() {
+        _pending = 0;
+        if(_chain != NULL) {
+            _chain->on_transfer_done();
+        }
+    });
+}
@@ -0,0 +1,37 @@
+#ifndef SIM_SPI_ADC_H
+#define SIM_SPI_ADC_H
+
+#include <stdint.h>
+#include "stand_adc.h"
+
+// ==================== SIMULATED ADC128S102 BUS ====================
+// Stands in for SPI2, its DMA and the chips on it. Each transaction is
+// decoded the way the ADC reads it (the channel converted in a word is the
+// one addressed in the word before, across transactions too), sampled
+// from a generator at each word's own time, and completed on the virtual
+// clock after the time the bits take at STAND_ADC_SCLK_HZ plus the select
+// and DMA set-up.
+#define SIM_SPI_ADC_SETUP_US    2
+
+typedef uint16_t (*sim_adc_generator_t)(uint8_t chip, uint8_t channel, uint32_t t_us, void* ctx);
+
+class SimSpiAdc : public SpiAdcBus {
+public:
+    SimSpiAdc(sim_adc_generator_t generator, void* ctx);
+
+    virtual bool start(SpiAdcChain* chain);
+    virtual void stop();
+    virtual void transfer(uint8_t chip, const uint16_t* tx, uint16_t* rx, uint32_t words);
+
+    uint32_t transfers() const { return _transfers; }
+
+private:
+    sim_adc_generator_t _generator;
+    void*               _ctx;
+    SpiAdcChain*        _chain;
+    uint32_t            _pending;           // Completion event, 0 = none
+    uint32_t            _transfers;
+    uint8_t             _mux[STAND_ADC_MAX];
+};
+
+#endif
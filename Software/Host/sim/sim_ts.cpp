@@ -0,0 +1,40 @@
+#include "stm32746g_discovery_ts.h"
+#include "mbed.h"
+#include <string.h>
+
+// ==================== VIRTUAL TOUCH PANEL ====================
+static bool     sim_pressed = false;
+static uint16_t sim_x = 0;
+static uint16_t sim_y = 0;
+static uint32_t sim_polls = 0;
+
+uint8_t BSP_TS_Init(uint16_t, uint16_t) {
+    return TS_OK;
+}
+
+uint8_t BSP_TS_GetState(TS_StateTypeDef* TS_State) {
+    sim_polls++;
+    memset(TS_State, 0, sizeof(*TS_State));
+    if(sim_pressed) {
+        TS_State->touchDetected = 1;
+        TS_State->touchX[0] = sim_x;
+        TS_State->touchY[0] = sim_y;
+    }
+    return TS_OK;
+}
+
+uint8_t BSP_TS_ITConfig(void) {
+    sim_pin_set(PI_13, sim_pressed ? 0 : 1);
+    return TS_OK;
+}
+
+void sim_touch_set(bool pressed, uint16_t x, uint16_t y) {
+    sim_pressed = pressed;
+    sim_x = x;
+    sim_y = y;
+    sim_pin_set(PI_13, pressed ? 0 : 1);
+}
+
+uint32_t sim_touch_polls() {
+    return sim_polls;
+}
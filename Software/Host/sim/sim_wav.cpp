@@ -0,0 +1,89 @@
+#include "sim_wav.h"
+#include <string.h>
+
+#define SIM_WAV_HEADER_BYTES    44
+
+WavAudioSink::WavAudioSink(const char* path, sim_audio_tap_t tap, void* ctx)
+    : _path(path), _tap(tap), _ctx(ctx), _file(NULL), _engine(NULL), _half(0), _frames(0) {
+}
+
+WavAudioSink::~WavAudioSink() {
+    stop();
+    if(_file != NULL) {
+        fclose(_file);
+    }
+}
+
+// A restart after stop() (the engine paused) appends to the same file
+bool WavAudioSink::start(AudioEngine* engine) {
+    if(_path != NULL && _file == NULL) {
+        _file = fopen(_path, "wb");
+        if(_file == NULL) {
+            return false;
+        }
+        write_header();     // Sizes patched in stop()
+        _frames = 0;
+    }
+    _engine = engine;
+    _half = 0;
+    _ticker.attach_us(callback(this, &WavAudioSink::period),
+                      (uint32_t)((uint64_t)AUDIO_BLOCK_FRAMES * 1000000 / AUDIO_RATE_HZ));
+    return true;
+}
+
+void WavAudioSink::stop() {
+    _ticker.detach();
+    _engine = NULL;
+    if(_file != NULL) {
+        fseek(_file, 0, SEEK_SET);
+        write_header();
+        fseek(_file, 0, SEEK_END);
+    }
+}
+
+// One half played: refill it, as the DMA interrupt would, and keep it
+void WavAudioSink::period() {
+    if(_engine == NULL) {
+        return;
+    }
+    _engine->fill(_half);
+    const int16_t* block = _engine->block(_half);
+    if(_file != NULL) {
+        fwrite(block, 1, _engine->block_bytes(), _file);    // Little-endian host, as WAV is
+    }
+    if(_tap != NULL) {
+        _tap(block, AUDIO_BLOCK_FRAMES, (uint32_t)sim_now_us(), _ctx);
+    }
+    _frames += AUDIO_BLOCK_FRAMES;
+    _half ^= 1;
+}
+
+static void sim_wav_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void sim_wav_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void WavAudioSink::write_header() {
+    uint32_t data = _frames * AUDIO_CHANNELS * sizeof(int16_t);
+    uint8_t h[SIM_WAV_HEADER_BYTES];
+    memcpy(h, "RIFF", 4);
+    sim_wav_u32(h + 4, 36 + data);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    sim_wav_u32(h + 16, 16);
+    sim_wav_u16(h + 20, 1);                                 // PCM
+    sim_wav_u16(h + 22, AUDIO_CHANNELS);
+    sim_wav_u32(h + 24, AUDIO_RATE_HZ);
+    sim_wav_u32(h + 28, AUDIO_RATE_HZ * AUDIO_CHANNELS * sizeof(int16_t));
+    sim_wav_u16(h + 32, AUDIO_CHANNELS * sizeof(int16_t));
+    sim_wav_u16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    sim_wav_u32(h + 40, data);
+    fwrite(h, 1, sizeof(h), _file);
+}
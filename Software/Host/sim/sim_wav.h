@@ -0,0 +1,42 @@
+#ifndef SIM_WAV_H
+#define SIM_WAV_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "mbed.h"
+#include "audio.h"
+
+// ==================== WAV FILE AUDIO SINK ====================
+// Stands in for the codec. A Ticker on the virtual clock takes the place of
+// the DMA half-transfer interrupts, one per block period. Each period
+// fills the half just "played", writes it to a 16-bit stereo WAV file and
+// passes it to an optional tap for analysis. The path can be NULL to use
+// only the tap. stop() leaves a complete file; restarting appends to it,
+// and the file is closed with the sink.
+typedef void (*sim_audio_tap_t)(const int16_t* block, uint32_t frames, uint32_t t_us, void* ctx);
+
+class WavAudioSink : public AudioSink {
+public:
+    WavAudioSink(const char* path, sim_audio_tap_t tap = NULL, void* ctx = NULL);
+    virtual ~WavAudioSink();
+
+    virtual bool start(AudioEngine* engine);
+    virtual void stop();
+
+    uint32_t frames() const { return _frames; }
+
+private:
+    void period();
+    void write_header();
+
+    const char*     _path;
+    sim_audio_tap_t _tap;
+    void*           _ctx;
+    FILE*           _file;
+    AudioEngine*    _engine;
+    Ticker          _ticker;
+    uint8_t         _half;
+    uint32_t        _frames;
+};
+
+#endif
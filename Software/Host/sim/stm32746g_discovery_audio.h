@@ -0,0 +1,13 @@
+#ifndef SIM_STM32746G_DISCOVERY_AUDIO_H
+#define SIM_STM32746G_DISCOVERY_AUDIO_H
+
+// ==================== HOST STAND-IN FOR THE AUDIO BSP ====================
+// The codec sink (SaiAudioSink) is board-only; the host plays the audio
+// engine into a WAV file instead (sim_wav.h). Kept so includes resolve.
+
+#include <stdint.h>
+
+#define AUDIO_OK    ((uint8_t)0)
+#define AUDIO_ERROR ((uint8_t)1)
+
+#endif
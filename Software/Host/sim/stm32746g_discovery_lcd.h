@@ -0,0 +1,78 @@
+#ifndef SIM_STM32746G_DISCOVERY_LCD_H
+#define SIM_STM32746G_DISCOVERY_LCD_H
+
+// ==================== HOST STAND-IN FOR THE LCD BSP ====================
+// Same entry points and semantics as the STM32746G-Discovery BSP, drawing
+// into a software ARGB8888 framebuffer. sim_lcd.h exposes the pixels and
+// the per-frame write counters the benchmarks use.
+
+#include <stdint.h>
+
+typedef struct _tFont {
+    const uint8_t* table;
+    uint16_t Width;
+    uint16_t Height;
+} sFONT;
+
+extern sFONT Font24;
+extern sFONT Font20;
+extern sFONT Font16;
+extern sFONT Font12;
+extern sFONT Font8;
+
+typedef enum {
+    CENTER_MODE = 0x01,
+    RIGHT_MODE  = 0x02,
+    LEFT_MODE   = 0x03
+} Text_AlignModeTypdef;
+
+#define LCD_OK                  ((uint8_t)0x00)
+#define LCD_ERROR               ((uint8_t)0x01)
+#define LCD_FB_START_ADDRESS    ((uint32_t)0xC0000000)
+#define LCD_COLOR_TRANSPARENT   ((uint32_t)0x00000000)
+
+#define BSP_LCD_RELOAD_NONE              ((uint32_t)0x00000000)
+#define BSP_LCD_RELOAD_IMMEDIATE         ((uint32_t)0x00000001)
+#define BSP_LCD_RELOAD_VERTICAL_BLANKING ((uint32_t)0x00000002)
+
+// Just enough of the HAL LTDC handle for the reload-event callback
+typedef struct {
+    uint32_t State;
+} LTDC_HandleTypeDef;
+
+extern LTDC_HandleTypeDef hLtdcHandler;
+
+// Weak in the HAL; the firmware overrides it to learn a reload has landed
+extern "C" void HAL_LTDC_ReloadEventCallback(LTDC_HandleTypeDef* hltdc);
+
+uint8_t  BSP_LCD_Init(void);
+uint32_t BSP_LCD_GetXSize(void);
+uint32_t BSP_LCD_GetYSize(void);
+void     BSP_LCD_LayerDefaultInit(uint16_t LayerIndex, uint32_t FB_Address);
+void     BSP_LCD_SelectLayer(uint32_t LayerIndex);
+void     BSP_LCD_SetLayerAddress_NoReload(uint32_t LayerIndex, uint32_t Address);
+void     BSP_LCD_Reload(uint32_t ReloadType);
+void     BSP_LCD_SetTextColor(uint32_t Color);
+uint32_t BSP_LCD_GetTextColor(void);
+void     BSP_LCD_SetBackColor(uint32_t Color);
+uint32_t BSP_LCD_GetBackColor(void);
+void     BSP_LCD_SetFont(sFONT* fonts);
+sFONT*   BSP_LCD_GetFont(void);
+
+uint32_t BSP_LCD_ReadPixel(uint16_t Xpos, uint16_t Ypos);
+void     BSP_LCD_Clear(uint32_t Color);
+void     BSP_LCD_DisplayStringAt(uint16_t Xpos, uint16_t Ypos, uint8_t* Text, Text_AlignModeTypdef Mode);
+void     BSP_LCD_DisplayChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii);
+
+void     BSP_LCD_DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t pixel);
+void     BSP_LCD_DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length);
+void     BSP_LCD_DrawVLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length);
+void     BSP_LCD_DrawRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height);
+void     BSP_LCD_DrawCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius);
+void     BSP_LCD_FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height);
+void     BSP_LCD_FillCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius);
+
+void     BSP_LCD_DisplayOn(void);
+void     BSP_LCD_DisplayOff(void);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SIM_STM32746G_DISCOVERY_TS_H
+#define SIM_STM32746G_DISCOVERY_TS_H
+
+// ==================== HOST STAND-IN FOR THE TOUCH BSP ====================
+// Touches are injected with sim_touch_set(); BSP_TS_GetState reports them
+// and the controller's INT line (PI_13, active low) is held low while pressed.
+
+#include <stdint.h>
+
+#define TS_MAX_NB_TOUCH     ((uint32_t)5)
+#define TS_OK               ((uint8_t)0x00)
+#define TS_ERROR            ((uint8_t)0x01)
+
+typedef struct {
+    uint8_t  touchDetected;
+    uint16_t touchX[TS_MAX_NB_TOUCH];
+    uint16_t touchY[TS_MAX_NB_TOUCH];
+    uint8_t  touchWeight[TS_MAX_NB_TOUCH];
+    uint8_t  touchEventId[TS_MAX_NB_TOUCH];
+    uint8_t  touchArea[TS_MAX_NB_TOUCH];
+    uint32_t gestureId;
+} TS_StateTypeDef;
+
+uint8_t BSP_TS_Init(uint16_t ts_SizeX, uint16_t ts_SizeY);
+uint8_t BSP_TS_GetState(TS_StateTypeDef* TS_State);
+uint8_t BSP_TS_ITConfig(void);
+
+// Simulator control: press at (x, y), or release when pressed is false
+void     sim_touch_set(bool pressed, uint16_t x, uint16_t y);
+uint32_t sim_touch_polls();     // BSP_TS_GetState calls (I2C transactions)
+
+#endif
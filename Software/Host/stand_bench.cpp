@@ -0,0 +1,218 @@
+// ==================== STAND MANAGER BENCHMARK ====================
+// Runs the stand manager (stands.h) on the simulated ADC128S102 bus for
+// 1 to STAND_MAX stands. Each stand sees its own laser spot swinging across
+// the row and its IR beam broken every few seconds. For each stand count
+// the benchmark reports:
+//  - chain: SPI time for one scan of every chip, on the virtual clock;
+//  - pass: host time to decide every stand from one scan, and that as a
+//    share of the scan period (the board's Cortex-M7 differs, but the
+//    growth with the number of stands is the same);
+//  - latency: scan to directive, virtual time, mean and worst stand;
+//  - STOP: beam broken to STOP published, worst case;
+//  - agree: decisions that match the noise-free reference.
+// Exits 1 if any beam break went without a STOP.
+//
+//   stand_bench [-s seconds] [-n max_stands]
+
+#include "mbed.h"
+#include "marshalling.h"
+#include "stands.h"
+#include "profiler.h"
+#include "sim_spi_adc.h"
+#include "approach.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SECONDS       20
+#define BENCH_TRIP_EVERY_S  5.0f            // IR beam broken once per this...
+#define BENCH_TRIP_FOR_S    1.2f            // ...for this long
+#define BENCH_NOISE         0.03f
+
+static const ApproachScenario bench_sc = {
+    "bench", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.30f, BENCH_NOISE, 0.0f, 1
+};
+
+struct BenchStand {
+    bool     broken;
+    uint64_t broken_us;
+    bool     stop_pending;
+    uint32_t trips;
+    uint32_t stops;
+    uint64_t stop_max_us;
+    uint8_t  ideal;
+    uint32_t agree;
+    uint32_t decisions;
+};
+
+static BenchStand bench[STAND_MAX];
+static uint8_t    bench_n = 0;
+static uint32_t   bench_rng = 1;
+
+static float bench_noise() {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return (bench_rng >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+// Spot offset across the row: each stand swings at its own rate
+static float bench_lateral_cm(uint8_t stand, uint32_t t_us) {
+    float t = t_us / 1e6f;
+    return 3.5f * sinf(6.2832f * t / (3.0f + 0.7f * stand) + stand);
+}
+
+static bool bench_beam_broken(uint8_t stand, uint32_t t_us) {
+    float t = t_us / 1e6f - (1.5f + 0.37f * stand);
+    return t >= 0.0f && fmodf(t, BENCH_TRIP_EVERY_S) < BENCH_TRIP_FOR_S;
+}
+
+// IN0..IN5 the row, IN6 the IR module (low = broken), IN7 unused
+static uint16_t bench_adc(uint8_t chip, uint8_t channel, uint32_t t_us, void*) {
+    if(chip >= bench_n || channel == 7) {
+        return 0;
+    }
+    float v;
+    if(channel == STAND_IR_CHANNEL) {
+        v = bench_beam_broken(chip, t_us) ? 0.05f : 0.95f;
+    } else {
+        v = approach_ldr_level(bench_sc, channel, bench_lateral_cm(chip, t_us)) + BENCH_NOISE * bench_noise();
+    }
+    if(v < 0.0f) v = 0.0f;
+    if(v > 1.0f) v = 1.0f;
+    return (uint16_t)(v * STAND_ADC_FULL_SCALE);
+}
+
+// Noise-free decision for the scan the stand just decided on
+static uint8_t bench_ideal(uint8_t stand, uint32_t t_us) {
+    SensorFrame f;
+    memset(&f, 0, sizeof(f));
+    for(uint8_t ch = 0; ch < LDR_CHANNELS; ch++) {
+        f.ldr_level[ch] = (uint16_t)(approach_ldr_level(bench_sc, ch, bench_lateral_cm(stand, t_us)) *
+                                     LDR_ADC_FULL_SCALE);
+    }
+    f.lateral = lateral_estimate(f.ldr_level, lateral_cal);
+    f.ir = bench_beam_broken(stand, t_us) ? 0 : 1;
+    f.valid = SENSOR_VALID_LDR | SENSOR_VALID_IR;
+    return determine_direction_from_sensors(f, bench[stand].ideal);
+}
+
+static void bench_listener(uint8_t stand, const SensorFrame& f, uint8_t directive) {
+    BenchStand& b = bench[stand];
+    b.ideal = bench_ideal(stand, f.ldr_us);
+    b.decisions++;
+    if(directive == b.ideal) {
+        b.agree++;
+    }
+    if(directive == DIRECTIVE_STOP && b.stop_pending) {
+        uint64_t us = sim_now_us() - b.broken_us;
+        if(us > b.stop_max_us) b.stop_max_us = us;
+        b.stops++;
+        b.stop_pending = false;
+    }
+}
+
+// The world side: when each beam actually broke
+static void bench_watch() {
+    uint32_t now = (uint32_t)sim_now_us();
+    for(uint8_t i = 0; i < bench_n; i++) {
+        bool broken = bench_beam_broken(i, now);
+        if(broken && !bench[i].broken) {
+            bench[i].broken_us = now;
+            bench[i].stop_pending = true;
+            bench[i].trips++;
+        }
+        bench[i].broken = broken;
+    }
+}
+
+// One run with n stands; returns the number of beam breaks without a STOP
+static uint32_t bench_run(uint8_t n, uint32_t seconds) {
+    sim_reset();
+    memset(bench, 0, sizeof(bench));
+    bench_n = n;
+    bench_rng = 1;
+
+    StandConfig configs[STAND_MAX];
+    memset(configs, 0, sizeof(configs));
+    for(uint8_t i = 0; i < n; i++) {
+        snprintf(configs[i].name, STAND_NAME_MAX, "S%u", i + 1);
+        configs[i].adc = i;
+        bench[i].ideal = DIRECTIVE_NONE;
+    }
+
+    SimSpiAdc bus(bench_adc, NULL);
+    Ticker watch;
+    watch.attach_us(bench_watch, 1000);
+    stand_adc.start(&bus, n);
+    stand_manager_start(configs, n, &stand_adc);
+    stand_attach(bench_listener);
+
+    // Settle the filters before measuring
+    sim_advance_to(500000);
+    stand_reset_stats();
+    sim_advance_to(500000 + (uint64_t)seconds * 1000000);
+
+    stand_manager_stop();
+    stand_adc.stop();
+    watch.detach();
+
+    StandPassStats ps = stand_pass_stats();
+    StandAdcStats as = stand_adc.stats();
+    uint64_t lat_sum = 0;
+    uint32_t lat_n = 0, lat_max = 0, shed = 0, agree = 0, decisions = 0, missed = 0;
+    uint64_t stop_max = 0;
+    for(uint8_t i = 0; i < n; i++) {
+        StandStats st = stand_stats(i);
+        lat_sum += st.sum_latency_us;
+        lat_n += st.decisions;
+        if(st.max_latency_us > lat_max) lat_max = st.max_latency_us;
+        shed += st.shed;
+        agree += bench[i].agree;
+        decisions += bench[i].decisions;
+        if(bench[i].stop_max_us > stop_max) stop_max = bench[i].stop_max_us;
+        missed += bench[i].trips - bench[i].stops - (bench[i].stop_pending ? 1 : 0);
+    }
+
+    double pass_us = ps.passes ? (double)ps.sum_cycles / ps.passes / PROF_CYCLES_PER_US : 0.0;
+    double pass_max_us = (double)ps.max_cycles / PROF_CYCLES_PER_US;
+    double period_us = 1e6 / STAND_SCAN_RATE_HZ;
+    printf("   %u    %6u   %5u   %7.1f  %7.1f   %5.2f   %6.1f  %6u   %6.2f   %6.2f   %4u  %3u\n",
+           n, ps.passes, as.max_chain_us, pass_us, pass_max_us, 100.0 * pass_us / period_us,
+           lat_n ? (double)lat_sum / lat_n : 0.0, lat_max, stop_max / 1000.0,
+           decisions ? 100.0 * agree / decisions : 0.0, shed, as.overruns);
+    return missed;
+}
+
+int main(int argc, char** argv) {
+    uint32_t seconds = BENCH_SECONDS;
+    uint32_t max_stands = STAND_MAX;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            max_stands = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-s seconds] [-n max_stands]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(seconds == 0) seconds = BENCH_SECONDS;
+    if(max_stands == 0 || max_stands > STAND_MAX) max_stands = STAND_MAX;
+
+    sim_serial_sink = NULL;     // Directive changes are logged; not wanted here
+    printf("==================== STAND MANAGER BENCHMARK ====================\n");
+    printf("%u s per run, scans at %u Hz, SPI at %.1f MHz, IR broken %.1f s in every %.0f s\n\n",
+           seconds, STAND_SCAN_RATE_HZ, STAND_ADC_SCLK_HZ / 1e6, BENCH_TRIP_FOR_S, BENCH_TRIP_EVERY_S);
+    printf("stands  passes  chain us  pass us  max us   cpu %%  lat us  max us  stop ms  agree %%  shed  ovr\n");
+
+    uint32_t missed = 0;
+    for(uint32_t n = 1; n <= max_stands; n++) {
+        missed += bench_run((uint8_t)n, seconds);
+    }
+    if(missed) {
+        printf("\n%u beam breaks without a STOP\n", missed);
+    }
+    return missed ? 1 : 0;
+}
@@ -0,0 +1,248 @@
+// ==================== STANDBY BENCHMARK ====================
+// Runs the firmware's UI, sampler and sensors (power.h) on an empty stand:
+// no target in range, LDRs dark, IR beam clear. Auto mode is left to go
+// idle, and the bench measures the standby that follows. It then ends a
+// standby each way: an IR edge, a touch, a target coming into range and a
+// light on the LDRs. For each wake it reports how long the UI took to leave
+// standby and, in auto mode, the time from the event to the directive on
+// glass (profiler probe PROF_WAKE). A touch that wakes must not count as a
+// tap, so the screen has to stay in auto mode. Per state it reports sampler
+// passes, echoes, flips and UI wakeups per second, and the estimated draw.
+// Exits 1 if a standby or a wake did not happen, or standby saved nothing.
+//
+//   standby_bench [-i idle_s] [-s standby_s]
+
+#include "mbed.h"
+#include "marshalling.h"
+#include "hmi.h"
+#include "ui.h"
+#include "logger.h"
+#include "profiler.h"
+#include "power.h"
+#include "sim_lcd.h"
+#include "sim_sonar.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_IDLE_S            5           // Shorter than POWER_IDLE_MS, same path
+#define BENCH_STANDBY_S         20
+#define BENCH_EMPTY_CM          600.0f      // Past the HC-SR04's range
+#define BENCH_TARGET_CM         250.0f
+#define BENCH_DARK              0.05f
+#define BENCH_LIT               0.90f
+#define BENCH_PULSE_MS          100         // IR blocked / finger down / light on
+#define BENCH_WAKE_MS           (POWER_STANDBY_RANGE_MS + 500)     // Slowest source
+
+static float    bench_distance_cm = BENCH_EMPTY_CM;
+static bool     bench_lit = false;
+static uint32_t bench_wakeups[POWER_STATES];
+static uint32_t bench_pump_handle = 0;
+
+static void bench_target(uint32_t, float* x, float* y, void*) {
+    *x = 0.0f;
+    *y = bench_distance_cm;
+}
+
+static uint16_t bench_ldr(uint8_t channel, uint32_t, void*) {
+    float v = (bench_lit && channel < 5) ? BENCH_LIT : BENCH_DARK;
+    return (uint16_t)(v * LDR_ADC_FULL_SCALE);
+}
+
+static SyntheticLdrSource bench_ldr_source(bench_ldr, NULL);
+
+// The DMA's half-buffer cadence at whatever rate the scan runs
+static void bench_pump() {
+    bench_ldr_source.pump((uint32_t)sim_now_us());
+    bench_pump_handle = sim_schedule(sim_now_us() + LDR_DMA_HALF_FRAMES * bench_ldr_source.period_us(),
+                                     bench_pump);
+}
+
+// Runs the UI until pred holds or timeout_ms passes; returns the ms taken
+static uint32_t bench_until(bool (*pred)(), uint32_t timeout_ms) {
+    uint64_t start = sim_now_us();
+    while(!pred() && sim_now_us() - start < (uint64_t)timeout_ms * 1000) {
+        ui_queue.dispatch(1);
+    }
+    return (uint32_t)((sim_now_us() - start) / 1000);
+}
+
+static bool bench_in_standby() {
+    return power_standby();
+}
+
+static bool bench_awake() {
+    return !power_standby();
+}
+
+static void bench_ir(bool blocked) {
+    sim_pin_set(D8, blocked ? 0 : 1);
+}
+
+static void bench_touch(bool down) {
+    sim_touch_set(down, SCREEN_W / 2, SCREEN_H / 2);
+}
+
+static void bench_range(bool near) {
+    bench_distance_cm = near ? BENCH_TARGET_CM : BENCH_EMPTY_CM;
+}
+
+static void bench_light(bool on) {
+    bench_lit = on;
+}
+
+struct BenchWake {
+    const char* name;
+    uint8_t     source;                     // POWER_WAKE_*
+    void        (*stimulus)(bool on);
+    uint32_t    hold_ms;                    // Before it is taken away again
+};
+
+static const BenchWake wakes[] = {
+    {"IR edge", POWER_WAKE_IR, bench_ir, BENCH_PULSE_MS},
+    {"touch", POWER_WAKE_TOUCH, bench_touch, BENCH_PULSE_MS},
+    {"range", POWER_WAKE_RANGE, bench_range, BENCH_WAKE_MS},
+    {"LDR", POWER_WAKE_LDR, bench_light, BENCH_PULSE_MS * 3},
+};
+
+#define BENCH_WAKES     (sizeof(wakes) / sizeof(wakes[0]))
+
+static void print_state(const PowerStats& s, uint8_t state, const char* name) {
+    const PowerStateStats& t = s.states[state];
+    double secs = t.ms / 1000.0;
+    if(secs <= 0.0) {
+        return;
+    }
+    uint32_t ma10 = power_estimate_ma10(s, state);
+    printf("%-8s %8.1f  %8.1f  %8.2f  %7.1f  %9.1f  %5u.%u\n", name, secs, t.passes / secs, t.echoes / secs,
+           t.flips / secs, bench_wakeups[state] / secs, ma10 / 10, ma10 % 10);
+}
+
+int main(int argc, char** argv) {
+    uint32_t idle_s = BENCH_IDLE_S;
+    uint32_t standby_s = BENCH_STANDBY_S;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            idle_s = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            standby_s = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-i idle_s] [-s standby_s]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(idle_s == 0) idle_s = BENCH_IDLE_S;
+    if(standby_s == 0) standby_s = BENCH_STANDBY_S;
+
+    printf("==================== STANDBY BENCHMARK ====================\n");
+    printf("empty stand, auto mode, idle %u s, standby measured over %u s\n", idle_s, standby_s);
+    printf("standby: LDR scan %u Hz, ranging every %u ms, telemetry %u Hz\n\n", POWER_STANDBY_LDR_HZ,
+           POWER_STANDBY_RANGE_MS, POWER_STANDBY_TELEMETRY_HZ);
+
+    sim_reset();
+    sim_touch_set(false, 0, 0);
+    sim_pin_set(D8, 1);
+    sim_pin_set(D5, 0);
+    lcd_init();
+    memset(bench_wakeups, 0, sizeof(bench_wakeups));
+    sim_set_wake_hook([]() { bench_wakeups[power_standby() ? POWER_STATE_STANDBY : POWER_STATE_ACTIVE]++; });
+
+    SimSonar sonar = {D6, D5, 0.0f, 0x01};
+    SimSonarField field(&sonar, 1, bench_target, NULL);
+    field.begin();
+    ldr_scan.start(&bench_ldr_source);
+    bench_pump();
+    ranger.start(US_DEFAULT_PERIOD_MS);
+    sensor_sampler_start();
+    power_start(idle_s * 1000);
+    ui_start();
+
+    Ticker log_tick;
+    log_tick.attach_us([]() { log_drain(); }, LOG_DRAIN_IDLE_MS * 1000);
+    prof_reset();
+
+    uint32_t failures = 0;
+    ui_queue.call([]() { ui_show(UI_SCREEN_AUTO); });
+    uint32_t took = bench_until(bench_in_standby, idle_s * 1000 + 1000);
+    if(!power_standby()) {
+        printf("no standby after %u ms idle\n", took);
+        failures++;
+    }
+    bench_until(bench_awake, standby_s * 1000);     // Nothing should end it
+    if(!power_standby()) {
+        printf("standby ended on an empty stand\n");
+        failures++;
+    }
+    PowerStats measured = power_stats();
+
+    printf("wake       exit ms  on glass ms  screen\n");
+    for(uint32_t i = 0; i < BENCH_WAKES && failures == 0; i++) {
+        const BenchWake& w = wakes[i];
+        if(i > 0) {
+            bench_until(bench_in_standby, idle_s * 1000 + 1000);
+            if(!power_standby()) {
+                printf("no standby before the %s wake\n", w.name);
+                failures++;
+                break;
+            }
+        }
+        const ProfHistogram* h = prof_histogram(PROF_WAKE);
+        uint32_t count_before = h->count;
+        uint64_t sum_before = h->sum;
+
+        w.stimulus(true);
+        uint32_t exit_ms = bench_until(bench_awake, BENCH_WAKE_MS);
+        bool woke = !power_standby();
+        uint32_t held = exit_ms;
+        while(held < w.hold_ms) {
+            ui_queue.dispatch(1);
+            held++;
+        }
+        w.stimulus(false);
+        ui_queue.dispatch(UI_TOUCH_RELEASE_MS * 2);     // Frame up; a finger lifted
+
+        PowerStats s = power_stats();
+        bool ok = woke && s.last_wake == w.source && ui_screen() == UI_SCREEN_AUTO &&
+                  h->count == count_before + 1;
+        char glass[16];
+        if(h->count > count_before) {
+            double us = (double)(h->sum - sum_before) / (h->count - count_before) / PROF_CYCLES_PER_US;
+            snprintf(glass, sizeof(glass), "%.1f", us / 1000.0);
+        } else {
+            snprintf(glass, sizeof(glass), "-");
+        }
+        printf("%-8s %9u  %11s  %s\n", w.name, exit_ms, glass, ui_screen() == UI_SCREEN_AUTO ? "auto" : "left auto");
+        if(!ok) {
+            printf("  ^ wrong (woken by %s)\n", power_wake_name(s.last_wake));
+            failures++;
+        }
+    }
+
+    ui_stop();
+    power_stop();
+    log_drain();
+    log_tick.detach();
+    sensor_sampler_stop();
+    ranger.stop();
+    ldr_scan.stop();
+    sim_cancel(bench_pump_handle);
+    field.end();
+    sim_set_wake_hook(std::function<void()>());
+
+    printf("\nstate        secs  passes/s  echoes/s  flips/s  UI wake/s  est. mA\n");
+    print_state(measured, POWER_STATE_ACTIVE, "active");
+    print_state(measured, POWER_STATE_STANDBY, "standby");
+    uint32_t active_ma10 = power_estimate_ma10(measured, POWER_STATE_ACTIVE);
+    uint32_t standby_ma10 = power_estimate_ma10(measured, POWER_STATE_STANDBY);
+    if(active_ma10 != 0) {
+        printf("\nstandby draws %.0f%% of active\n", 100.0 * standby_ma10 / active_ma10);
+    }
+    if(standby_ma10 == 0 || standby_ma10 >= active_ma10) {
+        printf("standby saved nothing\n");
+        failures++;
+    }
+    if(failures) {
+        printf("\n%u failures\n", failures);
+    }
+    return failures ? 1 : 0;
+}
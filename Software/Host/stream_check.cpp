@@ -0,0 +1,370 @@
+// ==================== SERIAL STREAM CHECK ====================
+// Runs the firmware on an aircraft approach with the binary telemetry
+// stream owning the serial port, as on the board, so its log lines go down
+// the stream as log records between the sensor records. The capture is
+// then read back by telemetry_decode, the PC tool, run as its own process.
+// Checks that what the diagnostics screen sends comes out whole:
+//  - memory report at boot, sent as main() does once the system is up;
+//  - memory DUMP: every budget entry, with the size and use it had then;
+//  - profiler DUMP: the header and, for every probe with samples, its two
+//    lines with the count it had when the button was pressed;
+//  - black-box stream, once the recorder has gone round its whole ring:
+//    telemetry_decode -b has to give back every block blackbox_export()
+//    had at that moment, byte for byte, with the stream's own log lines
+//    around it intact.
+// The capture has to decode with no bad or unknown frames and no log lines
+// dropped. Exits 1 on any mismatch.
+//
+//   stream_check
+// telemetry_decode is taken from stream_check's own directory. The capture,
+// the decoded log and the rebuilt recording are left next to it as
+// stream_check.bin, .log and .bbx.
+
+#include "mbed.h"
+#include "marshalling.h"
+#include "hmi.h"
+#include "ui.h"
+#include "telemetry.h"
+#include "logger.h"
+#include "profiler.h"
+#include "memstats.h"
+#include "blackbox.h"
+#include "sim_lcd.h"
+#include "approach.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK_RUN_MS            8000        // Approach before the buttons
+#define CHECK_SETTLE_MS         500         // After each, for the log to drain
+#define CHECK_WRAP_TIMEOUT_MS   300000      // For the black box to go round its ring
+#define CHECK_LOG_LINES         1024
+#define CHECK_LINE_MAX          256
+#define CHECK_PATH_MAX          512
+
+static const ApproachScenario check_scenario =
+    {"centreline", 300.0f, 15.0f, 40.0f, 60.0f, 0.0f, 0.0f, 1.5f, 600.0f, 0.10f, 0.02f, 0.0f, 1};
+
+// What telemetry_decode made of the capture
+struct Decoded {
+    unsigned long records, missing, bad, unknown, logs;
+    unsigned long blocks, broken;
+    uint32_t      lines;
+    char          line[CHECK_LOG_LINES][CHECK_LINE_MAX];
+};
+
+static Decoded  decoded;
+static uint32_t check_failures = 0;
+
+// Probe counts when the DUMP ran
+static uint32_t dump_counts[PROF_PROBES];
+
+// The memory budget when each report was written
+struct MemSnapshot {
+    uint8_t  n;
+    MemEntry e[MEM_ENTRIES_MAX];
+    MemHeap  heap;
+};
+
+static MemSnapshot boot_mem, dump_mem;
+
+// The ring as blackbox_export() gave it just before the stream
+struct RingCopy {
+    uint32_t blocks;
+    uint32_t bytes;
+    uint8_t  data[BLACKBOX_BLOCKS * BLACKBOX_BLOCK_BYTES];
+};
+
+static RingCopy ring_copy;
+
+static bool copy_block(const uint8_t* block, uint32_t len, void* ctx) {
+    RingCopy* r = (RingCopy*)ctx;
+    if(r->bytes + len > sizeof(r->data)) {
+        return false;
+    }
+    memcpy(r->data + r->bytes, block, len);
+    r->bytes += len;
+    r->blocks++;
+    return true;
+}
+
+static void mem_snapshot(MemSnapshot* m) {
+    m->n = mem_entries(m->e, MEM_ENTRIES_MAX);
+    m->heap = mem_heap();
+}
+
+static void fail(const char* what, const char* detail = "") {
+    printf("  FAIL %s %s\n", what, detail);
+    check_failures++;
+}
+
+static bool run_decoder(const char* tool, const char* base) {
+    char cmd[6 * CHECK_PATH_MAX];
+    snprintf(cmd, sizeof(cmd), "'%s' -b '%s.bbx' -l '%s.log' '%s.bin' > /dev/null 2> '%s.err'", tool, base, base,
+             base, base);
+    if(system(cmd) != 0) {
+        fprintf(stderr, "stream_check: could not run %s\n", tool);
+        return false;
+    }
+
+    char path[CHECK_PATH_MAX + 8];
+    snprintf(path, sizeof(path), "%s.err", base);
+    FILE* f = fopen(path, "r");
+    bool summary = false;
+    char text[CHECK_LINE_MAX];
+    while(f != NULL && fgets(text, sizeof(text), f) != NULL) {
+        unsigned long v[5];
+        if(sscanf(text, "telemetry_decode: %lu records, %lu missing, %lu bad frames, %lu unknown, %lu log lines",
+                  &v[0], &v[1], &v[2], &v[3], &v[4]) == 5) {
+            decoded.records = v[0];
+            decoded.missing = v[1];
+            decoded.bad = v[2];
+            decoded.unknown = v[3];
+            decoded.logs = v[4];
+            summary = true;
+        } else if(sscanf(text, "telemetry_decode: %lu black-box blocks written, %lu broken", &v[0], &v[1]) == 2) {
+            decoded.blocks = v[0];
+            decoded.broken = v[1];
+        }
+    }
+    if(f != NULL) {
+        fclose(f);
+    }
+    remove(path);
+
+    snprintf(path, sizeof(path), "%s.log", base);
+    f = fopen(path, "r");
+    while(f != NULL && decoded.lines < CHECK_LOG_LINES &&
+          fgets(decoded.line[decoded.lines], CHECK_LINE_MAX, f) != NULL) {
+        decoded.line[decoded.lines][strcspn(decoded.line[decoded.lines], "\r\n")] = '\0';
+        decoded.lines++;
+    }
+    if(f != NULL) {
+        fclose(f);
+    }
+    return summary;
+}
+
+// The message of a decoded "[s.ms] L text" line, NULL for anything else
+static const char* log_text(uint32_t i) {
+    const char* s = decoded.line[i];
+    const char* end = strchr(s, ']');
+    if(s[0] != '[' || end == NULL || end[1] != ' ' || end[2] == '\0' || end[3] != ' ') {
+        return NULL;
+    }
+    return end + 4;
+}
+
+// First line from `from` on whose message starts with prefix
+static int find_log(const char* prefix, uint32_t from) {
+    for(uint32_t i = from; i < decoded.lines; i++) {
+        const char* t = log_text(i);
+        if(t != NULL && strncmp(t, prefix, strlen(prefix)) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// ==================== CASES ====================
+// One mem_report() from line `from` on; returns the line after it, or -1
+static int check_mem_report(const char* name, const MemSnapshot& m, int from) {
+    char want[CHECK_LINE_MAX];
+    snprintf(want, sizeof(want), "memory budget, bytes: %u entries", m.n);
+    int at = find_log(want, from);
+    if(at < 0) {
+        fail(name, "no header");
+        return -1;
+    }
+    for(uint8_t i = 0; i < m.n; i++) {
+        const MemEntry& e = m.e[i];
+        int k = snprintf(want, sizeof(want), "  %-10s %-5s %8u", e.name, mem_where_name(e.where), e.size);
+        if(e.used != MEM_NA) {
+            snprintf(want + k, sizeof(want) - k, "  used %u", e.used);
+        }
+        const char* t = log_text(++at);
+        if(t == NULL || strcmp(t, want) != 0) {
+            fail(name, want);
+            return -1;
+        }
+    }
+    if(m.heap.available) {
+        at++;
+    }
+    snprintf(want, sizeof(want), "  %u allocations after boot", m.heap.late);
+    const char* t = log_text(++at);
+    if(t == NULL || strncmp(t, want, strlen(want)) != 0) {
+        fail(name, want);
+        return -1;
+    }
+    printf("%-17s %2u entries, %u lines    ok\n", name, m.n, m.n + (m.heap.available ? 3 : 2));
+    return at + 1;
+}
+
+static void check_prof_dump() {
+    int at = find_log("profile, times in us", 0);
+    uint32_t probes = 0;
+    if(at < 0) {
+        fail("profiler DUMP:", "no header");
+        return;
+    }
+    for(uint8_t p = 0; p < PROF_PROBES; p++) {
+        if(dump_counts[p] == 0) {
+            continue;
+        }
+        char want[CHECK_LINE_MAX];
+        snprintf(want, sizeof(want), "  %-14s n %6u  mean", prof_name(p), dump_counts[p]);
+        const char* t = log_text(++at);
+        if(t == NULL || strncmp(t, want, strlen(want)) != 0) {
+            fail("profiler DUMP, expected:", want);
+            return;
+        }
+        snprintf(want, sizeof(want), "  %-14s p50", prof_name(p));
+        t = log_text(++at);
+        if(t == NULL || strncmp(t, want, strlen(want)) != 0) {
+            fail("profiler DUMP, expected:", want);
+            return;
+        }
+        probes++;
+    }
+    printf("profiler DUMP     %2u probes, %u lines    ok\n", probes, 1 + 2 * probes);
+}
+
+static void check_blackbox(const char* base, uint32_t recorded) {
+    char path[CHECK_PATH_MAX + 8];
+    snprintf(path, sizeof(path), "%s.bbx", base);
+    FILE* f = fopen(path, "rb");
+    static uint8_t rebuilt[sizeof(ring_copy.data) + 1];
+    size_t n = f != NULL ? fread(rebuilt, 1, sizeof(rebuilt), f) : 0;
+    if(f != NULL) {
+        fclose(f);
+    }
+
+    if(recorded <= BLACKBOX_BLOCKS) {
+        fail("black box:", "the ring never wrapped");
+    }
+    if(decoded.blocks != ring_copy.blocks || decoded.broken != 0) {
+        fail("black box:", "blocks lost or broken");
+    }
+    if(n != ring_copy.bytes || memcmp(rebuilt, ring_copy.data, n) != 0) {
+        fail("black box:", "rebuilt recording differs from the ring");
+        return;
+    }
+    char want[CHECK_LINE_MAX];
+    snprintf(want, sizeof(want), "black box: streaming %u blocks", ring_copy.blocks);
+    int at = find_log(want, 0);
+    snprintf(want, sizeof(want), "black box: %u bytes sent", ring_copy.bytes);
+    if(at < 0 || find_log(want, at) < 0) {
+        fail("black box:", "stream log lines missing");
+        return;
+    }
+    printf("black-box stream  %u of %u blocks, %u bytes    ok\n", ring_copy.blocks, recorded, ring_copy.bytes);
+}
+
+int main(int argc, char** argv) {
+    // Tools sit side by side in the build directory
+    char base[CHECK_PATH_MAX], tool[CHECK_PATH_MAX];
+    snprintf(base, sizeof(base), "%s", argv[0]);
+    const char* slash = strrchr(argv[0], '/');
+    int dir = slash ? (int)(slash - argv[0] + 1) : 0;
+    snprintf(tool, sizeof(tool), "%s%.*stelemetry_decode", dir ? "" : "./", dir, argv[0]);
+
+    char path[CHECK_PATH_MAX + 8];
+    snprintf(path, sizeof(path), "%s.bin", base);
+    FILE* wire = fopen(path, "wb");
+    if(wire == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    printf("==================== SERIAL STREAM CHECK ====================\n");
+    sim_reset();
+    sim_touch_set(false, 0, 0);
+    sim_serial_sink = wire;
+    lcd_init();
+    telemetry_init(TELEMETRY_RATE_HZ);
+
+    Ticker log_tick;
+    log_tick.attach_us([]() { log_drain(); }, LOG_DRAIN_IDLE_MS * 1000);
+    Ticker telemetry_tick;
+    telemetry_tick.attach_us(telemetry_sample, 1000000 / TELEMETRY_RATE_HZ);
+    prof_reset();
+
+    // Boot as main() ends it: the budget goes out once the UI is up
+    ui_start();
+    mem_seal();
+    mem_snapshot(&boot_mem);
+    mem_report();
+
+    approach_begin(check_scenario);
+    ldr_scan.start(&approach_ldr_source());
+    ranger.start(US_DEFAULT_PERIOD_MS);
+    sensor_sampler_start();
+    ui_queue.call([]() { ui_show(UI_SCREEN_AUTO); });
+    ui_queue.dispatch(CHECK_RUN_MS);
+
+    // The aircraft stays parked while the recorder goes round its ring
+    ui_queue.call([]() { stop_automation(); ui_show(UI_SCREEN_HOME); });
+    for(uint32_t ms = 0; blackbox_stats().blocks <= BLACKBOX_BLOCKS && ms < CHECK_WRAP_TIMEOUT_MS; ms += 1000) {
+        ui_queue.dispatch(1000);
+    }
+
+    // As the diagnostics screen's buttons do, with the stream still running
+    ui_queue.call([]() { ui_show(UI_SCREEN_DIAG); });
+    ui_queue.dispatch(CHECK_SETTLE_MS);
+    ui_queue.call([]() {
+        for(uint8_t p = 0; p < PROF_PROBES; p++) {
+            dump_counts[p] = prof_histogram(p)->count;
+        }
+        prof_dump();
+    });
+    ui_queue.dispatch(CHECK_SETTLE_MS);
+    ui_queue.call([]() {
+        mem_snapshot(&dump_mem);
+        mem_report();
+    });
+    ui_queue.dispatch(CHECK_SETTLE_MS);
+    ui_queue.call([]() {
+        blackbox_export(copy_block, &ring_copy);
+        blackbox_stream_async();
+    });
+    ui_queue.dispatch(CHECK_SETTLE_MS);
+    uint32_t recorded = blackbox_stats().blocks;
+
+    ui_stop();
+    log_drain();
+    log_tick.detach();
+    telemetry_tick.detach();
+    sensor_sampler_stop();
+    ranger.stop();
+    ldr_scan.stop();
+    approach_end();
+    sim_serial_sink = NULL;
+    fclose(wire);
+
+    LogStats ls = log_stats();
+    if(!run_decoder(tool, base)) {
+        fail("telemetry_decode:", "no summary");
+        return 1;
+    }
+    printf("stream            %lu records, %lu log lines, %lu bad frames, %lu unknown\n", decoded.records,
+           decoded.logs, decoded.bad, decoded.unknown);
+    if(decoded.bad != 0 || decoded.unknown != 0 || decoded.records == 0) {
+        fail("stream:", "frames lost");
+    }
+    if(ls.dropped != 0 || decoded.logs != ls.drained) {
+        fail("log:", "lines lost");
+    }
+
+    int at = check_mem_report("memory at boot", boot_mem, 0);
+    if(at >= 0) {
+        check_mem_report("memory DUMP", dump_mem, at);
+    }
+    check_prof_dump();
+    check_blackbox(base, recorded);
+
+    if(check_failures) {
+        printf("\n%u failures\n", check_failures);
+    }
+    return check_failures ? 1 : 0;
+}
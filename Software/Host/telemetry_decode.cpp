@@ -0,0 +1,302 @@
+// ==================== TELEMETRY DECODER ====================
+// Turns the firmware's binary telemetry stream (telemetry_codec.h) into CSV.
+// Reads a capture file, or stdin, e.g. straight from the serial port:
+//
+//   telemetry_decode [-b out.bbx] [-m prefix] [-l log.txt] [file]  > run.csv
+//   stty -F /dev/ttyACM0 460800 raw && telemetry_decode /dev/ttyACM0
+//
+// Frames that fail COBS, CRC or version checks are skipped. Counts go to
+// stderr. The firmware's log lines and console text come as log records
+// and are printed to stderr as they arrive, or written to log.txt with -l.
+// With -b, black-box blocks streamed by the firmware (blackbox_stream())
+// are put back together and written to out.bbx for blackbox_replay.
+// With -m, the screen mirror (mirror.h) is rebuilt and each finished
+// mirror frame written as <prefix>NNNNN.ppm; ffmpeg -i <prefix>%05d.ppm
+// makes a video of it. Until the first whole-screen frame, the picture is
+// black where nothing has been sent yet.
+
+#include "telemetry_codec.h"
+#include "blackbox_codec.h"
+#include "mirror_codec.h"
+#include <stdio.h>
+#include <string.h>
+
+// Longer runs between delimiters cannot be telemetry
+#define DECODE_FRAME_MAX    256
+
+// The board's panel
+#define DECODE_SCREEN_W     480
+#define DECODE_SCREEN_H     272
+
+struct DecodeStats {
+    unsigned long records;
+    unsigned long bad_frames;   // COBS/CRC/length failures
+    unsigned long unknown;      // Valid CRC but newer version or type
+    unsigned long gaps;         // Records missing by sequence number
+    unsigned long blocks;       // Black-box blocks rebuilt
+    unsigned long broken;       // Black-box blocks with a piece missing or bad
+    unsigned long tiles;        // Mirror tiles drawn
+    unsigned long frames;       // Mirror frames finished
+    unsigned long torn;         // Mirror frames with a tile missing or bad
+    unsigned long logs;         // Log lines and console text
+};
+
+// The mirrored screen as it is being rebuilt
+struct MirrorView {
+    const char* prefix;         // NULL: count only
+    bool        in_frame;       // Tiles of an unfinished frame seen
+    uint16_t    frame;
+    bool        damaged;        // A tile of this frame was lost
+    unsigned long written;
+    uint16_t    pixels[DECODE_SCREEN_W * DECODE_SCREEN_H];
+};
+
+// One black-box block being put back together from its pieces
+struct BlockAssembly {
+    uint32_t block;
+    uint16_t total;
+    uint16_t have;              // 0 = waiting for a first piece
+    uint8_t  data[BLACKBOX_BLOCK_BYTES];
+};
+
+static void take_chunk(const TelemetryChunk& c, BlockAssembly* a, FILE* out, DecodeStats* st) {
+    if(c.offset == 0) {
+        if(a->have != 0) {
+            st->broken++;
+        }
+        a->block = c.block;
+        a->total = c.total;
+        a->have = 0;
+    } else if(a->have == 0 || c.block != a->block || c.offset != a->have || c.total != a->total) {
+        if(a->have != 0) {
+            st->broken++;
+        }
+        a->have = 0;
+        return;
+    }
+    if(a->total > sizeof(a->data) || a->have + c.len > a->total) {
+        st->broken++;
+        a->have = 0;
+        return;
+    }
+    memcpy(a->data + a->have, c.data, c.len);
+    a->have = (uint16_t)(a->have + c.len);
+    if(a->have < a->total) {
+        return;
+    }
+
+    BlackboxReader r;
+    BlackboxHeader h;
+    if(blackbox_open(&r, a->data, a->total, &h) == BLACKBOX_OK) {
+        st->blocks++;
+        if(out != NULL) {
+            fwrite(a->data, 1, a->total, out);
+        }
+    } else {
+        st->broken++;
+    }
+    a->have = 0;
+}
+
+static void write_mirror(MirrorView* v) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s%05lu.ppm", v->prefix, v->written++);
+    FILE* f = fopen(path, "wb");
+    if(f == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", DECODE_SCREEN_W, DECODE_SCREEN_H);
+    for(int i = 0; i < DECODE_SCREEN_W * DECODE_SCREEN_H; i++) {
+        uint16_t p = v->pixels[i];
+        uint8_t r = (uint8_t)(p >> 11), g = (uint8_t)((p >> 5) & 0x3F), b = (uint8_t)(p & 0x1F);
+        uint8_t rgb[3] = {
+            (uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)), (uint8_t)((b << 3) | (b >> 2))
+        };
+        fwrite(rgb, 1, 3, f);
+    }
+    fclose(f);
+}
+
+// A frame's tiles arrive in order; one that starts before the last ended
+// means tiles were lost, and what they covered is stale until resent
+static void take_mirror(const TelemetryMirror& m, MirrorView* v, DecodeStats* st) {
+    if(v->in_frame && m.frame != v->frame) {
+        st->torn++;
+        v->damaged = false;
+    }
+    v->in_frame = true;
+    v->frame = m.frame;
+    if(mirror_apply(m.data, m.len, m.x, m.y, m.w, m.h, v->pixels, DECODE_SCREEN_W, DECODE_SCREEN_H) == MIRROR_OK) {
+        st->tiles++;
+    } else {
+        v->damaged = true;
+    }
+    if(m.flags & TELEMETRY_MIRROR_LAST) {
+        if(v->damaged) {
+            st->torn++;
+        }
+        st->frames++;
+        v->in_frame = false;
+        v->damaged = false;
+        if(v->prefix != NULL) {
+            write_mirror(v);
+        }
+    }
+}
+
+// As the firmware prints it when the stream does not own the port
+static void print_log(const TelemetryLog& l, FILE* out) {
+    static const char level_tag[] = { 'D', 'I', 'W', 'E' };
+    if(l.level == TELEMETRY_LOG_TEXT) {
+        fwrite(l.text, 1, l.len, out);
+    } else {
+        unsigned long ms = l.timestamp_us / 1000;
+        fprintf(out, "[%6lu.%03lu] %c %.*s\n", ms / 1000, ms % 1000, level_tag[l.level & 3], l.len, l.text);
+    }
+    fflush(out);
+}
+
+static void print_record(const TelemetrySensors& r) {
+    printf("%lu,%lu", (unsigned long)r.sequence, (unsigned long)r.timestamp_us);
+    for(int ch = 0; ch < LDR_CHANNELS; ch++) {
+        printf(",%u", r.ldr[ch]);
+    }
+    printf(",%u,0x%02x,", r.ir, r.valid);
+    if(r.distance_mm != TELEMETRY_NO_DISTANCE) {
+        printf("%.1f", r.distance_mm / 10.0);
+    }
+    printf(",%u,%u\n", r.directive, r.age_us);
+}
+
+int main(int argc, char** argv) {
+    FILE* in = stdin;
+    FILE* bbx = NULL;
+    FILE* log = stderr;
+    const char* in_path = NULL;
+    static MirrorView view;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-b") == 0 && i + 1 < argc && bbx == NULL) {
+            bbx = fopen(argv[++i], "wb");
+            if(bbx == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            view.prefix = argv[++i];
+        } else if(strcmp(argv[i], "-l") == 0 && i + 1 < argc && log == stderr) {
+            log = fopen(argv[++i], "w");
+            if(log == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else if(argv[i][0] != '-' && in_path == NULL) {
+            in_path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [-b blackbox_file] [-m ppm_prefix] [-l log_file] [capture_file]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(in_path != NULL) {
+        in = fopen(in_path, "rb");
+        if(in == NULL) {
+            perror(in_path);
+            return 1;
+        }
+    }
+
+    printf("sequence,timestamp_us,a0,a1,a2,a3,a4,a5,ir,valid,distance_cm,directive,age_us\n");
+
+    DecodeStats st;
+    memset(&st, 0, sizeof(st));
+    uint8_t frame[DECODE_FRAME_MAX];
+    uint8_t raw[DECODE_FRAME_MAX];
+    size_t len = 0;
+    bool overflow = false;
+    bool have_seq = false;
+    uint32_t last_seq = 0;
+    static BlockAssembly assembly;
+
+    int c;
+    while((c = fgetc(in)) != EOF) {
+        if(c != 0) {
+            if(len < sizeof(frame)) {
+                frame[len++] = (uint8_t)c;
+            } else {
+                overflow = true;
+            }
+            continue;
+        }
+
+        // Delimiter: decode what came before it
+        if(len == 0) {
+            continue;
+        }
+        TelemetrySensors r;
+        size_t n = overflow ? 0 : cobs_decode(frame, len, raw);
+        len = 0;
+        overflow = false;
+        if(n != 0 && telemetry_type(raw, n) == TELEMETRY_RECORD_BLACKBOX) {
+            TelemetryChunk c;
+            if(telemetry_unpack_chunk(raw, n, &c) == TELEMETRY_OK) {
+                take_chunk(c, &assembly, bbx, &st);
+                continue;
+            }
+        }
+        if(n != 0 && telemetry_type(raw, n) == TELEMETRY_RECORD_MIRROR) {
+            TelemetryMirror m;
+            if(telemetry_unpack_mirror(raw, n, &m) == TELEMETRY_OK) {
+                take_mirror(m, &view, &st);
+                continue;
+            }
+        }
+        if(n != 0 && telemetry_type(raw, n) == TELEMETRY_RECORD_LOG) {
+            TelemetryLog l;
+            if(telemetry_unpack_log(raw, n, &l) == TELEMETRY_OK) {
+                st.logs++;
+                print_log(l, log);
+                continue;
+            }
+        }
+        int rc = (n == 0) ? TELEMETRY_ERR_LENGTH : telemetry_unpack(raw, n, &r);
+
+        if(rc == TELEMETRY_ERR_VERSION || rc == TELEMETRY_ERR_TYPE) {
+            st.unknown++;
+            continue;
+        }
+        if(rc != TELEMETRY_OK) {
+            st.bad_frames++;
+            continue;
+        }
+
+        // A sequence restart (firmware reset) is not a gap
+        if(have_seq && r.sequence > last_seq + 1) {
+            st.gaps += r.sequence - last_seq - 1;
+        }
+        have_seq = true;
+        last_seq = r.sequence;
+        st.records++;
+        print_record(r);
+    }
+
+    if(in != stdin) {
+        fclose(in);
+    }
+    if(bbx != NULL) {
+        fclose(bbx);
+    }
+    if(log != stderr) {
+        fclose(log);
+    }
+    fprintf(stderr, "telemetry_decode: %lu records, %lu missing, %lu bad frames, %lu unknown, %lu log lines\n",
+            st.records, st.gaps, st.bad_frames, st.unknown, st.logs);
+    if(st.blocks != 0 || st.broken != 0) {
+        fprintf(stderr, "telemetry_decode: %lu black-box blocks%s, %lu broken\n",
+                st.blocks, bbx != NULL ? " written" : "", st.broken);
+    }
+    if(st.frames != 0 || st.tiles != 0) {
+        fprintf(stderr, "telemetry_decode: %lu mirror frames%s from %lu tiles, %lu torn\n",
+                st.frames, view.prefix != NULL ? " written" : "", st.tiles, st.torn);
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// ==================== ULTRASONIC CHECK ====================
+// Checks the HC-SR04 ranging (ultrasonic.h) against its timeouts and its
+// 2-400 cm limits, exiting 1 on any mismatch. Two parts:
+//  - decoder: EchoTracker driven with scripted edge times, early in the
+//    clock and straddling the 32-bit us_ticker wrap. No rise before
+//    US_ECHO_TIMEOUT_US is NO_ECHO; an echo high past it (timed out, or a
+//    late fall) is ECHO_TOO_LONG; whole-microsecond pulses just outside
+//    2 cm and 400 cm are OUT_OF_RANGE, the ones just inside are OK;
+//  - ranger: UltrasonicRanger on the simulated pins, its Ticker, Timeout
+//    and InterruptIn wiring included, answered by a fake HC-SR04 that
+//    raises the echo after each trigger. One measurement per case.
+//
+//   ultrasonic_check
+
+#include "mbed.h"
+#include "ultrasonic.h"
+#include <math.h>
+#include <stdio.h>
+
+#define CHECK_ECHO_DELAY_US     200         // Trigger to rise, decoder and fake sensor
+#define CHECK_WRAP_START_US     0xFFFFFF00U // Trigger just before the wrap
+#define CHECK_TRIG_PIN          D6          // As wired on the board
+#define CHECK_ECHO_PIN          D5
+#define CHECK_PERIOD_MS         60
+#define CHECK_LISTEN_MS         45          // After a trigger; past both timeouts
+
+static const char* status_name(uint8_t status) {
+    switch(status) {
+    case US_STATUS_OK:            return "OK";
+    case US_STATUS_NO_ECHO:       return "NO_ECHO";
+    case US_STATUS_ECHO_TOO_LONG: return "ECHO_TOO_LONG";
+    case US_STATUS_OUT_OF_RANGE:  return "OUT_OF_RANGE";
+    default:                      return "?";
+    }
+}
+
+static uint32_t check_failures = 0;
+
+static void report(const char* name, uint32_t count, const UltrasonicMeasurement& m, uint8_t status) {
+    bool ok = count == 1 && m.status == status;
+    if(ok) {
+        ok = (status == US_STATUS_OK) ? m.distance_cm >= US_MIN_RANGE_CM && m.distance_cm <= US_MAX_RANGE_CM
+                                      : m.distance_cm < 0.0f;
+    }
+    printf("%-26s %-13s x%u  %4s", name, count ? status_name(m.status) : "none", count, ok ? "ok" : "FAIL");
+    if(count && m.status == US_STATUS_OK) {
+        printf("  %.3f cm", m.distance_cm);
+    }
+    printf("\n");
+    if(!ok) {
+        check_failures++;
+    }
+}
+
+// ==================== DECODER ====================
+static void expect(const char* name, const EchoTracker& t, uint8_t status) {
+    UltrasonicMeasurement m;
+    uint32_t count = t.latest(&m) ? m.sequence : 0;
+    if(t.busy()) {
+        count = 0;
+    }
+    report(name, count, m, status);
+}
+
+// Trigger at t0 and an echo pulse_us wide; the fall comes before any poll
+static void check_pulse(const char* name, uint32_t t0, uint32_t pulse_us, uint8_t status) {
+    EchoTracker t;
+    t.arm(t0);
+    t.echo_rise(t0 + CHECK_ECHO_DELAY_US);
+    t.echo_fall(t0 + CHECK_ECHO_DELAY_US + pulse_us);
+    expect(name, t, status);
+}
+
+static void check_no_echo(uint32_t t0) {
+    EchoTracker t;
+    t.arm(t0);
+    if(t.poll(t0 + US_ECHO_TIMEOUT_US - 1)) {
+        printf("no echo: timed out early\n");
+        check_failures++;
+    }
+    t.poll(t0 + US_ECHO_TIMEOUT_US);
+    t.echo_rise(t0 + US_ECHO_TIMEOUT_US + 10);    // Too late: ignored
+    expect("no rise before timeout", t, US_STATUS_NO_ECHO);
+}
+
+static void check_stuck_high(uint32_t t0) {
+    EchoTracker t;
+    uint32_t rise = t0 + CHECK_ECHO_DELAY_US;
+    t.arm(t0);
+    t.echo_rise(rise);
+    if(t.poll(rise + US_ECHO_TIMEOUT_US - 1)) {
+        printf("stuck high: timed out early\n");
+        check_failures++;
+    }
+    t.poll(rise + US_ECHO_TIMEOUT_US);
+    expect("echo high past timeout", t, US_STATUS_ECHO_TOO_LONG);
+}
+
+// ==================== RANGER ON FAKE PINS ====================
+static uint32_t              fake_pulse_us = 0;     // 0: the echo never rises
+static uint32_t              ranger_count = 0;
+static UltrasonicMeasurement ranger_result;
+
+static void fake_on_trigger(int level) {
+    if(level != 0 || fake_pulse_us == 0) {
+        return;
+    }
+    uint64_t rise_at = sim_now_us() + CHECK_ECHO_DELAY_US;
+    sim_schedule(rise_at, []() { sim_pin_set(CHECK_ECHO_PIN, 1); });
+    sim_schedule(rise_at + fake_pulse_us, []() { sim_pin_set(CHECK_ECHO_PIN, 0); });
+}
+
+static void ranger_on_result(const UltrasonicMeasurement& m) {
+    ranger_result = m;
+    ranger_count++;
+}
+
+// One trigger from the ranger's own Ticker, then listen until both phases
+// would have timed out
+static void check_ranger(const char* name, uint32_t pulse_us, uint8_t status) {
+    fake_pulse_us = pulse_us;
+    ranger_count = 0;
+    UltrasonicRanger ranger(CHECK_TRIG_PIN, CHECK_ECHO_PIN);
+    ranger.attach(ranger_on_result);
+    ranger.start(CHECK_PERIOD_MS);
+    sim_advance_us((CHECK_PERIOD_MS + CHECK_LISTEN_MS) * 1000ULL);
+    ranger.stop();
+    sim_advance_us(CHECK_PERIOD_MS * 1000ULL);     // Leftover echo edges land unheard
+    report(name, ranger_count, ranger_result, status);
+}
+
+int main() {
+    printf("==================== ULTRASONIC CHECK ====================\n");
+    printf("%.0f-%.0f cm at %.5f cm/us, %u us timeout per phase\n\n", US_MIN_RANGE_CM, US_MAX_RANGE_CM,
+           US_CM_PER_US, US_ECHO_TIMEOUT_US);
+
+    // Whole-microsecond pulses either side of the limits
+    uint32_t min_us = (uint32_t)ceil(US_MIN_RANGE_CM / US_CM_PER_US);
+    uint32_t max_us = (uint32_t)floor(US_MAX_RANGE_CM / US_CM_PER_US);
+    const uint32_t starts[] = {1000, CHECK_WRAP_START_US};
+
+    for(uint32_t t0 : starts) {
+        printf("decoder, clock from %08x\n", t0);
+        check_no_echo(t0);
+        check_stuck_high(t0);
+        check_pulse("fall after timeout", t0, US_ECHO_TIMEOUT_US + 1, US_STATUS_ECHO_TOO_LONG);
+        check_pulse("just under 2 cm", t0, min_us - 1, US_STATUS_OUT_OF_RANGE);
+        check_pulse("2 cm", t0, min_us, US_STATUS_OK);
+        check_pulse("400 cm", t0, max_us, US_STATUS_OK);
+        check_pulse("just over 400 cm", t0, max_us + 1, US_STATUS_OUT_OF_RANGE);
+    }
+
+    printf("ranger on D%d/D%d\n", CHECK_TRIG_PIN - D0, CHECK_ECHO_PIN - D0);
+    sim_reset();
+    sim_pin_listen(CHECK_TRIG_PIN, &fake_pulse_us, fake_on_trigger);
+    check_ranger("no echo", 0, US_STATUS_NO_ECHO);
+    check_ranger("echo high 35 ms", 35000, US_STATUS_ECHO_TOO_LONG);
+    check_ranger("1.7 cm", 100, US_STATUS_OUT_OF_RANGE);
+    check_ranger("401 cm", 23382, US_STATUS_OUT_OF_RANGE);
+    check_ranger("100 cm", 5831, US_STATUS_OK);
+    sim_pin_listen(CHECK_TRIG_PIN, &fake_pulse_us, sim_pin_fn());
+
+    if(check_failures) {
+        printf("\n%u failures\n", check_failures);
+    }
+    return check_failures ? 1 : 0;
+}